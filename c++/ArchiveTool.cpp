@@ -0,0 +1,145 @@
+/**
+ * @file        ArchiveTool.cpp
+ * @brief       Command line tool to convert recordings into archives and back.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * obp_archive file.dat|file.obp ...    converts each text file or binary recording into file.obz next to it and
+ *                                      prints the compression ratio.
+ * obp_archive -x file.obz              prints the archive as text with tab separated columns to stdout.
+ * The sampling rate of the text files can be set with -r rate before the files, the default is SAMPLING_RATE. Binary
+ * recordings have their own sampling rate in the header.
+ */
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <plog/Init.h>
+#include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include "common.h"
+#include "RecordingArchive.h"
+#include "RecordingReader.h"
+
+/**
+ * Gets the size of a file.
+ * @param fileName The name of the file.
+ * @return The size in bytes, 0 if the file does not exist.
+ */
+static size_t getFileSize(const std::string &fileName)
+{
+    struct stat status{};
+    return stat(fileName.c_str(), &status) == 0 ? (size_t) status.st_size : 0;
+}
+
+/**
+ * Prints an archive as text. The values are printed in the shortest form that reads back the same, which is the
+ * form of the original text file unless it had trailing zeros.
+ * @param fileName The name of the archive.
+ * @return False if the archive could not be read.
+ */
+static bool extract(const std::string &fileName)
+{
+    RecordingArchive archive(fileName);
+    if (!archive.isOpen())
+    {
+        return false;
+    }
+    const ArchiveHeader &header = archive.getHeader();
+    std::vector<std::vector<double>> channels(header.channels, std::vector<double>(header.blockSize));
+    std::string line;
+    char number[32];
+    for (size_t block = 0; block < archive.getBlockCount(); ++block)
+    {
+        size_t count = 0;
+        for (size_t channel = 0; channel < header.channels; ++channel)
+        {
+            count = archive.decodeBlock(channel, block, channels[channel].data());
+            if (count == 0)
+            {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            line.clear();
+            for (size_t channel = 0; channel < header.channels; ++channel)
+            {
+                const auto result = std::to_chars(number, number + sizeof(number), channels[channel][i]);
+                line.append(number, result.ptr);
+                line.push_back(channel + 1 < header.channels ? '\t' : '\n');
+            }
+            std::fwrite(line.data(), 1, line.size(), stdout);
+        }
+    }
+    return true;
+}
+
+/**
+ * Converts a text file or a binary recording into an archive with the extension ARCHIVE_EXTENSION and prints the
+ * result.
+ * @param fileName The name of the text file or binary recording.
+ * @param samplingRate The sampling rate of a text file in Hz.
+ * @return False if the file could not be converted.
+ */
+static bool convert(const std::string &fileName, double samplingRate)
+{
+    const size_t dot = fileName.find_last_of('.');
+    const size_t slash = fileName.find_last_of('/');
+    const std::string base = dot != std::string::npos && (slash == std::string::npos || dot > slash) ?
+                             fileName.substr(0, dot) : fileName;
+    const std::string archiveName = base + ARCHIVE_EXTENSION;
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool converted = RecordingReader::isRecording(fileName) ?
+                           RecordingArchive::convertRecording(fileName, archiveName) :
+                           RecordingArchive::convertText(fileName, archiveName, samplingRate);
+    if (!converted)
+    {
+        std::cerr << fileName << ": conversion failed" << std::endl;
+        return false;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t fileSize = getFileSize(fileName);
+    const size_t archiveSize = getFileSize(archiveName);
+    std::cout << fileName << " -> " << archiveName << ": " << fileSize << " -> " << archiveSize << " bytes, ratio "
+              << (double) fileSize / (double) std::max<size_t>(archiveSize, 1) << ", " << seconds << " s" << std::endl;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    static plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender);
+
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [-r samplingRate] file.dat|file.obp ...\n"
+                  << "       " << argv[0] << " -x file" << ARCHIVE_EXTENSION << std::endl;
+        return 2;
+    }
+    if (std::strcmp(argv[1], "-x") == 0)
+    {
+        return argc == 3 && extract(argv[2]) ? 0 : 1;
+    }
+
+    double samplingRate = SAMPLING_RATE;
+    int ret = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            samplingRate = std::stod(argv[++i]);
+        } else if (!convert(argv[i], samplingRate))
+        {
+            ret = 1;
+        }
+    }
+    return ret;
+}
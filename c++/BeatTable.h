@@ -0,0 +1,191 @@
+/**
+ * @file        BeatTable.h
+ * @brief       The header file of the BeatTable and Envelope classes.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines and implements the BeatTable and Envelope classes and contains the general class descriptions.
+ */
+#ifndef OBP_BEATTABLE_H
+#define OBP_BEATTABLE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Class dependant configuration values:
+ */
+#define BEAT_TABLE_CAPACITY 1024 //!< Maximal number of beats per measurement. Peaks closer than the minimal peak
+//!< time replace each other, so 5 min of data at 1 kHz and 300 ms peak distance fill at most 1000 rows.
+#define ENVELOPE_CAPACITY   (2 * BEAT_TABLE_CAPACITY) //!< Two envelope points are calculated per beat.
+
+/**
+ * Enum to describe the state of a beat in the BeatTable.
+ */
+enum class BeatType : uint8_t
+{
+    Unconfirmed,    //!< The peak was detected, but there is no previous peak to validate the heart rate with.
+    Valid,          //!< The heart rate to the previous peak is within the valid bounds.
+    Artifact,       //!< The peak does not fit the rhythm or the amplitude of the beats before, it is ignored.
+};
+
+//! The BeatTable class stores the detected beats of one measurement.
+/*!
+ * Each row of the table represents one beat: the time (sample number) and amplitude of the oscillation peak, the
+ * time and amplitude of the trough that follows the peak (the minimum between this peak and the next one), the
+ * heart rate calculated from the distance to the previous peak and the type of the beat. Artifacts stay in the table
+ * so the rows keep their order, but they are skipped by the analyses. The data is stored as a
+ * structure of arrays, so every column is contiguous in memory and can be passed to an analysis as a whole.
+ *
+ * The capacity is fixed at compile time, the table never allocates memory and a row index stays valid until the
+ * table is cleared. As the class is trivially copyable, it can be written to and read from a file as a whole.
+ */
+class BeatTable {
+
+public:
+    /**
+     * Removes all beats from the table.
+     */
+    void clear() {
+        nBeats = 0;
+        nTroughs = 0;
+    }
+
+    /**
+     * Adds a new beat with the given peak to the end of the table.
+     * @param time The sample number of the peak.
+     * @param amplitude The amplitude of the peak.
+     * @return False if the table is full and the beat could not be added.
+     */
+    bool addBeat(size_t time, double amplitude) {
+        if (nBeats == BEAT_TABLE_CAPACITY) {
+            return false;
+        }
+        peakTimes[nBeats] = time;
+        peakAmps[nBeats] = amplitude;
+        heartRates[nBeats] = 0.0;
+        types[nBeats] = BeatType::Unconfirmed;
+        nBeats++;
+        return true;
+    }
+
+    /**
+     * Replaces the peak of an existing beat.
+     * @param beat The index of the beat.
+     * @param time The new sample number of the peak.
+     * @param amplitude The new amplitude of the peak.
+     */
+    void setPeak(size_t beat, size_t time, double amplitude) {
+        peakTimes[beat] = time;
+        peakAmps[beat] = amplitude;
+    }
+
+    /**
+     * Sets the trough following the peak of a beat. Troughs are set in order, setting the trough of a beat that
+     * already has one replaces it.
+     * @param beat The index of the beat.
+     * @param time The sample number of the trough.
+     * @param amplitude The amplitude of the trough.
+     */
+    void setTrough(size_t beat, size_t time, double amplitude) {
+        troughTimes[beat] = time;
+        troughAmps[beat] = amplitude;
+        if (beat >= nTroughs) {
+            nTroughs = beat + 1;
+        }
+    }
+
+    /**
+     * Sets the heart rate calculated from the distance of the peak to the previous one and the type of the beat.
+     * @param beat The index of the beat.
+     * @param heartRate The heart rate in bpm.
+     * @param type The new type of the beat.
+     */
+    void setHeartRate(size_t beat, double heartRate, BeatType type) {
+        heartRates[beat] = heartRate;
+        types[beat] = type;
+    }
+
+    // Typed accessors:
+    [[nodiscard]] size_t size() const { return nBeats; }
+    [[nodiscard]] size_t troughCount() const { return nTroughs; }
+    [[nodiscard]] bool empty() const { return nBeats == 0; }
+    [[nodiscard]] bool full() const { return nBeats == BEAT_TABLE_CAPACITY; }
+    [[nodiscard]] size_t peakTime(size_t beat) const { return peakTimes[beat]; }
+    [[nodiscard]] double peakAmplitude(size_t beat) const { return peakAmps[beat]; }
+    [[nodiscard]] size_t troughTime(size_t beat) const { return troughTimes[beat]; }
+    [[nodiscard]] double troughAmplitude(size_t beat) const { return troughAmps[beat]; }
+    [[nodiscard]] double heartRate(size_t beat) const { return heartRates[beat]; }
+    [[nodiscard]] BeatType type(size_t beat) const { return types[beat]; }
+
+    // Column access for analyses over all beats:
+    [[nodiscard]] const size_t *peakTimeColumn() const { return peakTimes.data(); }
+    [[nodiscard]] const double *peakAmplitudeColumn() const { return peakAmps.data(); }
+    [[nodiscard]] const size_t *troughTimeColumn() const { return troughTimes.data(); }
+    [[nodiscard]] const double *troughAmplitudeColumn() const { return troughAmps.data(); }
+    [[nodiscard]] const double *heartRateColumn() const { return heartRates.data(); }
+    [[nodiscard]] const BeatType *typeColumn() const { return types.data(); }
+
+private:
+    size_t nBeats = 0;                                       //!< Number of beats (rows) in the table.
+    size_t nTroughs = 0;                                     //!< Number of beats that have a trough set.
+    std::array<size_t, BEAT_TABLE_CAPACITY> peakTimes{};     //!< Sample numbers of the peaks.
+    std::array<double, BEAT_TABLE_CAPACITY> peakAmps{};      //!< Amplitudes of the peaks.
+    std::array<size_t, BEAT_TABLE_CAPACITY> troughTimes{};   //!< Sample numbers of the troughs after the peaks.
+    std::array<double, BEAT_TABLE_CAPACITY> troughAmps{};    //!< Amplitudes of the troughs after the peaks.
+    std::array<double, BEAT_TABLE_CAPACITY> heartRates{};    //!< Heart rate from the previous peak in bpm.
+    std::array<BeatType, BEAT_TABLE_CAPACITY> types{};       //!< The type of each beat.
+};
+
+//! The Envelope class stores the points of the oscillometric waveform envelope (OMWE).
+/*!
+ * The points are stored as two contiguous columns of time (sample number) and amplitude with a fixed capacity. Like
+ * the BeatTable, the Envelope never allocates memory and is trivially copyable.
+ */
+class Envelope {
+
+public:
+    /**
+     * Removes all points from the envelope.
+     */
+    void clear() {
+        nPoints = 0;
+    }
+
+    /**
+     * Adds a point to the end of the envelope.
+     * @param time The sample number of the point.
+     * @param amplitude The amplitude of the envelope at that time.
+     * @return False if the envelope is full and the point could not be added.
+     */
+    bool addPoint(size_t time, double amplitude) {
+        if (nPoints == ENVELOPE_CAPACITY) {
+            return false;
+        }
+        times[nPoints] = time;
+        amps[nPoints] = amplitude;
+        nPoints++;
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const { return nPoints; }
+    [[nodiscard]] bool empty() const { return nPoints == 0; }
+    [[nodiscard]] size_t time(size_t point) const { return times[point]; }
+    [[nodiscard]] double amplitude(size_t point) const { return amps[point]; }
+    [[nodiscard]] const size_t *timeColumn() const { return times.data(); }
+    [[nodiscard]] const double *amplitudeColumn() const { return amps.data(); }
+
+private:
+    size_t nPoints = 0;                                  //!< Number of points in the envelope.
+    std::array<size_t, ENVELOPE_CAPACITY> times{};       //!< Sample numbers of the envelope points.
+    std::array<double, ENVELOPE_CAPACITY> amps{};        //!< Amplitudes of the envelope points.
+};
+
+static_assert(std::is_trivially_copyable_v<BeatTable>, "BeatTable has to be serializable as a whole.");
+static_assert(std::is_trivially_copyable_v<Envelope>, "Envelope has to be serializable as a whole.");
+
+#endif //OBP_BEATTABLE_H
@@ -0,0 +1,152 @@
+/**
+ * @file        BlockWriter.h
+ * @brief       The header file of the BlockWriter class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines and implements the BlockWriter class template and contains the general class description.
+ */
+#ifndef OBP_BLOCKWRITER_H
+#define OBP_BLOCKWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include "CppThread.h"
+
+//! The BlockWriter class is a writer thread that does the jobs handed to it one after the other.
+/*!
+ * The recordings are written by a writer thread, so the acquisition thread does not wait for the formatting and the
+ * file system. The owner hands jobs (a block of samples to append, a file to open or close, ...) to the BlockWriter
+ * with add(), which only moves the job into a queue and returns. The writer thread takes the jobs from the queue in
+ * the order they were added and calls the write function of the owner for each of them, without holding the lock.
+ *
+ * The buffers of the jobs are reused, so no memory is allocated once they have grown: add() takes a function that is
+ * called under the lock before the job is queued, it swaps the buffer of the job with a spare one of the owner. After
+ * a job is written, the recycle function is called under the lock and returns the buffers of the job to the spare
+ * ones. The spare buffers are therefore only touched in these two functions.
+ *
+ * waitForDone() blocks until all jobs are written. The destructor, or stop(), writes all pending jobs and stops the
+ * writer thread; an owner whose write function uses its members has to call stop() in its destructor.
+ *
+ * @tparam Job The job, has to be movable.
+ */
+template<typename Job>
+class BlockWriter final : public CppThread {
+
+public:
+    using WriteFunction = std::function<void(Job &job)>;    //!< Writes a job, called from the writer thread.
+    using RecycleFunction = std::function<void(Job &job)>;  //!< Takes back the buffers of a written job.
+
+    /**
+     * Constructor of the BlockWriter, starts the writer thread.
+     * @param write The function that writes a job, called from the writer thread without the lock.
+     * @param recycle The function that takes back the buffers of a written job, called under the lock, may be empty.
+     */
+    explicit BlockWriter(WriteFunction write, RecycleFunction recycle = nullptr) :
+            write(std::move(write)), recycle(std::move(recycle)) {
+        start();
+    }
+
+    /**
+     * Destructor of the BlockWriter. Writes all pending jobs and stops the writer thread.
+     */
+    ~BlockWriter() override {
+        stop();
+    }
+
+    BlockWriter(const BlockWriter &) = delete;
+    BlockWriter &operator=(const BlockWriter &) = delete;
+
+    /**
+     * Hands a job to the writer thread.
+     * @param job The job, it is moved into the queue.
+     */
+    void add(Job &job) {
+        add(job, [](Job &) {});
+    }
+
+    /**
+     * Hands a job to the writer thread after preparing it under the lock.
+     * @param job The job, it is moved into the queue.
+     * @param prepare Called with the job under the lock, e.g. to swap its buffer with a spare one.
+     */
+    template<typename Prepare>
+    void add(Job &job, Prepare prepare) {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            prepare(job);
+            jobs.push_back(std::move(job));
+        }
+        jobAdded.notify_one();
+    }
+
+    /**
+     * Blocks until all jobs handed to the writer thread are written.
+     */
+    void waitForDone() {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobDone.wait(lock, [this] { return jobs.empty() && !bWriting; });
+    }
+
+    /**
+     * Writes all pending jobs and stops the writer thread. Jobs added afterwards are not written.
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            if (bStopWriter) {
+                return;
+            }
+            bStopWriter = true;
+        }
+        jobAdded.notify_one();
+        join();
+    }
+
+protected:
+    /**
+     * The writer thread. Writes the jobs one after the other and recycles their buffers. Returns when it is told to
+     * stop and no jobs are pending.
+     */
+    void run() override {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        while (true) {
+            jobAdded.wait(lock, [this] { return !jobs.empty() || bStopWriter; });
+            if (jobs.empty()) {
+                break;
+            }
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            bWriting = true;
+
+            // The write function may hand new jobs to the writer, so it is called without the lock.
+            lock.unlock();
+            write(job);
+            lock.lock();
+
+            if (recycle) {
+                recycle(job);
+            }
+            bWriting = false;
+            jobDone.notify_all();
+        }
+    }
+
+private:
+    WriteFunction write;                        //!< Writes a job.
+    RecycleFunction recycle;                    //!< Takes back the buffers of a written job.
+    std::mutex jobMutex;                        //!< Protects the queue and the spare buffers of the owner.
+    std::condition_variable jobAdded;           //!< Wakes the writer thread when a job is added or it has to stop.
+    std::condition_variable jobDone;            //!< Wakes waitForDone() when the writer thread finished a job.
+    std::deque<Job> jobs;                       //!< The jobs waiting for the writer thread.
+    bool bWriting = false;                      //!< True while the writer thread writes a job.
+    bool bStopWriter = false;                   //!< Tells the writer thread to stop once all jobs are written.
+};
+
+
+#endif //OBP_BLOCKWRITER_H
@@ -165,7 +165,37 @@ int ComediHandler::getRawSample() {
  * @return The data sample in voltage.
  */
 double ComediHandler::getVoltageSample(){
-    return comedi_to_phys(readRawSample(), crange, maxdata);
+    return toVoltage(readRawSample());
+}
+
+/**
+ * Transforms a raw data sample into voltage.
+ * @param rawSample The raw data sample from getRawSample().
+ * @return The data sample in voltage.
+ */
+double ComediHandler::toVoltage(int rawSample) {
+    return comedi_to_phys(rawSample, crange, maxdata);
+}
+
+/**
+ * @return The largest raw data sample of the device.
+ */
+unsigned ComediHandler::getMaxData() const {
+    return maxdata;
+}
+
+/**
+ * @return The voltage of the raw data sample 0.
+ */
+double ComediHandler::getRangeMin() const {
+    return crange->min;
+}
+
+/**
+ * @return The voltage of the largest raw data sample, see getMaxData().
+ */
+double ComediHandler::getRangeMax() const {
+    return crange->max;
 }
 
 /**
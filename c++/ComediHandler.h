@@ -40,6 +40,10 @@ public:
     int getBufferContents();
     int getRawSample();
     double getVoltageSample();
+    double toVoltage(int rawSample);
+    unsigned getMaxData() const;
+    double getRangeMin() const;
+    double getRangeMax() const;
 
 private:
 
@@ -0,0 +1,132 @@
+/**
+ * @file        ConfigChannel.h
+ * @brief       The header file of the ConfigChannel class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines and implements the ConfigChannel class template and contains the general class description.
+ */
+#ifndef OBP_CONFIGCHANNEL_H
+#define OBP_CONFIGCHANNEL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//! The ConfigChannel class hands configuration values from one thread to another.
+/*!
+ * The configuration is a plain struct that is published by one thread (usually the UI) and picked up by another
+ * thread (usually the processing thread) as a consistent copy. The channel is implemented as a sequence lock: the
+ * writer makes the sequence number odd while it changes the data and even again when it is done. A reader copies the
+ * data and retries if the sequence number was odd or changed in the meantime. The data itself is stored in atomic
+ * words, so concurrent reading and writing is free of data races. Neither side ever blocks on a mutex or allocates
+ * memory. Writers are serialised against each other.
+ *
+ * The reader is expected to take a snapshot at a well-defined point (e.g. at the start of a measurement) and work
+ * with that plain copy afterwards, so the hot path never touches the channel.
+ *
+ * @tparam T The configuration struct, has to be trivially copyable.
+ */
+template<typename T>
+class ConfigChannel {
+    static_assert(std::is_trivially_copyable_v<T>, "The configuration has to be trivially copyable.");
+
+public:
+    /**
+     * Constructor of the ConfigChannel, publishes the initial configuration.
+     * @param initial The initial configuration.
+     */
+    explicit ConfigChannel(const T &initial = T()) {
+        store(initial);
+    }
+
+    /**
+     * Takes a consistent copy of the currently published configuration. Can be called from any thread.
+     * @return The current configuration.
+     */
+    T snapshot() const {
+        std::array<uint64_t, nWords> buffer;
+        uint64_t seqBefore;
+        uint64_t seqAfter;
+        do {
+            seqBefore = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < nWords; ++i) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            seqAfter = sequence.load(std::memory_order_relaxed);
+        } while ((seqBefore & 1u) || seqBefore != seqAfter);
+
+        T config;
+        std::memcpy(static_cast<void *>(&config), buffer.data(), sizeof(T));
+        return config;
+    }
+
+    /**
+     * Publishes a new configuration. Can be called from any thread.
+     * @param config The new configuration.
+     */
+    void publish(const T &config) {
+        update([&config](T &current) { current = config; });
+    }
+
+    /**
+     * Changes the currently published configuration (read-copy-update). Can be called from any thread.
+     * @param modify A callable that gets a reference to a copy of the current configuration to change.
+     */
+    template<typename Modifier>
+    void update(Modifier modify) {
+        // Acquire the write side by making the sequence number odd.
+        uint64_t seq = sequence.load(std::memory_order_relaxed);
+        do {
+            seq &= ~uint64_t(1);
+        } while (!sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                                 std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::array<uint64_t, nWords> buffer;
+        for (size_t i = 0; i < nWords; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        T config;
+        std::memcpy(static_cast<void *>(&config), buffer.data(), sizeof(T));
+        modify(config);
+        store(config);
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * Gets the number of configurations published so far. Can be used to check cheaply if the configuration changed
+     * since the last snapshot.
+     * @return The version of the configuration.
+     */
+    [[nodiscard]] uint64_t version() const {
+        return sequence.load(std::memory_order_acquire) >> 1u;
+    }
+
+private:
+    static constexpr size_t nWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t); //!< Size in words.
+
+    /**
+     * Stores the configuration in the atomic words. Only to be called by the writer.
+     * @param config The configuration to store.
+     */
+    void store(const T &config) {
+        std::array<uint64_t, nWords> buffer{};
+        std::memcpy(buffer.data(), &config, sizeof(T));
+        for (size_t i = 0; i < nWords; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> sequence{0};                  //!< The sequence number, odd while a writer is active.
+    std::array<std::atomic<uint64_t>, nWords> words{};  //!< The configuration data.
+};
+
+
+#endif //OBP_CONFIGCHANNEL_H
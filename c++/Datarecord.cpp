@@ -7,19 +7,25 @@
  *
  */
 
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
 #include <QtCore/QTextStream>
 #include <QtWidgets/QFileDialog>
 #include "Datarecord.h"
+#include "MeasurementIndex.h"
 
 /**
- * Constructor to prepare recording of data at a later point.
+ * Constructor to prepare recording of data at a later point. Starts the writer thread.
  * @param samplingRate The sampling rate at which the data will be recorded.
  */
-Datarecord::Datarecord(double samplingRate)
+Datarecord::Datarecord(double samplingRate) :
+        writer([this](WriteJob &job) { writeJob(job); }, [this](WriteJob &job) { recycleJob(job); })
 {
     nsample = 0;
     this->samplingRate = samplingRate;
     boRecord = false;
+    block.reserve(RECORDING_STREAM_BLOCK);
 }
 
 //
@@ -28,72 +34,399 @@ Datarecord::Datarecord(double samplingRate)
  * @param filename The filename to record data with.
  * @param samplingRate The sampling rate at which the data will be recorded.
  */
-Datarecord::Datarecord(QString filename, double samplingRate) // = "default.dat")
+Datarecord::Datarecord(QString filename, double samplingRate) : Datarecord(samplingRate) // = "default.dat")
 {
-    rec_filename = filename;
-    if (!rec_filename.isNull()) {
-        rec_file = new QFile(rec_filename);
-        if (rec_file->open(QIODevice::WriteOnly | QFile::Truncate)) {
-            outStream = new QTextStream(rec_file);
-        }
-    }
-    nsample = 0;
-    this->samplingRate = samplingRate;
-    boRecord = true;
+    startRecording(filename);
 }
 /**
- * Destructor of Datarecord. Save the file if there is one open.
+ * Destructor of Datarecord. Finishes the recording if there is one, writes all pending vectors and stops the writer
+ * thread.
  */
 Datarecord::~Datarecord() {
-    if (rec_file) {
-        rec_file->close();
-    }
+    stopRecording();
+    writer.stop();
 };
 
 /**
- * Start storing data to a file. Opens file with the name specified by the parameter.
+ * Start storing data to a text file. The file is opened by the writer thread. A running recording is finished first.
  * @param filename The name of the file to open.
  */
 void Datarecord::startRecording(QString filename) {
+    stopRecording();
+    rec_filename = filename;
     if (!rec_filename.isNull()) {
-        rec_file = new QFile(rec_filename);
-        if (rec_file->open(QIODevice::WriteOnly)) {
-            outStream = new QTextStream(rec_file);
-            nsample = 0;
-            boRecord = true;
-        }
+        WriteJob job;
+        job.type = JobType::open;
+        job.fileName = rec_filename;
+        writer.add(job);
+        nsample = 0;
+        boRecord = true;
     }
 }
+
 /**
- * Stop storing data to a file. Closed the previously declared file.
+ * Start storing data to a binary file. The file is opened by the writer thread. A running recording is finished
+ * first.
+ * @param filename The name of the file to open, should end with RECORDING_EXTENSION.
+ * @param mmHgPerVolt The calibration the samples are converted from voltages with.
+ * @param ambientVoltage The voltage at ambient pressure.
+ */
+void Datarecord::startRecording(QString filename, double mmHgPerVolt, double ambientVoltage) {
+    stopRecording();
+    rec_filename = filename;
+    if (!rec_filename.isNull()) {
+        WriteJob job;
+        job.type = JobType::open;
+        job.fileName = rec_filename;
+        job.binary = true;
+        job.mmHgPerVolt = mmHgPerVolt;
+        job.ambientVoltage = ambientVoltage;
+        writer.add(job);
+        nsample = 0;
+        boRecord = true;
+    }
+}
+/**
+ * Stop storing data to a file. The remaining samples are written and the file is closed by the writer thread.
  */
 void Datarecord::stopRecording() {
+    WriteJob job;
+    finishRecording(job);
+}
+
+/**
+ * Stop storing data to a file and store the results of the measurement in the footer of a binary file. Text files
+ * have no footer, the results are ignored.
+ * @param results The footer with the results.
+ */
+void Datarecord::stopRecording(const RecordingFooter &results) {
+    WriteJob job;
+    job.hasResults = true;
+    job.results = results;
+    finishRecording(job);
+}
+
+/**
+ * Hands the remaining samples and the job to finish the file to the writer thread.
+ * @param job The job with the results, if any.
+ */
+void Datarecord::finishRecording(WriteJob &job) {
+    if (!boRecord) {
+        return;
+    }
+    if (!block.empty()) {
+        WriteJob append;
+        append.type = JobType::append;
+        addJob(append, block, spareBlocks);
+    }
+    job.type = JobType::close;
+    job.fileName = rec_filename;
+    writer.add(job);
     nsample = 0;
     boRecord = false;
-    if (rec_file) {
-        rec_file->close();
-    }
 }
+
 /**
- * Add a single sample to a file.
+ * Add a single sample to a file. The samples are handed to the writer thread in blocks.
  * @param sample The sample to add.
  */
 void Datarecord::addSample(double sample) {
-    if (!boRecord || !rec_file) {
+    if (!boRecord) {
         return;
     }
     nsample++;
-    *outStream << (float) nsample / samplingRate << "\t" << sample << "\n";
+    block.push_back(sample);
+    if (block.size() >= RECORDING_STREAM_BLOCK) {
+        WriteJob job;
+        job.type = JobType::append;
+        addJob(job, block, spareBlocks);
+    }
+}
+
+/**
+ * @return The number of samples added since the recording was started, 0 if there is none.
+ */
+long int Datarecord::getSampleCount() const {
+    return nsample;
 }
+
 /**
- * Save the content of a vector to a file.
+ * Save the content of a vector to a file in the writer thread. Returns immediately.
  * @param fileName The name of the file to store the data to.
- * @param samples  The vector to store to a file.
+ * @param samples  The vector to store to a file. Its content is taken over, it is empty afterwards.
+ */
+void Datarecord::saveAll(QString fileName, std::vector<double> &samples) {
+    WriteJob job;
+    job.fileName = std::move(fileName);
+    addJob(job, samples, spare);
+}
+
+/**
+ * Save the content of a vector to a binary file in the writer thread. Returns immediately.
+ * @param fileName The name of the file to store the data to, should end with RECORDING_EXTENSION.
+ * @param samples The vector to store to a file, in mmHg. Its content is taken over, it is empty afterwards.
+ * @param mmHgPerVolt The calibration the samples were converted from voltages with.
+ * @param ambientVoltage The voltage at ambient pressure.
+ */
+void Datarecord::saveBinary(QString fileName, std::vector<double> &samples, double mmHgPerVolt,
+                            double ambientVoltage) {
+    WriteJob job;
+    job.fileName = std::move(fileName);
+    job.binary = true;
+    job.mmHgPerVolt = mmHgPerVolt;
+    job.ambientVoltage = ambientVoltage;
+    addJob(job, samples, spare);
+}
+
+/**
+ * Appends an entry to the measurement index in the writer thread. Returns immediately.
+ * @param indexFile The name of the measurement index.
+ * @param entry The entry of the measurement.
+ */
+void Datarecord::addIndexEntry(QString indexFile, const IndexEntry &entry) {
+    WriteJob job;
+    job.type = JobType::index;
+    job.fileName = std::move(indexFile);
+    job.entry = entry;
+    writer.add(job);
+}
+
+/**
+ * Hands a job with samples to the writer thread.
+ * @param job The job without samples.
+ * @param samples The samples to write, swapped with a spare buffer.
+ * @param pool The spare buffers to take the buffer from.
  */
-void Datarecord::saveAll(QString fileName, std::vector<double> samples) {
-    startRecording(fileName);
-    for (auto sample : samples) {
-        addSample(sample);
+void Datarecord::addJob(WriteJob &job, std::vector<double> &samples, std::vector<std::vector<double>> &pool) {
+    writer.add(job, [&samples, &pool](WriteJob &added) {
+        if (!pool.empty()) {
+            added.samples.swap(pool.back());
+            pool.pop_back();
+        } else {
+            // Until the writer returned the first buffers, they have to be allocated.
+            added.samples.reserve(samples.capacity());
+        }
+        added.samples.swap(samples);
+    });
+}
+
+/**
+ * Sets the callback that is called from the writer thread after each file.
+ * @param callback The callback, replaces the previous one.
+ */
+void Datarecord::setOnSaved(SavedCallback callback) {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    onSaved = std::move(callback);
+}
+
+/**
+ * Blocks until all jobs handed to the writer thread are done.
+ */
+void Datarecord::waitForSaved() {
+    writer.waitForDone();
+}
+
+/**
+ * Does a job in the writer thread.
+ * @param job The job.
+ */
+void Datarecord::writeJob(WriteJob &job) {
+    SavedCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        callback = onSaved;
     }
-    stopRecording();
+    // The callback may use the Datarecord, so it is called without any lock.
+    switch (job.type) {
+        case JobType::save: {
+            const bool success = job.binary ? writeBinary(job) : write(job.fileName, job.samples);
+            if (callback) {
+                callback(job.fileName, success);
+            }
+            break;
+        }
+        case JobType::open:
+            openStream(job);
+            break;
+        case JobType::append:
+            appendStream(job);
+            break;
+        case JobType::close: {
+            const bool success = closeStream(job);
+            if (callback) {
+                callback(job.fileName, success);
+            }
+            break;
+        }
+        case JobType::index:
+            MeasurementIndex::append(job.fileName.toStdString(), job.entry);
+            break;
+    }
+}
+
+/**
+ * Keeps the buffer of a written job for later jobs, called by the writer thread under its lock.
+ * @param job The written job.
+ */
+void Datarecord::recycleJob(WriteJob &job) {
+    if (job.samples.capacity() > 0) {
+        job.samples.clear();
+        (job.type == JobType::append ? spareBlocks : spare).push_back(std::move(job.samples));
+    }
+}
+
+/**
+ * Writes a vector of samples to a file, one line with the time and the value per sample.
+ * @param fileName The name of the file to store the data to.
+ * @param samples The samples to store.
+ * @return False if the file could not be opened.
+ */
+bool Datarecord::write(const QString &fileName, const std::vector<double> &samples) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QFile::Truncate)) {
+        return false;
+    }
+    QTextStream stream(&file);
+    writeSamples(file, &stream, samples, 0);
+    stream.flush();
+    file.close();
+    return file.error() == QFileDevice::NoError;
+}
+
+/**
+ * Writes a vector of samples to a binary file: the RecordingHeader followed by the samples as floats.
+ * @param job The job with the file name, the samples and the calibration.
+ * @return False if the file could not be opened or written.
+ */
+bool Datarecord::writeBinary(const WriteJob &job) const {
+    QFile file(job.fileName);
+    if (!file.open(QIODevice::WriteOnly | QFile::Truncate)) {
+        return false;
+    }
+    char header[RECORDING_HEADER_SIZE] = {};
+    const RecordingHeader recordingHeader = RecordingHeader::create(samplingRate, job.mmHgPerVolt, job.ambientVoltage,
+                                                                    1, job.samples.size());
+    std::memcpy(header, &recordingHeader, sizeof(RecordingHeader));
+    bool success = file.write(header, sizeof(header)) == (qint64) sizeof(header);
+    success = success && writeSamples(file, nullptr, job.samples, 0);
+    file.close();
+    return success && file.error() == QFileDevice::NoError;
+}
+
+/**
+ * Writes samples to an open file, as text lines or as floats.
+ * @param file The file.
+ * @param text The text stream on the file, nullptr to write floats.
+ * @param samples The samples to write.
+ * @param first The number of samples written to the file before, for the time of text lines.
+ * @return False if the floats could not be written.
+ */
+bool Datarecord::writeSamples(QFile &file, QTextStream *text, const std::vector<double> &samples,
+                              long int first) const {
+    if (text != nullptr) {
+        long int n = first;
+        for (auto sample : samples) {
+            n++;
+            *text << (float) n / samplingRate << "\t" << sample << "\n";
+        }
+        return true;
+    }
+
+    float floats[RECORDING_BLOCK_SIZE];
+    for (size_t start = 0; start < samples.size(); start += RECORDING_BLOCK_SIZE) {
+        const size_t n = std::min<size_t>(RECORDING_BLOCK_SIZE, samples.size() - start);
+        for (size_t i = 0; i < n; ++i) {
+            floats[i] = (float) samples[start + i];
+        }
+        const auto bytes = (qint64) (n * sizeof(float));
+        if (file.write(reinterpret_cast<const char *>(floats), bytes) != bytes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Opens the file of a streamed recording in the writer thread. Binary files get a header with an unknown sample
+ * count, which is written when the recording is finished.
+ * @param job The job with the file name and the format.
+ * @return False if the file could not be opened.
+ */
+bool Datarecord::openStream(const WriteJob &job) {
+    streamOk = false;
+    streamSamples = 0;
+    streamBlocks = 0;
+    streamFile = new QFile(job.fileName);
+    if (!streamFile->open(QIODevice::WriteOnly | QFile::Truncate)) {
+        delete streamFile;
+        streamFile = nullptr;
+        return false;
+    }
+    if (job.binary) {
+        char header[RECORDING_HEADER_SIZE] = {};
+        streamHeader = RecordingHeader::create(samplingRate, job.mmHgPerVolt, job.ambientVoltage, 1,
+                                               RECORDING_SAMPLES_UNKNOWN);
+        std::memcpy(header, &streamHeader, sizeof(RecordingHeader));
+        streamOk = streamFile->write(header, sizeof(header)) == (qint64) sizeof(header);
+    } else {
+        streamText = new QTextStream(streamFile);
+        streamOk = true;
+    }
+    return streamOk;
+}
+
+/**
+ * Appends a block of samples to the streamed recording in the writer thread. Every RECORDING_SYNC_BLOCKS blocks, the
+ * file is synced to the disk.
+ * @param job The job with the samples.
+ * @return False if there is no open recording or the samples could not be written.
+ */
+bool Datarecord::appendStream(const WriteJob &job) {
+    if (streamFile == nullptr) {
+        return false;
+    }
+    streamOk = writeSamples(*streamFile, streamText, job.samples, streamSamples) && streamOk;
+    streamSamples += (long int) job.samples.size();
+    if (++streamBlocks >= RECORDING_SYNC_BLOCKS) {
+        streamBlocks = 0;
+        if (streamText != nullptr) {
+            streamText->flush();
+        }
+        streamFile->flush();
+        fsync(streamFile->handle());
+    }
+    return streamOk;
+}
+
+/**
+ * Finishes the streamed recording in the writer thread. Binary files get the footer, if there are results, and the
+ * sample count in the header.
+ * @param job The job with the results.
+ * @return False if there is no open recording or any write to it failed.
+ */
+bool Datarecord::closeStream(const WriteJob &job) {
+    if (streamFile == nullptr) {
+        return false;
+    }
+    if (streamText != nullptr) {
+        streamText->flush();
+        delete streamText;
+        streamText = nullptr;
+    } else {
+        if (job.hasResults) {
+            streamOk = streamFile->write(reinterpret_cast<const char *>(&job.results), sizeof(RecordingFooter)) ==
+                       (qint64) sizeof(RecordingFooter) && streamOk;
+        }
+        streamHeader.samples = (uint64_t) streamSamples;
+        streamOk = streamFile->seek(0) && streamFile->write(reinterpret_cast<const char *>(&streamHeader),
+                                                            sizeof(RecordingHeader)) ==
+                                          (qint64) sizeof(RecordingHeader) && streamOk;
+    }
+    streamFile->flush();
+    fsync(streamFile->handle());
+    streamFile->close();
+    const bool success = streamOk && streamFile->error() == QFileDevice::NoError;
+    delete streamFile;
+    streamFile = nullptr;
+    return success;
 }
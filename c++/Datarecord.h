@@ -14,40 +14,130 @@
 #define OBP_DATARECORD_H
 
 
+#include <functional>
+#include <mutex>
+#include <vector>
 #include <QtCore/QString>
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
+#include "BlockWriter.h"
+#include "RecordingFormat.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define RECORDING_BLOCK_SIZE    4096    //!< Number of samples converted to float at once for binary files.
+#define RECORDING_STREAM_BLOCK  500     //!< Number of samples collected before they are handed to the writer thread.
+#define RECORDING_SYNC_BLOCKS   4       //!< Number of streamed blocks after which the file is synced to the disk.
 
 //! The Datarecord Class
 /*!
  * The class Datarecord is used to store data in a file. There are two options. One is to store it sample by sample,
  * the other by handing it a vector of doubles to store. If the sampling rate is supplied, it will save the values
  * with the corresponding time. Otherwise, data will be numbered with the sample. In this application, the data is
- * stored at the end of a measurement. A vector is handed to the object together with a file name that represents the
- * current date and time.
+ * recorded sample by sample while the measurement is running, to a file name that represents the current date and
+ * time. Files can be text or the binary format of RecordingFormat.h, which is several times smaller than the text and
+ * can be read without parsing by the RecordingReader.
+ *
+ * All files are written by a writer thread (BlockWriter), so the acquisition thread does not wait for the formatting
+ * and the file system. addSample() collects the samples in a block of RECORDING_STREAM_BLOCK and hands the full block
+ * to the writer thread, which appends it to the file and syncs the file to the disk every RECORDING_SYNC_BLOCKS blocks.
+ * A measurement that is interrupted by a crash therefore loses at most the last few seconds, and the memory needed does
+ * not depend on the length of the recording. stopRecording() writes the last block and finishes the file: binary
+ * recordings get their sample count and optionally a footer with the results.
+ *
+ * saveAll() and saveBinary() only swap the content of the vector with an empty buffer that was used for an earlier
+ * save, the samples are neither copied nor is memory allocated once the buffers have grown. The same holds for the
+ * blocks of addSample(). The completion of each file is reported through the callback set with setOnSaved(), from the
+ * writer thread. The destructor finishes the recording and writes all pending vectors before it returns.
+ *
+ * addIndexEntry() appends the entry of a measurement to the MeasurementIndex in the writer thread as well, in order
+ * with the recording, so the acquisition thread never waits for the index file either.
  */
 class Datarecord {
 
 public:
+    /**
+     * Callback that is called from the writer thread after a file was finished.
+     * @param fileName The name of the file.
+     * @param success False if the file could not be written.
+     */
+    using SavedCallback = std::function<void(const QString &fileName, bool success)>;
+
     Datarecord(double samplingRate);
     Datarecord(QString filename, double samplingRate);
     ~Datarecord();
+    Datarecord(const Datarecord &) = delete;
+    Datarecord &operator=(const Datarecord &) = delete;
 
     void addSample(double sample);
-    void saveAll(QString fileName, std::vector<double> samples);
+    void saveAll(QString fileName, std::vector<double> &samples);
+    void saveBinary(QString fileName, std::vector<double> &samples, double mmHgPerVolt, double ambientVoltage);
+    void addIndexEntry(QString indexFile, const IndexEntry &entry);
+    void setOnSaved(SavedCallback callback);
+    void waitForSaved();
     void startRecording(QString filename);
+    void startRecording(QString filename, double mmHgPerVolt, double ambientVoltage);
     void stopRecording();
+    void stopRecording(const RecordingFooter &results);
+    [[nodiscard]] long int getSampleCount() const;
 private:
+    //! The kind of work for the writer thread.
+    enum class JobType {
+        save,       //!< Write a vector to a new file.
+        open,       //!< Open the file of a streamed recording.
+        append,     //!< Append a block to the streamed recording.
+        close,      //!< Finish the streamed recording.
+        index,      //!< Append an entry to the measurement index.
+    };
+
+    //! Work waiting for the writer thread.
+    struct WriteJob {
+        JobType type = JobType::save;   //!< The kind of work.
+        QString fileName;               //!< The name of the file to write to.
+        std::vector<double> samples;    //!< The samples to write.
+        bool binary = false;            //!< Write the binary format instead of text.
+        double mmHgPerVolt = 0.0;       //!< The calibration stored in binary files.
+        double ambientVoltage = 0.0;    //!< The ambient voltage stored in binary files.
+        bool hasResults = false;        //!< Write the footer when the recording is finished.
+        RecordingFooter results{};      //!< The footer of binary files.
+        IndexEntry entry{};             //!< The entry to append to the measurement index.
+    };
+
+    void writeJob(WriteJob &job);
+    void recycleJob(WriteJob &job);
+    void addJob(WriteJob &job, std::vector<double> &samples, std::vector<std::vector<double>> &pool);
+    bool write(const QString &fileName, const std::vector<double> &samples) const;
+    bool writeBinary(const WriteJob &job) const;
+    bool writeSamples(QFile &file, QTextStream *text, const std::vector<double> &samples, long int first) const;
+    bool openStream(const WriteJob &job);
+    bool appendStream(const WriteJob &job);
+    bool closeStream(const WriteJob &job);
+    void finishRecording(WriteJob &job);
 
     QString rec_filename;
-    QFile*  rec_file;
-    QTextStream* outStream;
+    std::vector<double> block;                  //!< The samples of the recording not handed to the writer yet.
     bool boRecord;
     long int nsample;
     double samplingRate;
 
+    std::vector<std::vector<double>> spare;     //!< Empty buffers that keep their memory for the next save.
+    std::vector<std::vector<double>> spareBlocks; //!< Empty buffers that keep their memory for the next block.
+    std::mutex callbackMutex;                   //!< Protects onSaved.
+    SavedCallback onSaved;                      //!< Called after each file.
+
+    /**
+     * The streamed recording, only used by the writer thread:
+     */
+    QFile *streamFile = nullptr;                //!< The file of the recording, nullptr if none is open.
+    QTextStream *streamText = nullptr;          //!< The text stream of text recordings.
+    RecordingHeader streamHeader{};             //!< The header of binary recordings.
+    long int streamSamples = 0;                 //!< The number of samples written to the file.
+    int streamBlocks = 0;                       //!< The number of blocks written since the last sync.
+    bool streamOk = false;                      //!< All writes to the file succeeded.
+
+    BlockWriter<WriteJob> writer;               //!< The writer thread, guards the spare buffers.
 };
 
 
 #endif //OBP_DATARECORD_H
-
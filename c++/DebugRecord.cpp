@@ -0,0 +1,305 @@
+/**
+ * @file        DebugRecord.cpp
+ * @brief       The implementation of the DebugRecord class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <cstring>
+#include <unistd.h>
+#include "common.h"
+#include "DebugRecord.h"
+
+/**
+ * Constructor to prepare a debug recording at a later point. Starts the writer thread.
+ * @param samplingRate The sampling rate at which the data will be recorded.
+ * @param maxData The largest ADC count, written to the header with the range for the conversion of the counts.
+ * @param rangeMin The voltage of the ADC count 0.
+ * @param rangeMax The voltage of the ADC count maxData.
+ */
+DebugRecord::DebugRecord(double samplingRate, uint32_t maxData, double rangeMin, double rangeMax) :
+        samplingRate(samplingRate),
+        maxData(maxData),
+        rangeMin(rangeMin),
+        rangeMax(rangeMax),
+        writer([this](WriteJob &job) { writeJob(job); }, [this](WriteJob &job) { recycleJob(job); })
+{
+    rawBlock.reserve(DEBUG_BLOCK_SIZE);
+    mmHgBlock.reserve(DEBUG_BLOCK_SIZE);
+    lowPassBlock.reserve(DEBUG_BLOCK_SIZE);
+    highPassBlock.reserve(DEBUG_BLOCK_SIZE);
+}
+
+/**
+ * Destructor of the DebugRecord. Finishes the recording if there is one and stops the writer thread.
+ */
+DebugRecord::~DebugRecord()
+{
+    stopRecording();
+    writer.stop();
+}
+
+/**
+ * Starts a debug recording. The file is opened by the writer thread. A running recording is finished first.
+ * @param fileName The name of the file, should end with DEBUG_EXTENSION.
+ * @param mmHgPerVolt The calibration the pressure is converted from voltages with.
+ * @param ambientVoltage The voltage at ambient pressure.
+ */
+void DebugRecord::startRecording(const std::string &fileName, double mmHgPerVolt, double ambientVoltage)
+{
+    stopRecording();
+    WriteJob job;
+    job.type = JobType::open;
+    job.fileName = fileName;
+    job.header = DebugHeader::create(samplingRate, mmHgPerVolt, ambientVoltage, maxData, rangeMin, rangeMax);
+    addJob(job);
+    nsample = 0;
+    blockStart = 0;
+    boRecord = true;
+}
+
+/**
+ * Adds the values of all continuous streams at one sample. The block is handed to the writer thread when it is full.
+ * @param raw The ADC count.
+ * @param mmHg The pressure in mmHg.
+ * @param lowPass The low-pass filtered pressure.
+ * @param highPass The high-pass filtered oscillation.
+ */
+void DebugRecord::addSample(int raw, double mmHg, double lowPass, double highPass)
+{
+    if (!boRecord)
+    {
+        return;
+    }
+    rawBlock.push_back(raw);
+    mmHgBlock.push_back((float) mmHg);
+    lowPassBlock.push_back((float) lowPass);
+    highPassBlock.push_back((float) highPass);
+    nsample++;
+    if (rawBlock.size() >= DEBUG_BLOCK_SIZE)
+    {
+        flushBlock();
+    }
+}
+
+/**
+ * Adds an event at the next sample.
+ * @param stream The event stream.
+ * @param value The value of the event.
+ * @param flags Additional information, depends on the stream.
+ */
+void DebugRecord::addEvent(DebugStream stream, double value, uint32_t flags)
+{
+    addEvent(stream, nsample, value, flags);
+}
+
+/**
+ * Adds an event at any sample. Events are written with the next block.
+ * @param stream The event stream, continuous streams are ignored.
+ * @param sample The sample number of the event.
+ * @param value The value of the event.
+ * @param flags Additional information, depends on the stream.
+ */
+void DebugRecord::addEvent(DebugStream stream, uint64_t sample, double value, uint32_t flags)
+{
+    if (!boRecord || stream < DebugStream::peaks || (uint32_t) stream >= DEBUG_STREAM_COUNT)
+    {
+        return;
+    }
+    events[(uint32_t) stream].push_back(DebugEvent{sample, (float) value, flags});
+}
+
+/**
+ * Adds the beats and the envelope found by the detection as events.
+ * @param beats The beats, the type of each beat is stored as flags of its peak and trough.
+ * @param envelope The envelope.
+ * @param offset The sample number of the recording at which the detection started, the times of the beats and the
+ * envelope are relative to it.
+ */
+void DebugRecord::addBeats(const BeatTable &beats, const Envelope &envelope, uint64_t offset)
+{
+    for (size_t i = 0; i < beats.size(); ++i)
+    {
+        addEvent(DebugStream::peaks, offset + beats.peakTime(i), beats.peakAmplitude(i), (uint32_t) beats.type(i));
+    }
+    for (size_t i = 0; i < beats.troughCount(); ++i)
+    {
+        addEvent(DebugStream::troughs, offset + beats.troughTime(i), beats.troughAmplitude(i),
+                 (uint32_t) beats.type(i));
+    }
+    for (size_t i = 0; i < envelope.size(); ++i)
+    {
+        addEvent(DebugStream::envelope, offset + envelope.time(i), envelope.amplitude(i), 0);
+    }
+}
+
+/**
+ * Stops the recording. The remaining values are written and the file is closed by the writer thread.
+ */
+void DebugRecord::stopRecording()
+{
+    if (!boRecord)
+    {
+        return;
+    }
+    flushBlock();
+    WriteJob job;
+    job.type = JobType::close;
+    addJob(job);
+    boRecord = false;
+}
+
+/**
+ * Blocks until all jobs handed to the writer thread are done.
+ */
+void DebugRecord::waitForSaved()
+{
+    writer.waitForDone();
+}
+
+/**
+ * @return True while a recording is running.
+ */
+bool DebugRecord::isRecording() const
+{
+    return boRecord;
+}
+
+/**
+ * @return The number of samples added since the recording was started.
+ */
+uint64_t DebugRecord::getSampleCount() const
+{
+    return nsample;
+}
+
+/**
+ * Converts the block and the events into chunks and hands them to the writer thread.
+ */
+void DebugRecord::flushBlock()
+{
+    chunks.clear();
+    const size_t count = rawBlock.size();
+    if (count > 0)
+    {
+        appendChunk(DebugStream::raw, blockStart, rawBlock.data(), count);
+        appendChunk(DebugStream::mmHg, blockStart, mmHgBlock.data(), count);
+        appendChunk(DebugStream::lowPass, blockStart, lowPassBlock.data(), count);
+        appendChunk(DebugStream::highPass, blockStart, highPassBlock.data(), count);
+    }
+    for (auto &streamEvents : events)
+    {
+        if (!streamEvents.empty())
+        {
+            const DebugStream stream = (DebugStream) (&streamEvents - events);
+            appendChunk(stream, streamEvents.front().sample, streamEvents.data(), streamEvents.size());
+            streamEvents.clear();
+        }
+    }
+    rawBlock.clear();
+    mmHgBlock.clear();
+    lowPassBlock.clear();
+    highPassBlock.clear();
+    blockStart = nsample;
+    if (!chunks.empty())
+    {
+        WriteJob job;
+        job.type = JobType::append;
+        addJob(job);
+    }
+}
+
+/**
+ * Appends a chunk to the chunks of the block.
+ * @param stream The stream.
+ * @param first The sample number of the first value.
+ * @param values The values.
+ * @param count The number of values.
+ */
+void DebugRecord::appendChunk(DebugStream stream, uint64_t first, const void *values, size_t count)
+{
+    const DebugChunk chunk{stream, (uint32_t) (count * DebugChunk::valueSize(stream)), first};
+    const auto *header = reinterpret_cast<const uint8_t *>(&chunk);
+    const auto *bytes = static_cast<const uint8_t *>(values);
+    chunks.insert(chunks.end(), header, header + sizeof(DebugChunk));
+    chunks.insert(chunks.end(), bytes, bytes + chunk.size);
+}
+
+/**
+ * Hands a job to the writer thread. The chunks of append jobs are swapped with a spare buffer.
+ * @param job The job.
+ */
+void DebugRecord::addJob(WriteJob &job)
+{
+    writer.add(job, [this](WriteJob &added) {
+        if (added.type == JobType::append)
+        {
+            added.data.swap(chunks);
+            if (!spare.empty())
+            {
+                chunks.swap(spare.back());
+                spare.pop_back();
+            }
+        }
+    });
+}
+
+/**
+ * Does a job in the writer thread.
+ * @param job The job.
+ */
+void DebugRecord::writeJob(WriteJob &job)
+{
+    switch (job.type)
+    {
+        case JobType::open:
+            file = std::fopen(job.fileName.c_str(), "wb");
+            blocks = 0;
+            if (file == nullptr || std::fwrite(&job.header, sizeof(DebugHeader), 1, file) != 1)
+            {
+                PLOG_WARNING << "Could not write debug recording " << job.fileName;
+            }
+            break;
+        case JobType::append:
+            if (file != nullptr)
+            {
+                if (std::fwrite(job.data.data(), 1, job.data.size(), file) != job.data.size())
+                {
+                    PLOG_WARNING << "Could not append to the debug recording";
+                }
+                if (++blocks >= DEBUG_SYNC_BLOCKS)
+                {
+                    blocks = 0;
+                    std::fflush(file);
+                    fsync(fileno(file));
+                }
+            }
+            break;
+        case JobType::close:
+            if (file != nullptr)
+            {
+                std::fflush(file);
+                fsync(fileno(file));
+                if (std::fclose(file) != 0)
+                {
+                    PLOG_WARNING << "Could not close the debug recording";
+                }
+                file = nullptr;
+            }
+            break;
+    }
+}
+
+/**
+ * Keeps the buffer of a written job for later blocks, called by the writer thread under its lock.
+ * @param job The written job.
+ */
+void DebugRecord::recycleJob(WriteJob &job)
+{
+    if (job.data.capacity() > 0)
+    {
+        job.data.clear();
+        spare.push_back(std::move(job.data));
+    }
+}
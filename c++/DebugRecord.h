@@ -0,0 +1,109 @@
+/**
+ * @file        DebugRecord.h
+ * @brief       The header file of the DebugRecord class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the DebugRecord class and contains the general class description.
+ */
+#ifndef OBP_DEBUGRECORD_H
+#define OBP_DEBUGRECORD_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "BlockWriter.h"
+#include "BeatTable.h"
+#include "RecordingFormat.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define DEBUG_BLOCK_SIZE    500     //!< Number of samples collected before they are handed to the writer thread.
+#define DEBUG_SYNC_BLOCKS   4       //!< Number of blocks after which the file is synced to the disk.
+
+//! The DebugRecord class records all stages of the processing of a measurement in one file.
+/*!
+ * While the Datarecord only stores the pressure, a debug recording holds every stage of the pipeline time-aligned in
+ * one file: the ADC counts, the pressure in mmHg, the low-pass and the high-pass filtered signals, the peaks and
+ * troughs of the beats, the points of the envelope and the transitions of the state machine. The format is described
+ * at the DebugHeader in RecordingFormat.h, the files are read by the DebugRecordReader.
+ *
+ * Like the Datarecord, the samples are collected in blocks of DEBUG_BLOCK_SIZE and handed to a BlockWriter, which
+ * appends them to the file and syncs it every DEBUG_SYNC_BLOCKS blocks. The acquisition thread only copies the values
+ * into the block, the buffers are swapped with the ones the writer thread returned. Events are collected with the
+ * samples and written in the same block.
+ *
+ * The beats and the envelope are revised by the detection until the end of the measurement (artifacts, restarts), so
+ * they are not streamed but added as a whole with addBeats() once the detection is done.
+ */
+class DebugRecord {
+
+public:
+    DebugRecord(double samplingRate, uint32_t maxData, double rangeMin, double rangeMax);
+    ~DebugRecord();
+    DebugRecord(const DebugRecord &) = delete;
+    DebugRecord &operator=(const DebugRecord &) = delete;
+
+    void startRecording(const std::string &fileName, double mmHgPerVolt, double ambientVoltage);
+    void addSample(int raw, double mmHg, double lowPass, double highPass);
+    void addEvent(DebugStream stream, double value, uint32_t flags);
+    void addEvent(DebugStream stream, uint64_t sample, double value, uint32_t flags);
+    void addBeats(const BeatTable &beats, const Envelope &envelope, uint64_t offset);
+    void stopRecording();
+    void waitForSaved();
+    [[nodiscard]] bool isRecording() const;
+    [[nodiscard]] uint64_t getSampleCount() const;
+
+private:
+    //! The kind of work for the writer thread.
+    enum class JobType {
+        open,       //!< Open the file and write the header.
+        append,     //!< Append chunks.
+        close,      //!< Close the file.
+    };
+
+    //! Work waiting for the writer thread.
+    struct WriteJob {
+        JobType type = JobType::append; //!< The kind of work.
+        std::string fileName;           //!< The file to open.
+        DebugHeader header{};           //!< The header of the file to open.
+        std::vector<uint8_t> data;      //!< The chunks to append.
+    };
+
+    void writeJob(WriteJob &job);
+    void recycleJob(WriteJob &job);
+    void flushBlock();
+    void addJob(WriteJob &job);
+    void appendChunk(DebugStream stream, uint64_t first, const void *values, size_t count);
+
+    double samplingRate;                        //!< The sampling rate of the recording.
+    uint32_t maxData;                           //!< The largest ADC count.
+    double rangeMin;                            //!< The voltage of the ADC count 0.
+    double rangeMax;                            //!< The voltage of the ADC count maxData.
+    bool boRecord = false;                      //!< A recording is running.
+    uint64_t nsample = 0;                       //!< The number of samples of the recording.
+    uint64_t blockStart = 0;                    //!< The sample number of the first sample in the block.
+    std::vector<int32_t> rawBlock;              //!< The ADC counts not handed to the writer yet.
+    std::vector<float> mmHgBlock;               //!< The pressure not handed to the writer yet.
+    std::vector<float> lowPassBlock;            //!< The low-pass signal not handed to the writer yet.
+    std::vector<float> highPassBlock;           //!< The high-pass signal not handed to the writer yet.
+    std::vector<DebugEvent> events[DEBUG_STREAM_COUNT]; //!< The events not handed to the writer yet, per stream.
+    std::vector<uint8_t> chunks;                //!< The chunks of the block that is handed to the writer.
+
+    std::vector<std::vector<uint8_t>> spare;    //!< Empty buffers that keep their memory for the next block.
+
+    /**
+     * The file, only used by the writer thread:
+     */
+    std::FILE *file = nullptr;                  //!< The file of the recording, nullptr if none is open.
+    int blocks = 0;                             //!< The number of blocks written since the last sync.
+
+    BlockWriter<WriteJob> writer;               //!< The writer thread, guards the spare buffers.
+};
+
+
+#endif //OBP_DEBUGRECORD_H
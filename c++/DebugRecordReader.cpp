@@ -0,0 +1,199 @@
+/**
+ * @file        DebugRecordReader.cpp
+ * @brief       The implementation of the DebugRecordReader class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cstring>
+#include "common.h"
+#include "DebugRecordReader.h"
+
+/**
+ * Constructor that opens a debug recording immediately.
+ * @param fileName The name of the recording.
+ */
+DebugRecordReader::DebugRecordReader(const std::string &fileName)
+{
+    open(fileName);
+}
+
+/**
+ * Destructor of the DebugRecordReader. Releases the mapping.
+ */
+DebugRecordReader::~DebugRecordReader()
+{
+    close();
+}
+
+/**
+ * Opens a debug recording and indexes its chunks. A recording that is already open is closed first.
+ * @param fileName The name of the recording.
+ * @return False if the file could not be mapped or has no valid header.
+ */
+bool DebugRecordReader::open(const std::string &fileName)
+{
+    close();
+
+    if (!file.map(fileName, DEBUG_HEADER_SIZE_V1, "debug recording"))
+    {
+        return false;
+    }
+    // The fields of version 1 first, the range of the ADC stays zero for it.
+    std::memcpy(&header, file.data(), DEBUG_HEADER_SIZE_V1);
+    const size_t minHeaderSize = header.version == 1 ? DEBUG_HEADER_SIZE_V1 : sizeof(DebugHeader);
+    if (std::memcmp(header.magic, DEBUG_MAGIC, sizeof(header.magic)) != 0 || header.version < 1 ||
+        header.version > DEBUG_VERSION || header.headerSize < minHeaderSize || header.headerSize > file.size())
+    {
+        PLOG_WARNING << "Debug recording " << fileName << " has an invalid header";
+        close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), minHeaderSize);
+
+    size_t offset = header.headerSize;
+    while (file.size() - offset >= sizeof(DebugChunk))
+    {
+        DebugChunk chunk{};
+        std::memcpy(&chunk, file.data() + offset, sizeof(DebugChunk));
+        if (file.size() - offset - sizeof(DebugChunk) < chunk.size)
+        {
+            PLOG_WARNING << "Debug recording " << fileName << " was not finished, it is read up to the last chunk";
+            break;
+        }
+        offset += sizeof(DebugChunk);
+        if ((uint32_t) chunk.stream < DEBUG_STREAM_COUNT)
+        {
+            const auto count = (uint32_t) (chunk.size / DebugChunk::valueSize(chunk.stream));
+            chunks[(uint32_t) chunk.stream].push_back(ChunkIndex{chunk.first, count, offset});
+        }
+        offset += chunk.size;
+    }
+    return true;
+}
+
+/**
+ * Closes the recording and releases the mapping.
+ */
+void DebugRecordReader::close()
+{
+    file.unmap();
+    header = DebugHeader{};
+    for (auto &streamChunks : chunks)
+    {
+        streamChunks.clear();
+    }
+}
+
+/**
+ * @return True if a valid recording is open.
+ */
+bool DebugRecordReader::isOpen() const
+{
+    return file.isMapped();
+}
+
+/**
+ * Gets the header of the open recording.
+ * @return The header, all zero if no recording is open.
+ */
+const DebugHeader &DebugRecordReader::getHeader() const
+{
+    return header;
+}
+
+/**
+ * @return The number of samples of the continuous streams.
+ */
+uint64_t DebugRecordReader::getSampleCount() const
+{
+    const auto &rawChunks = chunks[(uint32_t) DebugStream::raw];
+    return rawChunks.empty() ? 0 : rawChunks.back().first + rawChunks.back().count;
+}
+
+/**
+ * Gets a whole continuous stream.
+ * @param stream The stream.
+ * @return The values, ADC counts for the raw stream. Empty for event streams.
+ */
+std::vector<double> DebugRecordReader::getStream(DebugStream stream) const
+{
+    return getStream(stream, 0, getSampleCount());
+}
+
+/**
+ * Gets a part of a continuous stream. Only the chunks that contain the part are read.
+ * @param stream The stream.
+ * @param first The first sample.
+ * @param count The number of samples, less are returned at the end of the recording.
+ * @return The values, ADC counts for the raw stream. Empty for event streams.
+ */
+std::vector<double> DebugRecordReader::getStream(DebugStream stream, uint64_t first, size_t count) const
+{
+    std::vector<double> values;
+    if (stream >= DebugStream::peaks || (uint32_t) stream >= DEBUG_STREAM_COUNT)
+    {
+        return values;
+    }
+    const auto &streamChunks = chunks[(uint32_t) stream];
+    auto chunk = std::upper_bound(streamChunks.begin(), streamChunks.end(), first,
+                                  [](uint64_t sample, const ChunkIndex &index) { return sample < index.first; });
+    if (chunk != streamChunks.begin())
+    {
+        --chunk;
+    }
+    values.reserve(count);
+    for (; chunk != streamChunks.end() && values.size() < count; ++chunk)
+    {
+        const uint64_t start = std::max(first, chunk->first);
+        for (uint64_t sample = start; sample < chunk->first + chunk->count && values.size() < count; ++sample)
+        {
+            values.push_back(getValue(stream, *chunk, (size_t) (sample - chunk->first)));
+        }
+    }
+    return values;
+}
+
+/**
+ * Gets all events of an event stream.
+ * @param stream The stream.
+ * @return The events in the order they were added. Empty for continuous streams.
+ */
+std::vector<DebugEvent> DebugRecordReader::getEvents(DebugStream stream) const
+{
+    std::vector<DebugEvent> events;
+    if (stream < DebugStream::peaks || (uint32_t) stream >= DEBUG_STREAM_COUNT)
+    {
+        return events;
+    }
+    for (const auto &chunk : chunks[(uint32_t) stream])
+    {
+        const size_t begin = events.size();
+        events.resize(begin + chunk.count);
+        std::memcpy(events.data() + begin, file.data() + chunk.offset, chunk.count * sizeof(DebugEvent));
+    }
+    return events;
+}
+
+/**
+ * Reads one value of a continuous stream.
+ * @param stream The stream.
+ * @param chunk The chunk.
+ * @param i The index of the value in the chunk.
+ * @return The value.
+ */
+double DebugRecordReader::getValue(DebugStream stream, const ChunkIndex &chunk, size_t i) const
+{
+    const unsigned char *pos = file.data() + chunk.offset + i * DebugChunk::valueSize(stream);
+    if (stream == DebugStream::raw)
+    {
+        int32_t raw;
+        std::memcpy(&raw, pos, sizeof(raw));
+        return raw;
+    }
+    float value;
+    std::memcpy(&value, pos, sizeof(value));
+    return value;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file        DebugRecordReader.h
+ * @brief       The header file of the DebugRecordReader class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the DebugRecordReader class and contains the general class description.
+ */
+#ifndef OBP_DEBUGRECORDREADER_H
+#define OBP_DEBUGRECORDREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "RecordingFormat.h"
+
+//! The DebugRecordReader class reads the debug recordings of the DebugRecord.
+/*!
+ * The file is mapped into memory like by the RecordingReader. Opening it only walks over the chunk headers and
+ * builds an index of the chunks of every stream, the values are converted when a stream is requested. A part of a
+ * continuous stream is found by a binary search in the index, so a replay can jump to any time and stage without
+ * reading the rest of the file.
+ *
+ * A recording that was interrupted is read up to its last complete chunk. Chunks of streams this reader does not
+ * know are skipped.
+ */
+class DebugRecordReader {
+
+public:
+    DebugRecordReader() = default;
+    explicit DebugRecordReader(const std::string &fileName);
+    ~DebugRecordReader();
+    DebugRecordReader(const DebugRecordReader &) = delete;
+    DebugRecordReader &operator=(const DebugRecordReader &) = delete;
+
+    bool open(const std::string &fileName);
+    void close();
+
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] const DebugHeader &getHeader() const;
+    [[nodiscard]] uint64_t getSampleCount() const;
+    [[nodiscard]] std::vector<double> getStream(DebugStream stream) const;
+    [[nodiscard]] std::vector<double> getStream(DebugStream stream, uint64_t first, size_t count) const;
+    [[nodiscard]] std::vector<DebugEvent> getEvents(DebugStream stream) const;
+
+private:
+    //! The position of a chunk in the mapping.
+    struct ChunkIndex {
+        uint64_t first;             //!< The sample number of the first value.
+        uint32_t count;             //!< The number of values.
+        size_t offset;              //!< Offset of the values in the mapping.
+    };
+
+    [[nodiscard]] double getValue(DebugStream stream, const ChunkIndex &chunk, size_t i) const;
+
+    DebugHeader header{};                                   //!< Copy of the header of the open file.
+    MappedFile file;                                        //!< The mapped file, not mapped if closed.
+    std::vector<ChunkIndex> chunks[DEBUG_STREAM_COUNT];     //!< The chunks of every stream in the order of the file.
+};
+
+
+#endif //OBP_DEBUGRECORDREADER_H
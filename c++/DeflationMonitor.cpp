@@ -0,0 +1,144 @@
+/**
+ * @file        DeflationMonitor.cpp
+ * @brief       The implementation of the DeflationMonitor class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include "DeflationMonitor.h"
+
+/**
+ * Constructor of the DeflationMonitor class.
+ * @param samplingRate The sampling rate of the processed data.
+ */
+DeflationMonitor::DeflationMonitor(double samplingRate) :
+        samplingRate(samplingRate),
+        updateInterval(std::max<size_t>(1, (size_t) (samplingRate * DEFLATE_UPDATE_TIME))),
+        values(std::max<size_t>(3, (size_t) (samplingRate * DEFLATE_WINDOW_TIME)))
+{
+    reset();
+}
+
+/**
+ * Resets the monitor to start a new deflation.
+ */
+void DeflationMonitor::reset()
+{
+    oldest = 0;
+    count = 0;
+    nSamples = 0;
+    sumY = 0.0;
+    sumXY = 0.0;
+    sumYY = 0.0;
+    firstPressure = 0.0;
+    lastPressure = 0.0;
+}
+
+/**
+ * Processes one pressure sample during deflation.
+ * @param pressure The (low-pass filtered) pressure in mmHg.
+ * @return True if the window is full and an update of the guidance is due.
+ */
+bool DeflationMonitor::processSample(double pressure)
+{
+    if (nSamples == 0)
+    {
+        firstPressure = pressure;
+    }
+    lastPressure = pressure;
+    nSamples++;
+
+    if (count == values.size())
+    {
+        // Remove the oldest value at position 0, the others move one position down.
+        const double removed = values[oldest];
+        sumY -= removed;
+        sumYY -= removed * removed;
+        sumXY -= sumY;
+        oldest = (oldest + 1) % values.size();
+        count--;
+    }
+    values[(oldest + count) % values.size()] = pressure;
+    sumXY += (double) count * pressure;
+    sumY += pressure;
+    sumYY += pressure * pressure;
+    count++;
+
+    return count == values.size() && nSamples % updateInterval == 0;
+}
+
+/**
+ * Gets the deflation rate in the window, the negative slope of the fitted line.
+ * @return The rate in mmHg/s, positive while the pressure falls. 0.0 until the window is full.
+ */
+double DeflationMonitor::getRate() const
+{
+    if (count < values.size())
+    {
+        return 0.0;
+    }
+    const auto n = (double) count;
+    const double sxx = n * (n * n - 1.0) / 12.0;
+    const double sxy = sumXY - 0.5 * (n - 1.0) * sumY;
+    return -sxy / sxx * samplingRate;
+}
+
+/**
+ * Gets the RMS of the residuals of the fitted line in the window.
+ * @return The residual in mmHg, 0.0 until the window is full.
+ */
+double DeflationMonitor::getResidual() const
+{
+    if (count < values.size())
+    {
+        return 0.0;
+    }
+    const auto n = (double) count;
+    const double sxx = n * (n * n - 1.0) / 12.0;
+    const double sxy = sumXY - 0.5 * (n - 1.0) * sumY;
+    const double syy = sumYY - sumY * sumY / n;
+    const double sse = syy - sxy * sxy / sxx;
+    return std::sqrt(std::max(0.0, sse) / (n - 2.0));
+}
+
+/**
+ * Gets the mean deflation rate since the reset.
+ * @return The rate in mmHg/s, positive while the pressure falls.
+ */
+double DeflationMonitor::getMeanRate() const
+{
+    if (nSamples < 2)
+    {
+        return 0.0;
+    }
+    return (firstPressure - lastPressure) * samplingRate / (double) (nSamples - 1);
+}
+
+/**
+ * Gets the guidance for the user from the current rate and residual.
+ * @return The guidance, unknown until the window is full.
+ */
+DeflationGuidance DeflationMonitor::getGuidance() const
+{
+    if (count < values.size())
+    {
+        return DeflationGuidance::unknown;
+    }
+    if (getResidual() > DEFLATE_MAX_RESIDUAL)
+    {
+        return DeflationGuidance::irregular;
+    }
+    const double rate = getRate();
+    if (rate < DEFLATE_RATE_MIN)
+    {
+        return DeflationGuidance::tooSlow;
+    }
+    if (rate > DEFLATE_RATE_MAX)
+    {
+        return DeflationGuidance::tooFast;
+    }
+    return DeflationGuidance::good;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file        DeflationMonitor.h
+ * @brief       The header file of the DeflationMonitor class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the DeflationMonitor class and contains the general class description.
+ */
+#ifndef OBP_DEFLATIONMONITOR_H
+#define OBP_DEFLATIONMONITOR_H
+
+#include <cstddef>
+#include <vector>
+#include "common.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define DEFLATE_WINDOW_TIME     2.0     //!< Length of the sliding window the rate is fitted over, in s.
+#define DEFLATE_UPDATE_TIME     0.25    //!< Time between two updates of the guidance, in s.
+#define DEFLATE_RATE_MIN        2.0     //!< Below this rate in mmHg/s, the deflation is too slow.
+#define DEFLATE_RATE_MAX        4.0     //!< Above this rate in mmHg/s, the deflation is too fast.
+#define DEFLATE_MAX_RESIDUAL    2.0     //!< Above this RMS residual in mmHg, the deflation is irregular.
+
+//! The DeflationMonitor class estimates the deflation rate to guide the user while the cuff is deflated.
+/*!
+ * The results are only accurate if the cuff is deflated at a steady rate of about 2-4 mmHg/s: too fast and there are
+ * too few beats between SBP and DBP, too slow and the measurement takes longer than necessary.
+ *
+ * A straight line is fitted to the (low-pass filtered) pressure over a sliding window of DEFLATE_WINDOW_TIME by least
+ * squares. The sums of the fit are updated incrementally: the sample that leaves the window is subtracted and all
+ * remaining samples are moved by one position, which only changes the sum of the products by the sum of the values.
+ * Each sample therefore costs O(1), independent of the window length. The deflation rate is the negative slope and
+ * the RMS of the residuals tells whether the pressure falls steadily; the pulses in the pressure leave a residual
+ * well below DEFLATE_MAX_RESIDUAL, jerky opening and closing of the valve does not.
+ */
+class DeflationMonitor {
+
+public:
+    explicit DeflationMonitor(double samplingRate);
+
+    void reset();
+    bool processSample(double pressure);
+
+    [[nodiscard]] double getRate() const;
+    [[nodiscard]] double getResidual() const;
+    [[nodiscard]] double getMeanRate() const;
+    [[nodiscard]] DeflationGuidance getGuidance() const;
+
+private:
+    double samplingRate;            //!< The sampling rate of the processed data.
+    size_t updateInterval;          //!< Number of samples between two updates.
+    std::vector<double> values;     //!< Ring buffer of the pressure in the window.
+    size_t oldest{};                //!< Position of the oldest value in values.
+    size_t count{};                 //!< Number of values in the window.
+    size_t nSamples{};              //!< Number of samples since the reset.
+    double sumY{};                  //!< Sum of the values in the window.
+    double sumXY{};                 //!< Sum of the values times their position in the window.
+    double sumYY{};                 //!< Sum of the squared values in the window.
+    double firstPressure{};         //!< The pressure at the reset, for the mean rate.
+    double lastPressure{};          //!< The latest pressure.
+};
+
+
+#endif //OBP_DEFLATIONMONITOR_H
@@ -0,0 +1,187 @@
+/**
+ * @file        DerivativeDetection.cpp
+ * @brief
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ */
+
+#include "DerivativeDetection.h"
+
+/**
+ * Constructor of the DerivativeDetection class.
+ * @param sampling_rate Sets the sampling rate of the processed data. Used to calculate the heart rate.
+ */
+DerivativeDetection::DerivativeDetection(double sampling_rate) :
+        OBPDetection(sampling_rate)
+{
+}
+
+/**
+ * Destructor of the DerivativeDetection class.
+ */
+DerivativeDetection::~DerivativeDetection()
+{
+
+}
+
+/**
+ * Gets the algorithm implemented by this instance.
+ * @return The derivative algorithm.
+ */
+DetectionAlgorithm DerivativeDetection::getAlgorithm() const
+{
+    return DetectionAlgorithm::Derivative;
+}
+
+/**
+ * Resets all variables to start a new measurement. Takes over the currently published configuration.
+ */
+void DerivativeDetection::reset()
+{
+    OBPDetection::reset();
+    resetEnvelope();
+}
+
+/**
+ * Discards the envelope and the running extrema, e.g. because the beat table was cleared after an invalid pulse.
+ */
+void DerivativeDetection::resetEnvelope()
+{
+    omwe.clear();
+    nFinal = 0;
+    firstPeakTime = 0;
+    lastBeat = 0;
+    lastAmp = 0.0;
+    maxAmp = 0.0;
+    maxBeat = 0;
+    maxRise = 0.0;
+    riseBeat = 0;
+    pendingRise = 0.0;
+    pendingBeat = 0;
+    maxFall = 0.0;
+    fallBeat = 0;
+    nBelowCutoff = 0;
+}
+
+/**
+ * Adds the beats whose peak and trough are final to the envelope and checks if enough data has been received.
+ *
+ * The trough of a beat is final as soon as the peak after it is final, which is the case once a further beat has
+ * been added to the table. Each beat is added exactly once, so the work per call is constant. Artifacts are skipped.
+ * @return True if the MAP and the largest fall after it have been found and the envelope has decayed.
+ */
+bool DerivativeDetection::isEnoughData()
+{
+    // The table is cleared and restarted after an invalid pulse, the envelope has to be restarted as well.
+    if (nFinal > 0 && (beats.empty() || beats.peakTime(0) != firstPeakTime))
+    {
+        resetEnvelope();
+    }
+
+    while (nFinal + 2 < beats.size() && nFinal < beats.troughCount())
+    {
+        if (beats.type(nFinal) != BeatType::Artifact)
+        {
+            addFinalBeat(nFinal);
+        }
+        nFinal++;
+    }
+
+    return nFinal > (size_t) config.minNbrPeaks && maxAmp > MIN_ENVELOPE_MAX && fallBeat > 0 && nBelowCutoff >= 3;
+}
+
+/**
+ * Adds one beat to the envelope and updates the running extrema of the envelope and its derivative.
+ * @param beat The index of the beat, beats have to be added in order. The derivative is taken to the previous beat
+ * that was added, i.e. across artifacts.
+ */
+void DerivativeDetection::addFinalBeat(size_t beat)
+{
+    const double amp = beats.peakAmplitude(beat) - beats.troughAmplitude(beat);
+    omwe.addPoint(beats.peakTime(beat), amp);
+
+    if (beat == 0)
+    {
+        firstPeakTime = beats.peakTime(0);
+        lastAmp = amp;
+        maxAmp = amp;
+        return;
+    }
+
+    const double change = amp - lastAmp;
+    const size_t previous = lastBeat;
+    lastAmp = amp;
+    lastBeat = beat;
+
+    if (amp > maxAmp)
+    {
+        // New MAP: all rises so far are before it, falls before it do not count anymore.
+        if (pendingRise > maxRise)
+        {
+            maxRise = pendingRise;
+            riseBeat = pendingBeat;
+        }
+        if (change > maxRise)
+        {
+            maxRise = change;
+            riseBeat = previous;
+        }
+        pendingRise = 0.0;
+        maxAmp = amp;
+        maxBeat = beat;
+        maxFall = 0.0;
+        fallBeat = 0;
+        nBelowCutoff = 0;
+        return;
+    }
+
+    if (change > pendingRise)
+    {
+        pendingRise = change;
+        pendingBeat = previous;
+    }
+    if (-change > maxFall)
+    {
+        maxFall = -change;
+        fallBeat = previous;
+    }
+
+    if (amp < maxAmp * (config.ratioDBP - config.cutoffHyst))
+    {
+        nBelowCutoff++;
+    } else
+    {
+        nBelowCutoff = 0;
+    }
+}
+
+/**
+ * The predictive mode is based on the DBP ratio, which this algorithm does not use.
+ * @param pressure All pressure values of the measurement so far, unused.
+ * @return Always false, the measurement is only finished by isEnoughData().
+ */
+bool DerivativeDetection::isPredictable(std::span<const double> pressure)
+{
+    (void) pressure;
+    return false;
+}
+
+/**
+ * Looks up the pressure at the MAP and at the extrema of the envelope derivative.
+ *
+ * The results will be saved in the result variables resMAP, resSBP and resDBP and the times at which they were found
+ * in resMAPTime, resSBPTime and resDBPTime.
+ * @param pressure All pressure values of the measurement so far.
+ */
+void DerivativeDetection::findResults(std::span<const double> pressure)
+{
+    resMAPTime = beats.peakTime(maxBeat);
+    resSBPTime = beats.peakTime(riseBeat);
+    resDBPTime = beats.peakTime(fallBeat);
+    resMAP = getPressureAt(pressure, resMAPTime);
+    resSBP = getPressureAt(pressure, resSBPTime);
+    resDBP = getPressureAt(pressure, resDBPTime);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file        DerivativeDetection.h
+ * @brief       The header file of the DerivativeDetection class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the DerivativeDetection class and contains the general class description.
+ */
+#ifndef OBP_DERIVATIVEDETECTION_H
+#define OBP_DERIVATIVEDETECTION_H
+
+#include "OBPDetection.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define MIN_ENVELOPE_MAX 1.5 //!< The maximum of the envelope needs to be at least this large to finish.
+
+//! The DerivativeDetection class implements the derivative based algorithm to get the blood pressure.
+/*!
+ * The beats are detected exactly as in OBPDetection. The envelope is the difference between the peak and the trough
+ * of each beat, one point per beat. The MAP is expected where this envelope is maximal. The SBP is the pressure where
+ * the envelope rises the most from one beat to the next before the MAP, the DBP is the pressure where it falls the
+ * most from one beat to the next after the MAP. In both cases, the pressure is taken at the earlier of the two beats.
+ * This is the method prototyped in python/obp_derrivative.py.
+ *
+ * The envelope and its derivative are evaluated incrementally: each beat is looked at exactly once, as soon as its
+ * peak and trough can no longer change, and only the running extrema are kept. The work per sample is therefore
+ * constant and does not grow with the length of the measurement. The measurement is finished when the envelope stayed
+ * below the fraction (ratioDBP - cutoffHyst) of its maximum for three beats after the largest fall was found.
+ * The ratios themselves are not used to find the results and the predictive mode is not supported.
+ */
+class DerivativeDetection : public OBPDetection {
+
+public:
+    explicit DerivativeDetection(double sampling_rate);
+    ~DerivativeDetection() override;
+
+    [[nodiscard]] DetectionAlgorithm getAlgorithm() const override;
+    void reset() override;
+
+protected:
+    bool isEnoughData() override;
+    void findResults(std::span<const double> pressure) override;
+    bool isPredictable(std::span<const double> pressure) override;
+
+private:
+    void resetEnvelope();
+    void addFinalBeat(size_t beat);
+
+    size_t nFinal{};        //!< Number of beats that have been added to the envelope.
+    size_t firstPeakTime{}; //!< Time of the first peak in the beat table, changes if the table was cleared.
+    size_t lastBeat{};      //!< The previous beat that was added to the envelope.
+    double lastAmp{};       //!< Envelope amplitude of the previous beat.
+    double maxAmp{};        //!< Maximal envelope amplitude so far, at the MAP.
+    size_t maxBeat{};       //!< Beat of the maximal envelope amplitude.
+    double maxRise{};       //!< Largest rise of the envelope before the MAP.
+    size_t riseBeat{};      //!< Beat before the largest rise, at the SBP.
+    double pendingRise{};   //!< Largest rise of the envelope since the MAP, only counts if a larger MAP follows.
+    size_t pendingBeat{};   //!< Beat before the largest rise since the MAP.
+    double maxFall{};       //!< Largest fall of the envelope after the MAP.
+    size_t fallBeat{};      //!< Beat before the largest fall, at the DBP.
+    int nBelowCutoff{};     //!< Number of consecutive beats below the cutoff after the MAP.
+};
+
+
+#endif //OBP_DERIVATIVEDETECTION_H
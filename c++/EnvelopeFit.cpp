@@ -0,0 +1,321 @@
+/**
+ * @file        EnvelopeFit.cpp
+ * @brief       The implementation of the EnvelopeFit class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include "EnvelopeFit.h"
+#include "OBPDetection.h"
+
+/**
+ * Fits a model to an envelope.
+ * @param model The model to fit.
+ * @param envelope The envelope points, in ascending time.
+ * @return The fitted model, check valid.
+ */
+EnvelopeFitResult EnvelopeFit::fit(EnvelopeModel model, const Envelope &envelope)
+{
+    if (model == EnvelopeModel::Gaussian)
+    {
+        return fitGaussian(envelope);
+    }
+    return fitPolynomial(envelope);
+}
+
+/**
+ * Fits a polynomial of degree POLYFIT_DEGREE to an envelope with the least squares method.
+ *
+ * The normal equations only depend on the sums of the powers of the time up to twice the degree, so these are
+ * accumulated in one pass over the points and the matrix is built from them afterwards.
+ * @param envelope The envelope points, in ascending time.
+ * @return The fitted polynomial, invalid if there are not enough points or the fit failed.
+ */
+EnvelopeFitResult EnvelopeFit::fitPolynomial(const Envelope &envelope)
+{
+    EnvelopeFitResult fit;
+    fit.model = EnvelopeModel::Polynomial;
+    if (envelope.size() <= POLYFIT_DEGREE || !normaliseTime(envelope, fit))
+    {
+        return fit;
+    }
+
+    constexpr size_t n = POLYFIT_DEGREE + 1;
+    const size_t *times = envelope.timeColumn();
+    const double *amps = envelope.amplitudeColumn();
+    std::array<double, 2 * n - 1> powerSums{};
+    std::array<double, n> coefficients{};
+    for (size_t i = 0; i < envelope.size(); ++i)
+    {
+        const double t = ((double) times[i] - fit.tStart) / fit.tRange;
+        double power = 1.0;
+        for (size_t k = 0; k < 2 * n - 1; ++k)
+        {
+            powerSums[k] += power;
+            if (k < n)
+            {
+                coefficients[k] += power * amps[i];
+            }
+            power *= t;
+        }
+    }
+
+    std::array<std::array<double, n>, n> matrix{};
+    for (size_t row = 0; row < n; ++row)
+    {
+        for (size_t col = 0; col < n; ++col)
+        {
+            matrix[row][col] = powerSums[row + col];
+        }
+    }
+    if (!solve(matrix, coefficients))
+    {
+        return fit;
+    }
+
+    std::copy(coefficients.begin(), coefficients.end(), fit.params.begin());
+    fit.valid = true;
+    fit.iterations = 1;
+    fit.rmsError = std::sqrt(getSquaredError(envelope, fit) / (double) envelope.size());
+    return fit;
+}
+
+/**
+ * Fits an asymmetric Gaussian to an envelope with the Levenberg-Marquardt method.
+ *
+ * The Gaussian has its maximum at the centre and falls off with the left width before and with the right width
+ * after it. The start values are taken from the maximal point and the half maximum crossings on both sides of it.
+ * @param envelope The envelope points, in ascending time.
+ * @return The fitted Gaussian, invalid if there are not enough points or the centre is outside of them.
+ */
+EnvelopeFitResult EnvelopeFit::fitGaussian(const Envelope &envelope)
+{
+    EnvelopeFitResult fit;
+    fit.model = EnvelopeModel::Gaussian;
+    if (envelope.size() <= GAUSS_PARAMS || !normaliseTime(envelope, fit))
+    {
+        return fit;
+    }
+
+    const size_t *times = envelope.timeColumn();
+    const double *amps = envelope.amplitudeColumn();
+    const size_t nPoints = envelope.size();
+
+    // Start values: the maximum and the widths at half maximum, converted to the standard deviation.
+    const size_t maxIdx = std::distance(amps, std::max_element(amps, amps + nPoints));
+    const double centre = ((double) times[maxIdx] - fit.tStart) / fit.tRange;
+    const double halfMax = amps[maxIdx] / 2.0;
+    const double fwhmToSigma = 1.0 / std::sqrt(2.0 * std::log(2.0));
+    size_t left = maxIdx;
+    while (left > 0 && amps[left] > halfMax)
+    {
+        left--;
+    }
+    size_t right = maxIdx;
+    while (right + 1 < nPoints && amps[right] > halfMax)
+    {
+        right++;
+    }
+    fit.params[0] = amps[maxIdx];
+    fit.params[1] = centre;
+    fit.params[2] = std::max(FIT_MIN_WIDTH, (centre - ((double) times[left] - fit.tStart) / fit.tRange) * fwhmToSigma);
+    fit.params[3] = std::max(FIT_MIN_WIDTH, (((double) times[right] - fit.tStart) / fit.tRange - centre) * fwhmToSigma);
+
+    double error = getSquaredError(envelope, fit);
+    double lambda = 1e-3;
+    bool converged = false;
+    for (int iteration = 1; iteration <= FIT_MAX_ITERATIONS && !converged; ++iteration)
+    {
+        fit.iterations = iteration;
+        // Normal equations of the linearised problem: J^T J and J^T r.
+        std::array<std::array<double, GAUSS_PARAMS>, GAUSS_PARAMS> jtj{};
+        std::array<double, GAUSS_PARAMS> jtr{};
+        const double a = fit.params[0];
+        const double mu = fit.params[1];
+        for (size_t i = 0; i < nPoints; ++i)
+        {
+            const double t = ((double) times[i] - fit.tStart) / fit.tRange;
+            const double d = t - mu;
+            const bool isLeft = d < 0.0;
+            const double sigma = isLeft ? fit.params[2] : fit.params[3];
+            const double e = std::exp(-d * d / (2.0 * sigma * sigma));
+            const double dSigma = a * e * d * d / (sigma * sigma * sigma);
+            const std::array<double, GAUSS_PARAMS> jacobian = {e, a * e * d / (sigma * sigma),
+                                                               isLeft ? dSigma : 0.0, isLeft ? 0.0 : dSigma};
+            const double residual = amps[i] - a * e;
+            for (size_t row = 0; row < GAUSS_PARAMS; ++row)
+            {
+                for (size_t col = 0; col < GAUSS_PARAMS; ++col)
+                {
+                    jtj[row][col] += jacobian[row] * jacobian[col];
+                }
+                jtr[row] += jacobian[row] * residual;
+            }
+        }
+
+        // Try steps with increasing damping until the error decreases.
+        bool improved = false;
+        while (!improved && lambda < FIT_MAX_DAMPING)
+        {
+            std::array<std::array<double, GAUSS_PARAMS>, GAUSS_PARAMS> matrix = jtj;
+            std::array<double, GAUSS_PARAMS> step = jtr;
+            for (size_t k = 0; k < GAUSS_PARAMS; ++k)
+            {
+                matrix[k][k] += lambda * jtj[k][k];
+            }
+            EnvelopeFitResult candidate = fit;
+            if (solve(matrix, step))
+            {
+                for (size_t k = 0; k < GAUSS_PARAMS; ++k)
+                {
+                    candidate.params[k] += step[k];
+                }
+            }
+            const bool inBounds = candidate.params[0] > 0.0 && candidate.params[2] >= FIT_MIN_WIDTH &&
+                                  candidate.params[3] >= FIT_MIN_WIDTH;
+            const double candidateError = inBounds ? getSquaredError(envelope, candidate) : error;
+            if (inBounds && candidateError < error)
+            {
+                converged = (error - candidateError) < FIT_TOLERANCE * error;
+                fit.params = candidate.params;
+                error = candidateError;
+                lambda = std::max(lambda / 10.0, 1e-12);
+                improved = true;
+            } else
+            {
+                lambda *= 10.0;
+            }
+        }
+        // No step reduces the error anymore, the fit is at a minimum.
+        converged = converged || !improved;
+    }
+
+    // The maximum has to be within the fitted points, otherwise MAP, SBP and DBP cannot be found on the curve.
+    fit.valid = fit.params[1] >= 0.0 && fit.params[1] <= 1.0;
+    fit.rmsError = std::sqrt(error / (double) nPoints);
+    return fit;
+}
+
+/**
+ * Evaluates a fitted model at a time.
+ * @param fit The fitted model.
+ * @param time The time (sample number).
+ * @return The value of the model.
+ */
+double EnvelopeFit::evaluate(const EnvelopeFitResult &fit, double time)
+{
+    return evaluateNormalised(fit, (time - fit.tStart) / fit.tRange);
+}
+
+/**
+ * Samples a fitted model evenly between the first and the last fitted point, with as many points as the envelope
+ * can hold, but not finer than one sample.
+ * @param fit The fitted model, has to be valid.
+ * @param envelope Returns the sampled model.
+ */
+void EnvelopeFit::sample(const EnvelopeFitResult &fit, Envelope &envelope)
+{
+    envelope.clear();
+    const size_t step = std::max<size_t>(1, (size_t) std::ceil(fit.tRange / (ENVELOPE_CAPACITY - 1)));
+    for (size_t time = (size_t) fit.tStart; time <= (size_t) (fit.tStart + fit.tRange); time += step)
+    {
+        envelope.addPoint(time, evaluate(fit, (double) time));
+    }
+}
+
+/**
+ * Finds the times of the MAP, SBP and DBP on a fitted model with the fixed-ratio method.
+ *
+ * For the Gaussian, the times are calculated directly from its parameters. The polynomial is sampled and searched
+ * like a measured envelope with OBPDetection::findRatioTimes().
+ * @param fit The fitted model, has to be valid.
+ * @param ratioSBP The ratio to find the SBP with.
+ * @param ratioDBP The ratio to find the DBP with.
+ * @param mapTime Returns the time (sample number) of the MAP.
+ * @param sbpTime Returns the time (sample number) of the SBP.
+ * @param dbpTime Returns the time (sample number) of the DBP, only set if it was found.
+ * @return True if the SBP and DBP are within the fitted time range.
+ */
+bool EnvelopeFit::findRatioTimes(const EnvelopeFitResult &fit, double ratioSBP, double ratioDBP, size_t &mapTime,
+                                 size_t &sbpTime, size_t &dbpTime)
+{
+    if (fit.model == EnvelopeModel::Gaussian)
+    {
+        // exp(-d^2 / (2 sigma^2)) = ratio  <=>  d = sigma * sqrt(-2 ln(ratio))
+        const double mu = fit.params[1];
+        const double tSBP = mu - fit.params[2] * std::sqrt(-2.0 * std::log(ratioSBP));
+        const double tDBP = mu + fit.params[3] * std::sqrt(-2.0 * std::log(ratioDBP));
+        const double tMAP = std::clamp(mu, 0.0, 1.0);
+        mapTime = (size_t) std::lround(fit.tStart + tMAP * fit.tRange);
+        sbpTime = (size_t) std::lround(fit.tStart + std::clamp(tSBP, 0.0, 1.0) * fit.tRange);
+        if (tDBP > 1.0)
+        {
+            return false;
+        }
+        dbpTime = (size_t) std::lround(fit.tStart + std::max(tDBP, 0.0) * fit.tRange);
+        return tSBP >= 0.0;
+    }
+
+    Envelope sampled;
+    sample(fit, sampled);
+    bool foundSBP = false;
+    return !sampled.empty() &&
+           OBPDetection::findRatioTimes(sampled, ratioSBP, ratioDBP, mapTime, sbpTime, dbpTime, foundSBP) && foundSBP;
+}
+
+/**
+ * Sets the time normalisation of a fit from the first and the last point of the envelope.
+ * @param envelope The envelope points, in ascending time.
+ * @param fit Returns the start and the range of the time.
+ * @return False if the envelope covers no time.
+ */
+bool EnvelopeFit::normaliseTime(const Envelope &envelope, EnvelopeFitResult &fit)
+{
+    fit.tStart = (double) envelope.time(0);
+    fit.tRange = (double) envelope.time(envelope.size() - 1) - fit.tStart;
+    return fit.tRange > 0.0;
+}
+
+/**
+ * Evaluates a fitted model at a normalised time.
+ * @param fit The fitted model.
+ * @param t The normalised time.
+ * @return The value of the model.
+ */
+double EnvelopeFit::evaluateNormalised(const EnvelopeFitResult &fit, double t)
+{
+    if (fit.model == EnvelopeModel::Gaussian)
+    {
+        const double d = t - fit.params[1];
+        const double sigma = (d < 0.0) ? fit.params[2] : fit.params[3];
+        return fit.params[0] * std::exp(-d * d / (2.0 * sigma * sigma));
+    }
+
+    double value = 0.0;
+    for (size_t k = POLYFIT_DEGREE + 1; k-- > 0;)
+    {
+        value = value * t + fit.params[k];
+    }
+    return value;
+}
+
+/**
+ * Calculates the sum of the squared errors of a model over all points of an envelope.
+ * @param envelope The envelope points.
+ * @param fit The model.
+ * @return The sum of the squared errors.
+ */
+double EnvelopeFit::getSquaredError(const Envelope &envelope, const EnvelopeFitResult &fit)
+{
+    const size_t *times = envelope.timeColumn();
+    const double *amps = envelope.amplitudeColumn();
+    double error = 0.0;
+    for (size_t i = 0; i < envelope.size(); ++i)
+    {
+        const double residual = amps[i] - evaluateNormalised(fit, ((double) times[i] - fit.tStart) / fit.tRange);
+        error += residual * residual;
+    }
+    return error;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file        EnvelopeFit.h
+ * @brief       The header file of the EnvelopeFit class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the EnvelopeFit class and contains the general class description.
+ */
+#ifndef OBP_ENVELOPEFIT_H
+#define OBP_ENVELOPEFIT_H
+
+#include <array>
+#include <cmath>
+#include <utility>
+#include "BeatTable.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define POLYFIT_DEGREE      4   //!< Degree of the polynomial fitted to the envelope.
+#define FIT_MAX_PARAMS      (POLYFIT_DEGREE + 1) //!< Maximal number of parameters of a model.
+#define GAUSS_PARAMS        4   //!< Parameters of the asymmetric Gaussian: amplitude, centre, left and right width.
+#define FIT_MAX_ITERATIONS  50  //!< Maximal number of iterations of the Gaussian fit.
+#define FIT_MIN_WIDTH       1e-3 //!< Minimal width of the Gaussian, relative to the fitted time range.
+#define FIT_TOLERANCE       1e-9 //!< The Gaussian fit stops when the relative error improvement is below this.
+#define FIT_MAX_DAMPING     1e10 //!< The Gaussian fit stops when no step with a damping below this improves.
+
+/**
+ * Enum of the parametric models that can be fitted to an envelope.
+ */
+enum class EnvelopeModel
+{
+    Polynomial,     //!< Polynomial of degree POLYFIT_DEGREE.
+    Gaussian,       //!< Gaussian with different widths before and after its centre.
+};
+
+/**
+ * The parameters of a fitted envelope model.
+ *
+ * The model is defined on the normalised time t = (time - tStart) / tRange, so the fitted points are in [0, 1]. The
+ * polynomial coefficients are in ascending order, the Gaussian parameters are amplitude, centre, left and right width.
+ */
+struct EnvelopeFitResult
+{
+    EnvelopeModel model = EnvelopeModel::Polynomial;    //!< The fitted model.
+    bool valid = false;                                 //!< The fit succeeded.
+    std::array<double, FIT_MAX_PARAMS> params{};        //!< The parameters of the model.
+    double tStart = 0.0;        //!< Time (sample number) of the first fitted point.
+    double tRange = 0.0;        //!< Time (samples) between the first and the last fitted point.
+    double rmsError = 0.0;      //!< The root mean square error of the fit.
+    int iterations = 0;         //!< Number of iterations the fit needed, 1 for the polynomial.
+};
+
+//! The EnvelopeFit class fits parametric models to the oscillometric waveform envelope (OMWE).
+/*!
+ * Two models are available: a polynomial, fitted in one step with the normal equations, and an asymmetric Gaussian,
+ * fitted with the Levenberg-Marquardt method. The MAP, SBP and DBP times are then taken from the fitted curve instead
+ * of the measured points, which makes them less sensitive to single disturbed beats.
+ *
+ * All linear algebra works on fixed-size arrays of at most FIT_MAX_PARAMS, nothing is allocated. The loops over the
+ * envelope points run over its contiguous columns, so the compiler can vectorise them. A fit of a typical envelope
+ * with around 100 points takes a few microseconds for the polynomial and some tens of microseconds for the Gaussian,
+ * so it can be repeated after every beat.
+ */
+class EnvelopeFit {
+
+public:
+    static EnvelopeFitResult fit(EnvelopeModel model, const Envelope &envelope);
+    static EnvelopeFitResult fitPolynomial(const Envelope &envelope);
+    static EnvelopeFitResult fitGaussian(const Envelope &envelope);
+    static double evaluate(const EnvelopeFitResult &fit, double time);
+    static void sample(const EnvelopeFitResult &fit, Envelope &envelope);
+    static bool findRatioTimes(const EnvelopeFitResult &fit, double ratioSBP, double ratioDBP, size_t &mapTime,
+                               size_t &sbpTime, size_t &dbpTime);
+
+    /**
+     * Solves a linear system of equations with Gaussian elimination and partial pivoting.
+     * @tparam N The size of the system.
+     * @param matrix The matrix of the system, is changed.
+     * @param vector The right hand side of the system, returns the solution.
+     * @return False if the matrix is singular.
+     */
+    template<size_t N>
+    static bool solve(std::array<std::array<double, N>, N> &matrix, std::array<double, N> &vector) {
+        for (size_t col = 0; col < N; ++col) {
+            size_t pivot = col;
+            for (size_t row = col + 1; row < N; ++row) {
+                if (std::abs(matrix[row][col]) > std::abs(matrix[pivot][col])) {
+                    pivot = row;
+                }
+            }
+            if (std::abs(matrix[pivot][col]) < 1e-12) {
+                return false;
+            }
+            std::swap(matrix[col], matrix[pivot]);
+            std::swap(vector[col], vector[pivot]);
+            for (size_t row = col + 1; row < N; ++row) {
+                const double factor = matrix[row][col] / matrix[col][col];
+                for (size_t k = col; k < N; ++k) {
+                    matrix[row][k] -= factor * matrix[col][k];
+                }
+                vector[row] -= factor * vector[col];
+            }
+        }
+        for (size_t row = N; row-- > 0;) {
+            for (size_t k = row + 1; k < N; ++k) {
+                vector[row] -= matrix[row][k] * vector[k];
+            }
+            vector[row] /= matrix[row][row];
+        }
+        return true;
+    }
+
+private:
+    static bool normaliseTime(const Envelope &envelope, EnvelopeFitResult &fit);
+    static double evaluateNormalised(const EnvelopeFitResult &fit, double t);
+    static double getSquaredError(const Envelope &envelope, const EnvelopeFitResult &fit);
+};
+
+
+#endif //OBP_ENVELOPEFIT_H
@@ -0,0 +1,427 @@
+/**
+ * @file        ExportTool.cpp
+ * @brief       Command line tool to export recordings as WFDB records or EDF+ files.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * obp_export [-f 16|212|edf] [-j threads] [-o directory] [-r rate] file ...
+ * exports each recording (.obp, .obz, .dat or .obd) with the WaveformExporter, as WFDB record in format 16 (the
+ * default) or 212, or as EDF+ file. The records are written next to the recordings or to the directory given with -o
+ * and are named like the recordings, WFDB records with WFDB_RECORD_SUFFIX appended so their signal file cannot replace
+ * a text recording. Existing files are never replaced, a recording whose record exists already is not exported. The
+ * recordings are exported in parallel by -j threads, the number of processors by default. The sampling rate of text
+ * recordings without time in seconds can be set with -r, the default is SAMPLING_RATE.
+ *
+ * Debug recordings are exported with the ADC counts, the pressure and the filtered signals, and the beats as
+ * annotations. The ADC counts are stored with the calibration of the pressure sensor, the gain in counts per mmHg and
+ * the count at ambient pressure as baseline, so WFDB and EDF tools show them in mmHg; counts with more bits than the
+ * format lose the lowest ones. Binary recordings are exported with the pressure and the results as annotation at the
+ * end. The calibration of the pressure sensor is added as comment to both.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <plog/Init.h>
+#include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include "common.h"
+#include "BeatTable.h"
+#include "DebugRecordReader.h"
+#include "RecordingArchive.h"
+#include "RecordingParser.h"
+#include "RecordingReader.h"
+#include "WaveformExporter.h"
+
+#define EXPORT_BLOCK_FRAMES 4096    //!< The number of frames converted and written at once.
+
+/**
+ * A recording loaded for the export.
+ */
+struct Recording
+{
+    double samplingRate = 0.0;                      //!< The sampling rate in Hz.
+    std::vector<WaveformSignal> signals;            //!< The signals.
+    std::vector<std::vector<double>> channels;      //!< The samples of each signal.
+    std::vector<WaveformAnnotation> annotations;    //!< The annotations.
+    std::vector<std::string> comments;              //!< The comments.
+};
+
+/**
+ * Adds a signal with the range of its samples.
+ * @param recording The recording.
+ * @param label The name of the signal.
+ * @param unit The unit of the samples.
+ * @param resolution The resolution of the samples, 0 if they are not quantized.
+ * @param samples The samples.
+ */
+static void addSignal(Recording &recording, const std::string &label, const std::string &unit, double resolution,
+                      std::vector<double> samples)
+{
+    WaveformSignal signal{label, unit};
+    signal.resolution = resolution;
+    if (!samples.empty())
+    {
+        const auto [min, max] = std::minmax_element(samples.begin(), samples.end());
+        signal.min = *min;
+        signal.max = *max;
+    }
+    recording.signals.push_back(signal);
+    recording.channels.push_back(std::move(samples));
+}
+
+/**
+ * Tells whether the samples are ADC counts.
+ * @param samples The samples.
+ * @return True if all samples are integers from 0 to PARSER_MAX_RAW.
+ */
+static bool isRaw(const std::vector<double> &samples)
+{
+    return std::all_of(samples.begin(), samples.end(), [](double value) {
+        return value >= 0.0 && value < PARSER_MAX_RAW && value == std::floor(value);
+    });
+}
+
+/**
+ * Adds the calibration of the pressure sensor as comment.
+ * @param recording The recording.
+ * @param mmHgPerVolt The calibration of the pressure sensor.
+ * @param ambientVoltage The voltage at ambient pressure.
+ */
+static void addCalibration(Recording &recording, double mmHgPerVolt, double ambientVoltage)
+{
+    char comment[96];
+    std::snprintf(comment, sizeof(comment), "Calibration: %.9g mmHg/V, ambient pressure at %.9g V", mmHgPerVolt,
+                  ambientVoltage);
+    recording.comments.emplace_back(comment);
+}
+
+/**
+ * Adds the ADC counts of a debug recording. If the header holds the range of the ADC, the counts are converted into
+ * mmHg with the calibration and the signal gets the calibration: the gain is the counts per mmHg and the baseline the
+ * count at ambient pressure, so the record holds the counts and reads them back as mmHg. Recordings without the range
+ * of the ADC (version 1) get the counts as they are.
+ * @param recording The recording.
+ * @param header The header of the debug recording.
+ * @param counts The ADC counts.
+ */
+static void addAdcSignal(Recording &recording, const DebugHeader &header, std::vector<double> counts)
+{
+    if (header.maxData == 0 || !(header.rangeMax > header.rangeMin) || !(header.mmHgPerVolt > 0.0))
+    {
+        addSignal(recording, "ADC", "adu", 1.0, std::move(counts));
+        return;
+    }
+    const double countsPerVolt = (double) header.maxData / (header.rangeMax - header.rangeMin);
+    const double gain = countsPerVolt / header.mmHgPerVolt;
+    const double baseline = (header.ambientVoltage - header.rangeMin) * countsPerVolt;
+    for (double &value : counts)
+    {
+        value = (value - baseline) / gain;
+    }
+    addSignal(recording, "Pressure (ADC)", "mmHg", 0.0, std::move(counts));
+    recording.signals.back().gain = gain;
+    recording.signals.back().baseline = baseline;
+
+    char comment[96];
+    std::snprintf(comment, sizeof(comment), "ADC: counts 0 to %u from %.9g V to %.9g V", header.maxData,
+                  header.rangeMin, header.rangeMax);
+    recording.comments.emplace_back(comment);
+}
+
+/**
+ * Loads a binary recording with its results.
+ * @param fileName The name of the recording.
+ * @param recording Returns the recording.
+ * @return False if the recording could not be read.
+ */
+static bool loadBinary(const std::string &fileName, Recording &recording)
+{
+    RecordingReader reader(fileName);
+    if (!reader.isOpen())
+    {
+        return false;
+    }
+    const RecordingHeader &header = reader.getHeader();
+    recording.samplingRate = header.samplingRate;
+    for (size_t channel = 0; channel < header.channels; ++channel)
+    {
+        addSignal(recording, header.channels == 1 ? "Pressure" : "Pressure " + std::to_string(channel + 1), "mmHg",
+                  0.0, reader.getChannel(channel));
+    }
+    addCalibration(recording, header.mmHgPerVolt, header.ambientVoltage);
+    RecordingFooter footer{};
+    if (reader.getFooter(footer) && header.samples > 0)
+    {
+        char results[96];
+        std::snprintf(results, sizeof(results), "MAP %.1f mmHg, SBP %.1f mmHg, DBP %.1f mmHg, HR %.1f bpm",
+                      footer.map, footer.sbp, footer.dbp, footer.heartRate);
+        recording.annotations.push_back(WaveformAnnotation{header.samples - 1, WaveformAnnotationType::note, results});
+    }
+    return true;
+}
+
+/**
+ * Loads a debug recording: the continuous streams as signals, the beats and the state transitions as annotations.
+ * @param fileName The name of the recording.
+ * @param recording Returns the recording.
+ * @return False if the recording could not be read.
+ */
+static bool loadDebug(const std::string &fileName, Recording &recording)
+{
+    DebugRecordReader reader(fileName);
+    if (!reader.isOpen())
+    {
+        return false;
+    }
+    const DebugHeader &header = reader.getHeader();
+    recording.samplingRate = header.samplingRate;
+    addAdcSignal(recording, header, reader.getStream(DebugStream::raw));
+    addSignal(recording, "Pressure", "mmHg", 0.0, reader.getStream(DebugStream::mmHg));
+    addSignal(recording, "Low-pass", "mmHg", 0.0, reader.getStream(DebugStream::lowPass));
+    addSignal(recording, "Oscillation", "mmHg", 0.0, reader.getStream(DebugStream::highPass));
+    addCalibration(recording, header.mmHgPerVolt, header.ambientVoltage);
+    for (const DebugEvent &event : reader.getEvents(DebugStream::peaks))
+    {
+        const bool artifact = event.flags == (uint32_t) BeatType::Artifact;
+        recording.annotations.push_back(WaveformAnnotation{
+                event.sample, artifact ? WaveformAnnotationType::artifact : WaveformAnnotationType::beat, ""});
+    }
+    for (const DebugEvent &event : reader.getEvents(DebugStream::state))
+    {
+        recording.annotations.push_back(WaveformAnnotation{
+                event.sample, WaveformAnnotationType::note, "State " + std::to_string((int) event.value)});
+    }
+    return true;
+}
+
+/**
+ * Loads a compressed archive, the first channel is the time of the text recording and is left out.
+ * @param fileName The name of the archive.
+ * @param recording Returns the recording.
+ * @return False if the archive could not be read.
+ */
+static bool loadArchive(const std::string &fileName, Recording &recording)
+{
+    RecordingArchive archive(fileName);
+    if (!archive.isOpen())
+    {
+        return false;
+    }
+    const ArchiveHeader &header = archive.getHeader();
+    recording.samplingRate = header.samplingRate;
+    for (size_t channel = 1; channel < header.channels; ++channel)
+    {
+        std::vector<double> samples = archive.getChannel(channel);
+        const bool raw = isRaw(samples);
+        addSignal(recording, "Channel " + std::to_string(channel), raw ? "adu" : "", raw ? 1.0 : 0.0,
+                  std::move(samples));
+    }
+    return true;
+}
+
+/**
+ * Loads a text recording.
+ * @param fileName The name of the recording.
+ * @param samplingRate The sampling rate if the time is no seconds.
+ * @param recording Returns the recording.
+ * @return False if the recording could not be read.
+ */
+static bool loadText(const std::string &fileName, double samplingRate, Recording &recording)
+{
+    RecordingParser parser;
+    if (!parser.load(fileName))
+    {
+        return false;
+    }
+    // The rate estimated from the time column is rounded to mHz, the time is printed with a few decimals only.
+    recording.samplingRate = parser.getSamplingRate() > 0.0 ? std::round(parser.getSamplingRate() * 1000.0) / 1000.0 :
+                             samplingRate;
+    for (size_t channel = 0; channel + 1 < parser.getColumnCount(); ++channel)
+    {
+        addSignal(recording, "Channel " + std::to_string(channel + 1), parser.isRaw() ? "adu" : "",
+                  parser.isRaw() ? 1.0 : 0.0, parser.getChannel(channel));
+    }
+    return true;
+}
+
+/**
+ * Gets the start of a recording from its name, which starts with the time as yyyy_MM_dd_hh_mm_ss.
+ * @param name The name of the recording without directory.
+ * @return The start in local time, 0 if the name holds no time.
+ */
+static std::time_t getStartTime(const std::string &name)
+{
+    std::tm local{};
+    if (std::sscanf(name.c_str(), "%4d_%2d_%2d_%2d_%2d_%2d", &local.tm_year, &local.tm_mon, &local.tm_mday,
+                    &local.tm_hour, &local.tm_min, &local.tm_sec) != 6)
+    {
+        return 0;
+    }
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_isdst = -1;
+    return std::mktime(&local);
+}
+
+/**
+ * Exports a recording.
+ * @param fileName The name of the recording.
+ * @param format The format of the export.
+ * @param directory The directory of the export, empty for the directory of the recording.
+ * @param samplingRate The sampling rate of text recordings without time in seconds.
+ * @return The name of the record, empty if the recording could not be exported.
+ */
+static std::string exportRecording(const std::string &fileName, WaveformFormat format, const std::string &directory,
+                                   double samplingRate)
+{
+    const size_t slash = fileName.find_last_of('/');
+    const size_t dot = fileName.find_last_of('.');
+    const std::string extension = dot == std::string::npos || (slash != std::string::npos && dot < slash) ? "" :
+                                  fileName.substr(dot);
+    const std::string name = fileName.substr(slash == std::string::npos ? 0 : slash + 1,
+                                             fileName.size() - extension.size() - (slash + 1));
+    const std::string baseName = WaveformExporter::getRecordName(
+            (directory.empty() ? fileName.substr(0, slash + 1) : directory + "/") + name, format);
+
+    Recording recording;
+    bool loaded;
+    if (extension == RECORDING_EXTENSION)
+    {
+        loaded = loadBinary(fileName, recording);
+    } else if (extension == DEBUG_EXTENSION)
+    {
+        loaded = loadDebug(fileName, recording);
+    } else if (extension == ARCHIVE_EXTENSION)
+    {
+        loaded = loadArchive(fileName, recording);
+    } else
+    {
+        loaded = loadText(fileName, samplingRate, recording);
+    }
+    if (!loaded || recording.signals.empty())
+    {
+        PLOG_WARNING << "Could not load " << fileName;
+        return "";
+    }
+
+    WaveformExporter exporter;
+    if (!exporter.open(baseName, format, recording.samplingRate, recording.signals, getStartTime(name)))
+    {
+        return "";
+    }
+    for (const std::string &comment : recording.comments)
+    {
+        exporter.addComment(comment);
+    }
+    for (const WaveformAnnotation &annotation : recording.annotations)
+    {
+        exporter.addAnnotation(annotation);
+    }
+
+    // The channels are interleaved into frames block by block.
+    const size_t nsig = recording.channels.size();
+    size_t samples = recording.channels[0].size();
+    for (const std::vector<double> &channel : recording.channels)
+    {
+        samples = std::min(samples, channel.size());
+    }
+    std::vector<double> frames(EXPORT_BLOCK_FRAMES * nsig);
+    bool success = true;
+    for (size_t first = 0; first < samples && success; first += EXPORT_BLOCK_FRAMES)
+    {
+        const size_t count = std::min<size_t>(EXPORT_BLOCK_FRAMES, samples - first);
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (size_t signal = 0; signal < nsig; ++signal)
+            {
+                frames[i * nsig + signal] = recording.channels[signal][first + i];
+            }
+        }
+        success = exporter.addSamples(frames.data(), count);
+    }
+    success = exporter.close() && success;
+    return success ? baseName + WaveformExporter::getExtension(format) : "";
+}
+
+int main(int argc, char **argv)
+{
+    static plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender);
+
+    WaveformFormat format = WaveformFormat::wfdb16;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string directory;
+    double samplingRate = SAMPLING_RATE;
+    std::vector<std::string> files;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "-f") == 0 && hasValue)
+        {
+            const std::string name = argv[++i];
+            valid = name == "16" || name == "212" || name == "edf";
+            format = name == "212" ? WaveformFormat::wfdb212 : name == "edf" ? WaveformFormat::edf :
+                     WaveformFormat::wfdb16;
+        } else if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+        {
+            threads = (size_t) std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "-o") == 0 && hasValue)
+        {
+            directory = argv[++i];
+        } else if (std::strcmp(argv[i], "-r") == 0 && hasValue)
+        {
+            samplingRate = std::stod(argv[++i]);
+        } else
+        {
+            files.emplace_back(argv[i]);
+        }
+    }
+    if (!valid || files.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [-f 16|212|edf] [-j threads] [-o directory] [-r samplingRate] file ..."
+                  << std::endl;
+        return 2;
+    }
+
+    // Every thread takes the next recording until all are exported.
+    std::atomic<size_t> next{0};
+    std::atomic<int> ret{0};
+    std::mutex outputMutex;
+    auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++)
+        {
+            const std::string record = exportRecording(files[i], format, directory, samplingRate);
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (record.empty())
+            {
+                std::cout << files[i] << ": failed" << std::endl;
+                ret = 1;
+            } else
+            {
+                std::cout << files[i] << " -> " << record << std::endl;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(threads, files.size()); ++i)
+    {
+        workers.emplace_back(worker);
+    }
+    for (std::thread &thread : workers)
+    {
+        thread.join();
+    }
+    return ret;
+}
@@ -0,0 +1,294 @@
+/**
+ * @file        FlightRecorder.cpp
+ * @brief       The implementation of the FlightRecorder class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "MappedFile.h"
+#include "FlightRecorder.h"
+
+static_assert(std::atomic_ref<uint64_t>::is_always_lock_free, "The counters of the flight recorder need lock-free "
+                                                              "atomics to be read from another process.");
+
+/**
+ * Destructor of the FlightRecorder. Releases the mapping, the file keeps its content.
+ */
+FlightRecorder::~FlightRecorder()
+{
+    close();
+}
+
+/**
+ * Creates the file of the flight recorder and maps it. The space of the file is reserved, so a full disk cannot
+ * interrupt the acquisition later. An existing file is kept with FLIGHT_PREVIOUS appended to its name, a file that is
+ * already open is closed first.
+ * @param fileName The name of the file, should end with FLIGHT_EXTENSION.
+ * @param samplingRate The sampling rate of the samples.
+ * @param capacity The number of samples the file holds.
+ * @param eventCapacity The number of events the file holds.
+ * @return False if the file could not be created, the recorder ignores all samples then.
+ */
+bool FlightRecorder::open(const std::string &fileName, double samplingRate, uint64_t capacity, uint64_t eventCapacity)
+{
+    close();
+    if (capacity == 0 || eventCapacity == 0)
+    {
+        PLOG_WARNING << "Flight recorder " << fileName << " needs room for samples and events";
+        return false;
+    }
+
+    struct stat status{};
+    if (stat(fileName.c_str(), &status) == 0 && std::rename(fileName.c_str(), (fileName + FLIGHT_PREVIOUS).c_str()))
+    {
+        PLOG_WARNING << "Could not keep the previous flight recorder " << fileName;
+    }
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    const FlightHeader created = FlightHeader::create(samplingRate, capacity, eventCapacity, milliseconds);
+    const int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        PLOG_WARNING << "Could not create flight recorder " << fileName;
+        return false;
+    }
+    if (posix_fallocate(fd, 0, (off_t) created.fileSize()) != 0)
+    {
+        PLOG_WARNING << "Could not reserve " << created.fileSize() << " bytes for flight recorder " << fileName;
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, created.fileSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        PLOG_WARNING << "Could not map flight recorder " << fileName;
+        return false;
+    }
+
+    auto *mapping = static_cast<unsigned char *>(mapped);
+    mappingSize = created.fileSize();
+    header = static_cast<FlightHeader *>(mapped);
+    std::memcpy(header, &created, sizeof(FlightHeader));
+    samples = reinterpret_cast<float *>(mapping + created.headerSize);
+    events = reinterpret_cast<DebugEvent *>(mapping + created.eventsOffset());
+    nsample = 0;
+    nevent = 0;
+    position = 0;
+    return true;
+}
+
+/**
+ * Releases the mapping. The kernel writes the content that is not written yet to the file.
+ */
+void FlightRecorder::close()
+{
+    if (header != nullptr)
+    {
+        munmap(header, mappingSize);
+    }
+    header = nullptr;
+    mappingSize = 0;
+    samples = nullptr;
+    events = nullptr;
+}
+
+/**
+ * @return True if the file of the flight recorder is open.
+ */
+bool FlightRecorder::isOpen() const
+{
+    return header != nullptr;
+}
+
+/**
+ * Stores the calibration the voltages are converted to mmHg with when a part is extracted.
+ * @param mmHgPerVolt The calibration of the pressure sensor.
+ * @param ambientVoltage The voltage at ambient pressure.
+ */
+void FlightRecorder::setCalibration(double mmHgPerVolt, double ambientVoltage)
+{
+    if (header == nullptr)
+    {
+        return;
+    }
+    header->mmHgPerVolt = mmHgPerVolt;
+    header->ambientVoltage = ambientVoltage;
+}
+
+/**
+ * Adds a sample, the oldest sample is overwritten when the ring is full.
+ * @param voltage The voltage of the pressure sensor.
+ */
+void FlightRecorder::addSample(double voltage)
+{
+    if (header == nullptr)
+    {
+        return;
+    }
+    samples[position] = (float) voltage;
+    if (++position == header->capacity)
+    {
+        position = 0;
+    }
+    std::atomic_ref<uint64_t>(header->samples).store(++nsample, std::memory_order_release);
+}
+
+/**
+ * Adds an event at the next sample, the oldest event is overwritten when the ring is full.
+ * @param type The kind of event.
+ * @param value The value of the event, depends on the type.
+ */
+void FlightRecorder::addEvent(FlightEventType type, double value)
+{
+    if (header == nullptr)
+    {
+        return;
+    }
+    events[nevent % header->eventCapacity] = DebugEvent{nsample, (float) value, (uint32_t) type};
+    std::atomic_ref<uint64_t>(header->events).store(++nevent, std::memory_order_release);
+}
+
+/**
+ * @return The number of samples added since the file was opened.
+ */
+uint64_t FlightRecorder::getSampleCount() const
+{
+    return nsample;
+}
+
+/**
+ * Copies the values of a ring in the order they were written, oldest first. The slot the writer stores the next
+ * value in is left out, so capacity - 1 values are copied at most.
+ * @tparam T The type of the values.
+ * @param ring The ring in the mapping.
+ * @param capacity The number of values the ring holds.
+ * @param counter The counter of the values written in the mapping.
+ * @param first Returns the number of the first value copied.
+ * @param values Returns the values.
+ */
+template<typename T>
+static void copyRing(const T *ring, uint64_t capacity, uint64_t &counter, uint64_t &first, std::vector<T> &values)
+{
+    const uint64_t written = std::atomic_ref<uint64_t>(counter).load(std::memory_order_acquire);
+    first = written >= capacity ? written + 1 - capacity : 0;
+    values.resize(written - first);
+    const size_t start = first % capacity;
+    const size_t head = std::min<size_t>(values.size(), capacity - start);
+    std::memcpy(values.data(), ring + start, head * sizeof(T));
+    std::memcpy(values.data() + head, ring, (values.size() - head) * sizeof(T));
+
+    // The writer may have overwritten the oldest values while they were copied, also the one it is writing now.
+    const uint64_t after = std::atomic_ref<uint64_t>(counter).load(std::memory_order_acquire);
+    if (after + 1 > capacity && after + 1 - capacity > first)
+    {
+        const auto dropped = (size_t) std::min<uint64_t>(after + 1 - capacity - first, values.size());
+        values.erase(values.begin(), values.begin() + (ptrdiff_t) dropped);
+        first += dropped;
+    }
+}
+
+/**
+ * Reads the content of a flight recorder file, also while it is written by a running application.
+ * @param fileName The name of the file.
+ * @param header Returns the header, with the counters at the time the values were copied.
+ * @param first Returns the sample number of the first sample.
+ * @param voltages Returns the samples, oldest first.
+ * @param events Returns the events, oldest first.
+ * @return False if the file could not be mapped or is no valid flight recorder file.
+ */
+bool FlightRecorder::read(const std::string &fileName, FlightHeader &header, uint64_t &first,
+                          std::vector<float> &voltages, std::vector<DebugEvent> &events)
+{
+    // Shared, so the samples a running application adds are seen.
+    MappedFile file;
+    if (!file.map(fileName, sizeof(FlightHeader), "flight recorder", true))
+    {
+        return false;
+    }
+    const size_t size = file.size();
+    const unsigned char *mapping = file.data();
+    auto *mappedHeader = reinterpret_cast<FlightHeader *>(const_cast<unsigned char *>(mapping));
+    std::memcpy(&header, mappedHeader, sizeof(FlightHeader));
+    if (std::memcmp(header.magic, FLIGHT_MAGIC, sizeof(header.magic)) != 0 || header.version < 1 ||
+        header.version > FLIGHT_VERSION || header.headerSize < sizeof(FlightHeader) || header.capacity == 0 ||
+        header.eventCapacity == 0 || header.capacity > size / sizeof(float) ||
+        header.eventCapacity > size / sizeof(DebugEvent) || header.fileSize() > size)
+    {
+        PLOG_WARNING << "Flight recorder " << fileName << " has an invalid header";
+        return false;
+    }
+
+    // The counters are only loaded, the mapping is never written.
+    uint64_t firstEvent;
+    copyRing(reinterpret_cast<const float *>(mapping + header.headerSize), header.capacity, mappedHeader->samples,
+             first, voltages);
+    copyRing(reinterpret_cast<const DebugEvent *>(mapping + header.eventsOffset()), header.eventCapacity,
+             mappedHeader->events, firstEvent, events);
+    header.samples = first + voltages.size();
+    header.events = firstEvent + events.size();
+    return true;
+}
+
+/**
+ * Writes a part of the samples of a flight recorder file as binary recording. The voltages are converted to mmHg
+ * with the calibration in the file.
+ * @param fileName The name of the flight recorder file.
+ * @param recordingName The name of the recording, should end with RECORDING_EXTENSION.
+ * @param first The sample number of the first sample of the part.
+ * @param count The number of samples, the part is limited to the samples the file still holds.
+ * @return False if the file could not be read, holds no samples of the part or the recording could not be written.
+ */
+bool FlightRecorder::extract(const std::string &fileName, const std::string &recordingName, uint64_t first,
+                             uint64_t count)
+{
+    FlightHeader header{};
+    uint64_t start;
+    std::vector<float> voltages;
+    std::vector<DebugEvent> flightEvents;
+    if (!read(fileName, header, start, voltages, flightEvents))
+    {
+        return false;
+    }
+    const uint64_t begin = std::max(first, start);
+    const uint64_t end = std::min(first + std::min(count, UINT64_MAX - first), start + voltages.size());
+    if (begin >= end)
+    {
+        PLOG_WARNING << "Flight recorder " << fileName << " holds no samples from " << first;
+        return false;
+    }
+
+    std::vector<float> mmHg(end - begin);
+    for (size_t i = 0; i < mmHg.size(); ++i)
+    {
+        mmHg[i] = (float) ((voltages[begin - start + i] - header.ambientVoltage) * header.mmHgPerVolt);
+    }
+    char recordingHeader[RECORDING_HEADER_SIZE] = {};
+    const RecordingHeader created = RecordingHeader::create(header.samplingRate, header.mmHgPerVolt,
+                                                            header.ambientVoltage, 1, mmHg.size());
+    std::memcpy(recordingHeader, &created, sizeof(RecordingHeader));
+
+    std::FILE *file = std::fopen(recordingName.c_str(), "wb");
+    bool success = file != nullptr && std::fwrite(recordingHeader, sizeof(recordingHeader), 1, file) == 1 &&
+                   std::fwrite(mmHg.data(), sizeof(float), mmHg.size(), file) == mmHg.size();
+    if (file != nullptr && std::fclose(file) != 0)
+    {
+        success = false;
+    }
+    if (!success)
+    {
+        PLOG_WARNING << "Could not write recording " << recordingName;
+    }
+    return success;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file        FlightRecorder.h
+ * @brief       The header file of the FlightRecorder class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the FlightRecorder class and contains the general class description.
+ */
+#ifndef OBP_FLIGHTRECORDER_H
+#define OBP_FLIGHTRECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RecordingFormat.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define FLIGHT_FILE         "obp_flight.obf"    //!< The file of the flight recorder of the application.
+#define FLIGHT_MINUTES      10                  //!< The minutes of samples in the flight recorder of the application.
+#define FLIGHT_EVENTS       4096                //!< The number of events the flight recorder of the application holds.
+#define FLIGHT_PREVIOUS     ".prev"             //!< Appended to the name of the file of the previous run.
+
+//! The FlightRecorder class keeps the last minutes of the signal in a file that survives a crash.
+/*!
+ * The Datarecord only records while a measurement is running. To see what the signal looked like before a fault or a
+ * bad reading, also while Idle, the flight recorder is always on: it keeps the voltages of the pressure sensor of the
+ * last minutes and the events of the state machine in two rings in a file of fixed size. The format is described at
+ * the FlightHeader in RecordingFormat.h.
+ *
+ * The file is mapped into memory shared, so adding a sample is a store into the mapping and an atomic increment of
+ * the counter, without locks, system calls or a writer thread. The kernel writes the mapping back to the file, also
+ * after the application crashed. Only one thread may add samples and events.
+ *
+ * When the file is opened, the file of the previous run is kept with FLIGHT_PREVIOUS appended, so a crash can still
+ * be looked at after the application was restarted. read() takes the content of a file while it is written and
+ * extract() writes a part of it as binary recording, both are used by the obp_flight tool.
+ */
+class FlightRecorder {
+
+public:
+    FlightRecorder() = default;
+    ~FlightRecorder();
+    FlightRecorder(const FlightRecorder &) = delete;
+    FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+    bool open(const std::string &fileName, double samplingRate, uint64_t capacity, uint64_t eventCapacity);
+    void close();
+    [[nodiscard]] bool isOpen() const;
+    void setCalibration(double mmHgPerVolt, double ambientVoltage);
+    void addSample(double voltage);
+    void addEvent(FlightEventType type, double value);
+    [[nodiscard]] uint64_t getSampleCount() const;
+
+    static bool read(const std::string &fileName, FlightHeader &header, uint64_t &first, std::vector<float> &voltages,
+                     std::vector<DebugEvent> &events);
+    static bool extract(const std::string &fileName, const std::string &recordingName, uint64_t first,
+                        uint64_t count);
+
+private:
+    FlightHeader *header = nullptr;     //!< The header in the mapping, nullptr if closed.
+    size_t mappingSize = 0;             //!< The size of the mapping in bytes.
+    float *samples = nullptr;           //!< The ring of samples in the mapping.
+    DebugEvent *events = nullptr;       //!< The ring of events in the mapping.
+    uint64_t nsample = 0;               //!< The number of samples written.
+    uint64_t nevent = 0;                //!< The number of events written.
+    uint64_t position = 0;              //!< The index in the ring of samples the next sample is stored at.
+};
+
+
+#endif //OBP_FLIGHTRECORDER_H
@@ -0,0 +1,166 @@
+/**
+ * @file        FlightTool.cpp
+ * @brief       Command line tool to look at the flight recorder and extract parts of it.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * obp_flight file.obf                                  prints the time span of the samples the flight recorder holds
+ *                                                      and all its events.
+ * obp_flight [-b seconds] [-l seconds] file.obf out.obp
+ *                                                      writes a part of the samples as binary recording and prints
+ *                                                      the events within it. The part starts the given seconds before
+ *                                                      the last sample, the default is the oldest sample, and lasts
+ *                                                      the given seconds, the default is up to the last sample.
+ * The file can be read while the application is running.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <plog/Init.h>
+#include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include "common.h"
+#include "FlightRecorder.h"
+
+/**
+ * The names of the states of the Processing, in the order of its ProcState.
+ */
+static const char *const stateNames[] = {"Config", "Idle", "Inflate", "Deflate", "Empty", "Results"};
+
+/**
+ * Formats the time of a sample as local date and time.
+ * @param header The header of the flight recorder.
+ * @param sample The sample number.
+ * @return The time with milliseconds.
+ */
+static std::string formatTime(const FlightHeader &header, uint64_t sample)
+{
+    const auto ms = header.startTime + (int64_t) std::llround((double) sample * 1000.0 / header.samplingRate);
+    const auto seconds = (time_t) (ms / 1000);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    char text[40];
+    const size_t length = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(text + length, sizeof(text) - length, ".%03d", (int) (ms % 1000));
+    return text;
+}
+
+/**
+ * Prints the events from a sample on.
+ * @param header The header of the flight recorder.
+ * @param events The events.
+ * @param first The first sample, the sample numbers are printed relative to it.
+ * @param end The sample after the last sample.
+ */
+static void printEvents(const FlightHeader &header, const std::vector<DebugEvent> &events, uint64_t first,
+                        uint64_t end)
+{
+    for (const DebugEvent &event : events)
+    {
+        if (event.sample < first || event.sample > end)
+        {
+            continue;
+        }
+        std::cout << formatTime(header, event.sample) << "  sample " << event.sample - first << "  ";
+        switch ((FlightEventType) event.flags)
+        {
+            case FlightEventType::state:
+                if (event.value >= 0 && event.value < (float) std::size(stateNames))
+                {
+                    std::cout << "state " << stateNames[(size_t) event.value];
+                } else
+                {
+                    std::cout << "state " << event.value;
+                }
+                break;
+            case FlightEventType::ambient:
+                std::cout << "ambient pressure at " << event.value << " V";
+                break;
+            case FlightEventType::cancelled:
+                std::cout << "measurement cancelled at " << event.value << " mmHg";
+                break;
+            default:
+                std::cout << "unknown event " << event.flags << ": " << event.value;
+                break;
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender);
+
+    double before = -1.0;
+    double length = -1.0;
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-'; i += 2)
+    {
+        if (std::strcmp(argv[i], "-b") == 0)
+        {
+            before = std::stod(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "-l") == 0)
+        {
+            length = std::stod(argv[i + 1]);
+        } else
+        {
+            break;
+        }
+    }
+    if (argc - i < 1 || argc - i > 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " file" << FLIGHT_EXTENSION << "\n"
+                  << "       " << argv[0] << " [-b seconds] [-l seconds] file" << FLIGHT_EXTENSION << " out"
+                  << RECORDING_EXTENSION << std::endl;
+        return 2;
+    }
+
+    FlightHeader header{};
+    uint64_t first;
+    std::vector<float> voltages;
+    std::vector<DebugEvent> events;
+    if (!FlightRecorder::read(argv[i], header, first, voltages, events))
+    {
+        return 1;
+    }
+    const uint64_t end = first + voltages.size();
+    if (argc - i == 1)
+    {
+        std::cout << argv[i] << ": " << voltages.size() << " samples at " << header.samplingRate << " Hz";
+        if (!voltages.empty())
+        {
+            std::cout << " from " << formatTime(header, first) << " to " << formatTime(header, end - 1);
+        }
+        std::cout << ", " << events.size() << " events\n";
+        printEvents(header, events, 0, end);
+        return 0;
+    }
+
+    uint64_t start = first;
+    if (before >= 0.0)
+    {
+        const auto samples = (uint64_t) std::llround(before * header.samplingRate);
+        start = std::max(first, end - std::min(samples, end));
+    }
+    uint64_t count = end - start;
+    if (length >= 0.0)
+    {
+        count = std::min(count, (uint64_t) std::llround(length * header.samplingRate));
+    }
+    if (!FlightRecorder::extract(argv[i], argv[i + 1], start, count))
+    {
+        return 1;
+    }
+    std::cout << argv[i + 1] << ": " << count << " samples from " << formatTime(header, start) << "\n";
+    printEvents(header, events, start, start + count);
+    return 0;
+}
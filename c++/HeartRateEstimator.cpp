@@ -0,0 +1,180 @@
+/**
+ * @file        HeartRateEstimator.cpp
+ * @brief       The implementation of the HeartRateEstimator class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include "common.h"
+#include "HeartRateEstimator.h"
+
+/**
+ * Constructor of the HeartRateEstimator class, set up for the default sampling rate and heart rate range.
+ */
+HeartRateEstimator::HeartRateEstimator()
+{
+    reset(SAMPLING_RATE, 50.0, 120.0);
+}
+
+/**
+ * Resets the estimator to start a new measurement.
+ * @param samplingRate The sampling rate of the oscillation.
+ * @param minHR The min. valid heart rate in bpm, defines the longest period.
+ * @param maxHR The max. valid heart rate in bpm, defines the shortest period.
+ */
+void HeartRateEstimator::reset(double samplingRate, double minHR, double maxHR)
+{
+    decimation = std::max<size_t>(1, (size_t) std::lround(samplingRate / HR_DECIMATED_RATE));
+    decimatedRate = samplingRate / (double) decimation;
+    window = std::max<size_t>(1, (size_t) std::lround(HR_WINDOW_TIME * decimatedRate));
+    minLag = std::max<size_t>(1, (size_t) std::floor(60.0 * decimatedRate / maxHR));
+    maxLag = std::max(minLag, (size_t) std::ceil(60.0 * decimatedRate / minHR));
+    minSamples = (size_t) std::lround(HR_MIN_TIME * decimatedRate);
+
+    samples.assign(window + maxLag + 2, 0.0);
+    sums.assign(maxLag + 2, 0.0);
+    blockCount = 0;
+    blockSum = 0.0;
+    nSamples = 0;
+    correlation = 0.0;
+    estimates.clear();
+}
+
+/**
+ * Processes one sample of the oscillation.
+ * @param oscillation The (high-pass filtered) oscillation.
+ * @return True if a new, stable estimate of the heart rate was found.
+ */
+bool HeartRateEstimator::processSample(double oscillation)
+{
+    blockSum += oscillation;
+    if (++blockCount < decimation)
+    {
+        return false;
+    }
+    addDecimated(blockSum / (double) decimation);
+    blockCount = 0;
+    blockSum = 0.0;
+    return estimate();
+}
+
+/**
+ * Gets the estimated heart rate, the median of the last estimates if they agree.
+ * @return The heart rate in bpm, 0.0 if there is no stable estimate (yet).
+ */
+double HeartRateEstimator::getHeartRate() const
+{
+    if (!estimates.full() || estimates.sigma() > HR_MAX_SPREAD)
+    {
+        return 0.0;
+    }
+    return estimates.median();
+}
+
+/**
+ * Gets the normalised autocorrelation at the period of the last estimate, a measure of how periodic the signal is.
+ * @return The correlation between 0.0 and 1.0, 0.0 if there is no estimate yet.
+ */
+double HeartRateEstimator::getCorrelation() const
+{
+    return correlation;
+}
+
+/**
+ * Adds a decimated sample and updates the sums of the autocorrelation for all lags.
+ * @param value The decimated sample.
+ */
+void HeartRateEstimator::addDecimated(double value)
+{
+    const size_t n = nSamples;
+    samples[n % samples.size()] = value;
+    for (size_t lag = 0; lag < sums.size() && lag <= n; ++lag)
+    {
+        sums[lag] += value * getSample(n - lag);
+        // The product of the sample that left the window.
+        if (n >= window && n - window >= lag)
+        {
+            sums[lag] -= getSample(n - window) * getSample(n - window - lag);
+        }
+    }
+    nSamples++;
+}
+
+/**
+ * Finds the period in the autocorrelation and adds the heart rate to the estimates.
+ * @return True if the signal is periodic enough for an estimate and the estimates are stable.
+ */
+bool HeartRateEstimator::estimate()
+{
+    if (nSamples < minSamples || sums[0] <= 0.0)
+    {
+        return false;
+    }
+
+    // The largest local maximum within the valid range.
+    double best = 0.0;
+    for (size_t lag = minLag; lag <= maxLag; ++lag)
+    {
+        const double value = getNormalised(lag);
+        if (value > best && value >= getNormalised(lag - 1) && value >= getNormalised(lag + 1))
+        {
+            best = value;
+        }
+    }
+    if (best < HR_MIN_CORRELATION)
+    {
+        return false;
+    }
+
+    // The shortest period that correlates almost as well, the others are multiples of it.
+    size_t period = minLag;
+    for (; period < maxLag; ++period)
+    {
+        const double value = getNormalised(period);
+        if (value >= HR_HARMONIC_RATIO * best && value >= getNormalised(period - 1) &&
+            value >= getNormalised(period + 1))
+        {
+            break;
+        }
+    }
+
+    // Refine the period with a parabola through the neighbours.
+    const double before = getNormalised(period - 1);
+    const double at = getNormalised(period);
+    const double after = getNormalised(period + 1);
+    const double curvature = before - 2.0 * at + after;
+    const double offset = (curvature < 0.0) ? 0.5 * (before - after) / curvature : 0.0;
+
+    correlation = at;
+    estimates.add(60.0 * decimatedRate / ((double) period + offset));
+    return getHeartRate() > 0.0;
+}
+
+/**
+ * Gets a decimated sample from the ring buffer.
+ * @param n The index of the sample since the reset, has to be within the buffer.
+ * @return The sample.
+ */
+double HeartRateEstimator::getSample(size_t n) const
+{
+    return samples[n % samples.size()];
+}
+
+/**
+ * Gets the autocorrelation at a lag, normalised by the number of products and the correlation at lag 0.
+ * @param lag The lag in decimated samples, up to maxLag + 1.
+ * @return The normalised autocorrelation, 0.0 if there are too few products for the lag.
+ */
+double HeartRateEstimator::getNormalised(size_t lag) const
+{
+    const size_t count0 = std::min(window, nSamples);
+    const size_t count = (nSamples > lag) ? std::min(window, nSamples - lag) : 0;
+    if (count < window / 4 || count0 == 0 || sums[0] <= 0.0)
+    {
+        return 0.0;
+    }
+    return (sums[lag] / (double) count) / (sums[0] / (double) count0);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file        HeartRateEstimator.h
+ * @brief       The header file of the HeartRateEstimator class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the HeartRateEstimator class and contains the general class description.
+ */
+#ifndef OBP_HEARTRATEESTIMATOR_H
+#define OBP_HEARTRATEESTIMATOR_H
+
+#include <cstddef>
+#include <vector>
+#include "SlidingMedian.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define HR_DECIMATED_RATE   50.0    //!< Sampling rate in Hz the oscillation is decimated to.
+#define HR_WINDOW_TIME      2.0     //!< Length of the window the autocorrelation is summed over, in s.
+#define HR_MIN_TIME         1.5     //!< Min. length of the signal before the first estimate, in s.
+#define HR_MIN_CORRELATION  0.6     //!< Min. normalised autocorrelation at the period for a valid estimate.
+#define HR_HARMONIC_RATIO   0.8     //!< Shorter periods with this fraction of the largest correlation are preferred.
+#define HR_SMOOTH_COUNT     25      //!< Number of estimates the published heart rate is the median of.
+#define HR_MAX_SPREAD       3.0     //!< Max. spread (scaled MAD) of the estimates in bpm to publish the median.
+
+//! The HeartRateEstimator class estimates the heart rate from the oscillation before single beats are confirmed.
+/*!
+ * The beat detection needs at least two accepted peaks before a heart rate is known. The oscillation is periodic
+ * with the heart rate long before that, so the period can be found from the autocorrelation of the signal.
+ *
+ * The oscillation is decimated to HR_DECIMATED_RATE by averaging blocks of samples. For every decimated sample, the
+ * autocorrelation is updated incrementally for all lags up to the period of the min. heart rate: the product of the
+ * new sample with the sample one lag earlier is added and the product that left the window of HR_WINDOW_TIME is
+ * subtracted, so the work per sample is constant. The period is the lag of the largest normalised autocorrelation
+ * within the valid heart rate range, refined by a parabola through its neighbours. A multiple of the period
+ * correlates as well as the period itself, so the shortest lag that reaches HR_HARMONIC_RATIO of the largest
+ * correlation is taken. The heart rate is only published once the last HR_SMOOTH_COUNT estimates agree within
+ * HR_MAX_SPREAD, it is their running median.
+ */
+class HeartRateEstimator {
+
+public:
+    HeartRateEstimator();
+
+    void reset(double samplingRate, double minHR, double maxHR);
+    bool processSample(double oscillation);
+
+    [[nodiscard]] double getHeartRate() const;
+    [[nodiscard]] double getCorrelation() const;
+
+private:
+    void addDecimated(double value);
+    bool estimate();
+    [[nodiscard]] double getSample(size_t n) const;
+    [[nodiscard]] double getNormalised(size_t lag) const;
+
+    double decimatedRate{};         //!< The sampling rate after decimation.
+    size_t decimation{};            //!< Number of samples averaged to one decimated sample.
+    size_t blockCount{};            //!< Number of samples in the current block.
+    double blockSum{};              //!< Sum of the samples in the current block.
+    size_t window{};                //!< Number of products the autocorrelation is summed over.
+    size_t minLag{};                //!< The lag of the max. heart rate.
+    size_t maxLag{};                //!< The lag of the min. heart rate.
+    size_t minSamples{};            //!< Number of decimated samples before the first estimate.
+    size_t nSamples{};              //!< Number of decimated samples so far.
+    std::vector<double> samples;    //!< Ring buffer of the last decimated samples.
+    std::vector<double> sums;       //!< Sum of the products in the window for each lag, from 0 to maxLag + 1.
+    double correlation{};           //!< The normalised autocorrelation at the period of the last estimate.
+    SlidingMedian estimates{HR_SMOOTH_COUNT};   //!< The last estimates of the heart rate.
+};
+
+
+#endif //OBP_HEARTRATEESTIMATOR_H
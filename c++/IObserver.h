@@ -49,12 +49,27 @@ public:
      */
     virtual void eResults(double map, double sbp, double dbp) {};
 
+    /**
+     * The virtual function to handle confidence interval events, which follow the result event if enabled.
+     * @param map The interval of the MAP.
+     * @param sbp The interval of the SBP.
+     * @param dbp The interval of the DBP, both bounds are 0.0 if it is not available.
+     */
+    virtual void eConfidence(ConfidenceInterval map, ConfidenceInterval sbp, ConfidenceInterval dbp) {};
+
     /**
      * The virtual function to handle heart rate events.
      * @param heartRate The new heart rate value.
      */
     virtual void eHeartRate(double heartRate) {};
 
+    /**
+     * The virtual function to handle deflation rate events, sent regularly while the cuff is deflated.
+     * @param rate The current deflation rate in mmHg/s.
+     * @param guidance The guidance for the user derived from the rate.
+     */
+    virtual void eDeflationRate(double rate, DeflationGuidance guidance) {};
+
     /**
      * The virtual function to handle ready events.
      */
@@ -102,6 +102,31 @@ protected:
                       });
     }
 
+    /**
+     * Notify observers about the confidence intervals of the results.
+     * @param map The interval of the MAP.
+     * @param sbp The interval of the SBP.
+     * @param dbp The interval of the DBP.
+     */
+    virtual void notifyConfidence(ConfidenceInterval map, ConfidenceInterval sbp, ConfidenceInterval dbp) {
+        std::for_each(observerList.begin(), observerList.end(),
+                      [map, sbp, dbp](IObserver *observer) {
+                          observer->eConfidence(map, sbp, dbp);
+                      });
+    }
+
+    /**
+     * Notify observers about a new deflation rate.
+     * @param rate The current deflation rate in mmHg/s.
+     * @param guidance The guidance for the user derived from the rate.
+     */
+    virtual void notifyDeflationRate(double rate, DeflationGuidance guidance) {
+        std::for_each(observerList.begin(), observerList.end(),
+                      [rate, guidance](IObserver *observer) {
+                          observer->eDeflationRate(rate, guidance);
+                      });
+    }
+
     /**
      * Notify observers about a new heartRate value.
      * @param heartRate The new value.
@@ -0,0 +1,186 @@
+/**
+ * @file        IndexTool.cpp
+ * @brief       Command line tool to query the measurement index.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * obp_index [-i index.obi] [-d days] [-f yyyy-mm-dd] [-t yyyy-mm-dd] [-a] [condition ...]
+ * prints the measurements of the index that meet all conditions, in the order of time. -d takes the last days, -f and
+ * -t the days from and up to and including a date, -a includes measurements that were cancelled. A condition compares
+ * a value with a number, for example sbp>140 or hr<=60. The values are map, sbp, dbp, hr, inflate (the highest
+ * pressure during the inflation), rate (the mean deflation rate) and duration, the comparisons <, <=, =, >= and >.
+ * The index is INDEX_FILE by default.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <plog/Init.h>
+#include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include "common.h"
+#include "MeasurementIndex.h"
+
+/**
+ * The names of the values in conditions, in the order of IndexField.
+ */
+static const char *const fieldNames[] = {"map", "sbp", "dbp", "hr", "inflate", "rate", "duration"};
+
+/**
+ * Parses a date.
+ * @param text The date as yyyy-mm-dd.
+ * @param time Returns the start of the day in local time, in ms since the epoch.
+ * @return False if the text is no date.
+ */
+static bool parseDate(const char *text, int64_t &time)
+{
+    std::tm local{};
+    if (std::sscanf(text, "%d-%d-%d", &local.tm_year, &local.tm_mon, &local.tm_mday) != 3)
+    {
+        return false;
+    }
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_isdst = -1;
+    time = (int64_t) std::mktime(&local) * 1000;
+    return true;
+}
+
+/**
+ * Parses a condition.
+ * @param text The condition, for example sbp>140.
+ * @param condition Returns the condition.
+ * @return False if the text is no valid condition.
+ */
+static bool parseCondition(const char *text, IndexCondition &condition)
+{
+    const size_t nameLength = std::strcspn(text, "<=>");
+    const size_t opLength = std::strspn(text + nameLength, "<=>");
+    const std::string name(text, nameLength);
+    const std::string op(text + nameLength, opLength);
+    char *end;
+    const double value = std::strtod(text + nameLength + opLength, &end);
+    if (*end != '\0' || end == text + nameLength + opLength)
+    {
+        return false;
+    }
+
+    size_t field = 0;
+    while (field < std::size(fieldNames) && name != fieldNames[field])
+    {
+        field++;
+    }
+    if (field == std::size(fieldNames))
+    {
+        return false;
+    }
+    condition = IndexCondition{(IndexField) field};
+    if (op == "<")
+    {
+        condition.max = std::nextafter(value, -HUGE_VAL);
+    } else if (op == "<=")
+    {
+        condition.max = value;
+    } else if (op == "=")
+    {
+        condition.min = value;
+        condition.max = value;
+    } else if (op == ">=")
+    {
+        condition.min = value;
+    } else if (op == ">")
+    {
+        condition.min = std::nextafter(value, HUGE_VAL);
+    } else
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Prints an entry as one line.
+ * @param entry The entry.
+ */
+static void printEntry(const IndexEntry &entry)
+{
+    const auto seconds = (time_t) (entry.time / 1000);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    char date[24];
+    std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &local);
+    char line[256];
+    std::snprintf(line, sizeof(line), "%s  %-31.31s  SBP %5.1f  DBP %5.1f  MAP %5.1f  HR %5.1f  %3u beats  %5.1f s%s",
+                  date, entry.fileName, entry.sbp, entry.dbp, entry.map, entry.heartRate, entry.beats,
+                  entry.duration, entry.hasFlag(IndexFlag::complete) ? "" : "  cancelled");
+    std::cout << line << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    static plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender);
+
+    std::string fileName = INDEX_FILE;
+    IndexQuery query;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "-i") == 0 && hasValue)
+        {
+            fileName = argv[++i];
+        } else if (std::strcmp(argv[i], "-d") == 0 && hasValue)
+        {
+            const auto now = std::chrono::system_clock::now().time_since_epoch();
+            query.from = std::chrono::duration_cast<std::chrono::milliseconds>(now).count() -
+                         (int64_t) (std::stod(argv[++i]) * 86400000.0);
+        } else if (std::strcmp(argv[i], "-f") == 0 && hasValue)
+        {
+            valid = parseDate(argv[++i], query.from);
+        } else if (std::strcmp(argv[i], "-t") == 0 && hasValue)
+        {
+            // Up to and including the day.
+            valid = parseDate(argv[++i], query.to);
+            query.to += 86400000;
+        } else if (std::strcmp(argv[i], "-a") == 0)
+        {
+            query.completeOnly = false;
+        } else
+        {
+            IndexCondition condition;
+            valid = parseCondition(argv[i], condition);
+            query.conditions.push_back(condition);
+        }
+    }
+    if (!valid)
+    {
+        std::cerr << "Usage: " << argv[0] << " [-i index" << INDEX_EXTENSION
+                  << "] [-d days] [-f yyyy-mm-dd] [-t yyyy-mm-dd] [-a] [condition ...]\n"
+                  << "       condition: (map|sbp|dbp|hr|inflate|rate|duration)(<|<=|=|>=|>)value" << std::endl;
+        return 2;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    MeasurementIndex index(fileName);
+    if (!index.isOpen())
+    {
+        return 1;
+    }
+    const std::vector<size_t> found = index.query(query);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (size_t i : found)
+    {
+        printEntry(index.getEntry(i));
+    }
+    std::cout << found.size() << " of " << index.size() << " measurements, " << seconds * 1000.0 << " ms"
+              << std::endl;
+    return 0;
+}
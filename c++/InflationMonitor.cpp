@@ -0,0 +1,116 @@
+/**
+ * @file        InflationMonitor.cpp
+ * @brief       The implementation of the InflationMonitor class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include "InflationMonitor.h"
+
+/**
+ * Constructor of the InflationMonitor class.
+ * @param samplingRate The sampling rate of the processed data.
+ */
+InflationMonitor::InflationMonitor(double samplingRate) :
+        blockSize(std::max<size_t>(1, (size_t) (samplingRate * INFLATE_BLOCK_TIME)))
+{
+    reset(PUMP_UP_VALUE_MAX, PUMP_UP_VALUE_MIN);
+}
+
+/**
+ * Resets the monitor to start a new inflation.
+ * @param maxTarget The fixed pump-up value, used as target until the oscillations vanished.
+ * @param minTarget The adaptive target is never set below this pressure.
+ */
+void InflationMonitor::reset(double maxTarget, double minTarget)
+{
+    blockCount = 0;
+    quietBlocks = 0;
+    maxAmplitude = 0.0;
+    maxPressure = 0.0;
+    target = maxTarget;
+    lowerLimit = std::min(minTarget, maxTarget);
+    adaptive = false;
+}
+
+/**
+ * Processes one sample pair of pressure and oscillation during inflation.
+ * @param pressure The (low-pass filtered) pressure in mmHg.
+ * @param oscillation The (high-pass filtered) oscillation.
+ * @return True if the pressure is above the current target, i.e. the cuff is sufficiently inflated.
+ */
+bool InflationMonitor::processSample(double pressure, double oscillation)
+{
+    if (blockCount == 0)
+    {
+        blockStart = pressure;
+        blockMax = oscillation;
+        blockMin = oscillation;
+    } else
+    {
+        blockMax = std::max(blockMax, oscillation);
+        blockMin = std::min(blockMin, oscillation);
+    }
+    blockEnd = pressure;
+    if (++blockCount == blockSize)
+    {
+        evaluateBlock();
+        blockCount = 0;
+    }
+    return pressure > target;
+}
+
+/**
+ * Gets the current pump-up target.
+ * @return The target in mmHg.
+ */
+double InflationMonitor::getTarget() const
+{
+    return target;
+}
+
+/**
+ * Check if the target was found from the oscillations.
+ * @return True if the target is adaptive, false if it is still the fixed pump-up value.
+ */
+bool InflationMonitor::isAdaptive() const
+{
+    return adaptive;
+}
+
+/**
+ * Evaluates the completed block and lowers the target if the oscillations vanished.
+ */
+void InflationMonitor::evaluateBlock()
+{
+    if (std::abs(blockEnd - blockStart) > INFLATE_QUIET_RISE)
+    {
+        quietBlocks = 0;
+        return;
+    }
+    quietBlocks++;
+    if (adaptive || quietBlocks <= INFLATE_SETTLE_BLOCKS || blockEnd < INFLATE_MIN_PRESSURE)
+    {
+        return;
+    }
+
+    const double amplitude = blockMax - blockMin;
+    if (amplitude > maxAmplitude)
+    {
+        maxAmplitude = amplitude;
+        maxPressure = blockEnd;
+    } else if (maxAmplitude > INFLATE_MIN_AMPLITUDE && blockEnd > maxPressure &&
+               amplitude < INFLATE_VANISH_RATIO * maxAmplitude)
+    {
+        const double newTarget = std::max(blockEnd + INFLATE_MARGIN, lowerLimit);
+        if (newTarget < target)
+        {
+            target = newTarget;
+            adaptive = true;
+            PLOG_INFO << "Oscillations vanished at " << blockEnd << " mmHg, pump-up target set to " << target;
+        }
+    }
+}
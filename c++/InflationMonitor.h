@@ -0,0 +1,72 @@
+/**
+ * @file        InflationMonitor.h
+ * @brief       The header file of the InflationMonitor class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the InflationMonitor class and contains the general class description.
+ */
+#ifndef OBP_INFLATIONMONITOR_H
+#define OBP_INFLATIONMONITOR_H
+
+#include <cstddef>
+#include "common.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define INFLATE_BLOCK_TIME      1.5     //!< Length of the blocks the oscillation amplitude is measured in, in s,
+//!< long enough to contain a full beat down to 40 bpm.
+#define INFLATE_QUIET_RISE      2.0     //!< Max. pressure change in mmHg within a block without pumping.
+#define INFLATE_SETTLE_BLOCKS   1       //!< Number of quiet blocks after pumping until the filters have settled.
+#define INFLATE_MIN_PRESSURE    40.0    //!< Below this pressure in mmHg, the oscillations are not analysed.
+#define INFLATE_MIN_AMPLITUDE   0.5     //!< The min. amplitude of the largest oscillations to be valid.
+#define INFLATE_VANISH_RATIO    0.3     //!< Oscillations below this fraction of the largest ones have vanished.
+#define INFLATE_MARGIN          20.0    //!< Margin in mmHg above the pressure where the oscillations vanished.
+
+//! The InflationMonitor class finds the pump-up target from the oscillations during inflation.
+/*!
+ * Above the SBP, the artery stays closed and the oscillations vanish. If the oscillations are observed while the
+ * cuff is inflated, the cuff only has to be inflated a margin above the pressure where they vanished, instead of a
+ * fixed pump-up value that is too high for most subjects.
+ *
+ * The signals are evaluated in blocks of INFLATE_BLOCK_TIME. Pumping causes pressure steps that are much larger
+ * than the oscillations, so only blocks without pumping are evaluated and only after the filters have settled, i.e.
+ * while the user pauses during inflation. For each such block, the amplitude (peak to peak) of the oscillation and
+ * the pressure are taken. The largest amplitude is expected around the MAP. Once a block at a higher pressure has an
+ * amplitude below INFLATE_VANISH_RATIO of the largest one, the oscillations have vanished and the target is set to
+ * that pressure plus INFLATE_MARGIN. The target never exceeds the fixed pump-up value, which stays the target if the
+ * oscillations could not be observed (e.g. with continuous pumping).
+ */
+class InflationMonitor {
+
+public:
+    explicit InflationMonitor(double samplingRate);
+
+    void reset(double maxTarget, double minTarget);
+    bool processSample(double pressure, double oscillation);
+
+    [[nodiscard]] double getTarget() const;
+    [[nodiscard]] bool isAdaptive() const;
+
+private:
+    void evaluateBlock();
+
+    size_t blockSize;               //!< Number of samples per block.
+    size_t blockCount{};            //!< Number of samples in the current block.
+    double blockStart{};            //!< Pressure at the start of the current block.
+    double blockEnd{};              //!< Pressure at the end of the current block.
+    double blockMax{};              //!< Max. oscillation in the current block.
+    double blockMin{};              //!< Min. oscillation in the current block.
+    int quietBlocks{};              //!< Number of consecutive blocks without pumping.
+    double maxAmplitude{};          //!< The largest oscillation amplitude observed.
+    double maxPressure{};           //!< The pressure at which the largest amplitude was observed.
+    double target{};                //!< The current pump-up target in mmHg.
+    double lowerLimit{};            //!< The adaptive target is never set below this pressure in mmHg.
+    bool adaptive{};                //!< The target was found from the oscillations.
+};
+
+
+#endif //OBP_INFLATIONMONITOR_H
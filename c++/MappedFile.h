@@ -0,0 +1,131 @@
+/**
+ * @file        MappedFile.h
+ * @brief       The header file of the MappedFile class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines and implements the MappedFile class and contains the general class description.
+ */
+#ifndef OBP_MAPPEDFILE_H
+#define OBP_MAPPEDFILE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+
+//! The MappedFile class maps a whole file into memory for reading.
+/*!
+ * All readers of the binary files (recordings, archives, debug recordings, the measurement index and the flight
+ * recorder) and the parser of the text recordings map the file instead of reading it, so only the pages that are used
+ * are read from disk. map() opens the file, checks that it has a minimal size, maps it read-only and closes it again,
+ * the mapping stays valid without the file descriptor. The mapping is released by unmap() or the destructor, pointers
+ * into it are invalid afterwards.
+ *
+ * The mapping is private by default. A shared mapping sees what another process writes to the file later, which is
+ * needed to read the flight recorder of a running application.
+ */
+class MappedFile {
+
+public:
+    MappedFile() = default;
+
+    /**
+     * Destructor of the MappedFile. Releases the mapping.
+     */
+    ~MappedFile() {
+        unmap();
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * Maps a file read-only. A file that is already mapped is released first.
+     * @param fileName The name of the file.
+     * @param minSize The min. size of the file in bytes, at least 1.
+     * @param description What the file is, for the log, e.g. "recording".
+     * @param shared Map the file shared, so later changes to the file are seen.
+     * @return False if the file could not be opened or mapped or is shorter than minSize.
+     */
+    bool map(const std::string &fileName, size_t minSize, const char *description, bool shared = false) {
+        unmap();
+
+        const int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            PLOG_WARNING << "Could not open " << description << " " << fileName;
+            return false;
+        }
+        struct stat status{};
+        if (fstat(fd, &status) != 0 || (size_t) status.st_size < std::max<size_t>(minSize, 1)) {
+            PLOG_WARNING << "The " << description << " " << fileName << " is too short";
+            ::close(fd);
+            return false;
+        }
+        const auto fileSize = (size_t) status.st_size;
+        void *mapped = mmap(nullptr, fileSize, PROT_READ, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        // The mapping stays valid when the file is closed.
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            PLOG_WARNING << "Could not map " << description << " " << fileName;
+            return false;
+        }
+        mapping = static_cast<const unsigned char *>(mapped);
+        mappingSize = fileSize;
+        return true;
+    }
+
+    /**
+     * Releases the mapping, if any.
+     */
+    void unmap() {
+        if (mapping != nullptr) {
+            munmap(const_cast<unsigned char *>(mapping), mappingSize);
+        }
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+
+    /**
+     * Tells the kernel that the mapping is read from the start to the end, so it reads ahead.
+     */
+    void adviseSequential() const {
+        if (mapping != nullptr) {
+            madvise(const_cast<unsigned char *>(mapping), mappingSize, MADV_SEQUENTIAL);
+        }
+    }
+
+    /**
+     * @return True if a file is mapped.
+     */
+    [[nodiscard]] bool isMapped() const {
+        return mapping != nullptr;
+    }
+
+    /**
+     * @return The start of the mapped file, nullptr if none is mapped.
+     */
+    [[nodiscard]] const unsigned char *data() const {
+        return mapping;
+    }
+
+    /**
+     * @return The size of the mapped file in bytes, 0 if none is mapped.
+     */
+    [[nodiscard]] size_t size() const {
+        return mappingSize;
+    }
+
+private:
+    const unsigned char *mapping = nullptr; //!< The mapped file, nullptr if none is mapped.
+    size_t mappingSize = 0;                 //!< The size of the mapping in bytes.
+};
+
+
+#endif //OBP_MAPPEDFILE_H
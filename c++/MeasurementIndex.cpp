@@ -0,0 +1,245 @@
+/**
+ * @file        MeasurementIndex.cpp
+ * @brief       The implementation of the MeasurementIndex class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "MeasurementIndex.h"
+
+/**
+ * Constructor that opens a measurement index immediately.
+ * @param fileName The name of the index.
+ */
+MeasurementIndex::MeasurementIndex(const std::string &fileName)
+{
+    open(fileName);
+}
+
+/**
+ * Destructor of the MeasurementIndex. Releases the mapping.
+ */
+MeasurementIndex::~MeasurementIndex()
+{
+    close();
+}
+
+/**
+ * Opens a measurement index and checks whether its entries are in the order of time. An index that is already open
+ * is closed first.
+ * @param fileName The name of the index.
+ * @return False if the file could not be mapped or has no valid header.
+ */
+bool MeasurementIndex::open(const std::string &fileName)
+{
+    close();
+
+    if (!file.map(fileName, sizeof(IndexHeader), "measurement index"))
+    {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(IndexHeader));
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 || header.version < 1 ||
+        header.version > INDEX_VERSION || header.headerSize < sizeof(IndexHeader) || header.headerSize % 8 != 0 ||
+        header.headerSize > file.size() || header.entrySize < sizeof(IndexEntry) || header.entrySize % 8 != 0)
+    {
+        PLOG_WARNING << "Measurement index " << fileName << " has an invalid header";
+        close();
+        return false;
+    }
+
+    count = (file.size() - header.headerSize) / header.entrySize;
+    for (size_t i = 1; i < count && sorted; ++i)
+    {
+        sorted = getEntry(i - 1).time <= getEntry(i).time;
+    }
+    if (!sorted)
+    {
+        PLOG_WARNING << "The entries of measurement index " << fileName << " are not in the order of time";
+    }
+    return true;
+}
+
+/**
+ * Closes the index and releases the mapping.
+ */
+void MeasurementIndex::close()
+{
+    file.unmap();
+    header = IndexHeader{};
+    count = 0;
+    sorted = true;
+}
+
+/**
+ * @return True if a valid index is open.
+ */
+bool MeasurementIndex::isOpen() const
+{
+    return file.isMapped();
+}
+
+/**
+ * @return The number of entries, 0 if no index is open.
+ */
+size_t MeasurementIndex::size() const
+{
+    return count;
+}
+
+/**
+ * Gets an entry. The entry is in the mapping and valid until the index is closed.
+ * @param i The index of the entry, less than size().
+ * @return The entry.
+ */
+const IndexEntry &MeasurementIndex::getEntry(size_t i) const
+{
+    return *reinterpret_cast<const IndexEntry *>(file.data() + header.headerSize + i * header.entrySize);
+}
+
+/**
+ * Finds the entries that meet a query.
+ * @param query The query.
+ * @return The indexes of the entries in the order of the file.
+ */
+std::vector<size_t> MeasurementIndex::query(const IndexQuery &query) const
+{
+    std::vector<size_t> found;
+    const auto [begin, end] = sorted ? findRange(query.from, query.to) : std::pair<size_t, size_t>(0, count);
+    for (size_t i = begin; i < end; ++i)
+    {
+        const IndexEntry &entry = getEntry(i);
+        if (entry.time < query.from || entry.time >= query.to ||
+            (query.completeOnly && !entry.hasFlag(IndexFlag::complete)))
+        {
+            continue;
+        }
+        bool match = true;
+        for (const IndexCondition &condition : query.conditions)
+        {
+            const double value = getValue(entry, condition.field);
+            if (value < condition.min || value > condition.max)
+            {
+                match = false;
+                break;
+            }
+        }
+        if (match)
+        {
+            found.push_back(i);
+        }
+    }
+    return found;
+}
+
+/**
+ * Finds the entries of a time range with a binary search. The entries have to be in the order of time.
+ * @param from The earliest time in ms since the epoch.
+ * @param to The latest time in ms since the epoch, excluded.
+ * @return The index of the first entry and the index after the last entry of the range.
+ */
+std::pair<size_t, size_t> MeasurementIndex::findRange(int64_t from, int64_t to) const
+{
+    auto lowerBound = [this](int64_t time) {
+        size_t low = 0;
+        size_t high = count;
+        while (low < high)
+        {
+            const size_t middle = low + (high - low) / 2;
+            if (getEntry(middle).time < time)
+            {
+                low = middle + 1;
+            } else
+            {
+                high = middle;
+            }
+        }
+        return low;
+    };
+    const size_t begin = lowerBound(from);
+    return {begin, std::max(begin, lowerBound(to))};
+}
+
+/**
+ * Gets a value of an entry.
+ * @param entry The entry.
+ * @param field The value.
+ * @return The value.
+ */
+double MeasurementIndex::getValue(const IndexEntry &entry, IndexField field)
+{
+    switch (field)
+    {
+        case IndexField::map:
+            return entry.map;
+        case IndexField::sbp:
+            return entry.sbp;
+        case IndexField::dbp:
+            return entry.dbp;
+        case IndexField::heartRate:
+            return entry.heartRate;
+        case IndexField::inflatePressure:
+            return entry.inflatePressure;
+        case IndexField::deflationRate:
+            return entry.deflationRate;
+        case IndexField::duration:
+            return entry.duration;
+    }
+    return 0.0;
+}
+
+/**
+ * Appends an entry to a measurement index. The index is created if it does not exist, an entry that was not written
+ * completely is replaced. Only one process may append to an index at a time.
+ * @param fileName The name of the index.
+ * @param entry The entry.
+ * @return False if the index could not be written or was written by a newer version.
+ */
+bool MeasurementIndex::append(const std::string &fileName, const IndexEntry &entry)
+{
+    const int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        PLOG_WARNING << "Could not open measurement index " << fileName;
+        return false;
+    }
+    struct stat status{};
+    IndexHeader header = IndexHeader::create();
+    bool success = fstat(fd, &status) == 0;
+    if (success && (size_t) status.st_size < sizeof(IndexHeader))
+    {
+        success = pwrite(fd, &header, sizeof(IndexHeader), 0) == (ssize_t) sizeof(IndexHeader);
+        status.st_size = sizeof(IndexHeader);
+    } else if (success)
+    {
+        success = pread(fd, &header, sizeof(IndexHeader), 0) == (ssize_t) sizeof(IndexHeader) &&
+                  std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+                  header.version <= INDEX_VERSION && header.entrySize == sizeof(IndexEntry) &&
+                  header.headerSize <= (size_t) status.st_size;
+        if (!success)
+        {
+            PLOG_WARNING << "Measurement index " << fileName << " has an invalid header, the entry is not added";
+            ::close(fd);
+            return false;
+        }
+    }
+    if (success)
+    {
+        const size_t entries = ((size_t) status.st_size - header.headerSize) / header.entrySize;
+        const auto offset = (off_t) (header.headerSize + entries * header.entrySize);
+        success = pwrite(fd, &entry, sizeof(IndexEntry), offset) == (ssize_t) sizeof(IndexEntry);
+    }
+    if (::close(fd) != 0 || !success)
+    {
+        PLOG_WARNING << "Could not append to measurement index " << fileName;
+        return false;
+    }
+    return true;
+}
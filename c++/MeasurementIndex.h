@@ -0,0 +1,107 @@
+/**
+ * @file        MeasurementIndex.h
+ * @brief       The header file of the MeasurementIndex class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the MeasurementIndex class and contains the general class description.
+ */
+#ifndef OBP_MEASUREMENTINDEX_H
+#define OBP_MEASUREMENTINDEX_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MappedFile.h"
+#include "RecordingFormat.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define INDEX_FILE          "obp_index.obi"     //!< The measurement index of the application, next to the recordings.
+
+/**
+ * The values of an IndexEntry a query can be restricted by.
+ */
+enum class IndexField
+{
+    map,                //!< The mean arterial pressure.
+    sbp,                //!< The systolic blood pressure.
+    dbp,                //!< The diastolic blood pressure.
+    heartRate,          //!< The average heart rate.
+    inflatePressure,    //!< The highest pressure during the inflation.
+    deflationRate,      //!< The mean deflation rate.
+    duration,           //!< The duration of the recording.
+};
+
+/**
+ * Restricts a value of the entries of a query to a range, both limits included.
+ */
+struct IndexCondition
+{
+    IndexField field = IndexField::sbp; //!< The value.
+    double min = -HUGE_VAL;             //!< The smallest value accepted.
+    double max = HUGE_VAL;              //!< The largest value accepted.
+};
+
+/**
+ * A query of a measurement index. All conditions have to be met.
+ */
+struct IndexQuery
+{
+    int64_t from = INT64_MIN;                   //!< The earliest start of a measurement in ms since the epoch.
+    int64_t to = INT64_MAX;                     //!< The latest start of a measurement in ms since the epoch, excluded.
+    bool completeOnly = true;                   //!< Only measurements that were finished with results.
+    std::vector<IndexCondition> conditions;     //!< Restrictions of the values of the entries.
+};
+
+//! The MeasurementIndex class keeps the results of all measurements in one file that can be queried.
+/*!
+ * The recordings only hold the samples, the results are in the footer of binary recordings at best. So that the
+ * measurements can be searched, for example for all measurements of the last week with an SBP above 140 mmHg, the
+ * Processing appends an entry to the measurement index INDEX_FILE after every measurement, in the writer thread of
+ * the Datarecord: the start time, the name of the recording and where its samples start, the results, the
+ * configuration and a few values that describe the measurement. The format is described at the IndexHeader in
+ * RecordingFormat.h.
+ *
+ * To query the index, the file is mapped into memory like by the RecordingReader. The entries are appended in the
+ * order of time, so the entries of a time range are found with a binary search and only they are compared with the
+ * conditions. If the clock was set back and the entries are not in order, all entries are compared. No recording is
+ * opened for a query.
+ */
+class MeasurementIndex {
+
+public:
+    MeasurementIndex() = default;
+    explicit MeasurementIndex(const std::string &fileName);
+    ~MeasurementIndex();
+    MeasurementIndex(const MeasurementIndex &) = delete;
+    MeasurementIndex &operator=(const MeasurementIndex &) = delete;
+
+    bool open(const std::string &fileName);
+    void close();
+
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] const IndexEntry &getEntry(size_t i) const;
+    [[nodiscard]] std::vector<size_t> query(const IndexQuery &query) const;
+
+    static double getValue(const IndexEntry &entry, IndexField field);
+    static bool append(const std::string &fileName, const IndexEntry &entry);
+
+private:
+    [[nodiscard]] std::pair<size_t, size_t> findRange(int64_t from, int64_t to) const;
+
+    IndexHeader header{};                   //!< Copy of the header of the open file.
+    MappedFile file;                        //!< The mapped file, not mapped if closed.
+    size_t count = 0;                       //!< The number of complete entries.
+    bool sorted = true;                     //!< The entries are in the order of their time.
+};
+
+
+#endif //OBP_MEASUREMENTINDEX_H
@@ -0,0 +1,201 @@
+/**
+ * @file        OBPBootstrap.cpp
+ * @brief       The implementation of the OBPBootstrap class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "OBPBootstrap.h"
+
+/**
+ * Calculates the confidence intervals of the results of a measurement.
+ * @param result The result of the detection. If it is not finished, the intervals are invalid.
+ * @param pressure The pressure data the beat times refer to.
+ * @param config The configuration the detection was done with, its ratios and sampling rate are used.
+ * @param resamples The number of resampled beat tables.
+ * @param nThreads The number of worker threads, 0 to use the number of cores, up to BOOTSTRAP_MAX_THREADS.
+ * @return The confidence intervals.
+ */
+BootstrapResult OBPBootstrap::analyze(const OBPResult &result, std::span<const double> pressure,
+                                      const DetectionConfig &config, size_t resamples, size_t nThreads)
+{
+    BootstrapResult bootstrap;
+    if (!result.finished || pressure.empty() || resamples == 0)
+    {
+        return bootstrap;
+    }
+
+    if (nThreads == 0)
+    {
+        nThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), BOOTSTRAP_MAX_THREADS);
+    }
+    nThreads = std::min(nThreads, resamples);
+
+    // Every resample writes to its own entries, so the workers share nothing but the counter.
+    std::vector<double> maps(resamples);
+    std::vector<double> sbps(resamples);
+    std::vector<double> dbps(resamples);
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        auto workspace = std::make_unique<Workspace>();
+        for (size_t i = next++; i < resamples; i = next++)
+        {
+            resample(result, pressure, config, BOOTSTRAP_SEED + (uint32_t) i, *workspace, maps[i], sbps[i], dbps[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < nThreads; ++i)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    // Resamples without a result are NaN and sorted out.
+    auto removeInvalid = [](std::vector<double> &values) {
+        values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return std::isnan(v); }),
+                     values.end());
+    };
+    removeInvalid(maps);
+    removeInvalid(sbps);
+    removeInvalid(dbps);
+
+    const auto minValid = (size_t) std::ceil(BOOTSTRAP_MIN_VALID * (double) resamples);
+    bootstrap.resamples = std::min(maps.size(), sbps.size());
+    bootstrap.dbpResamples = dbps.size();
+    bootstrap.valid = bootstrap.resamples >= minValid;
+    if (bootstrap.valid)
+    {
+        bootstrap.map = getInterval(maps.data(), maps.size());
+        bootstrap.sbp = getInterval(sbps.data(), sbps.size());
+    }
+    if (bootstrap.dbpResamples >= minValid)
+    {
+        bootstrap.dbp = getInterval(dbps.data(), dbps.size());
+    }
+    return bootstrap;
+}
+
+/**
+ * Calculates the results of one resampled beat table.
+ * @param result The result of the detection with the beat table to resample.
+ * @param pressure The pressure data the beat times refer to.
+ * @param config The configuration with the ratios and the sampling rate.
+ * @param seed The seed of the random generator of this resample.
+ * @param workspace The memory to calculate the resample in.
+ * @param map Returns the MAP, NaN if it could not be calculated.
+ * @param sbp Returns the SBP, NaN if it could not be calculated.
+ * @param dbp Returns the DBP, NaN if it could not be calculated.
+ */
+void OBPBootstrap::resample(const OBPResult &result, std::span<const double> pressure, const DetectionConfig &config,
+                            uint32_t seed, Workspace &workspace, double &map, double &sbp, double &dbp)
+{
+    map = std::numeric_limits<double>::quiet_NaN();
+    sbp = map;
+    dbp = map;
+
+    // Only beats with a trough that are not artifacts contribute to the envelope.
+    const BeatTable &original = result.beats;
+    auto &rows = workspace.rows;
+    size_t nRows = 0;
+    for (size_t i = 0; i < original.troughCount(); ++i)
+    {
+        if (original.type(i) != BeatType::Artifact)
+        {
+            rows[nRows++] = i;
+        }
+    }
+    if (nRows < 2)
+    {
+        return;
+    }
+
+    std::mt19937 generator(seed);
+    auto &drawn = workspace.drawn;
+    std::fill(drawn.begin(), drawn.begin() + (long) nRows, 0);
+    std::uniform_int_distribution<size_t> pick(0, nRows - 1);
+    for (size_t i = 0; i < nRows; ++i)
+    {
+        drawn[pick(generator)]++;
+    }
+
+    const auto jitter = (long) std::lround(BOOTSTRAP_JITTER * config.samplingRate);
+    std::uniform_int_distribution<long> shift(-jitter, jitter);
+    BeatTable &beats = workspace.beats;
+    beats.clear();
+    long lastTrough = -1;
+    for (size_t i = 0; i < nRows; ++i)
+    {
+        // Every copy of a beat is added, the order of peaks and troughs is kept.
+        const size_t row = rows[i];
+        for (size_t copy = 0; copy < drawn[i]; ++copy)
+        {
+            const long peak = std::max((long) original.peakTime(row) + shift(generator), lastTrough + 1);
+            const long trough = std::max((long) original.troughTime(row) + shift(generator), peak + 1);
+            const size_t beat = beats.size();
+            beats.addBeat((size_t) peak, original.peakAmplitude(row));
+            beats.setTrough(beat, (size_t) trough, original.troughAmplitude(row));
+            beats.setHeartRate(beat, original.heartRate(row), original.type(row));
+            lastTrough = trough;
+        }
+    }
+
+    OBPDetection::filterOutliers(beats, beats.peakAmplitudeColumn(), beats.size(), workspace.peakAmps.data());
+    OBPDetection::filterOutliers(beats, beats.troughAmplitudeColumn(), beats.troughCount(),
+                                 workspace.troughAmps.data());
+    Envelope &envelope = workspace.envelope;
+    OBPDetection::calculateEnvelope(beats, workspace.peakAmps.data(), workspace.troughAmps.data(), envelope);
+    if (envelope.empty())
+    {
+        return;
+    }
+
+    size_t mapTime = 0;
+    size_t sbpTime = 0;
+    size_t dbpTime = 0;
+    bool foundSBP;
+    const bool foundDBP = OBPDetection::findRatioTimes(envelope, config.ratioSBP, config.ratioDBP, mapTime, sbpTime,
+                                                       dbpTime, foundSBP);
+    map = OBPDetection::getAveragePressureAt(pressure, mapTime, result.heartRate, config.samplingRate);
+    if (foundSBP)
+    {
+        sbp = OBPDetection::getAveragePressureAt(pressure, sbpTime, result.heartRate, config.samplingRate);
+    }
+    if (foundDBP)
+    {
+        dbp = OBPDetection::getAveragePressureAt(pressure, dbpTime, result.heartRate, config.samplingRate);
+    }
+}
+
+/**
+ * Gets the confidence interval of BOOTSTRAP_LEVEL from the percentiles of the values.
+ * @param values The values, are partially sorted.
+ * @param count The number of values, must be larger than 0.
+ * @return The confidence interval.
+ */
+ConfidenceInterval OBPBootstrap::getInterval(double *values, size_t count)
+{
+    const double tail = 0.5 * (1.0 - BOOTSTRAP_LEVEL);
+    const auto lower = (size_t) std::lround(tail * (double) (count - 1));
+    const auto upper = (size_t) std::lround((1.0 - tail) * (double) (count - 1));
+
+    ConfidenceInterval interval;
+    std::nth_element(values, values + lower, values + count);
+    interval.lower = values[lower];
+    std::nth_element(values + lower, values + upper, values + count);
+    interval.upper = values[upper];
+    return interval;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file        OBPBootstrap.h
+ * @brief       The header file of the OBPBootstrap class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the OBPBootstrap class and contains the general class description.
+ */
+#ifndef OBP_OBPBOOTSTRAP_H
+#define OBP_OBPBOOTSTRAP_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include "common.h"
+#include "OBPDetection.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define BOOTSTRAP_RESAMPLES     500     //!< Default number of resampled beat tables.
+#define BOOTSTRAP_LEVEL         0.95    //!< Confidence level of the intervals.
+#define BOOTSTRAP_JITTER        0.01    //!< Max. jitter of the peak and trough times in s.
+#define BOOTSTRAP_MIN_VALID     0.5     //!< Min. fraction of resamples a value has to be found in for an interval.
+#define BOOTSTRAP_MAX_THREADS   8       //!< Max. number of worker threads.
+#define BOOTSTRAP_SEED          20200818 //!< Seed of the first resample, the results are reproducible.
+
+/**
+ * The confidence intervals of the results of one measurement.
+ */
+struct BootstrapResult
+{
+    bool valid = false;         //!< The intervals of MAP and SBP could be calculated.
+    size_t resamples = 0;       //!< Number of resamples the MAP and SBP were found in.
+    size_t dbpResamples = 0;    //!< Number of resamples the DBP was found in.
+    ConfidenceInterval map;     //!< The interval of the MAP.
+    ConfidenceInterval sbp;     //!< The interval of the SBP.
+    ConfidenceInterval dbp;     //!< The interval of the DBP, 0.0 if the DBP was found in too few resamples.
+};
+
+//! The OBPBootstrap class estimates the uncertainty of the results with a beat-level bootstrap.
+/*!
+ * The results of a measurement are calculated from a few dozen beats, so a different selection of beats gives a
+ * different envelope and different results. Each resample draws as many beats as there are in the beat table with
+ * replacement and keeps the beats in their original order. A beat drawn several times is repeated in the resampled
+ * table, each copy with its own jitter, so it contributes as many envelope points and as much weight in the outlier
+ * filter as it was drawn. The times of the peaks and troughs are jittered by up to BOOTSTRAP_JITTER, the uncertainty
+ * of the extremum of a noisy oscillation. The envelope and the results are then calculated exactly as OBPDetection
+ * does, with the fixed ratios of the configuration. The confidence intervals are the percentiles of the results over
+ * all resamples.
+ *
+ * The resamples are independent and are distributed to a pool of worker threads, which take the next resample from a
+ * shared counter until all are done. Every resample has its own random generator seeded with its index, so the
+ * results do not depend on the number of threads. Each worker calculates its resamples in one workspace with a beat
+ * table and an envelope, so a resample does not allocate memory. The analysis is only meaningful for the FixedRatio
+ * algorithm.
+ */
+class OBPBootstrap {
+
+public:
+    static BootstrapResult analyze(const OBPResult &result, std::span<const double> pressure,
+                                   const DetectionConfig &config, size_t resamples = BOOTSTRAP_RESAMPLES,
+                                   size_t nThreads = 0);
+
+private:
+    /**
+     * The memory one worker needs to calculate a resample, reused for all resamples of the worker.
+     */
+    struct Workspace
+    {
+        std::array<size_t, BEAT_TABLE_CAPACITY> rows;           //!< The rows of the beats that can be drawn.
+        std::array<size_t, BEAT_TABLE_CAPACITY> drawn;          //!< How many times each row was drawn.
+        BeatTable beats;                                        //!< The resampled beat table.
+        std::array<double, BEAT_TABLE_CAPACITY> peakAmps;       //!< Peak amplitudes with outliers replaced.
+        std::array<double, BEAT_TABLE_CAPACITY> troughAmps;     //!< Trough amplitudes with outliers replaced.
+        Envelope envelope;                                      //!< The envelope of the resampled beats.
+    };
+
+    static void resample(const OBPResult &result, std::span<const double> pressure, const DetectionConfig &config,
+                         uint32_t seed, Workspace &workspace, double &map, double &sbp, double &dbp);
+    static ConfidenceInterval getInterval(double *values, size_t count);
+};
+
+
+#endif //OBP_OBPBOOTSTRAP_H
@@ -8,6 +8,8 @@
  * @details
  */
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <cmath>
 #include <numeric>
@@ -16,15 +18,15 @@
 /**
  * Constructor of the OBPDetection class.
  *
- * Initialises and resets the data.
+ * Initialises and resets the data. The configuration is initialised with the default values.
  * @param sampling_rate Sets the sampling rate of the processed data. Used to calculate the heart rate.
  */
 OBPDetection::OBPDetection(double sampling_rate) :
         pData(DEFAULT_DATA_SIZE),
         oData(DEFAULT_DATA_SIZE),
-        enoughData(false),
-        samplingRate(sampling_rate)
+        enoughData(false)
 {
+    configChannel.update([sampling_rate](DetectionConfig &c) { c.samplingRate = sampling_rate; });
     reset();
 }
 
@@ -42,18 +44,18 @@ OBPDetection::~OBPDetection()
  */
 double OBPDetection::getRatioSBP()
 {
-    return ratio_SBP;
+    return configChannel.snapshot().ratioSBP;
 }
 
 /**
- * Sets the value of the SBP ratio.
+ * Sets the value of the SBP ratio. The value is used from the next measurement on.
  * @param val The value to set.
  */
 void OBPDetection::setRatioSBP(double val)
 {
     if (val > MIN_RATIO && val < MAX_RATIO)
     {
-        ratio_SBP = val;
+        configChannel.update([val](DetectionConfig &c) { c.ratioSBP = val; });
     }
 }
 
@@ -63,18 +65,18 @@ void OBPDetection::setRatioSBP(double val)
  */
 double OBPDetection::getRatioDBP()
 {
-    return ratio_DBP;
+    return configChannel.snapshot().ratioDBP;
 }
 
 /**
- * Sets the value of the DBP ratio.
+ * Sets the value of the DBP ratio. The value is used from the next measurement on.
  * @param val The value to set.
  */
 void OBPDetection::setRatioDBP(double val)
 {
     if (val > MIN_RATIO && val < MAX_RATIO)
     {
-        ratio_DBP = val;
+        configChannel.update([val](DetectionConfig &c) { c.ratioDBP = val; });
     }
 }
 
@@ -84,52 +86,128 @@ void OBPDetection::setRatioDBP(double val)
  */
 int OBPDetection::getMinNbrPeaks()
 {
-    return minNbrPeaks;
+    return configChannel.snapshot().minNbrPeaks;
 }
 
 /**
- * Sets the value for the minimally required number of peaks.
+ * Sets the value for the minimally required number of peaks. The value is used from the next measurement on.
  * @param val The value to set.
  */
 void OBPDetection::setMinNbrPeaks(int val)
 {
     if (val > MIN_PEAKS)
     {
-        minNbrPeaks = val;
+        configChannel.update([val](DetectionConfig &c) { c.minNbrPeaks = val; });
     }
 }
 
 /**
- * Resets the configuration values to their default.
+ * Gets if the predictive mode is enabled.
+ * @return True if the measurement finishes as soon as the DBP can be predicted.
+ */
+bool OBPDetection::getPredictive()
+{
+    return configChannel.snapshot().predictive;
+}
+
+/**
+ * Enables or disables the predictive mode. The value is used from the next measurement on.
+ * @param val True to finish the measurement as soon as the DBP can be predicted.
+ */
+void OBPDetection::setPredictive(bool val)
+{
+    configChannel.update([val](DetectionConfig &c) { c.predictive = val; });
+}
+
+/**
+ * Resets the configuration values to their default. The values are used from the next measurement on.
  */
 void OBPDetection::resetConfigValues()
 {
-    ratio_SBP = 0.57;
-    ratio_DBP = 0.70;
-    minNbrPeaks = 10;
+    configChannel.update([](DetectionConfig &c) {
+        const DetectionConfig defaults;
+        c.ratioSBP = defaults.ratioSBP;
+        c.ratioDBP = defaults.ratioDBP;
+        c.minNbrPeaks = defaults.minNbrPeaks;
+        c.predictive = defaults.predictive;
+    });
 }
 
 /**
  * Gets the last valid heart rate value if there were any.
- * @return The last entry of the heart rate vector.
+ * @return The heart rate of the last beat that is not an artifact if it is valid, 0.0 otherwise.
  */
-double OBPDetection::getCurrentHeartRate()
+double OBPDetection::getCurrentHeartRate() const
 {
     double cHR = 0.0;
-    if (!hrData.empty())
+    if (!beats.empty())
     {
-        cHR = hrData.back();
+        const size_t last = getPreviousBeat(beats.size());
+        if (last < beats.size() && beats.type(last) == BeatType::Valid)
+        {
+            cHR = beats.heartRate(last);
+        }
     }
     return cHR;
 }
 
 /**
- * Calculates the average over all saved heart rate entries.
+ * Calculates the average over all valid heart rate entries in the beat table.
  * @return The average heart rate in the current calculations.
  */
-double OBPDetection::getAverageHeartRate()
+double OBPDetection::getAverageHeartRate() const
 {
-    return getAverage(hrData);
+    // The first beat is never confirmed and artifacts have no valid heart rate.
+    double sum = 0.0;
+    size_t n = 0;
+    for (size_t i = 0; i < beats.size(); ++i)
+    {
+        if (beats.type(i) == BeatType::Valid)
+        {
+            sum += beats.heartRate(i);
+            n++;
+        }
+    }
+    return n > 0 ? sum / (double) n : 0.0;
+}
+
+/**
+ * Gets the median of the heart rate of the last HR_MEDIAN_WINDOW valid beats, which is not affected by a single
+ * irregular beat. Only beats that can no longer change are included, i.e. not the latest one.
+ * @return The median heart rate, the current heart rate if there are no such beats yet.
+ */
+double OBPDetection::getMedianHeartRate() const
+{
+    return hrWindow.empty() ? getCurrentHeartRate() : hrWindow.median();
+}
+
+/**
+ * Gets the heart rate estimated from the periodicity of the oscillation, available before the first beats are
+ * confirmed.
+ * @return The estimated heart rate in bpm, 0.0 if the estimate is not stable (yet).
+ */
+double OBPDetection::getEstimatedHeartRate() const
+{
+    return hrEstimator.getHeartRate();
+}
+
+/**
+ * Gives access to the beats detected in the current measurement.
+ * @return A reference to the beat table.
+ */
+const BeatTable &OBPDetection::getBeats() const
+{
+    return beats;
+}
+
+/**
+ * Gives access to the OMWE calculated in the current measurement. The envelope is only available after enough data
+ * has been acquired.
+ * @return A reference to the envelope.
+ */
+const Envelope &OBPDetection::getEnvelope() const
+{
+    return omwe;
 }
 
 /**
@@ -169,6 +247,58 @@ bool OBPDetection::getIsEnoughData() const
     return enoughData;
 }
 
+/**
+ * Gets the configuration of the current measurement, which was taken over at the last reset().
+ * @return The configuration in use.
+ */
+DetectionConfig OBPDetection::getConfig() const
+{
+    return config;
+}
+
+/**
+ * Gets the algorithm implemented by this instance.
+ * @return The fixed ratio algorithm.
+ */
+DetectionAlgorithm OBPDetection::getAlgorithm() const
+{
+    return DetectionAlgorithm::FixedRatio;
+}
+
+/**
+ * Gives access to the pressure data that was processed sample by sample in the current measurement.
+ * @return The pressure data.
+ */
+std::span<const double> OBPDetection::getPressureData() const
+{
+    return pData;
+}
+
+/**
+ * Collects all results of the current measurement.
+ * @return The results, including copies of the beat table and the envelope.
+ */
+OBPResult OBPDetection::getResult() const
+{
+    OBPResult result;
+    result.finished = enoughData;
+    result.map = resMAP;
+    result.sbp = resSBP;
+    result.dbp = resDBP;
+    result.heartRate = getAverageHeartRate();
+    result.decisionTime = decisionTime;
+    result.mapTime = resMAPTime;
+    result.sbpTime = resSBPTime;
+    result.dbpTime = resDBPTime;
+    result.predicted = predicted;
+    result.dbpConfidence = predicted ? predConfidence : 0.0;
+    result.artifacts = (size_t) std::count(beats.typeColumn(), beats.typeColumn() + beats.size(), BeatType::Artifact);
+    result.restarts = restarts;
+    result.beats = beats;
+    result.envelope = omwe;
+    return result;
+}
+
 /**
  * Processes one data sample pair of pressure and oscillation at a time.
  * Returns true if the process has finished and results might be available.
@@ -182,16 +312,54 @@ bool OBPDetection::getIsEnoughData() const
  */
 bool OBPDetection::processSample(double pressure, double oscillation)
 {
-    bool newMax = false;
     pData.push_back(pressure);
     oData.push_back(oscillation);
-    if (checkMaxima())
+    return processLatest(pData, oData);
+}
+
+/**
+ * Analyses an entire recording of pressure and oscillation at once. Resets the object beforehand.
+ *
+ * The analysis works on the given data directly, the data is neither copied nor stored. It is not a separate batch
+ * algorithm: processLatest() is called for every sample, exactly as during a measurement, and the analysis stops as
+ * soon as enough data is available. The results are therefore identical to handing the same data to processSample()
+ * one by one until getIsEnoughData() returns true. A batch path would gain little, the HeartRateEstimator needs every
+ * sample in order for the adaptive min. peak time and takes most of the time (about 4 ms for a recording of one
+ * minute at 1 kHz).
+ *
+ * @param pressure The pressure in mmHg.
+ * @param oscillation The oscillation in arbitrary units, same length as the pressure.
+ * @return The results, including the beat table and the envelope.
+ */
+OBPResult OBPDetection::analyze(std::span<const double> pressure, std::span<const double> oscillation)
+{
+    reset();
+    const size_t nSamples = std::min(pressure.size(), oscillation.size());
+
+    // The samples before the minimal data size are needed for the heart rate estimate.
+    for (size_t i = 0; i < nSamples && !enoughData; ++i)
+    {
+        processLatest(pressure.first(i + 1), oscillation.first(i + 1));
+    }
+    return getResult();
+}
+
+/**
+ * Processes the latest sample pair, which is the last entry in the pressure and oscillation data.
+ * @param pressure All pressure values of the measurement so far.
+ * @param oscillation All oscillation values of the measurement so far.
+ * @return True if a new valid maxima was found.
+ */
+bool OBPDetection::processLatest(std::span<const double> pressure, std::span<const double> oscillation)
+{
+    bool newMax = false;
+    updateHeartRateEstimate(oscillation.back());
+    if (checkMaxima(oscillation))
     {
-        findMinima();
-        if (isEnoughData())
+        if (isEnoughData() || (config.predictive && isPredictable(pressure)))
         {
-            findOWME();
-            findMAP();
+            findResults(pressure);
+            decisionTime = oscillation.size() - 1;
             enoughData = true;
         }
         newMax = true;
@@ -201,22 +369,38 @@ bool OBPDetection::processSample(double pressure, double oscillation)
 
 
 /**
- * Checks the latest samples in oData if there is a local maxima and puts it in a vector to hold all
+ * Feeds the latest sample to the heart rate estimator and adapts the min. time between two peaks to the estimate.
+ * @param oscillation The latest oscillation value.
+ */
+void OBPDetection::updateHeartRateEstimate(double oscillation)
+{
+    if (hrEstimator.processSample(oscillation) && config.adaptivePeakTime)
+    {
+        // Never longer than the interval at the max. valid heart rate, a valid beat must not be skipped.
+        const double interval = 60.0 * config.samplingRate / hrEstimator.getHeartRate();
+        const double maxPeakTime = 60.0 * config.samplingRate / config.maxValidHR;
+        minPeakTime = std::max(config.minPeakTime, (size_t) std::min(PEAK_TIME_RATIO * interval, maxPeakTime));
+    }
+}
+
+/**
+ * Checks the latest samples in the oscillation data if there is a local maxima and puts it in a vector to hold all
  * local maxima, together with a reference to the 'time' (sample number) it was recorded.
+ * @param oscillation All oscillation values of the measurement so far.
  * @return true if a local maxima was found.
  */
-bool OBPDetection::checkMaxima()
+bool OBPDetection::checkMaxima(std::span<const double> oscillation)
 {
     bool isValid = false;
 
-    if (oData.size() > minDataSize && *(oData.end() - 2) > prominence)
+    if (oscillation.size() > config.minDataSize && *(oscillation.end() - 2) > config.prominence)
     {
-        auto i = std::max_element((oData.end() - 3), oData.end());
+        auto i = std::max_element((oscillation.end() - 3), oscillation.end());
 
         // is result the middle entry?
-        if (std::distance(i, oData.end()) == 2)
+        if (std::distance(i, oscillation.end()) == 2)
         {
-            isValid = isValidMaxima();
+            isValid = isValidMaxima(oscillation);
         }
 
     }
@@ -227,79 +411,185 @@ bool OBPDetection::checkMaxima()
 /**
  * Checks if the found maximum is acutally valid. If it is found as a valid maxima, the
  * current time and amplitude is saved and the heart rate is calculated from the last valid maximum.
+ * @param oscillation All oscillation values of the measurement so far.
  * @return True if a valid maxima and a new current heart rate was calculated.
  */
-bool OBPDetection::isValidMaxima()
+bool OBPDetection::isValidMaxima(std::span<const double> oscillation)
 {
-    static int validPulseCnt = 0; // Only for logging purposes.
     bool isValid = false;
 
-    assert(oData.size() >= 2);
+    assert(oscillation.size() >= 2);
 
-    const double testValue = *(oData.end() - 2); // testing the second to last entry
-    const auto testSmplNbr = (oData.size() - 1); // NEW: in relation to oData for min-detect!
+    const double testValue = *(oscillation.end() - 2); // testing the second to last entry
+    const size_t testSmplNbr = (oscillation.size() - 1); // NEW: in relation to oData for min-detect!
 
-    if (maxtime.empty())
+    if (beats.empty())
     {
         // Accept any value as a first value, only start testing after the second one
-        maxtime.push_back(testSmplNbr);
-        maxAmp.push_back(testValue);
+        beats.addBeat(testSmplNbr, testValue);
         // do not set isValid true, because this would start checking for a minimum between two maxima
     } else
     {
-        assert(!maxtime.empty());
-        assert(!maxAmp.empty());
+        size_t last = beats.size() - 1;
 
         //time since last max is <minPeakTime (ms) and the new sample is larger: replace the old value
-        if ((testSmplNbr - maxtime.back()) < minPeakTime)
+        if ((testSmplNbr - beats.peakTime(last)) < minPeakTime)
         {
-            if (maxAmp.back() < testValue)
+            if (beats.peakAmplitude(last) < testValue)
             {
-                maxAmp.back() = testValue;
-                maxtime.back() = testSmplNbr;
+                beats.setPeak(last, testSmplNbr, testValue);
             } else
             {
-                // Skip this maxima, it is too quick after the last one, but smaller.
-                if (validPulseCnt > 0)
-                {
-                    // No new maxima detected, finish function with old values.
-                    // validPulseCnt will be increased again by this.
-                    validPulseCnt--;
-                }
+                // Skip this maxima, it is too quick after the last one, but smaller. Nothing changed.
+                return false;
             }
+        } else if (beats.addBeat(testSmplNbr, testValue))
+        {
+            // The beat before can no longer change.
+            addToWindows(last);
+            last++;
         } else
         {
-            maxAmp.push_back(testValue);
-            maxtime.push_back(testSmplNbr);
+            PLOG_WARNING << "Beat table full after " << beats.size() << " beats, maximum ignored";
+            return false;
         }
 
-        if (maxtime.size() > 1)
+        if (last > 0)
         {
-            double newHR = (60.0 * samplingRate) / (double) (maxtime.back() - (*(maxtime.end() - 2)));
-
-            if (isHeartRateValid(newHR))
-            {
-                hrData.push_back(newHR);
-                validPulseCnt++;
-                isValid = true;
-            } else
-            {
-                PLOG_INFO << "Invalid pulse after " << validPulseCnt << " valid ones";
-                validPulseCnt = 0;
-                maxAmp.clear();
-                maxtime.clear();
-                minAmp.clear();
-                mintime.clear();
-                maxtime.push_back(testSmplNbr);
-                maxAmp.push_back(testValue);
-                hrData.clear();
-                isValid = false;
-            }
+            // The trough before the new (or moved) peak is set for artifacts as well, every row keeps its trough.
+            findMinima(oscillation);
+            isValid = validateBeat(last);
         }
     }
     return isValid;
 }
 
+/**
+ * Validates the latest beat against the beats before it and sets its heart rate and type.
+ *
+ * The heart rate is calculated from the distance to the last beat that is not an artifact. A peak that comes too
+ * soon or that is an amplitude outlier is marked as an artifact. A pause of up to MAX_MISSED_BEATS intervals at the
+ * heart rate of the previous beat is bridged, the heart rate of the beat is the one of the missed beats. If there is
+ * no valid beat yet, the pause is too long or there are more than MAX_ARTIFACTS artifacts in a row, the beat history
+ * is discarded and the detection restarts with the latest peak.
+ * @param beat The index of the latest beat, must be larger than 0.
+ * @return True if the beat is valid.
+ */
+bool OBPDetection::validateBeat(size_t beat)
+{
+    const size_t previous = getPreviousBeat(beat);
+    bool tolerated = beats.type(previous) == BeatType::Valid && validPulseCnt >= MIN_TOLERANT_BEATS;
+    double newHR = (60.0 * config.samplingRate) / (double) (beats.peakTime(beat) - beats.peakTime(previous));
+    BeatType type = BeatType::Artifact;
+
+    if (isHeartRateValid(newHR))
+    {
+        type = BeatType::Valid;
+    } else if (tolerated && newHR < config.minValidHR)
+    {
+        // The peaks in between were missed, e.g. because they were below the prominence.
+        const double lastHR = beats.heartRate(previous);
+        const double intervals = std::round(lastHR / newHR);
+        if (intervals <= MAX_MISSED_BEATS && std::abs(newHR * intervals - lastHR) < MISSED_BEAT_TOLERANCE * lastHR)
+        {
+            PLOG_INFO << "Bridged " << intervals - 1 << " missed beat(s) at " << beats.peakTime(beat);
+            newHR *= intervals;
+            type = BeatType::Valid;
+        } else
+        {
+            tolerated = false;
+        }
+    }
+
+    if (type == BeatType::Valid && tolerated && isAmplitudeOutlier(beat))
+    {
+        type = BeatType::Artifact;
+    }
+
+    if (type == BeatType::Valid)
+    {
+        beats.setHeartRate(beat, newHR, BeatType::Valid);
+        validPulseCnt++;
+        return true;
+    }
+    // All beats after the previous one are artifacts.
+    if (tolerated && beat - previous <= MAX_ARTIFACTS)
+    {
+        PLOG_INFO << "Artifact at " << beats.peakTime(beat) << " after " << validPulseCnt << " valid pulses";
+        beats.setHeartRate(beat, newHR, BeatType::Artifact);
+        return false;
+    }
+
+    PLOG_INFO << "Invalid pulse after " << validPulseCnt << " valid ones";
+    const size_t time = beats.peakTime(beat);
+    const double amplitude = beats.peakAmplitude(beat);
+    if (std::find(beats.typeColumn(), beats.typeColumn() + beats.size(), BeatType::Valid) !=
+        beats.typeColumn() + beats.size())
+    {
+        restarts++;
+    }
+    validPulseCnt = 0;
+    beats.clear();
+    peakWindow.clear();
+    hrWindow.clear();
+    beats.addBeat(time, amplitude);
+    return false;
+}
+
+/**
+ * Finds the last beat before the given one that is not an artifact.
+ * @param beat The index of the beat, may be the size of the table to search from the last beat on.
+ * @return The index of the beat, or the size of the table if there is none.
+ */
+size_t OBPDetection::getPreviousBeat(size_t beat) const
+{
+    while (beat > 0)
+    {
+        beat--;
+        if (beats.type(beat) != BeatType::Artifact)
+        {
+            return beat;
+        }
+    }
+    return beats.size();
+}
+
+/**
+ * Checks if the peak of a beat is far larger than the recent peaks, e.g. because of a movement of the arm.
+ *
+ * The peak is compared to the running median of the last AMP_OUTLIER_WINDOW peaks that are not artifacts, with the
+ * median absolute deviation (MAD) as the measure of their spread. The rising envelope before the MAP is not an outlier
+ * as long as the peaks grow by less than AMP_OUTLIER_RATIO over the window.
+ * @param beat The index of the beat.
+ * @return True if the peak is an outlier, false if it is not or there are not enough beats to decide.
+ */
+bool OBPDetection::isAmplitudeOutlier(size_t beat) const
+{
+    if (!peakWindow.full())
+    {
+        return false;
+    }
+    const double median = peakWindow.median();
+    const double amplitude = beats.peakAmplitude(beat);
+    return amplitude > AMP_OUTLIER_RATIO * median && amplitude > median + AMP_OUTLIER_MAD * peakWindow.sigma();
+}
+
+/**
+ * Adds a beat that can no longer change to the running medians of the peaks and the heart rate.
+ * @param beat The index of the beat.
+ */
+void OBPDetection::addToWindows(size_t beat)
+{
+    if (beats.type(beat) != BeatType::Artifact)
+    {
+        peakWindow.add(beats.peakAmplitude(beat));
+    }
+    if (beats.type(beat) == BeatType::Valid)
+    {
+        hrWindow.add(beats.heartRate(beat));
+    }
+}
+
 
 /**
  * Checks if the heart rate is in between the defined values of maxValidHR and minValidHR.
@@ -308,37 +598,31 @@ bool OBPDetection::isValidMaxima()
  */
 bool OBPDetection::isHeartRateValid(double heartRate)
 {
-    return (minValidHR <= heartRate && heartRate <= maxValidHR);
+    return (config.minValidHR <= heartRate && heartRate <= config.maxValidHR);
 }
 
 
 /**
  * Finds the minimal value in the oscillation between two maxima.
+ * @param oscillation All oscillation values of the measurement so far.
  */
-void OBPDetection::findMinima()
+void OBPDetection::findMinima(std::span<const double> oscillation)
 {
 
-    if (maxAmp.size() >= 2)
+    if (beats.size() >= 2)
     {
-        // get sub-vector of oData from second last to last max value
-        auto firstMax = oData.begin() + *(maxtime.end() - 2);
-        auto lastMax = oData.begin() + maxtime.back();
+        const size_t firstBeat = beats.size() - 2;
+        // get sub-span of the oscillation from second last to last max value
+        auto firstMax = oscillation.begin() + beats.peakTime(firstBeat);
+        auto lastMax = oscillation.begin() + beats.peakTime(firstBeat + 1);
         // find minimal value in between
         auto iter = std::min_element(firstMax, lastMax);
         // find distance from first max value to calculate time of minima
         // min time = first max time + dist
-        auto dist = std::distance(firstMax, iter);
+        auto dist = (size_t) std::distance(firstMax, iter);
 
-        // Check if the last maxima value was replaced. If yes, replace last minima value
-        if (mintime.size() == (maxtime.size() - 1))
-        {
-            minAmp.back() = *iter;
-            mintime.back() = dist + *(maxtime.end() - 2);
-        } else
-        {
-            minAmp.push_back(*iter);
-            mintime.push_back(dist + *(maxtime.end() - 2));
-        }
+        // If the last maxima value was replaced, the minima value of the beat before is replaced as well.
+        beats.setTrough(firstBeat, beats.peakTime(firstBeat) + dist, *iter);
     }
 
 }
@@ -350,18 +634,34 @@ void OBPDetection::findMinima()
 bool OBPDetection::isEnoughData()
 {
     bool bIsEnough = false;
+    // The last three peaks that are not artifacts (the current one first) and the largest peak, without outliers.
+    filterOutliers(beats, beats.peakAmplitudeColumn(), beats.size(), peakAmps.data());
+    std::array<double, 3> maxAmp{};
+    size_t nPeaks = 0;
+    double maxEl = 0.0;
+    for (size_t i = beats.size(); i-- > 0;)
+    {
+        if (beats.type(i) != BeatType::Artifact)
+        {
+            if (nPeaks < maxAmp.size())
+            {
+                maxAmp[nPeaks] = peakAmps[i];
+            }
+            maxEl = std::max(maxEl, peakAmps[i]);
+            nPeaks++;
+        }
+    }
     // minimum number of peaks detected:
-    if (maxAmp.size() > minNbrPeaks)
+    if (nPeaks > (size_t) config.minNbrPeaks)
     {
-        auto maxEl = std::max_element(maxAmp.begin(), maxAmp.end());
         // maximum value has minimal size of 1.5
         // the last two values are larger than the current --> continuously decreasing
-        if (*maxEl > 1.5 && (((maxAmp.back() < *(maxAmp.end() - 3)) && (maxAmp.back() < *(maxAmp.end() - 2))) ||
-                             (maxAmp.back() < 2 * prominence)))
+        if (maxEl > 1.5 && (((maxAmp[0] < maxAmp[2]) && (maxAmp[0] < maxAmp[1])) ||
+                            (maxAmp[0] < 2 * config.prominence)))
         {
-            double cutoff = (*maxEl) * (ratio_DBP - cutoffHyst);
+            double cutoff = maxEl * (config.ratioDBP - config.cutoffHyst);
             // the last three values (current included), are smaller than the cutoff
-            if ((*(maxAmp.end() - 3) < cutoff) && (*(maxAmp.end() - 2) < cutoff) && (maxAmp.back() < cutoff))
+            if ((maxAmp[2] < cutoff) && (maxAmp[1] < cutoff) && (maxAmp[0] < cutoff))
             {
                 bIsEnough = true;
             }
@@ -373,100 +673,346 @@ bool OBPDetection::isEnoughData()
 
 
 /**
- * Calculates the Oscillometric Waveform Envelope (OMWE) from the saved min and max values (minAmp and mintime and
- * maxAmp and maxtime) in preparation to find the maximal oscillation and the ratios of it for the systolic and
- * diastolic blood pressure.
+ * Calculates the results from the beats detected so far, called once enough data is available.
+ *
+ * Calculates the envelope from all beats and finds the MAP, SBP and DBP at fixed ratios of its maximum.
+ * @param pressure All pressure values of the measurement so far.
+ */
+void OBPDetection::findResults(std::span<const double> pressure)
+{
+    findOWME();
+    findMAP(pressure);
+}
+
+/**
+ * Calculates the Oscillometric Waveform Envelope (OMWE) from the peaks and troughs saved in the beat table in
+ * preparation to find the maximal oscillation and the ratios of it for the systolic and diastolic blood pressure.
+ * Outliers of the peaks and troughs are replaced beforehand (filterBeats()).
  *
- * The calculated values will be stored in omvweTimes and omweData.
+ * The calculated values will be stored in omwe, replacing any previously calculated envelope.
  */
 void OBPDetection::findOWME()
 {
-    // forward iteration using const iterator, because they should not be touched
-    auto timeMax1 = maxtime.cbegin();
-    auto ampMin1 = minAmp.cbegin();
-    auto ampMax1 = maxAmp.cbegin();
+    filterBeats();
+    calculateEnvelope(beats, peakAmps.data(), troughAmps.data(), omwe);
+}
+
+/**
+ * Calculates the envelope from the peaks and troughs of a beat table.
+ *
+ * For every pair of consecutive beats, the peaks are interpolated at the time of the first trough and the troughs at
+ * the time of the second peak, which gives two envelope points per beat. Artifacts are skipped, the envelope is
+ * interpolated between the beats around them.
+ * @param beats The beat table with the times of the peaks and troughs.
+ * @param peakAmps The peak amplitudes to use, e.g. with outliers replaced, one per beat.
+ * @param troughAmps The trough amplitudes to use, one per beat with a trough.
+ * @param envelope Returns the envelope.
+ */
+void OBPDetection::calculateEnvelope(const BeatTable &beats, const double *peakAmps, const double *troughAmps,
+                                     Envelope &envelope)
+{
+    envelope.clear();
 
     // The min values are defined between two max values. Therefore, iterate trough them until the second to last value.
-    for (auto timeMin1 = mintime.cbegin(); timeMin1 != (mintime.cend() - 1); ++timeMin1)
+    // Artifacts are skipped, the envelope is interpolated between the beats around them.
+    size_t previous = beats.troughCount();
+    for (size_t next = 0; next < beats.troughCount(); ++next)
     {
-        auto timeMin2 = std::next(timeMin1, 1);
-        auto timeMax2 = std::next(timeMax1, 1);
-        auto ampMin2 = std::next(ampMin1, 1);
-        auto ampMax2 = std::next(ampMax1, 1);
+        if (beats.type(next) == BeatType::Artifact)
+        {
+            continue;
+        }
+        const size_t i = previous;
+        previous = next;
+        if (i == beats.troughCount())
+        {
+            continue;
+        }
+
+        const size_t timeMax1 = beats.peakTime(i);
+        const size_t timeMax2 = beats.peakTime(next);
+        const size_t timeMin1 = beats.troughTime(i);
+        const size_t timeMin2 = beats.troughTime(next);
+        const double ampMax1 = peakAmps[i];
+        const double ampMax2 = peakAmps[next];
+        const double ampMin1 = troughAmps[i];
+        const double ampMin2 = troughAmps[next];
 
-        assert(*timeMin1 > *timeMax1);
-        assert(*timeMin2 > *timeMax2);
+        assert(timeMin1 > timeMax1);
+        assert(timeMin2 > timeMax2);
 
         // Empty a value interpolated between the two max (resp. min) values at the position (in time)
         // where another min (resp. max) value is to be able to calculate the envelope.
-        auto lerpMax = std::lerp(*ampMax1, *ampMax2, getRatio(*timeMax1, *timeMax2, *timeMin1));
-        auto lerpMin = std::lerp(*ampMin1, *ampMin2, getRatio(*timeMin1, *timeMin2, *timeMax2));
+        auto lerpMax = std::lerp(ampMax1, ampMax2, getRatio(timeMax1, timeMax2, timeMin1));
+        auto lerpMin = std::lerp(ampMin1, ampMin2, getRatio(timeMin1, timeMin2, timeMax2));
 
         // Empty the envelope, save both time and values.
-        omweData.push_back(lerpMax - *ampMin1);
-        omweTimes.push_back(*timeMin1);
-        omweData.push_back(*ampMax2 - lerpMin);
-        omweTimes.push_back(*timeMax2);
+        envelope.addPoint(timeMin1, lerpMax - ampMin1);
+        envelope.addPoint(timeMax2, ampMax2 - lerpMin);
+    }
+}
+
+/**
+ * Replaces single outliers of the peak and trough amplitudes, which are the OMWE is calculated from, so a single
+ * spiky beat does not shift the MAP. The results are stored in peakAmps and troughAmps.
+ */
+void OBPDetection::filterBeats()
+{
+    filterOutliers(beats, beats.peakAmplitudeColumn(), beats.size(), peakAmps.data());
+    filterOutliers(beats, beats.troughAmplitudeColumn(), beats.troughCount(), troughAmps.data());
+}
+
+/**
+ * Replaces outliers in a column of the beat table by the median of the beats around them (Hampel filter).
+ *
+ * The running median and MAD are taken over ENVELOPE_FILTER_WINDOW beats centred on each beat, artifacts are skipped.
+ * A value that differs from the median by more than ENVELOPE_FILTER_MAD scaled MADs is replaced by the median. The
+ * beats at both ends, which have no full window around them, are kept.
+ * @param table The beat table, to skip the artifacts.
+ * @param values The column of the beat table.
+ * @param count The number of values in the column.
+ * @param filtered Returns the filtered values, has to hold count values. The values of artifacts are not set.
+ */
+void OBPDetection::filterOutliers(const BeatTable &table, const double *values, size_t count, double *filtered)
+{
+    SlidingMedian window(ENVELOPE_FILTER_WINDOW);
+    const size_t half = window.windowSize() / 2;
+    std::array<size_t, ENVELOPE_FILTER_WINDOW> rows{}; // the rows in the window, as a ring in the order added
+    size_t nAdded = 0;
+    for (size_t next = 0; next < count; ++next)
+    {
+        if (table.type(next) == BeatType::Artifact)
+        {
+            continue;
+        }
+        // The window only holds the original values, replaced values are not fed back.
+        filtered[next] = values[next];
+        window.add(values[next]);
+        rows[nAdded % rows.size()] = next;
+        nAdded++;
+        if (window.full())
+        {
+            const size_t row = rows[(nAdded - 1 - half) % rows.size()];
+            const double median = window.median();
+            if (std::abs(values[row] - median) > ENVELOPE_FILTER_MAD * window.sigma())
+            {
+                filtered[row] = median;
+            }
+        }
+    }
+}
 
-        // Increase all the iterators not handled by the for loop:
-        timeMax1++;
-        ampMin1++;
-        ampMax1++;
+/**
+ * Predicts the DBP from the falling flank of the envelope, only used in predictive mode.
+ *
+ * A straight line is fitted to the envelope points after the maximum that are below FLANK_UPPER of it. The DBP time
+ * is where the line crosses the DBP ratio of the maximum. Its confidence interval follows from the standard error
+ * of the inverse prediction of a linear regression:
+ *   var(t) = s^2 / b^2 * (1/n + (t - mean(t))^2 / Sxx)
+ * with the residual variance s^2, the slope b and the sum of squares of the times Sxx. The interval is converted to
+ * mmHg with the deflation rate between the maximum and the latest sample.
+ *
+ * @param pressure All pressure values of the measurement so far.
+ * @return True if the confidence interval is within the prediction tolerance.
+ */
+bool OBPDetection::isPredictable(std::span<const double> pressure)
+{
+    predDBPTime = 0;
+    if (beats.size() <= (size_t) config.minNbrPeaks)
+    {
+        return false;
+    }
+    findOWME();
+    if (omwe.empty())
+    {
+        return false;
     }
 
+    const double *amps = omwe.amplitudeColumn();
+    const size_t *times = omwe.timeColumn();
+    const size_t maxIdx = std::distance(amps, std::max_element(amps, amps + omwe.size()));
+    const double flankUpper = FLANK_UPPER * amps[maxIdx];
+
+    // Sums for the linear regression over the points of the falling flank.
+    size_t n = 0;
+    double sumT = 0.0;
+    double sumY = 0.0;
+    for (size_t i = maxIdx + 1; i < omwe.size(); ++i)
+    {
+        if (amps[i] < flankUpper)
+        {
+            n++;
+            sumT += (double) times[i];
+            sumY += amps[i];
+        }
+    }
+    if (n < (size_t) std::max(config.minFlankPoints, 3))
+    {
+        return false;
+    }
+    const double meanT = sumT / (double) n;
+    const double meanY = sumY / (double) n;
+    double sxx = 0.0;
+    double sxy = 0.0;
+    for (size_t i = maxIdx + 1; i < omwe.size(); ++i)
+    {
+        if (amps[i] < flankUpper)
+        {
+            sxx += ((double) times[i] - meanT) * ((double) times[i] - meanT);
+            sxy += ((double) times[i] - meanT) * (amps[i] - meanY);
+        }
+    }
+    if (sxx <= 0.0 || sxy >= 0.0)
+    {
+        return false; // the flank is not falling
+    }
+    const double slope = sxy / sxx;
+    double sse = 0.0;
+    for (size_t i = maxIdx + 1; i < omwe.size(); ++i)
+    {
+        if (amps[i] < flankUpper)
+        {
+            const double residual = amps[i] - (meanY + slope * ((double) times[i] - meanT));
+            sse += residual * residual;
+        }
+    }
+
+    const double dbpTime = meanT + (config.ratioDBP * amps[maxIdx] - meanY) / slope;
+    const double varT = sse / (double) (n - 2) / (slope * slope) *
+                        (1.0 / (double) n + (dbpTime - meanT) * (dbpTime - meanT) / sxx);
+
+    // Deflation rate in mmHg per sample, from the maximum of the envelope to the latest sample.
+    const size_t now = pressure.size() - 1;
+    if (dbpTime <= (double) times[maxIdx] || now <= times[maxIdx])
+    {
+        return false;
+    }
+    const double rate = (pressure[times[maxIdx]] - pressure[now]) / (double) (now - times[maxIdx]);
+    if (rate <= 0.0)
+    {
+        return false;
+    }
+
+    const double confidence = PREDICTION_Z * std::sqrt(varT) * rate;
+    if (confidence > config.predictionTolerance)
+    {
+        return false;
+    }
+
+    predDBPTime = (size_t) dbpTime;
+    predConfidence = confidence;
+    if (predDBPTime < now)
+    {
+        predDBP = getPressureAt(pressure, predDBPTime);
+    } else
+    {
+        predDBP = pressure[now] - rate * (dbpTime - (double) now);
+    }
+    PLOG_INFO << "DBP predicted at " << predDBPTime << ": " << predDBP << " +/- " << predConfidence << " mmHg";
+    return true;
 }
 
 /**
  * Find the Mean Arterial Pressure (MAP) as well as the systolic and diastolic blood pressures (SBP, DBP).
  *
  * The results will be saved in the result variables resMAP, resSBP and resDBP. They are saved as doubled, but this
- * does not represent their precision.
+ * does not represent their precision. The times at which they were found are saved in resMAPTime, resSBPTime and
+ * resDBPTime.
+ * @param pressure All pressure values of the measurement so far.
  */
-void OBPDetection::findMAP()
+void OBPDetection::findMAP(std::span<const double> pressure)
 {
+    if (omwe.empty())
+    {
+        PLOG_WARNING << "couldn't find MAP, the envelope is empty";
+        return;
+    }
 
-    auto maxOMWE = std::max_element(omweData.begin(), omweData.end());
-    auto maxTime = omweTimes[std::distance(omweData.begin(), maxOMWE)];
+    bool foundSBP;
+    const bool foundDBP = findRatioTimes(omwe, config.ratioSBP, config.ratioDBP, resMAPTime, resSBPTime, resDBPTime,
+                                         foundSBP);
+    resMAP = getPressureAt(pressure, resMAPTime);
+    if (foundSBP)
+    {
+        resSBP = getPressureAt(pressure, resSBPTime);
+    } else
+    {
+        resSBP = 0.0;
+        PLOG_WARNING << "couldn't find SBP";
+    }
+    if (foundDBP)
+    {
+        resDBP = getPressureAt(pressure, resDBPTime);
+    } else if (predDBPTime != 0)
+    {
+        // The envelope has not crossed the DBP ratio yet, use the prediction.
+        resDBPTime = predDBPTime;
+        resDBP = predDBP;
+        predicted = true;
+    } else
+    {
+        resDBPTime = 0;
+        PLOG_WARNING << "couldn't find DBP";
+    }
+}
 
-    resMAP = getPressureAt(maxTime);
+/**
+ * Finds the times of the MAP, SBP and DBP in an envelope.
+ *
+ * The MAP is where the envelope is maximal. The SBP is where the envelope first rises above the fraction ratioSBP
+ * of the maximum and the DBP is where it first falls below the fraction ratioDBP of the maximum after the MAP. The
+ * times of SBP and DBP are interpolated between the two envelope points around the crossing. The SBP is not found if
+ * the envelope does not rise above the ratio before the maximum or already starts above it, as there is no point
+ * before the crossing to interpolate from.
+ *
+ * @param envelope The envelope to search, must not be empty.
+ * @param ratioSBP The ratio to find the SBP with.
+ * @param ratioDBP The ratio to find the DBP with.
+ * @param mapTime Returns the time (sample number) of the MAP.
+ * @param sbpTime Returns the time (sample number) of the SBP, 0 if it was not found.
+ * @param dbpTime Returns the time (sample number) of the DBP, only set if it was found.
+ * @param foundSBP Returns true if the SBP was found.
+ * @return True if the DBP was found.
+ */
+bool OBPDetection::findRatioTimes(const Envelope &envelope, double ratioSBP, double ratioDBP, size_t &mapTime,
+                                  size_t &sbpTime, size_t &dbpTime, bool &foundSBP)
+{
+    const double *omweData = envelope.amplitudeColumn();
+    const size_t *omweTimes = envelope.timeColumn();
+    const size_t maxIdx = std::distance(omweData, std::max_element(omweData, omweData + envelope.size()));
 
-    double maxVAL = *maxOMWE;
-    double sbpSearch = ratio_SBP * maxVAL;
-    double ubSBP = 0;
-    double lbSBP = 0;
-    int lbSTime = 0;
-    int ubSTime = 0;
+    mapTime = omweTimes[maxIdx];
 
-    for (auto omweSBP = omweData.begin(); omweSBP != maxOMWE; ++omweSBP)
+    double maxVAL = omweData[maxIdx];
+    double sbpSearch = ratioSBP * maxVAL;
+    size_t sbpIdx = 0;
+    while (sbpIdx < maxIdx && !(omweData[sbpIdx] > sbpSearch))
     {
-        if (*omweSBP > sbpSearch)
-        {
-            ubSBP = *omweSBP;
-            ubSTime = omweTimes[std::distance(omweData.begin(), omweSBP)];
-            omweSBP--;
-            lbSBP = *omweSBP;
-            lbSTime = omweTimes[std::distance(omweData.begin(), omweSBP)];
-            break;
-        }
+        ++sbpIdx;
+    }
+    foundSBP = sbpIdx > 0 && sbpIdx < maxIdx;
+    sbpTime = 0;
+    if (foundSBP)
+    {
+        const double lbSBP = omweData[sbpIdx - 1];
+        const double ubSBP = omweData[sbpIdx];
+        sbpTime = (size_t) std::lerp((double) omweTimes[sbpIdx - 1], (double) omweTimes[sbpIdx],
+                                     getRatio(lbSBP, ubSBP, sbpSearch));
     }
 
-    int lerpSBPtime = (int) std::lerp(lbSTime, ubSTime, getRatio(lbSBP, ubSBP, sbpSearch));
-    resSBP = getPressureAt(lerpSBPtime);
-
-    double dbpSearch = ratio_DBP * maxVAL;
+    double dbpSearch = ratioDBP * maxVAL;
     double ubDBP = 0;
     double lbDBP = 0;
-    int lbDTime = 0;
-    int ubDTime = 0;
-    for (auto omweDBP = maxOMWE; omweDBP != omweData.end(); ++omweDBP)
+    size_t lbDTime = 0;
+    size_t ubDTime = 0;
+    for (size_t i = maxIdx; i < envelope.size(); ++i)
     {
-        if (*omweDBP < dbpSearch)
+        if (omweData[i] < dbpSearch)
         {
-            lbDBP = *omweDBP;
-            lbDTime = omweTimes[std::distance(omweData.begin(), omweDBP)];
-            omweDBP--;
-            ubDBP = *omweDBP;
-            ubDTime = omweTimes[std::distance(omweData.begin(), omweDBP)];
+            lbDBP = omweData[i];
+            lbDTime = omweTimes[i];
+            ubDBP = omweData[i - 1];
+            ubDTime = omweTimes[i - 1];
             break;
         }
     }
@@ -477,38 +1023,47 @@ void OBPDetection::findMAP()
         // value relating to the higher time the ratio is inverted.
         // The interpolation is done from the "upper bound" time (earlier in time) to the
         // "lower bound" time (later in time).
-        int lerpDBPtime = (int) std::lerp(ubDTime, lbDTime, 1.0 - getRatio(lbDBP, ubDBP, dbpSearch));
-        resDBP = getPressureAt(lerpDBPtime);
-    } else
-    {
-        PLOG_WARNING << "couldn't find DBP";
+        dbpTime = (size_t) std::lerp((double) ubDTime, (double) lbDTime, 1.0 - getRatio(lbDBP, ubDBP, dbpSearch));
     }
+    return lbDBP != 0;
+}
+
+/**
+ * Get a pressure value at a specific time, averaged over one pulse at the average heart rate of the measurement.
+ * @param pressure All pressure values of the measurement so far.
+ * @param time The time value (in samples) where to get the pressure.
+ * @return The pressure value at the specified time.
+ */
+double OBPDetection::getPressureAt(std::span<const double> pressure, size_t time)
+{
+    return getAveragePressureAt(pressure, time, getAverageHeartRate(), config.samplingRate);
 }
 
 /**
- * Get a pressure value at a specific time. Considers the average heart rate and gets the pressure as the average
+ * Get a pressure value at a specific time. Considers the heart rate and gets the pressure as the average
  * value over the samples for one pulse centered around the specified time value.
+ * @param pressure The pressure values.
  * @param time The time value (in samples) where to get the pressure.
+ * @param heartRate The heart rate in bpm that defines the length of one pulse.
+ * @param samplingRate The sampling rate of the pressure values.
  * @return The pressure value at the specified time.
  */
-double OBPDetection::getPressureAt(int time)
+double OBPDetection::getAveragePressureAt(std::span<const double> pressure, size_t time, double heartRate,
+                                          double samplingRate)
 {
     double average;
-    int hrSamplesHalf = (samplingRate * (int) getAverage(hrData)) / 120;
+    int hrSamplesHalf = (samplingRate * (int) heartRate) / 120;
 
-    assert(!pData.empty());
+    assert(!pressure.empty());
 
-    if (pData.size() > time + hrSamplesHalf)
+    if (pressure.size() > time + hrSamplesHalf && time >= (size_t) hrSamplesHalf)
     {
-        auto firstP = &pData[time - hrSamplesHalf];
-        auto lastP = &pData[time + hrSamplesHalf];
-        std::vector<double> newVec(firstP, lastP);
-        average = getAverage(newVec);
+        average = getAverage(pressure.subspan(time - hrSamplesHalf, 2 * hrSamplesHalf));
     } else
     {
         PLOG_WARNING << "Trying to get pressure at time " << time << " with hrSamplesHalf: " << hrSamplesHalf <<
-                     "and pData.size(): " << pData.size();
-        average = pData[time];
+                     "and pressure.size(): " << pressure.size();
+        average = pressure[std::min(time, pressure.size() - 1)];
     }
     return average;
 }
@@ -530,10 +1085,10 @@ double OBPDetection::getRatio(double lowerBound, double upperBound, double value
 
 /**
  * Calculates the average value in a given vector and returns it.
- * @param avVector A vector of doubles to take the average from.
+ * @param avVector A span of doubles to take the average from.
  * @return The average of all the values in the vector.
  */
-double OBPDetection::getAverage(std::vector<double> avVector)
+double OBPDetection::getAverage(std::span<const double> avVector)
 {
     double av = 0.0;
     if (!avVector.empty())
@@ -544,22 +1099,32 @@ double OBPDetection::getAverage(std::vector<double> avVector)
 }
 
 /**
- * Resets all variables to start a new measurement.
+ * Resets all variables to start a new measurement. Takes over the currently published configuration.
  */
 void OBPDetection::reset()
 {
+    config = configChannel.snapshot();
     pData.clear();
     oData.clear();
-    omweData.clear();
-    omweTimes.clear();
-    maxAmp.clear();
-    maxtime.clear();
-    minAmp.clear();
-    mintime.clear();
-    hrData.clear();
+    beats.clear();
+    omwe.clear();
 
     resMAP = 0.0;
     resSBP = 0.0;
     resDBP = 0.0;
+    resMAPTime = 0;
+    resSBPTime = 0;
+    resDBPTime = 0;
+    decisionTime = 0;
+    validPulseCnt = 0;
+    restarts = 0;
+    peakWindow.clear();
+    hrWindow.clear();
+    hrEstimator.reset(config.samplingRate, config.minValidHR, config.maxValidHR);
+    minPeakTime = config.minPeakTime;
     enoughData = false;
+    predicted = false;
+    predDBPTime = 0;
+    predDBP = 0.0;
+    predConfidence = 0.0;
 }
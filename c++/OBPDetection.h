@@ -12,8 +12,12 @@
 #define OBP_OBPDETECTION_H
 
 #include <vector>
-#include <atomic>
+#include <span>
 #include "common.h"
+#include "BeatTable.h"
+#include "SlidingMedian.h"
+#include "HeartRateEstimator.h"
+#include "ConfigChannel.h"
 
 /**
  * Class dependant configuration values:
@@ -22,6 +26,83 @@
 #define MIN_RATIO 0.01 //!< A ratio minimum should be larger than 0.
 #define MAX_RATIO 0.99 //!< A ratio maximum should be smaller than 1.
 #define MIN_PEAKS 5    //!< With less than 5 peaks, the detection is impossible.
+#define FLANK_UPPER 0.9 //!< Envelope points below this fraction of the maximum belong to the falling flank.
+#define PREDICTION_Z 2.0 //!< Number of standard deviations of the confidence interval of the predicted DBP (~95 %).
+#define MIN_TOLERANT_BEATS 5 //!< Artifacts are only tolerated after this many valid beats.
+#define MAX_ARTIFACTS 3 //!< Max. number of consecutive artifacts before the beat history is discarded.
+#define MAX_MISSED_BEATS 3 //!< A pause of up to this many beat intervals is bridged as missed beats.
+#define MISSED_BEAT_TOLERANCE 0.25 //!< Max. relative deviation of the heart rate over missed beats.
+#define AMP_OUTLIER_WINDOW 8 //!< Number of previous beats the running median of the peak amplitudes is taken over.
+#define AMP_OUTLIER_MAD 5.0 //!< A peak more than this many (scaled) MADs above the median is an artifact
+#define AMP_OUTLIER_RATIO 3.0 //!< if it is also larger than this multiple of the median.
+#define ENVELOPE_FILTER_WINDOW 7 //!< Number of beats the running median for the envelope is taken over (odd).
+#define ENVELOPE_FILTER_MAD 5.0 //!< Amplitudes more than this many (scaled) MADs from the median are replaced.
+#define HR_MEDIAN_WINDOW 5 //!< Number of beats the displayed heart rate is the median of.
+#define PEAK_TIME_RATIO 0.6 //!< Fraction of the estimated beat interval used as the min. time between two peaks.
+
+/**
+ * Enum of the available detection algorithms, selects the class that implements the detection.
+ */
+enum class DetectionAlgorithm
+{
+    FixedRatio,     //!< SBP and DBP at fixed ratios of the envelope maximum, implemented by OBPDetection.
+    Derivative,     //!< SBP and DBP at the extrema of the envelope derivative, implemented by DerivativeDetection.
+};
+
+/**
+ * The configuration of the detection algorithm.
+ *
+ * The values that are directly initialised are considered as configuration values but not implemented as such,
+ * they might just as well be constants until then.
+ */
+struct DetectionConfig
+{
+    double ratioSBP = 0.57;             //!< from literature, might be changed in settings later
+    double ratioDBP = 0.70;             //!< from literature, might be changed in settings later
+    double maxValidHR = 120.0;          //!< The maximal valid heart rate
+    double minValidHR = 50.0;           //!< The minimal valid heart rate
+    double prominence = 0.25;           //!< The min. prominence of one oscillation to count as a maximum
+    size_t minDataSize = 1200;          //!< The min. size of oscillation data. Before this it will not be analysed.
+    size_t minPeakTime = 300;           //!< The minimal time two peaks should be apart. If there are multiples,
+    //!< only the larger one will be considered.
+    bool adaptivePeakTime = true;       //!< Raise the min. peak time with the heart rate estimated from the spectrum.
+    double samplingRate = SAMPLING_RATE;//!< The sampling rate needed to calculate the heart rate from samples.
+    int minNbrPeaks = 10;               //!< The number of oscillation peaks required to be able to perform the
+    //!< algorithm.
+    double cutoffHyst = 0.3;            //!< The hysteresis below ratio_DBP the oscillations have to be in order to
+    //!< be able to end the measurement. This is not from the total OMVE, but from the maximal amplitude.
+    //!< (OMVE calculated afterwards).
+    bool predictive = false;            //!< Finish as soon as the DBP can be predicted from the falling flank.
+    double predictionTolerance = 3.0;   //!< The max. half width of the confidence interval of the predicted DBP
+    //!< in mmHg, to finish the measurement in predictive mode.
+    int minFlankPoints = 6;             //!< The min. number of envelope points on the falling flank to predict.
+};
+
+/**
+ * The complete result of the analysis of one measurement.
+ *
+ * All times are sample numbers relative to the first analysed sample (offset in the analysed data). Times of results
+ * that could not be calculated are 0.
+ */
+struct OBPResult
+{
+    bool finished = false;      //!< Enough data was found to calculate the results.
+    double map = 0.0;           //!< The mean arterial pressure in mmHg.
+    double sbp = 0.0;           //!< The systolic blood pressure in mmHg.
+    double dbp = 0.0;           //!< The diastolic blood pressure in mmHg.
+    double heartRate = 0.0;     //!< The average heart rate in bpm.
+    size_t offset = 0;          //!< Index of the first analysed sample in the data that was handed to the analysis.
+    size_t decisionTime = 0;    //!< The sample at which enough data was available to calculate the results.
+    size_t mapTime = 0;         //!< The sample at which the MAP was found.
+    size_t sbpTime = 0;         //!< The sample at which the SBP was found.
+    size_t dbpTime = 0;         //!< The sample at which the DBP was found.
+    bool predicted = false;     //!< The DBP was predicted, its time may be after the last analysed sample.
+    double dbpConfidence = 0.0; //!< Half width of the confidence interval of a predicted DBP in mmHg.
+    size_t artifacts = 0;       //!< Number of beats in the beat table that were marked as artifacts.
+    size_t restarts = 0;        //!< Number of times a beat history with valid beats was discarded.
+    BeatTable beats;            //!< The detected beats, including the heart rate series.
+    Envelope envelope;          //!< The OMWE the results were calculated from.
+};
 
 
 //! The OBPDetection class handles the implementation of the algorithm to get
@@ -43,12 +124,48 @@
  * Similarly, the diastolic blood pressure is defined as the pressure in time
  * after the MAP where the OMVE is a fraction of @ratio_DBP of the value at
  * the MAP.
+ *
+ * A peak that does not fit the rhythm of the beats before (too soon after the last one) or is far larger than the
+ * recent peaks (running median and MAD) is marked as an artifact instead of discarding all beats found so far. The
+ * heart rate and the envelope are calculated from the other beats. A pause of a few beat intervals is bridged as
+ * missed beats. Only if there is no valid beat yet, the pause is too long or too many artifacts follow each other,
+ * the beat history is discarded and the detection restarts. Single outliers among the remaining peaks and troughs are
+ * replaced by the running median of the beats around them before the envelope is calculated.
+ *
+ * Every sample of the oscillation, including the ones before the min. data size, is fed to a HeartRateEstimator. It
+ * finds the heart rate from the periodicity of the signal before two beats are confirmed, which is shown instead of
+ * the beat based heart rate until then. With adaptivePeakTime, the min. time between two peaks is raised to a
+ * fraction of the estimated beat interval, so the smaller peaks of the dicrotic notch and noise in between are not
+ * taken as beats. It is never raised above the interval of the max. valid heart rate, so no valid beat is skipped.
+ *
+ * Whole recordings can be analysed at once with analyze(). It works directly on the given data without copying it,
+ * but replays the streaming detection sample by sample and stops as soon as the results are available, so its results
+ * are exactly those of the measurement. There is no separate batch algorithm: the heart rate estimate that adapts the
+ * min. peak time has to see every sample in order and takes most of the time anyway.
+ *
+ * The configuration can be changed from any thread at any time. It is published through a ConfigChannel and only
+ * taken over at the next call to reset(), i.e. at the start of the next measurement. During a measurement, the
+ * algorithm works with a plain copy of the configuration.
+ *
+ * The detection of the beats is shared by all algorithms. Other algorithms derive from this class and replace the
+ * termination criterion (isEnoughData()) and the calculation of the results from the beats (findResults()), so they
+ * can be used through the same interface.
+ *
+ * In predictive mode, the measurement does not wait for the envelope to decay below the cutoff. A straight line is
+ * fitted to the falling flank of the envelope after every beat and the time where it crosses the DBP ratio is
+ * predicted, together with its confidence interval. As soon as the interval, converted to mmHg with the current
+ * deflation rate, is narrower than the tolerance, the measurement is finished. If the crossing has not been observed
+ * yet, the DBP is extrapolated with the deflation rate.
+ *
+ * Thread compatibility: all state of the detection is held per instance. Different instances can be used
+ * concurrently from different threads without synchronisation. A single instance must only be used by one thread at a
+ * time, with the exception of the configuration getters and setters, which may be called from any thread.
  */
 class OBPDetection {
 //TODO: add configurable parameters in constructor
 public:
     OBPDetection(double sampling_rate);
-    ~OBPDetection();
+    virtual ~OBPDetection();
 
     // Configuration getter and setters:
     double getRatioSBP();
@@ -57,70 +174,101 @@ public:
     void setRatioDBP(double val);
     int getMinNbrPeaks();
     void setMinNbrPeaks(int val);
+    bool getPredictive();
+    void setPredictive(bool val);
     void resetConfigValues();
 
     // Process values sample by sample:
     bool processSample(double pressure, double oscillation);
 
+    // Process an entire recording at once:
+    OBPResult analyze(std::span<const double> pressure, std::span<const double> oscillation);
+
     // Getter for results:
-    double getCurrentHeartRate();
-    double getAverageHeartRate();
+    [[nodiscard]] double getCurrentHeartRate() const;
+    [[nodiscard]] double getAverageHeartRate() const;
+    [[nodiscard]] double getMedianHeartRate() const;
+    [[nodiscard]] double getEstimatedHeartRate() const;
+    [[nodiscard]] const BeatTable &getBeats() const;
+    [[nodiscard]] const Envelope &getEnvelope() const;
     [[nodiscard]] double getMAP() const;
     [[nodiscard]] double getSBP() const;
     [[nodiscard]] double getDBP() const;
     [[nodiscard]] bool getIsEnoughData() const;
-    void reset();
+    [[nodiscard]] OBPResult getResult() const;
+    [[nodiscard]] DetectionConfig getConfig() const;
+    [[nodiscard]] std::span<const double> getPressureData() const;
+    [[nodiscard]] virtual DetectionAlgorithm getAlgorithm() const;
+    virtual void reset();
 
-private:
+    // Static helper functions, also used by other estimators:
+    static bool findRatioTimes(const Envelope &envelope, double ratioSBP, double ratioDBP, size_t &mapTime,
+                               size_t &sbpTime, size_t &dbpTime, bool &foundSBP);
+    static double getAveragePressureAt(std::span<const double> pressure, size_t time, double heartRate,
+                                       double samplingRate);
+    static void calculateEnvelope(const BeatTable &beats, const double *peakAmps, const double *troughAmps,
+                                  Envelope &envelope);
+    static void filterOutliers(const BeatTable &table, const double *values, size_t count, double *filtered);
+
+protected:
     // vectors to store values for calculations
     std::vector<double> pData;    //!< Stores the pressure data.
     std::vector<double> oData;    //!< Stores the oscillation data.
-    std::vector<double> maxAmp;   //!< Stores the detected maxima.
-    std::vector<int> maxtime;     //!< Stores the times values where the maxima occurred.
-    std::vector<double> minAmp;   //!< Stores the detected minima.
-    std::vector<int> mintime;     //!< Stores the times values where the minima occurred.
-    std::vector<double> omweData; //!< Stores the calculated values of the OMWE.
-    std::vector<int> omweTimes;   //!< Stores the time series where the OMWE was calculated.
-    std::vector<double> hrData;   //!< Stores the detected heart rate values.
+    BeatTable beats;              //!< Stores the detected beats (maxima, minima and heart rate).
+    Envelope omwe;                //!< Stores the calculated OMWE.
 
     // variables to store results
     double resMAP{};    //!< The result of the MAP calculation.
     double resSBP{};    //!< The result of the SBP calculation.
     double resDBP{};    //!< The result of the DBP calculation.
+    size_t resMAPTime{};    //!< The sample at which the MAP was found.
+    size_t resSBPTime{};    //!< The sample at which the SBP was found.
+    size_t resDBPTime{};    //!< The sample at which the DBP was found.
+    size_t decisionTime{};  //!< The sample at which enough data was available.
     bool enoughData;    //!< Enough data is available to attempt calculation of the OMWE.
+    bool predicted{};   //!< The DBP result was predicted.
+    size_t predDBPTime{};   //!< The predicted time of the DBP crossing.
+    double predDBP{};       //!< The predicted DBP.
+    double predConfidence{};//!< Half width of the confidence interval of the predicted DBP in mmHg.
+    int validPulseCnt{};    //!< Number of valid pulses since the beat history was last discarded.
+    size_t restarts{};      //!< Number of times a beat history with valid beats was discarded.
+    SlidingMedian peakWindow{AMP_OUTLIER_WINDOW};   //!< Running median of the last peaks that are not artifacts.
+    SlidingMedian hrWindow{HR_MEDIAN_WINDOW};       //!< Running median of the heart rate of the last valid beats.
+    std::array<double, BEAT_TABLE_CAPACITY> peakAmps{};     //!< Peak amplitudes with outliers replaced.
+    std::array<double, BEAT_TABLE_CAPACITY> troughAmps{};   //!< Trough amplitudes with outliers replaced.
+    HeartRateEstimator hrEstimator; //!< Estimates the heart rate from the spectrum before beats are confirmed.
+    size_t minPeakTime{};           //!< The min. time between two peaks, adapted to the estimated heart rate.
 
     // variables to store configurations
-    // The values that are directly initialised are considered as configuration alues but not implemented as such,
-    // they might just as well be constants until then.
-    std::atomic<double> ratio_SBP;               //! from literature, might be changed in settings later
-    std::atomic<double> ratio_DBP;               //! from literature, might be changed in settings later
-    std::atomic<double> maxValidHR = 120.0;      //! The maximal valid heart rate
-    std::atomic<double> minValidHR = 50.0;       //! The minimal valid heart rate
-    std::atomic<double> prominence = 0.25;       //! The min. prominence of one oscillation to count as a maximum
-    std::atomic<int> minDataSize = 1200;         //! The min. size of oscillation data. Before this it will not be
-    //! analysed.
-    std::atomic<int> minPeakTime = 300;          //! The minimal time two peaks should be apart. If there are
-    //! multiples, only the larger one will be considered.
-    std::atomic<double> samplingRate;            //! The sampling rate needed to calculate the heart rate from samples.
-    std::atomic<int> minNbrPeaks = 10;           //! The number of oscillation peaks required to be able to perform
-    //! the algorithm.
-    std::atomic<double> cutoffHyst = 0.3;        //! The hysteresis below ratio_DBP the oscillations have to be in
-    //! order to be able to end the measurement. This is not from the total OMVE, but from the maximal amplitude.
-    //! (OMVE calculated afterwards).
+    ConfigChannel<DetectionConfig> configChannel;   //!< The published configuration, changed by the setters.
+    DetectionConfig config;                         //!< The configuration of the current measurement.
 
+    // functions to be replaced by other algorithms:
+    virtual bool isEnoughData();
+    virtual void findResults(std::span<const double> pressure);
+    virtual bool isPredictable(std::span<const double> pressure);
+
+    double getPressureAt(std::span<const double> pressure, size_t time);
+    size_t getPreviousBeat(size_t beat) const;
+
+private:
     // private functions:
-    bool checkMaxima();
-    bool isValidMaxima();
+    bool processLatest(std::span<const double> pressure, std::span<const double> oscillation);
+    bool checkMaxima(std::span<const double> oscillation);
+    void updateHeartRateEstimate(double oscillation);
+    bool isValidMaxima(std::span<const double> oscillation);
+    bool validateBeat(size_t beat);
     bool isHeartRateValid(double heartRate);
-    void findMinima();
-    bool isEnoughData();
+    bool isAmplitudeOutlier(size_t beat) const;
+    void addToWindows(size_t beat);
+    void findMinima(std::span<const double> oscillation);
     void findOWME();
-    void findMAP();
-    double getPressureAt(int time);
+    void filterBeats();
+    void findMAP(std::span<const double> pressure);
 
     // Static functions:
     static double getRatio(double lowerBound, double upperBound, double value);
-    static double getAverage(std::vector<double> avVector);
+    static double getAverage(std::span<const double> avVector);
 };
 
 
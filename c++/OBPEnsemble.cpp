@@ -0,0 +1,209 @@
+/**
+ * @file        OBPEnsemble.cpp
+ * @brief       The implementation of the OBPEnsemble class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <cmath>
+#include "OBPEnsemble.h"
+
+/**
+ * Analyses an entire recording with the detector and evaluates all estimators on the detected beats.
+ * @param detector The detector to analyse the recording with, its configuration is used.
+ * @param pressure The pressure in mmHg.
+ * @param oscillation The oscillation in arbitrary units, same length as the pressure.
+ * @return The result of the detection and the estimates.
+ */
+EnsembleResult OBPEnsemble::analyze(OBPDetection &detector, std::span<const double> pressure,
+                                    std::span<const double> oscillation)
+{
+    EnsembleResult ensemble;
+    ensemble.detection = detector.analyze(pressure, oscillation);
+    ensemble.estimates = evaluate(ensemble.detection, pressure, detector.getConfig(), detector.getAlgorithm());
+    return ensemble;
+}
+
+/**
+ * Evaluates all estimators on the beats of a detection result.
+ * @param result The result of the detection. If it is not finished, all estimates are invalid.
+ * @param pressure The pressure data the beat times refer to.
+ * @param config The configuration the detection was done with, its ratios are used by all estimators.
+ * @param algorithm The algorithm of the detection. The interpolation estimate is the result of the detection, so it is
+ * only valid for the FixedRatio algorithm.
+ * @return The estimates, indexed by the Estimator enum.
+ */
+std::array<Estimate, NBR_ESTIMATORS> OBPEnsemble::evaluate(const OBPResult &result, std::span<const double> pressure,
+                                                           const DetectionConfig &config, DetectionAlgorithm algorithm)
+{
+    std::array<Estimate, NBR_ESTIMATORS> estimates;
+    for (size_t i = 0; i < NBR_ESTIMATORS; ++i)
+    {
+        estimates[i].estimator = static_cast<Estimator>(i);
+    }
+    if (!result.finished || pressure.empty())
+    {
+        return estimates;
+    }
+
+    Envelope envelope;
+    getMaxValueEnvelope(result.beats, envelope);
+    estimates[(size_t) Estimator::MaxValue] =
+            estimateFromEnvelope(Estimator::MaxValue, envelope, pressure, result.heartRate, config);
+
+    getMaxMinEnvelope(result.beats, envelope);
+    estimates[(size_t) Estimator::MaxMin] =
+            estimateFromEnvelope(Estimator::MaxMin, envelope, pressure, result.heartRate, config);
+
+    // The interpolated envelope is the one of the fixed-ratio detection itself, other algorithms do not build it.
+    if (algorithm == DetectionAlgorithm::FixedRatio)
+    {
+        Estimate &interpolation = estimates[(size_t) Estimator::Interpolation];
+        interpolation.valid = result.sbpTime != 0 && result.dbpTime != 0;
+        interpolation.map = result.map;
+        interpolation.sbp = result.sbp;
+        interpolation.dbp = result.dbp;
+        interpolation.mapTime = result.mapTime;
+        interpolation.sbpTime = result.sbpTime;
+        interpolation.dbpTime = result.dbpTime;
+    }
+
+    // The models are fitted to the max-min envelope.
+    getMaxMinEnvelope(result.beats, envelope);
+    estimates[(size_t) Estimator::Polyfit] =
+            estimateFromFit(Estimator::Polyfit, EnvelopeFit::fitPolynomial(envelope), pressure, result.heartRate,
+                            config);
+    estimates[(size_t) Estimator::Gaussian] =
+            estimateFromFit(Estimator::Gaussian, EnvelopeFit::fitGaussian(envelope), pressure, result.heartRate,
+                            config);
+    return estimates;
+}
+
+/**
+ * Gets a printable name of an estimator.
+ * @param estimator The estimator.
+ * @return The name of the estimator.
+ */
+const char *OBPEnsemble::getName(Estimator estimator)
+{
+    switch (estimator)
+    {
+        case Estimator::MaxValue:
+            return "max value";
+        case Estimator::MaxMin:
+            return "max-min value";
+        case Estimator::Interpolation:
+            return "interpolation";
+        case Estimator::Polyfit:
+            return "polyfit";
+        case Estimator::Gaussian:
+            return "gaussian";
+    }
+    return "unknown";
+}
+
+/**
+ * Calculates an estimate from an envelope with the fixed-ratio method.
+ * @param estimator The estimator the envelope was built by.
+ * @param envelope The envelope.
+ * @param pressure The pressure data the envelope times refer to.
+ * @param heartRate The average heart rate, used to average the pressure over one pulse.
+ * @param config The configuration with the ratios and the sampling rate.
+ * @return The estimate.
+ */
+Estimate OBPEnsemble::estimateFromEnvelope(Estimator estimator, const Envelope &envelope,
+                                           std::span<const double> pressure, double heartRate,
+                                           const DetectionConfig &config)
+{
+    Estimate estimate;
+    estimate.estimator = estimator;
+    if (envelope.empty())
+    {
+        return estimate;
+    }
+
+    bool foundSBP;
+    const bool foundDBP = OBPDetection::findRatioTimes(envelope, config.ratioSBP, config.ratioDBP, estimate.mapTime,
+                                                       estimate.sbpTime, estimate.dbpTime, foundSBP);
+    estimate.valid = foundSBP && foundDBP;
+    estimate.map = OBPDetection::getAveragePressureAt(pressure, estimate.mapTime, heartRate, config.samplingRate);
+    estimate.sbp = OBPDetection::getAveragePressureAt(pressure, estimate.sbpTime, heartRate, config.samplingRate);
+    if (estimate.valid)
+    {
+        estimate.dbp = OBPDetection::getAveragePressureAt(pressure, estimate.dbpTime, heartRate, config.samplingRate);
+    } else
+    {
+        estimate.dbpTime = 0;
+    }
+    return estimate;
+}
+
+/**
+ * Calculates an estimate from a model fitted to an envelope with the fixed-ratio method.
+ * @param estimator The estimator the model was fitted by.
+ * @param fit The fitted model.
+ * @param pressure The pressure data the envelope times refer to.
+ * @param heartRate The average heart rate, used to average the pressure over one pulse.
+ * @param config The configuration with the ratios and the sampling rate.
+ * @return The estimate, invalid if the fit failed.
+ */
+Estimate OBPEnsemble::estimateFromFit(Estimator estimator, const EnvelopeFitResult &fit,
+                                      std::span<const double> pressure, double heartRate,
+                                      const DetectionConfig &config)
+{
+    Estimate estimate;
+    estimate.estimator = estimator;
+    if (!fit.valid)
+    {
+        return estimate;
+    }
+
+    estimate.valid = EnvelopeFit::findRatioTimes(fit, config.ratioSBP, config.ratioDBP, estimate.mapTime,
+                                                 estimate.sbpTime, estimate.dbpTime);
+    estimate.map = OBPDetection::getAveragePressureAt(pressure, estimate.mapTime, heartRate, config.samplingRate);
+    estimate.sbp = OBPDetection::getAveragePressureAt(pressure, estimate.sbpTime, heartRate, config.samplingRate);
+    if (estimate.valid)
+    {
+        estimate.dbp = OBPDetection::getAveragePressureAt(pressure, estimate.dbpTime, heartRate, config.samplingRate);
+    } else
+    {
+        estimate.dbpTime = 0;
+    }
+    return estimate;
+}
+
+/**
+ * Builds an envelope from the peak amplitudes only, artifacts are skipped.
+ * @param beats The detected beats.
+ * @param envelope Returns the envelope.
+ */
+void OBPEnsemble::getMaxValueEnvelope(const BeatTable &beats, Envelope &envelope)
+{
+    envelope.clear();
+    for (size_t i = 0; i < beats.size(); ++i)
+    {
+        if (beats.type(i) != BeatType::Artifact)
+        {
+            envelope.addPoint(beats.peakTime(i), beats.peakAmplitude(i));
+        }
+    }
+}
+
+/**
+ * Builds an envelope from the difference of each peak and the trough following it, at the time of the peak. Artifacts
+ * are skipped.
+ * @param beats The detected beats.
+ * @param envelope Returns the envelope.
+ */
+void OBPEnsemble::getMaxMinEnvelope(const BeatTable &beats, Envelope &envelope)
+{
+    envelope.clear();
+    for (size_t i = 0; i < beats.troughCount(); ++i)
+    {
+        if (beats.type(i) != BeatType::Artifact)
+        {
+            envelope.addPoint(beats.peakTime(i), beats.peakAmplitude(i) - beats.troughAmplitude(i));
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file        OBPEnsemble.h
+ * @brief       The header file of the OBPEnsemble class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the OBPEnsemble class and contains the general class description.
+ */
+#ifndef OBP_OBPENSEMBLE_H
+#define OBP_OBPENSEMBLE_H
+
+#include <array>
+#include <span>
+#include "common.h"
+#include "OBPDetection.h"
+#include "EnvelopeFit.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define NBR_ESTIMATORS 5    //!< Number of implemented estimators.
+
+/**
+ * Enum to describe the method used to estimate the blood pressure from the detected beats.
+ */
+enum class Estimator
+{
+    MaxValue,       //!< The envelope consists of the peak amplitudes only.
+    MaxMin,         //!< The envelope is the difference between each peak and the following trough.
+    Interpolation,  //!< The envelope is interpolated between peaks and troughs, as done by OBPDetection.
+    Polyfit,        //!< A polynomial is fitted to the max-min envelope.
+    Gaussian,       //!< An asymmetric Gaussian is fitted to the max-min envelope.
+};
+
+/**
+ * The result of one estimator. Times are sample numbers, relative to the analysed data.
+ */
+struct Estimate
+{
+    Estimator estimator = Estimator::Interpolation; //!< The estimator that calculated this estimate.
+    bool valid = false;         //!< All three values could be calculated.
+    double map = 0.0;           //!< The mean arterial pressure in mmHg.
+    double sbp = 0.0;           //!< The systolic blood pressure in mmHg.
+    double dbp = 0.0;           //!< The diastolic blood pressure in mmHg.
+    size_t mapTime = 0;         //!< The sample at which the MAP was found.
+    size_t sbpTime = 0;         //!< The sample at which the SBP was found.
+    size_t dbpTime = 0;         //!< The sample at which the DBP was found.
+};
+
+/**
+ * The results of the detection and of all estimators.
+ */
+struct EnsembleResult
+{
+    OBPResult detection;                                //!< The result of the detection, including the beat table.
+    std::array<Estimate, NBR_ESTIMATORS> estimates;     //!< The estimates, indexed by the Estimator enum.
+};
+
+//! The OBPEnsemble class evaluates several blood pressure estimators on the same detected beats.
+/*!
+ * The beats and the envelope are detected once by an OBPDetection instance. All estimators then work on that beat
+ * table and only differ in how they build the envelope and look up the results on it, which costs a few
+ * microseconds each, compared to the full detection. The estimators are the ones compared in the Python scripts:
+ * maximal value, max-min value, interpolation and polynomial fit, plus the fit of an asymmetric Gaussian. The models
+ * are fitted by EnvelopeFit. The fixed-ratio search and the pressure lookup are the same as in OBPDetection.
+ *
+ * The interpolation estimate is the result of the fixed-ratio detection. If the beats were detected by another
+ * algorithm, its envelope is not interpolated and the estimate stays invalid.
+ */
+class OBPEnsemble {
+
+public:
+    static EnsembleResult analyze(OBPDetection &detector, std::span<const double> pressure,
+                                  std::span<const double> oscillation);
+    static std::array<Estimate, NBR_ESTIMATORS> evaluate(const OBPResult &result, std::span<const double> pressure,
+                                                         const DetectionConfig &config, DetectionAlgorithm algorithm);
+    static const char *getName(Estimator estimator);
+
+private:
+    static Estimate estimateFromEnvelope(Estimator estimator, const Envelope &envelope,
+                                         std::span<const double> pressure, double heartRate,
+                                         const DetectionConfig &config);
+    static Estimate estimateFromFit(Estimator estimator, const EnvelopeFitResult &fit,
+                                    std::span<const double> pressure, double heartRate,
+                                    const DetectionConfig &config);
+    static void getMaxValueEnvelope(const BeatTable &beats, Envelope &envelope);
+    static void getMaxMinEnvelope(const BeatTable &beats, Envelope &envelope);
+};
+
+
+#endif //OBP_OBPENSEMBLE_H
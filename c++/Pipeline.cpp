@@ -0,0 +1,98 @@
+/**
+ * @file        Pipeline.cpp
+ * @brief       The implementation of the Pipeline class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <vector>
+#include <algorithm>
+
+#include "Pipeline.h"
+
+/**
+ * The constructor of the Pipeline class. Sets up the filters.
+ * @param config The sampling rate and cutoff frequencies to set up the filters with.
+ */
+Pipeline::Pipeline(const PipelineConfig &config) :
+        config(config)
+{
+    iirLP.setup(config.samplingRate, config.fcLP);
+    iirHP.setup(config.samplingRate, config.fcHP);
+}
+
+/**
+ * Filters one pressure sample.
+ * @param mmHg The pressure sample in mmHg.
+ * @param yLP Returns the low-pass filtered pressure.
+ * @param yHP Returns the oscillation (high-pass filtered pressure).
+ */
+void Pipeline::filter(double mmHg, double &yLP, double &yHP)
+{
+    yLP = iirLP.filter(mmHg);
+    yHP = iirHP.filter(yLP);
+}
+
+/**
+ * Resets the internal states of the filters.
+ */
+void Pipeline::reset()
+{
+    iirLP.reset();
+    iirHP.reset();
+}
+
+/**
+ * Gets the configuration the pipeline was set up with.
+ * @return The configuration.
+ */
+const PipelineConfig &Pipeline::getConfig() const
+{
+    return config;
+}
+
+/**
+ * Analyses a recorded measurement as a whole.
+ *
+ * The recording is filtered with a new pipeline. The detection starts where the pressure is maximal, which is where
+ * the deflation starts. The offset of the result is set to that sample.
+ *
+ * @param recording The recorded pressure in mmHg, as it is stored by Processing.
+ * @param config The configuration of the pipeline the recording is analysed with.
+ * @param detector The detector to analyse the recording with, its configuration is used.
+ * @return The results of the analysis.
+ */
+OBPResult Pipeline::analyze(std::span<const double> recording, const PipelineConfig &config, OBPDetection &detector)
+{
+    std::vector<double> yLP;
+    std::vector<double> yHP;
+    const size_t start = filterRecording(recording, config, yLP, yHP);
+    OBPResult result = detector.analyze(std::span<const double>(yLP).subspan(start),
+                                        std::span<const double>(yHP).subspan(start));
+    result.offset = start;
+    return result;
+}
+
+/**
+ * Filters a recorded measurement as a whole with a new pipeline and finds the sample the detection starts at.
+ * @param recording The recorded pressure in mmHg, as it is stored by Processing.
+ * @param config The configuration of the pipeline the recording is filtered with.
+ * @param yLP Returns the low-pass filtered pressure.
+ * @param yHP Returns the oscillation.
+ * @return The sample where the filtered pressure is maximal, which is where the deflation starts.
+ */
+size_t Pipeline::filterRecording(std::span<const double> recording, const PipelineConfig &config,
+                                 std::vector<double> &yLP, std::vector<double> &yHP)
+{
+    Pipeline pipeline(config);
+    yLP.resize(recording.size());
+    yHP.resize(recording.size());
+
+    for (size_t i = 0; i < recording.size(); ++i)
+    {
+        pipeline.filter(recording[i], yLP[i], yHP[i]);
+    }
+
+    return std::distance(yLP.begin(), std::max_element(yLP.begin(), yLP.end()));
+}
@@ -0,0 +1,64 @@
+/**
+ * @file        Pipeline.h
+ * @brief       The header file of the Pipeline class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the Pipeline class and contains the general class description.
+ */
+#ifndef OBP_PIPELINE_H
+#define OBP_PIPELINE_H
+
+#include <span>
+#include <vector>
+#include <Iir.h>
+
+#include "common.h"
+#include "OBPDetection.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define IIRORDER 4      //!< IIR filter order.
+
+/**
+ * The configuration of the signal processing pipeline.
+ */
+struct PipelineConfig
+{
+    double samplingRate = SAMPLING_RATE;    //!< The sampling rate of the data.
+    double fcLP = 10.0;                     //!< Cutoff frequency of the low-pass filter (pressure).
+    double fcHP = 0.5;                      //!< Cutoff frequency of the high-pass filter (oscillation).
+};
+
+//! The Pipeline class implements the filters that split the pressure signal into pressure and oscillation.
+/*!
+ * The pressure signal in mmHg is low-pass filtered to remove noise, the result is the pressure in the cuff. The
+ * low-pass filtered signal is then high-pass filtered to get the oscillations. Processing filters the signal sample
+ * by sample, while recorded measurements can be analysed as a whole with the static analyze() method, which uses the
+ * same filters and an OBPDetection instance.
+ */
+class Pipeline {
+
+public:
+    explicit Pipeline(const PipelineConfig &config);
+
+    void filter(double mmHg, double &yLP, double &yHP);
+    void reset();
+    [[nodiscard]] const PipelineConfig &getConfig() const;
+
+    static OBPResult analyze(std::span<const double> recording, const PipelineConfig &config,
+                             OBPDetection &detector);
+    static size_t filterRecording(std::span<const double> recording, const PipelineConfig &config,
+                                  std::vector<double> &yLP, std::vector<double> &yHP);
+
+private:
+    PipelineConfig config;                      //!< The configuration the filters were set up with.
+    Iir::Butterworth::LowPass<IIRORDER> iirLP;  //!< Low-pass filter instance
+    Iir::Butterworth::HighPass<IIRORDER> iirHP; //!< High-pass filter instance
+};
+
+
+#endif //OBP_PIPELINE_H
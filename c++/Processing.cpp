@@ -6,9 +6,12 @@
  * @copyright   GNU General Public License v2.0
  *
  */
+#include <algorithm>
 #include <iostream>
 #include <unistd.h>
 #include <cmath>
+#include <chrono>
+#include <cstring>
 #include <QtCore/QDateTime>
 
 #include "Processing.h"
@@ -22,9 +25,10 @@
   * @param fcHP Cutoff frequency for the high-pass filter. Changing the default might have severe concequences.
   */
 Processing::Processing(double fcLP, double fcHP) :
-        rawData(DEFAULT_DATA_SIZE),
+        rawData(AMBIENT_AV_TIME),
         bRunning(false),
-        bMeasuring(false) {
+        bMeasuring(false),
+        corrFactor(2.6) {
 
     PLOG_VERBOSE << "Processing started";
 
@@ -40,22 +44,31 @@ Processing::Processing(double fcLP, double fcHP) :
         PLOG_WARNING << "Processing running with low pass filter of: " << fcLP;
     }
 
-    iirLP = new Iir::Butterworth::LowPass<IIRORDER>;
-    assert(iirLP != NULL);
-    iirLP->setup(sampling_rate, fcLP);
-
     /**
      * HP filter, default value is 0.5 Hz.
      */
     if (fcHP != 0.5) {
         PLOG_WARNING << "Processing running with high pass filter of: " << fcHP;
     }
-    iirHP = new Iir::Butterworth::HighPass<IIRORDER>;
-    assert(iirHP != NULL);
-    iirHP->setup(sampling_rate, fcHP);
-
-    obpDetect = new OBPDetection(sampling_rate);
+    PipelineConfig pipelineConfig;
+    pipelineConfig.samplingRate = sampling_rate;
+    pipelineConfig.fcLP = fcLP;
+    pipelineConfig.fcHP = fcHP;
+    pipeline = new Pipeline(pipelineConfig);
+    assert(pipeline != NULL);
+    inflationMonitor = new InflationMonitor(sampling_rate);
+    deflationMonitor = new DeflationMonitor(sampling_rate);
+
+    obpDetect = createDetection(ProcessingConfig().algorithm, sampling_rate);
     record = new Datarecord(sampling_rate);
+    debugRecord = new DebugRecord(sampling_rate, comedi->getMaxData(), comedi->getRangeMin(), comedi->getRangeMax());
+    record->setOnSaved([](const QString &fileName, bool success) {
+        if (success) {
+            PLOG_INFO << "Measurement saved to " << fileName.toStdString();
+        } else {
+            PLOG_ERROR << "Could not save the measurement to " << fileName.toStdString();
+        }
+    });
 
     /**
      * Initialise and reset all values.
@@ -63,6 +76,12 @@ Processing::Processing(double fcLP, double fcHP) :
     rawData.clear();
     resetConfigValues();
 
+    /**
+     * The flight recorder is always on, the ambient pressure is added to its calibration when it was found.
+     */
+    flightRecorder = new FlightRecorder();
+    flightRecorder->open(FLIGHT_FILE, sampling_rate, (uint64_t) (FLIGHT_MINUTES * 60 * sampling_rate), FLIGHT_EVENTS);
+    flightRecorder->setCalibration(kPa_per_V * corrFactor / kPa_per_mmHg, 0.0);
 }
 
 /**
@@ -73,92 +92,315 @@ Processing::Processing(double fcLP, double fcHP) :
 Processing::~Processing() {
     stopMeasurement();
     stopThread();
-    delete iirHP;
-    delete iirLP;
+    delete pipeline;
+    delete inflationMonitor;
+    delete deflationMonitor;
     delete comedi;
     delete record;
+    delete debugRecord;
+    delete flightRecorder;
     delete obpDetect;
 }
 
 /**
  * Set the ratio for SBP calculation.
  *
- * Only possible before the thread is running.
+ * Can be called at any time, the value is applied at the start of the next measurement.
  * @param val The new SBP ratio.
+ * @return False if the value is invalid and was not set.
  */
-void Processing::setRatioSBP(double val) {
-    if (!bRunning) {
-        obpDetect->setRatioSBP(val);
-    }
+bool Processing::setRatioSBP(double val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.ratioSBP = val;
+    return setConfig(newConfig);
 }
 
 /**
  * Check the set value for the SBP ratio.
- * @return The SBP ratio stored in the obpDetect instance.
+ * @return The SBP ratio that is used from the next measurement on.
  */
 double Processing::getRatioSBP() {
-    return obpDetect->getRatioSBP();
+    return configChannel.snapshot().ratioSBP;
 }
 
 /**
  * Set the ratio for DBP calculation.
  *
- * Only possible before the thread is running.
+ * Can be called at any time, the value is applied at the start of the next measurement.
  * @param val The new DBP ratio.
+ * @return False if the value is invalid and was not set.
  */
-void Processing::setRatioDBP(double val) {
-    if (!bRunning) {
-        obpDetect->setRatioDBP(val);
-    }
+bool Processing::setRatioDBP(double val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.ratioDBP = val;
+    return setConfig(newConfig);
 }
 
 /**
  * Check the set value for the DBP ratio.
- * @return The DBP ratio stored in the obpDetect instance.
+ * @return The DBP ratio that is used from the next measurement on.
  */
 double Processing::getRatioDBP() {
-    return obpDetect->getRatioDBP();
+    return configChannel.snapshot().ratioDBP;
 }
 
 /**
  * Set the minimally necessary number of peaks for a successful BP detection.
  *
- * Only possible before the thread is running.
+ * Can be called at any time, the value is applied at the start of the next measurement.
  * @param val The new minimal number of peaks value.
+ * @return False if the value is invalid and was not set.
  */
-void Processing::setMinNbrPeaks(int val) {
-    if (!bRunning) {
-        obpDetect->setMinNbrPeaks(val);
-    }
+bool Processing::setMinNbrPeaks(int val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.minNbrPeaks = val;
+    return setConfig(newConfig);
 }
 
 /**
  * Check the set value for the minimal number of peaks.
- * @return The minimal number of peaks stored in the obpDetect instance.
+ * @return The minimal number of peaks that is used from the next measurement on.
  */
 int Processing::getMinNbrPeaks() {
-    return obpDetect->getMinNbrPeaks();
+    return configChannel.snapshot().minNbrPeaks;
 }
 
 /**
  * Set the pump-up value used to switch from Inflate to Defalte state.
  *
- * Only possible before the thread is running.
+ * Can be called at any time, the value is applied at the start of the next measurement.
+ * @param val The new pump-up value in mmHg.
+ * @return False if the value is invalid and was not set.
  */
-void Processing::setPumpUpValue(int val) {
-    if (!bRunning && val < MAX_PUMPUP) {
-        mmHgInflate = (double) val;
-    }
+bool Processing::setPumpUpValue(int val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.mmHgInflate = (double) val;
+    return setConfig(newConfig);
 }
 
 /**
  * Gets the currently set pump-up value used to determine when the cuff is sufficiently inflated.
  *
  * This value is used to transition from Inflate to Deflate states.
- * @return mmHgInflate The currently used pump-up value.
+ * @return The pump-up value that is used from the next measurement on.
  */
 int Processing::getPumpUpValue() {
-    return mmHgInflate;
+    return (int) configChannel.snapshot().mmHgInflate;
+}
+
+/**
+ * Selects the algorithm used to find the blood pressure.
+ *
+ * Can be called at any time, the algorithm is switched at the start of the next measurement.
+ * @param val The new algorithm.
+ * @return False if the value is invalid and was not set.
+ */
+bool Processing::setAlgorithm(DetectionAlgorithm val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.algorithm = val;
+    return setConfig(newConfig);
+}
+
+/**
+ * Gets the currently selected algorithm to find the blood pressure.
+ * @return The algorithm that is used from the next measurement on.
+ */
+DetectionAlgorithm Processing::getAlgorithm() {
+    return configChannel.snapshot().algorithm;
+}
+
+/**
+ * Enables or disables the predictive mode, which finishes the measurement as soon as the DBP can be predicted.
+ *
+ * Can be called at any time, the value is applied at the start of the next measurement.
+ * @param val True to enable the predictive mode.
+ * @return False if the value is invalid and was not set.
+ */
+bool Processing::setPredictive(bool val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.predictive = val;
+    return setConfig(newConfig);
+}
+
+/**
+ * Check if the predictive mode is enabled.
+ * @return True if the predictive mode is used from the next measurement on.
+ */
+bool Processing::getPredictive() {
+    return configChannel.snapshot().predictive;
+}
+
+/**
+ * Enables or disables the adaptive pump-up value, which is lowered if the oscillations vanished during inflation.
+ *
+ * Can be called at any time, the value is applied at the start of the next measurement.
+ * @param val True to enable the adaptive pump-up value.
+ * @return False if the value is invalid and was not set.
+ */
+bool Processing::setAdaptiveInflate(bool val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.adaptiveInflate = val;
+    return setConfig(newConfig);
+}
+
+/**
+ * Check if the adaptive pump-up value is enabled.
+ * @return True if the adaptive pump-up value is used from the next measurement on.
+ */
+bool Processing::getAdaptiveInflate() {
+    return configChannel.snapshot().adaptiveInflate;
+}
+
+/**
+ * Enables or disables the confidence intervals, which are calculated after the measurement by OBPBootstrap.
+ *
+ * Can be called at any time, the value is applied at the start of the next measurement.
+ * @param val True to calculate the confidence intervals.
+ * @return False if the value is invalid and was not set.
+ */
+bool Processing::setBootstrap(bool val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.bootstrap = val;
+    return setConfig(newConfig);
+}
+
+/**
+ * Check if the confidence intervals are enabled.
+ * @return True if the confidence intervals are calculated from the next measurement on.
+ */
+bool Processing::getBootstrap() {
+    return configChannel.snapshot().bootstrap;
+}
+
+/**
+ * Selects the format the measurements are saved in.
+ *
+ * Can be called at any time, the value is applied at the start of the next measurement.
+ * @param val True to save the binary format of RecordingFormat.h, false for text.
+ * @return False if the value is invalid and was not set.
+ */
+bool Processing::setBinaryRecording(bool val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.binaryRecording = val;
+    return setConfig(newConfig);
+}
+
+/**
+ * Check the format the measurements are saved in.
+ * @return True if the measurements are saved in the binary format from the next measurement on.
+ */
+bool Processing::getBinaryRecording() {
+    return configChannel.snapshot().binaryRecording;
+}
+
+/**
+ * Selects whether all stages of the processing are saved in a debug recording in addition to the measurement.
+ *
+ * Can be called at any time, the value is applied at the start of the next measurement.
+ * @param val True to save a debug recording (DEBUG_EXTENSION) of every measurement.
+ * @return False if the value is invalid and was not set.
+ */
+bool Processing::setDebugRecording(bool val) {
+    ProcessingConfig newConfig = configChannel.snapshot();
+    newConfig.debugRecording = val;
+    return setConfig(newConfig);
+}
+
+/**
+ * Check whether debug recordings are saved.
+ * @return True if a debug recording is saved from the next measurement on.
+ */
+bool Processing::getDebugRecording() {
+    return configChannel.snapshot().debugRecording;
+}
+
+/**
+ * Sets all user configurable values at once.
+ *
+ * Can be called at any time from any thread. The values are validated and handed to the processing thread, which
+ * applies all of them together when it is in the Idle state and the next measurement starts. The thread keeps
+ * running, no samples are lost and the ambient pressure is not calibrated again.
+ * @param newConfig The new configuration.
+ * @return False if any of the values is invalid, in which case none of them is set.
+ */
+bool Processing::setConfig(const ProcessingConfig &newConfig) {
+    if (!isValidConfig(newConfig)) {
+        PLOG_WARNING << "Invalid configuration ignored: SBP ratio " << newConfig.ratioSBP << ", DBP ratio "
+                     << newConfig.ratioDBP << ", min. peaks " << newConfig.minNbrPeaks << ", pump-up value "
+                     << newConfig.mmHgInflate << ", algorithm " << (int) newConfig.algorithm;
+        return false;
+    }
+    configChannel.publish(newConfig);
+    return true;
+}
+
+/**
+ * Gets the currently set user configurable values.
+ * @return The configuration that is used from the next measurement on.
+ */
+ProcessingConfig Processing::getConfig() {
+    return configChannel.snapshot();
+}
+
+/**
+ * Checks if all values of a configuration are within their limits.
+ * @param checkConfig The configuration to check.
+ * @return True if all values are valid.
+ */
+bool Processing::isValidConfig(const ProcessingConfig &checkConfig) {
+    return checkConfig.ratioSBP >= RATIO_MIN && checkConfig.ratioSBP <= RATIO_MAX &&
+           checkConfig.ratioDBP >= RATIO_MIN && checkConfig.ratioDBP <= RATIO_MAX &&
+           checkConfig.minNbrPeaks >= NBR_PEAKS_MIN && checkConfig.minNbrPeaks <= NBR_PEAKS_MAX &&
+           checkConfig.mmHgInflate >= PUMP_UP_VALUE_MIN && checkConfig.mmHgInflate <= PUMP_UP_VALUE_MAX &&
+           checkConfig.mmHgInflate < MAX_PUMPUP &&
+           (checkConfig.algorithm == DetectionAlgorithm::FixedRatio ||
+            checkConfig.algorithm == DetectionAlgorithm::Derivative);
+}
+
+/**
+ * Creates a new instance of the class that implements the given detection algorithm.
+ * @param algorithm The algorithm to create the detection for.
+ * @param samplingRate The sampling rate of the processed data.
+ * @return The new detection, to be deleted by the caller.
+ */
+OBPDetection *Processing::createDetection(DetectionAlgorithm algorithm, double samplingRate) {
+    switch (algorithm) {
+        case DetectionAlgorithm::Derivative:
+            return new DerivativeDetection(samplingRate);
+        case DetectionAlgorithm::FixedRatio:
+        default:
+            return new OBPDetection(samplingRate);
+    }
+}
+
+/**
+ * Applies the latest configuration published through setConfig() to this thread and the obpDetect instance.
+ *
+ * Only to be called from the processing thread at the start of a measurement.
+ */
+void Processing::applyConfig() {
+    const uint64_t version = configChannel.version();
+    if (version != configVersion) {
+        config = configChannel.snapshot();
+        configVersion = version;
+        if (config.algorithm != obpDetect->getAlgorithm()) {
+            delete obpDetect;
+            obpDetect = createDetection(config.algorithm, sampling_rate);
+        }
+        obpDetect->setRatioSBP(config.ratioSBP);
+        obpDetect->setRatioDBP(config.ratioDBP);
+        obpDetect->setMinNbrPeaks(config.minNbrPeaks);
+        obpDetect->setPredictive(config.predictive);
+        PLOG_INFO << "Configuration applied: SBP ratio " << config.ratioSBP << ", DBP ratio " << config.ratioDBP
+                  << ", min. peaks " << config.minNbrPeaks << ", pump-up value " << config.mmHgInflate
+                  << ", algorithm " << (int) config.algorithm << ", predictive " << config.predictive
+                  << ", adaptive pump-up " << config.adaptiveInflate << ", bootstrap " << config.bootstrap
+                  << ", binary recording " << config.binaryRecording << ", debug recording "
+                  << config.debugRecording;
+    }
+    obpDetect->reset();
+    inflationMonitor->reset(config.mmHgInflate, PUMP_UP_VALUE_MIN);
+    deflationMonitor->reset();
 }
 
 /**
@@ -175,15 +417,12 @@ double Processing::getSamplingRate() {
  *
  * This function should be called once at initialisation of the object and
  * if the default values are to be restored. Non-default values should be set after initialisation.
- *
- * The obpDetect object has to be initialised beforehand.
+ * Like all other configuration changes, the default values are applied at the start of the next measurement, a
+ * running measurement is not affected. The obpDetect object belongs to the processing thread, applyConfig() passes
+ * the default values on to it.
  */
 void Processing::resetConfigValues() {
-    bMeasuring = false;
-    mmHgInflate = 180.0;
-    corrFactor = 2.6;
-
-    obpDetect->resetConfigValues();
+    configChannel.publish(ProcessingConfig());
 }
 
 
@@ -199,7 +438,8 @@ void Processing::run() {
          * Read comedi buffer and process the sample.
          */
         if (comedi->getBufferContents() > 0) {
-            processSample(comedi->getVoltageSample());
+            const int rawSample = comedi->getRawSample();
+            processSample(comedi->toVoltage(rawSample), rawSample);
         } else {
             /**
              * If there was no data in the buffer, sleep for 1ms.
@@ -232,37 +472,53 @@ void Processing::stopMeasurement() {
 
 /**
  * Gets a file name (string) from the current time.
+ * @param extension The extension of the file, e.g. ".dat" for text or RECORDING_EXTENSION.
  * @return The file name as a QString.
  */
-QString Processing::getFilename() {
+QString Processing::getFilename(const char *extension) {
     QDateTime dateTime = QDateTime::currentDateTime();
     QString dateTimeString = dateTime.toString("yyyy_MM_dd_hh_mm_ss");
-    dateTimeString.append("_data.dat");
+    dateTimeString.append("_data");
+    dateTimeString.append(extension);
     return dateTimeString;
 }
 
+/**
+ * Switches the state machine to a new state and records the transition in the flight recorder and in the debug
+ * recording, if there is one.
+ * @param state The new state.
+ */
+void Processing::switchState(ProcState state) {
+    currentState = state;
+    flightRecorder->addEvent(FlightEventType::state, (double) state);
+    debugRecord->addEvent(DebugStream::state, (double) state, (uint32_t) state);
+}
+
 /**
  * Processing a single new sample in a state machine.
- * @param newSample
+ * @param newSample The sample in voltage.
+ * @param rawSample The same sample as ADC count, only for the debug recording.
  */
-void Processing::processSample(double newSample) {
+void Processing::processSample(double newSample, int rawSample) {
 
     /**
      * Every sample is filtered and sent to the Observers
      * after configuration is done.
-     * The raw data is stored to save to a file after a successful measurement.
+     * The raw data is streamed to a file by the Datarecord while a measurement is running.
+     * The flight recorder keeps every sample, in all states.
      */
+    flightRecorder->addSample(newSample);
     double ymmHg = 0.0;
     double yLP = 0.0;
     double yHP = 0.0;
     if (currentState != ProcState::Config) {
         ymmHg = getmmHgValue(newSample);
-        yLP = iirLP->filter(ymmHg);
-        yHP = iirHP->filter(yLP);
+        pipeline->filter(ymmHg, yLP, yHP);
         notifyNewData(yLP, yHP);
     }
-    if (rawData.size() > DEFAULT_DATA_SIZE) {
+    if (record->getSampleCount() > DEFAULT_DATA_SIZE) {
         PLOG_WARNING << "Recording too long to continue algorithm. Cancelled";
+        flightRecorder->addEvent(FlightEventType::cancelled, ymmHg);
         // Setting bMeasuring false will ensure return to Idle state.
         bMeasuring = false;
     }
@@ -270,7 +526,9 @@ void Processing::processSample(double newSample) {
         case ProcState::Config:
 
             if (checkAmbient()) {
-                currentState = ProcState::Idle;
+                flightRecorder->setCalibration(kPa_per_V * corrFactor / kPa_per_mmHg, ambientVoltage);
+                flightRecorder->addEvent(FlightEventType::ambient, ambientVoltage);
+                switchState(ProcState::Idle);
                 // Send ready signal to observers
                 notifyReady();
                 rawData.clear();
@@ -284,76 +542,219 @@ void Processing::processSample(double newSample) {
         case ProcState::Idle:
 
             if (bMeasuring) {
-                // Reset parameters:
-                rawData.clear();
+                // Reset parameters and apply any changed configuration:
+                applyConfig();
+                const QString recordingName = Processing::getFilename(config.binaryRecording ? RECORDING_EXTENSION :
+                                                                      ".dat");
+                if (config.binaryRecording) {
+                    record->startRecording(recordingName, kPa_per_V * corrFactor / kPa_per_mmHg, ambientVoltage);
+                } else {
+                    record->startRecording(recordingName);
+                }
+                startIndexEntry(recordingName);
+                if (config.debugRecording) {
+                    debugRecord->startRecording(Processing::getFilename(DEBUG_EXTENSION).toStdString(),
+                                                kPa_per_V * corrFactor / kPa_per_mmHg, ambientVoltage);
+                }
                 notifyResults(0.0, 0.0, 0.0);
                 notifyHeartRate(0.0);
-                currentState = ProcState::Inflate;
+                switchState(ProcState::Inflate);
                 notifySwitchScreen(Screen::inflateScreen);
             }
 
             break;
         case ProcState::Inflate:
             if (!bMeasuring) {
-                currentState = ProcState::Idle;
+                // The samples recorded so far are kept.
+                finishIndexEntry(false);
+                record->stopRecording();
+                switchState(ProcState::Idle);
+                debugRecord->stopRecording();
                 notifySwitchScreen(Screen::startScreen);
             } else {
-                rawData.push_back(ymmHg);
+                record->addSample(ymmHg);
+                debugRecord->addSample(rawSample, ymmHg, yLP, yHP);
+                indexEntry.inflatePressure = std::max(indexEntry.inflatePressure, ymmHg);
 
                 // Check if pressure in cuff is large enough, so it can be switched to the next state.
-                if (ymmHg > mmHgInflate) {
-                    obpDetect->reset();
+                // The adaptive target is lowered as soon as the oscillations vanished.
+                inflationMonitor->processSample(yLP, yHP);
+                const double target = config.adaptiveInflate ? inflationMonitor->getTarget() : config.mmHgInflate;
+                if (ymmHg > target) {
                     notifySwitchScreen(Screen::deflateScreen);
-                    currentState = ProcState::Deflate;
+                    // The detection gets the samples from the next one on, its times are relative to it.
+                    deflateStart = debugRecord->getSampleCount();
+                    switchState(ProcState::Deflate);
                 }
             }
 
             break;
         case ProcState::Deflate:
             if (!bMeasuring) {
-                currentState = ProcState::Idle;
+                // The samples recorded so far are kept.
+                finishIndexEntry(false);
+                record->stopRecording();
+                switchState(ProcState::Idle);
+                debugRecord->addBeats(obpDetect->getBeats(), obpDetect->getEnvelope(), deflateStart);
+                debugRecord->stopRecording();
                 notifySwitchScreen(Screen::startScreen);
             } else {
-                rawData.push_back(ymmHg);
+                record->addSample(ymmHg);
+                debugRecord->addSample(rawSample, ymmHg, yLP, yHP);
 
+                if (deflationMonitor->processSample(yLP)) {
+                    notifyDeflationRate(deflationMonitor->getRate(), deflationMonitor->getGuidance());
+                }
                 if (obpDetect->processSample(yLP, yHP)) {
                     if (obpDetect->getIsEnoughData()) {
+                        logEstimates();
+                        debugRecord->addBeats(obpDetect->getBeats(), obpDetect->getEnvelope(), deflateStart);
                         notifyHeartRate(obpDetect->getAverageHeartRate());
                         notifySwitchScreen(Screen::emptyCuffScreen);
-                        currentState = ProcState::Empty;
+                        switchState(ProcState::Empty);
                     } else {
-                        notifyHeartRate(obpDetect->getCurrentHeartRate());
+                        notifyHeartRate(obpDetect->getMedianHeartRate());
                     }
+                } else if (obpDetect->getCurrentHeartRate() == 0.0 &&
+                           obpDetect->getPressureData().size() % HR_DISPLAY_INTERVAL == 0) {
+                    // No beat confirmed yet, show the heart rate estimated from the periodicity of the oscillation.
+                    notifyHeartRate(obpDetect->getEstimatedHeartRate());
                 }
                 if (ymmHg < 20) {
                     PLOG_WARNING << "Pressure too low to continue algorithm. Cancelled";
+                    flightRecorder->addEvent(FlightEventType::cancelled, ymmHg);
                     bMeasuring = false;
                 }
             }
             break;
         case ProcState::Empty:
             if (!bMeasuring) {
-                currentState = ProcState::Idle;
+                // The samples recorded so far are kept.
+                finishIndexEntry(false);
+                record->stopRecording();
+                switchState(ProcState::Idle);
+                debugRecord->stopRecording();
                 notifySwitchScreen(Screen::startScreen);
             } else {
-                rawData.push_back(ymmHg);
+                record->addSample(ymmHg);
+                debugRecord->addSample(rawSample, ymmHg, yLP, yHP);
                 if (ymmHg < 2) {
                     notifyResults(obpDetect->getMAP(), obpDetect->getSBP(), obpDetect->getDBP());
-                    record->saveAll(Processing::getFilename(), rawData);
+                    if (config.bootstrap) {
+                        notifyBootstrap();
+                    }
+                    finishIndexEntry(true);
+                    // Only hands the last samples over, the file is finished by the writer thread of the Datarecord.
+                    record->stopRecording(RecordingFooter::create(obpDetect->getMAP(), obpDetect->getSBP(),
+                                                                  obpDetect->getDBP(),
+                                                                  obpDetect->getAverageHeartRate(),
+                                                                  (uint32_t) config.algorithm));
                     notifySwitchScreen(Screen::resultScreen);
-                    currentState = ProcState::Results;
+                    switchState(ProcState::Results);
+                    debugRecord->stopRecording();
                 }
             }
             break;
         case ProcState::Results:
             if (!bMeasuring) {
-                currentState = ProcState::Idle;
+                switchState(ProcState::Idle);
                 notifySwitchScreen(Screen::startScreen);
             }
             break;
     }
 }
 
+/**
+ * Starts the entry of the measurement in the measurement index with the time, the recording and the configuration.
+ * @param recordingName The name of the recording of the measurement.
+ */
+void Processing::startIndexEntry(const QString &recordingName) {
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    indexEntry = IndexEntry{};
+    indexEntry.time = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+    std::strncpy(indexEntry.fileName, recordingName.toStdString().c_str(), sizeof(indexEntry.fileName) - 1);
+    indexEntry.ratioSBP = config.ratioSBP;
+    indexEntry.ratioDBP = config.ratioDBP;
+    indexEntry.mmHgInflate = config.mmHgInflate;
+    indexEntry.dataOffset = config.binaryRecording ? RECORDING_HEADER_SIZE : 0;
+    indexEntry.algorithm = (uint32_t) config.algorithm;
+    indexEntry.minNbrPeaks = (uint32_t) config.minNbrPeaks;
+    indexEntry.flags = (config.predictive ? (uint32_t) IndexFlag::predictive : 0) |
+                       (config.adaptiveInflate ? (uint32_t) IndexFlag::adaptiveInflate : 0) |
+                       (config.bootstrap ? (uint32_t) IndexFlag::bootstrap : 0);
+}
+
+/**
+ * Completes the entry of the measurement with the results and the summary of the measurement and hands it to the
+ * writer thread of the Datarecord, which appends it to the measurement index. Has to be called before the recording
+ * is stopped.
+ * @param complete True if the measurement was finished with results, false if it was cancelled.
+ */
+void Processing::finishIndexEntry(bool complete) {
+    if (obpDetect->getIsEnoughData()) {
+        indexEntry.map = obpDetect->getMAP();
+        indexEntry.sbp = obpDetect->getSBP();
+        indexEntry.dbp = obpDetect->getDBP();
+        indexEntry.heartRate = obpDetect->getAverageHeartRate();
+    }
+    const BeatTable &beats = obpDetect->getBeats();
+    indexEntry.deflationRate = deflationMonitor->getMeanRate();
+    indexEntry.samples = (uint64_t) record->getSampleCount();
+    indexEntry.duration = (double) indexEntry.samples / sampling_rate;
+    indexEntry.beats = (uint32_t) beats.size();
+    indexEntry.artifacts = (uint32_t) std::count(beats.typeColumn(), beats.typeColumn() + beats.size(),
+                                                 BeatType::Artifact);
+    if (complete) {
+        indexEntry.flags |= (uint32_t) IndexFlag::complete;
+    }
+    record->addIndexEntry(INDEX_FILE, indexEntry);
+}
+
+/**
+ * Evaluates all estimators of the OBPEnsemble on the beats of the current measurement and logs the estimates for
+ * comparison, together with the number of artifacts and restarts of the beat detection and the mean deflation rate.
+ * Estimates that could not be calculated are not logged.
+ * The results of the measurement are not affected.
+ */
+void Processing::logEstimates() {
+    const OBPResult result = obpDetect->getResult();
+    PLOG_INFO << "Beats: " << result.beats.size() << ", artifacts: " << result.artifacts << ", restarts: "
+              << result.restarts << ", mean deflation rate: " << deflationMonitor->getMeanRate() << " mmHg/s";
+    if (deflationMonitor->getMeanRate() > DEFLATE_RATE_MAX) {
+        PLOG_WARNING << "The cuff was deflated too fast, the results may be inaccurate";
+    }
+    const auto estimates = OBPEnsemble::evaluate(result, obpDetect->getPressureData(), obpDetect->getConfig(),
+                                                 obpDetect->getAlgorithm());
+    for (const Estimate &estimate : estimates) {
+        if (!estimate.valid) {
+            continue;
+        }
+        PLOG_INFO << "Estimate (" << OBPEnsemble::getName(estimate.estimator) << "): MAP " << estimate.map
+                  << " SBP " << estimate.sbp << " DBP " << estimate.dbp;
+    }
+}
+
+/**
+ * Calculates the confidence intervals of the results of the current measurement, logs them and notifies the
+ * observers. The intervals are only calculated for the FixedRatio algorithm, whose envelope OBPBootstrap resamples.
+ */
+void Processing::notifyBootstrap() {
+    if (config.algorithm != DetectionAlgorithm::FixedRatio) {
+        PLOG_INFO << "Confidence intervals are only available for the fixed ratio algorithm";
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const BootstrapResult bootstrap = OBPBootstrap::analyze(obpDetect->getResult(), obpDetect->getPressureData(),
+                                                            obpDetect->getConfig());
+    const auto duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+    PLOG_INFO << "Confidence intervals from " << bootstrap.resamples << " resamples in " << duration.count()
+              << " ms: MAP " << bootstrap.map.lower << "-" << bootstrap.map.upper << ", SBP " << bootstrap.sbp.lower
+              << "-" << bootstrap.sbp.upper << ", DBP " << bootstrap.dbp.lower << "-" << bootstrap.dbp.upper;
+    if (bootstrap.valid) {
+        notifyConfidence(bootstrap.map, bootstrap.sbp, bootstrap.dbp);
+    }
+}
+
 /**
  * Calculates the mmHg value from the given voltage input.
  * @param voltageValue The voltage input.
@@ -13,30 +13,66 @@
 
 #include <vector>
 #include <comedilib.h>
-#include <Iir.h>
 
 #include "common.h"
 #include "CppThread.h"
+#include "ConfigChannel.h"
 #include "Datarecord.h"
+#include "DebugRecord.h"
+#include "FlightRecorder.h"
+#include "MeasurementIndex.h"
 #include "ISubject.h"
 #include "ComediHandler.h"
 #include "OBPDetection.h"
+#include "DerivativeDetection.h"
+#include "OBPEnsemble.h"
+#include "Pipeline.h"
+#include "InflationMonitor.h"
+#include "DeflationMonitor.h"
+#include "OBPBootstrap.h"
 
 /**
  * Class dependant configuration values:
  */
 #define MAX_PUMPUP 250  //!< Maximal settable pump-up value.
-#define IIRORDER 4      //!< IIR filter order.
+#define HR_DISPLAY_INTERVAL 500 //!< Samples between updates of the estimated heart rate before the first beat.
+
+/**
+ * The user configurable values of the measurement. The defaults are the same as in OBPDetection.
+ */
+struct ProcessingConfig
+{
+    double ratioSBP = 0.57;     //!< The SBP ratio used by the OBPDetection.
+    double ratioDBP = 0.70;     //!< The DBP ratio used by the OBPDetection.
+    int minNbrPeaks = 10;       //!< The minimal number of peaks used by the OBPDetection.
+    double mmHgInflate = 180.0; //!< Pump-up value used to transition from Inflate to Deflate state.
+    DetectionAlgorithm algorithm = DetectionAlgorithm::FixedRatio; //!< The algorithm to find the blood pressure.
+    bool predictive = false;    //!< Finish the measurement as soon as the DBP can be predicted.
+    bool adaptiveInflate = true;//!< Lower the pump-up value if the oscillations vanished during inflation.
+    bool bootstrap = false;     //!< Calculate confidence intervals of the results after the measurement.
+    bool binaryRecording = false;//!< Save the measurements in the binary format instead of text.
+    bool debugRecording = false;//!< Save all stages of the processing in a debug recording as well.
+};
 
 //! The Processing class handles the data acquisition and processing.
 /*!
  * The processing class inherits from the CppThread class and the ISubject class. CppThread is a wrapper to the
  * std::thread class that was written by Bernd Porr to avoid static methods and makes the inheriting class a runnable
- * thread. Processing has an instance of ComediHandler to acquire and two IIR filter instances to pre-process the data.
- * The raw, unfiltered data is stored in a vector that can be handed to the Datarecord instance to save it as a file.
+ * thread. Processing has an instance of ComediHandler to acquire and a Pipeline instance to pre-process the data.
+ * The raw, unfiltered data of a measurement is handed to the Datarecord instance sample by sample, which streams it to
+ * a file in its own writer thread. Optionally, the DebugRecord instance records every stage of the processing as
+ * well: the ADC counts, the pressure, the filtered signals, the state transitions and finally the beats and the
+ * envelope found by the detection. After every measurement, its results and configuration are appended to the
+ * MeasurementIndex by the writer thread of the Datarecord, so measurements can be searched without opening their
+ * recordings.
  * The filtered data is sent to the observer(s) to display and passed to the OPDetection instance that performs the
  * algorithm. Data acquisition and filtering are happening whenever the thread is running, the state machine
  * decides when data is passed to the OBPDetection or stored to a file.
+ *
+ * The configuration can be changed at any time while the thread is running. New values are validated and handed to
+ * the thread through a ConfigChannel, the thread applies them when a new measurement is started from the Idle state.
+ * This includes the selection of the detection algorithm: if it changed, the OBPDetection instance is replaced by
+ * one of the selected class before the measurement starts.
  */
 class Processing : public CppThread, public ISubject {
 
@@ -53,14 +89,28 @@ public:
     explicit Processing(double fcLP = 10.0, double fcHP = 0.5);
     ~Processing() override;
 
-    void setRatioSBP(double val);
+    bool setRatioSBP(double val);
     double getRatioSBP();
-    void setRatioDBP(double val);
+    bool setRatioDBP(double val);
     double getRatioDBP();
-    void setMinNbrPeaks(int val);
+    bool setMinNbrPeaks(int val);
     int getMinNbrPeaks();
-    void setPumpUpValue(int val);
+    bool setPumpUpValue(int val);
     int getPumpUpValue();
+    bool setAlgorithm(DetectionAlgorithm val);
+    DetectionAlgorithm getAlgorithm();
+    bool setPredictive(bool val);
+    bool getPredictive();
+    bool setAdaptiveInflate(bool val);
+    bool getAdaptiveInflate();
+    bool setBootstrap(bool val);
+    bool getBootstrap();
+    bool setBinaryRecording(bool val);
+    bool getBinaryRecording();
+    bool setDebugRecording(bool val);
+    bool getDebugRecording();
+    bool setConfig(const ProcessingConfig &newConfig);
+    ProcessingConfig getConfig();
     double getSamplingRate();
 
     void resetConfigValues();
@@ -70,20 +120,33 @@ public:
 
 private:
     void run() override;
-    void processSample(double newSample);
+    void processSample(double newSample, int rawSample);
+    void switchState(ProcState state);
     [[nodiscard]] double getmmHgValue(double voltageValue) const;
     bool checkAmbient();
+    void applyConfig();
+    void logEstimates();
+    void startIndexEntry(const QString &recordingName);
+    void finishIndexEntry(bool complete);
+    void notifyBootstrap();
+    static bool isValidConfig(const ProcessingConfig &checkConfig);
+    static OBPDetection *createDetection(DetectionAlgorithm algorithm, double samplingRate);
 
-    static QString getFilename();
+    static QString getFilename(const char *extension);
 
-    std::vector<double> rawData;                 //!< stores the acquired raw data
+    std::vector<double> rawData;                 //!< stores the acquired raw data to find the ambient pressure
 
-    Iir::Butterworth::LowPass<IIRORDER> *iirLP;  //!< Low-pass filter instance
-    Iir::Butterworth::HighPass<IIRORDER> *iirHP; //!< High-pass filter instance
+    Pipeline *pipeline;                          //!< Pipeline instance with the low-pass and high-pass filters
+    InflationMonitor *inflationMonitor;          //!< InflationMonitor instance to find the pump-up target
+    DeflationMonitor *deflationMonitor;          //!< DeflationMonitor instance to guide the deflation
 
     Datarecord *record;                         //!< Datarecord instance to store data
+    DebugRecord *debugRecord;                   //!< DebugRecord instance to store all stages of the processing
+    uint64_t deflateStart = 0;                  //!< The sample of the debug recording at which the deflation started
+    FlightRecorder *flightRecorder;             //!< FlightRecorder instance that keeps the last minutes of the signal
+    IndexEntry indexEntry{};                    //!< The entry of the running measurement in the measurement index
     ComediHandler *comedi;                      //!< ComediHandler instance to acquire data
-    OBPDetection *obpDetect;                    //!< LOBPDetection instance that implements the algorithm
+    OBPDetection *obpDetect;                    //!< OBPDetection instance that implements the selected algorithm
     std::atomic<bool> bRunning;                 //!< process is running and displaying data on screen.
     std::atomic<bool> bMeasuring;               //!< Boolean to indicate an ongoing measurement.
     ProcState currentState;                     //!< Stores the state of the application
@@ -97,7 +160,9 @@ private:
     /**
      * User set configuration values:
      */
-    std::atomic<double> mmHgInflate;           //!< Pump-up value used to transition from Inflate to Deflate state.
+    ConfigChannel<ProcessingConfig> configChannel; //!< The configuration published by the setters.
+    ProcessingConfig config;                   //!< The configuration of the current measurement.
+    uint64_t configVersion = 0;                //!< The version of the configuration that was applied last.
     double corrFactor;                         //!< Correction factor to account for voltage divider.
 
     /**
@@ -0,0 +1,189 @@
+/**
+ * @file        ReanalyzeTool.cpp
+ * @brief       Command line tool to analyse binary recordings again with another configuration.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * obp_reanalyze [-a ratio|derivative] [-s ratioSBP] [-d ratioDBP] [-p minNbrPeaks] [-P] [-c directory] [-n]
+ *               [-j threads] file.obp ...
+ * analyses each binary recording with the Pipeline and the detection algorithm (the fixed ratios by default) and
+ * prints the results, in the order of the files. -s, -d and -p change the configuration of the detection, -P enables
+ * the predictive mode. The stages of the analysis are kept in the ResultCache in the directory given with -c
+ * (CACHE_DIRECTORY by default), so only what the changed configuration depends on is calculated again; -n analyses
+ * without the cache. The recordings are analysed in parallel by -j threads, the number of processors by default.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <plog/Init.h>
+#include <plog/Appenders/ConsoleAppender.h>
+#include <plog/Formatters/TxtFormatter.h>
+#include "common.h"
+#include "DerivativeDetection.h"
+#include "RecordingReader.h"
+#include "ResultCache.h"
+
+/**
+ * The configuration of the reanalysis given on the command line.
+ */
+struct ReanalysisConfig
+{
+    DetectionAlgorithm algorithm = DetectionAlgorithm::FixedRatio;  //!< The detection algorithm.
+    double ratioSBP = 0.0;      //!< The SBP ratio, 0 for the default.
+    double ratioDBP = 0.0;      //!< The DBP ratio, 0 for the default.
+    int minNbrPeaks = 0;        //!< The min. number of peaks, 0 for the default.
+    bool predictive = false;    //!< Analyse in predictive mode.
+};
+
+/**
+ * Analyses a binary recording.
+ * @param fileName The name of the recording.
+ * @param config The configuration of the reanalysis.
+ * @param cache The cache, nullptr to analyse without it.
+ * @return The line with the results.
+ */
+static std::string reanalyze(const std::string &fileName, const ReanalysisConfig &config, ResultCache *cache)
+{
+    RecordingReader reader(fileName);
+    if (!reader.isOpen())
+    {
+        return fileName + ": not readable";
+    }
+    const double samplingRate = reader.getHeader().samplingRate;
+    std::unique_ptr<OBPDetection> detector;
+    if (config.algorithm == DetectionAlgorithm::Derivative)
+    {
+        detector = std::make_unique<DerivativeDetection>(samplingRate);
+    } else
+    {
+        detector = std::make_unique<OBPDetection>(samplingRate);
+    }
+    if (config.ratioSBP > 0.0)
+    {
+        detector->setRatioSBP(config.ratioSBP);
+    }
+    if (config.ratioDBP > 0.0)
+    {
+        detector->setRatioDBP(config.ratioDBP);
+    }
+    if (config.minNbrPeaks > 0)
+    {
+        detector->setMinNbrPeaks(config.minNbrPeaks);
+    }
+    detector->setPredictive(config.predictive);
+
+    PipelineConfig pipelineConfig;
+    pipelineConfig.samplingRate = samplingRate;
+    const std::vector<double> recording = reader.getChannel(0);
+    const OBPResult result = cache != nullptr ? cache->analyze(recording, pipelineConfig, *detector) :
+                             Pipeline::analyze(recording, pipelineConfig, *detector);
+
+    char line[256];
+    if (result.finished)
+    {
+        std::snprintf(line, sizeof(line), "%s: MAP %5.1f  SBP %5.1f  DBP %5.1f  HR %5.1f  %zu beats",
+                      fileName.c_str(), result.map, result.sbp, result.dbp, result.heartRate, result.beats.size());
+    } else
+    {
+        std::snprintf(line, sizeof(line), "%s: not finished", fileName.c_str());
+    }
+    return line;
+}
+
+int main(int argc, char **argv)
+{
+    static plog::ConsoleAppender<plog::TxtFormatter> consoleAppender;
+    plog::init(plog::warning, &consoleAppender);
+
+    ReanalysisConfig config;
+    std::string directory = CACHE_DIRECTORY;
+    bool useCache = true;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> files;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "-a") == 0 && hasValue)
+        {
+            const std::string name = argv[++i];
+            valid = name == "ratio" || name == "derivative";
+            config.algorithm = name == "derivative" ? DetectionAlgorithm::Derivative : DetectionAlgorithm::FixedRatio;
+        } else if (std::strcmp(argv[i], "-s") == 0 && hasValue)
+        {
+            config.ratioSBP = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "-d") == 0 && hasValue)
+        {
+            config.ratioDBP = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "-p") == 0 && hasValue)
+        {
+            config.minNbrPeaks = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-P") == 0)
+        {
+            config.predictive = true;
+        } else if (std::strcmp(argv[i], "-c") == 0 && hasValue)
+        {
+            directory = argv[++i];
+        } else if (std::strcmp(argv[i], "-n") == 0)
+        {
+            useCache = false;
+        } else if (std::strcmp(argv[i], "-j") == 0 && hasValue)
+        {
+            threads = (size_t) std::max(1, std::atoi(argv[++i]));
+        } else
+        {
+            files.emplace_back(argv[i]);
+        }
+    }
+    if (!valid || files.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [-a ratio|derivative] [-s ratioSBP] [-d ratioDBP] [-p minNbrPeaks] [-P]"
+                  << " [-c directory] [-n] [-j threads] file" << RECORDING_EXTENSION << " ..." << std::endl;
+        return 2;
+    }
+
+    // Every thread takes the next recording until all are analysed, the lines are printed in the order of the files.
+    const auto start = std::chrono::steady_clock::now();
+    ResultCache cache(directory);
+    std::vector<std::string> lines(files.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++)
+        {
+            lines[i] = reanalyze(files[i], config, useCache ? &cache : nullptr);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::min(threads, files.size()); ++i)
+    {
+        workers.emplace_back(worker);
+    }
+    for (std::thread &thread : workers)
+    {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const std::string &line : lines)
+    {
+        std::cout << line << "\n";
+    }
+    std::cout << files.size() << " recordings in " << seconds << " s";
+    if (useCache)
+    {
+        std::cout << ", cached: " << cache.getResultHits() << " results, " << cache.getFilteredHits()
+                  << " filtered, " << cache.getMisses() << " not cached";
+    }
+    std::cout << std::endl;
+    return 0;
+}
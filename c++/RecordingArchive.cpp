@@ -0,0 +1,322 @@
+/**
+ * @file        RecordingArchive.cpp
+ * @brief       The implementation of the RecordingArchive class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "common.h"
+#include "RecordingCodec.h"
+#include "RecordingParser.h"
+#include "RecordingReader.h"
+#include "RecordingArchive.h"
+
+/**
+ * Constructor that opens an archive immediately.
+ * @param fileName The name of the archive.
+ */
+RecordingArchive::RecordingArchive(const std::string &fileName)
+{
+    open(fileName);
+}
+
+/**
+ * Destructor of the RecordingArchive. Releases the mapping.
+ */
+RecordingArchive::~RecordingArchive()
+{
+    close();
+}
+
+/**
+ * Writes channels to a new archive.
+ * @param fileName The name of the archive.
+ * @param samplingRate The sampling rate in Hz.
+ * @param channels The channels, all of the same length.
+ * @return False if the channels differ in length or the file could not be written.
+ */
+bool RecordingArchive::write(const std::string &fileName, double samplingRate,
+                             const std::vector<std::vector<double>> &channels)
+{
+    const size_t samples = channels.empty() ? 0 : channels[0].size();
+    for (const auto &channel : channels)
+    {
+        if (channel.size() != samples)
+        {
+            PLOG_WARNING << "The channels of archive " << fileName << " differ in length";
+            return false;
+        }
+    }
+
+    ArchiveHeader archiveHeader{};
+    std::memcpy(archiveHeader.magic, ARCHIVE_MAGIC, sizeof(archiveHeader.magic));
+    archiveHeader.version = ARCHIVE_VERSION;
+    archiveHeader.headerSize = sizeof(ArchiveHeader);
+    archiveHeader.samplingRate = samplingRate;
+    archiveHeader.channels = (uint32_t) channels.size();
+    archiveHeader.blockSize = ARCHIVE_BLOCK_SIZE;
+    archiveHeader.samples = samples;
+
+    const size_t nBlocks = (samples + ARCHIVE_BLOCK_SIZE - 1) / ARCHIVE_BLOCK_SIZE;
+    std::vector<uint64_t> blockIndex;
+    blockIndex.reserve(nBlocks * channels.size() + 1);
+    std::vector<uint8_t> data;
+    for (size_t block = 0; block < nBlocks; ++block)
+    {
+        const size_t first = block * ARCHIVE_BLOCK_SIZE;
+        const size_t count = std::min<size_t>(ARCHIVE_BLOCK_SIZE, samples - first);
+        for (const auto &channel : channels)
+        {
+            blockIndex.push_back(sizeof(ArchiveHeader) + data.size());
+            RecordingCodec::encodeBlock(channel.data() + first, count, data);
+        }
+    }
+    blockIndex.push_back(sizeof(ArchiveHeader) + data.size());
+    // The index is aligned, so it can be used in place when the file is mapped.
+    data.resize((data.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t), 0);
+    archiveHeader.indexOffset = sizeof(ArchiveHeader) + data.size();
+
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&archiveHeader), sizeof(ArchiveHeader));
+    out.write(reinterpret_cast<const char *>(data.data()), (std::streamsize) data.size());
+    out.write(reinterpret_cast<const char *>(blockIndex.data()),
+              (std::streamsize) (blockIndex.size() * sizeof(uint64_t)));
+    out.close();
+    if (!out)
+    {
+        PLOG_WARNING << "Could not write archive " << fileName;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Converts a text recording into an archive.
+ * @param textFile The name of the text file, with the same number of columns in every line.
+ * @param archiveFile The name of the archive.
+ * @param samplingRate The sampling rate of the recording in Hz.
+ * @return False if the text file could not be read or the archive could not be written.
+ */
+bool RecordingArchive::convertText(const std::string &textFile, const std::string &archiveFile, double samplingRate)
+{
+    std::vector<std::vector<double>> channels;
+    return readText(textFile, channels) && write(archiveFile, samplingRate, channels);
+}
+
+/**
+ * Reads all columns of a text recording with the RecordingParser.
+ * @param textFile The name of the text file.
+ * @param channels Returns one vector per column, the time first.
+ * @return False if the file is not a valid text recording.
+ */
+bool RecordingArchive::readText(const std::string &textFile, std::vector<std::vector<double>> &channels)
+{
+    channels.clear();
+    RecordingParser parser;
+    if (!parser.load(textFile))
+    {
+        return false;
+    }
+    for (size_t column = 0; column < parser.getColumnCount(); ++column)
+    {
+        channels.push_back(parser.getColumn(column));
+    }
+    return true;
+}
+
+/**
+ * Converts a binary recording into an archive. The samples are floats and are coded by their bits, so the archive
+ * restores them exactly.
+ * @param recordingFile The name of the binary recording.
+ * @param archiveFile The name of the archive.
+ * @return False if the recording could not be read or the archive could not be written.
+ */
+bool RecordingArchive::convertRecording(const std::string &recordingFile, const std::string &archiveFile)
+{
+    std::vector<std::vector<double>> channels;
+    double samplingRate;
+    return readRecording(recordingFile, channels, samplingRate) && write(archiveFile, samplingRate, channels);
+}
+
+/**
+ * Reads all channels of a binary recording with the RecordingReader.
+ * @param recordingFile The name of the binary recording.
+ * @param channels Returns one vector per channel.
+ * @param samplingRate Returns the sampling rate of the recording in Hz.
+ * @return False if the file is not a valid binary recording.
+ */
+bool RecordingArchive::readRecording(const std::string &recordingFile, std::vector<std::vector<double>> &channels,
+                                     double &samplingRate)
+{
+    channels.clear();
+    RecordingReader reader;
+    if (!reader.open(recordingFile))
+    {
+        return false;
+    }
+    samplingRate = reader.getHeader().samplingRate;
+    for (size_t channel = 0; channel < reader.getHeader().channels; ++channel)
+    {
+        channels.push_back(reader.getChannel(channel));
+    }
+    return true;
+}
+
+/**
+ * Opens an archive and checks its header and index. An archive that is already open is closed first.
+ * @param fileName The name of the archive.
+ * @return False if the file could not be mapped or is not a valid archive.
+ */
+bool RecordingArchive::open(const std::string &fileName)
+{
+    close();
+
+    if (!file.map(fileName, sizeof(ArchiveHeader), "archive"))
+    {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(ArchiveHeader));
+
+    bool valid = std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version >= 1 && header.version <= ARCHIVE_VERSION &&
+                 header.headerSize >= sizeof(ArchiveHeader) && header.blockSize > 0 &&
+                 header.indexOffset % sizeof(uint64_t) == 0 && header.indexOffset <= file.size();
+    if (valid)
+    {
+        // The index has to fill the rest of the file with exactly one entry per block and channel and the end of the
+        // data. Compared by division, so a corrupt header cannot overflow, and only with at least the end entry.
+        const size_t indexSize = file.size() - header.indexOffset;
+        const size_t entries = indexSize / sizeof(uint64_t);
+        const size_t nBlocks = header.samples / header.blockSize + (header.samples % header.blockSize != 0);
+        valid = indexSize % sizeof(uint64_t) == 0 && entries >= 1 &&
+                (header.channels == 0 ? entries == 1 : (entries - 1) % header.channels == 0 &&
+                                                       (entries - 1) / header.channels == nBlocks);
+    }
+    if (valid)
+    {
+        index = reinterpret_cast<const uint64_t *>(file.data() + header.indexOffset);
+        const size_t entries = getBlockCount() * header.channels + 1;
+        for (size_t i = 0; valid && i < entries; ++i)
+        {
+            valid = index[i] >= header.headerSize && index[i] <= header.indexOffset &&
+                    (i == 0 || index[i] >= index[i - 1]);
+        }
+    }
+    if (!valid)
+    {
+        PLOG_WARNING << "Archive " << fileName << " has an invalid header or index";
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Closes the archive and releases the mapping.
+ */
+void RecordingArchive::close()
+{
+    file.unmap();
+    index = nullptr;
+    header = ArchiveHeader{};
+}
+
+/**
+ * @return True if a valid archive is open.
+ */
+bool RecordingArchive::isOpen() const
+{
+    return file.isMapped();
+}
+
+/**
+ * Gets the header of the open archive.
+ * @return The header, all zero if no archive is open.
+ */
+const ArchiveHeader &RecordingArchive::getHeader() const
+{
+    return header;
+}
+
+/**
+ * @return The number of blocks per channel, 0 if no archive is open.
+ */
+size_t RecordingArchive::getBlockCount() const
+{
+    if (!file.isMapped())
+    {
+        return 0;
+    }
+    return header.samples / header.blockSize + (header.samples % header.blockSize != 0);
+}
+
+/**
+ * Decodes one block of a channel.
+ * @param channel The channel, starting at 0.
+ * @param block The block, starting at 0.
+ * @param values Returns the values, has to hold the block size of the archive.
+ * @return The number of values of the block, 0 if it does not exist or is corrupt.
+ */
+size_t RecordingArchive::decodeBlock(size_t channel, size_t block, double *values) const
+{
+    if (channel >= header.channels || block >= getBlockCount())
+    {
+        return 0;
+    }
+    const size_t count = std::min<size_t>(header.blockSize, header.samples - block * header.blockSize);
+    const size_t entry = block * header.channels + channel;
+    if (!RecordingCodec::decodeBlock(file.data() + index[entry], index[entry + 1] - index[entry], values, count))
+    {
+        PLOG_WARNING << "Block " << block << " of channel " << channel << " is corrupt";
+        return 0;
+    }
+    return count;
+}
+
+/**
+ * Decodes a whole channel.
+ * @param channel The channel, starting at 0.
+ * @return The values, empty if the channel does not exist or a block is corrupt.
+ */
+std::vector<double> RecordingArchive::getChannel(size_t channel) const
+{
+    return getChannel(channel, 0, header.samples);
+}
+
+/**
+ * Decodes a part of a channel. Only the blocks that contain the part are decoded.
+ * @param channel The channel, starting at 0.
+ * @param first The first sample.
+ * @param count The number of samples, less are returned at the end of the channel.
+ * @return The values, empty if the channel does not exist or a block is corrupt.
+ */
+std::vector<double> RecordingArchive::getChannel(size_t channel, size_t first, size_t count) const
+{
+    std::vector<double> values;
+    if (channel >= header.channels || first >= header.samples)
+    {
+        return values;
+    }
+    count = std::min<size_t>(count, header.samples - first);
+    values.resize(count);
+    std::vector<double> block(header.blockSize);
+    for (size_t pos = first; pos < first + count;)
+    {
+        const size_t blockNumber = pos / header.blockSize;
+        const size_t blockStart = blockNumber * header.blockSize;
+        const size_t n = decodeBlock(channel, blockNumber, block.data());
+        if (n == 0)
+        {
+            return {};
+        }
+        const size_t copyEnd = std::min(blockStart + n, first + count);
+        std::copy(block.begin() + (long) (pos - blockStart), block.begin() + (long) (copyEnd - blockStart),
+                  values.begin() + (long) (pos - first));
+        pos = copyEnd;
+    }
+    return values;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file        RecordingArchive.h
+ * @brief       The header file of the RecordingArchive class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the RecordingArchive class and contains the general class description.
+ */
+#ifndef OBP_RECORDINGARCHIVE_H
+#define OBP_RECORDINGARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "RecordingFormat.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define ARCHIVE_BLOCK_SIZE  4096    //!< Number of samples per block and channel, the unit of random access.
+
+//! The RecordingArchive class stores recordings compressed for the long term.
+/*!
+ * Archives keep recordings losslessly at a fraction of the size of the text files: every channel is split into
+ * blocks of ARCHIVE_BLOCK_SIZE samples that are coded by the RecordingCodec. The layout is described at the
+ * ArchiveHeader. Since each block is coded on its own and the index holds the position of every block, any part of a
+ * recording can be decoded without decoding what comes before it.
+ *
+ * Archives are written at once with write(), or converted from the text files of the Datarecord (and the other text
+ * files in the data folder) with convertText(), which loads the file with the RecordingParser and takes all columns
+ * as channels. The time column is a channel as well, so the text can be restored exactly. Binary recordings are
+ * converted with convertRecording(), which reads them with the RecordingReader and takes their channels; their float
+ * samples are coded by their bits. For reading, the file is mapped into memory like by the RecordingReader and the
+ * blocks are decoded on request.
+ */
+class RecordingArchive {
+
+public:
+    RecordingArchive() = default;
+    explicit RecordingArchive(const std::string &fileName);
+    ~RecordingArchive();
+    RecordingArchive(const RecordingArchive &) = delete;
+    RecordingArchive &operator=(const RecordingArchive &) = delete;
+
+    static bool write(const std::string &fileName, double samplingRate,
+                      const std::vector<std::vector<double>> &channels);
+    static bool convertText(const std::string &textFile, const std::string &archiveFile, double samplingRate);
+    static bool readText(const std::string &textFile, std::vector<std::vector<double>> &channels);
+    static bool convertRecording(const std::string &recordingFile, const std::string &archiveFile);
+    static bool readRecording(const std::string &recordingFile, std::vector<std::vector<double>> &channels,
+                              double &samplingRate);
+
+    bool open(const std::string &fileName);
+    void close();
+
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] const ArchiveHeader &getHeader() const;
+    [[nodiscard]] size_t getBlockCount() const;
+    size_t decodeBlock(size_t channel, size_t block, double *values) const;
+    [[nodiscard]] std::vector<double> getChannel(size_t channel) const;
+    [[nodiscard]] std::vector<double> getChannel(size_t channel, size_t first, size_t count) const;
+
+private:
+    ArchiveHeader header{};                 //!< Copy of the header of the open file.
+    MappedFile file;                        //!< The mapped file, not mapped if closed.
+    const uint64_t *index = nullptr;        //!< The block index in the mapping.
+};
+
+
+#endif //OBP_RECORDINGARCHIVE_H
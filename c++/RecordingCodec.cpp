@@ -0,0 +1,420 @@
+/**
+ * @file        RecordingCodec.cpp
+ * @brief       The implementation of the RecordingCodec class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <cmath>
+#include <cstring>
+#include "RecordingCodec.h"
+
+/**
+ * The powers of ten up to CODEC_MAX_DECIMALS, all exactly representable as doubles.
+ */
+static constexpr double powersOfTen[CODEC_MAX_DECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                                               1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+/**
+ * Maps a signed residual to an unsigned value, small magnitudes to small values (0, -1, 1, -2, ... to 0, 1, 2, 3).
+ * @param value The signed value.
+ * @return The unsigned value.
+ */
+static inline uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t) value << 1u) ^ (uint64_t) (value >> 63);
+}
+
+/**
+ * Reverses zigzag().
+ * @param value The unsigned value.
+ * @return The signed value.
+ */
+static inline int64_t unzigzag(uint64_t value)
+{
+    return (int64_t) (value >> 1u) ^ -(int64_t) (value & 1u);
+}
+
+//! Writes bits to a byte vector, the first bit is the least significant bit of the first byte.
+struct BitWriter {
+    std::vector<uint8_t> &out;      //!< The bytes written so far.
+    uint64_t buffer = 0;            //!< Bits not written to out yet.
+    unsigned bits = 0;              //!< Number of bits in buffer, less than 32 between calls.
+
+    /**
+     * Appends bits.
+     * @param value The bits, only the lowest count bits may be set.
+     * @param count The number of bits, at most 32.
+     */
+    inline void put(uint64_t value, unsigned count)
+    {
+        buffer |= value << bits;
+        bits += count;
+        if (bits >= 32)
+        {
+            const auto word = (uint32_t) buffer;
+            const uint8_t bytes[4] = {(uint8_t) word, (uint8_t) (word >> 8u), (uint8_t) (word >> 16u),
+                                      (uint8_t) (word >> 24u)};
+            out.insert(out.end(), bytes, bytes + 4);
+            buffer >>= 32u;
+            bits -= 32;
+        }
+    }
+
+    /**
+     * Writes the remaining bits, the last byte is padded with zeros.
+     */
+    void flush()
+    {
+        for (; bits > 0; bits = bits > 8 ? bits - 8 : 0)
+        {
+            out.push_back((uint8_t) buffer);
+            buffer >>= 8u;
+        }
+    }
+};
+
+//! Reads bits written by the BitWriter.
+struct BitReader {
+    const uint8_t *next;            //!< The next byte to load into the buffer.
+    const uint8_t *end;             //!< The end of the data.
+    uint64_t buffer = 0;            //!< Bits loaded but not read yet.
+    unsigned bits = 0;              //!< Number of bits in buffer.
+
+    /**
+     * Loads bytes into the buffer until it holds at least 56 bits or the data ends.
+     */
+    inline void refill()
+    {
+        if (end - next >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, next, sizeof(word));
+            buffer |= word << bits;
+            next += (63 - bits) >> 3u;
+            bits |= 56u;
+        } else
+        {
+            while (bits <= 56 && next < end)
+            {
+                buffer |= (uint64_t) *next++ << bits;
+                bits += 8;
+            }
+        }
+    }
+
+    /**
+     * Reads bits, the buffer has to hold enough of them.
+     * @param count The number of bits, at most 32.
+     * @return The bits.
+     */
+    inline uint64_t take(unsigned count)
+    {
+        const uint64_t value = buffer & ((1ull << count) - 1u);
+        buffer >>= count;
+        bits -= count;
+        return value;
+    }
+};
+
+/**
+ * Appends an unsigned value as varint, 7 bits per byte with the highest bit set if more bytes follow.
+ * @param value The value.
+ * @param out The vector to append to.
+ */
+static void putVarint(uint64_t value, std::vector<uint8_t> &out)
+{
+    while (value >= 0x80u)
+    {
+        out.push_back((uint8_t) (value | 0x80u));
+        value >>= 7u;
+    }
+    out.push_back((uint8_t) value);
+}
+
+/**
+ * Maps the bit pattern of a float to an integer with the same order as the floats, so that close floats give close
+ * integers. Negative floats have their magnitude bits inverted; the mapping is its own inverse.
+ * @param bits The bit pattern of the float, or the integer to map back.
+ * @return The integer, or the bit pattern of the float.
+ */
+static inline int32_t toOrdered(int32_t bits)
+{
+    return bits < 0 ? bits ^ 0x7FFFFFFF : bits;
+}
+
+/**
+ * Predicts and Rice codes the integers of a block and appends them to a byte vector, after the Rice parameter and
+ * the mode byte.
+ * @param count The number of values.
+ * @param mode The number of decimal places of the integers or CODEC_FLOAT32, stored for the decoder.
+ * @param toInteger Gets the integer of the value with the given index.
+ * @param out The vector to append the coded block to.
+ */
+template<typename ToInteger>
+static void encodeIntegers(size_t count, uint8_t mode, ToInteger toInteger, std::vector<uint8_t> &out)
+{
+    // The mean residual selects the Rice parameter, about its binary logarithm.
+    double sum = 0.0;
+    int64_t first = count > 0 ? toInteger(0) : 0;
+    int64_t prev1 = first;
+    int64_t prev2 = first;
+    for (size_t i = 1; i < count; ++i)
+    {
+        const int64_t value = toInteger(i);
+        sum += (double) zigzag(value - (2 * prev1 - prev2));
+        prev2 = prev1;
+        prev1 = value;
+    }
+    unsigned k = 0;
+    const double mean = count > 1 ? sum / (double) (count - 1) : 0.0;
+    while (k < 31 && (double) (1ull << (k + 1)) <= mean)
+    {
+        k++;
+    }
+
+    out.push_back((uint8_t) k);
+    out.push_back(mode);
+    putVarint(zigzag(first), out);
+    BitWriter writer{out};
+    const uint64_t mask = (1ull << k) - 1u;
+    prev1 = first;
+    prev2 = first;
+    for (size_t i = 1; i < count; ++i)
+    {
+        const int64_t value = toInteger(i);
+        const uint64_t residual = zigzag(value - (2 * prev1 - prev2));
+        prev2 = prev1;
+        prev1 = value;
+        const uint64_t quotient = residual >> k;
+        if (quotient < CODEC_RICE_ESCAPE)
+        {
+            writer.put(1ull << quotient, (unsigned) quotient + 1);
+            writer.put(residual & mask, k);
+        } else
+        {
+            writer.put(1ull << CODEC_RICE_ESCAPE, CODEC_RICE_ESCAPE + 1);
+            writer.put(residual & 0xFFFFFFFFu, 32);
+            writer.put(residual >> 32u, 32);
+        }
+    }
+    writer.flush();
+}
+
+/**
+ * Decodes the integers of a block coded by encodeIntegers().
+ * @param data The coded block.
+ * @param size The size of the coded block in bytes.
+ * @param k The Rice parameter of the block.
+ * @param values Returns the values, has to hold count values.
+ * @param count The number of values of the block.
+ * @param toValue Gets the value of an integer.
+ * @return False if the block is corrupt.
+ */
+template<typename ToValue>
+static bool decodeIntegers(const uint8_t *data, size_t size, unsigned k, double *values, size_t count, ToValue toValue)
+{
+    // The first value as varint.
+    size_t pos = 2;
+    uint64_t zigzagFirst = 0;
+    for (unsigned shift = 0;; shift += 7)
+    {
+        if (pos >= size || shift > 63)
+        {
+            return false;
+        }
+        const uint8_t byte = data[pos++];
+        zigzagFirst |= (uint64_t) (byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0)
+        {
+            break;
+        }
+    }
+    if (count == 0)
+    {
+        return true;
+    }
+    const int64_t first = unzigzag(zigzagFirst);
+    values[0] = toValue(first);
+
+    BitReader reader{data + pos, data + size};
+    int64_t prev1 = first;
+    int64_t prev2 = first;
+    for (size_t i = 1; i < count; ++i)
+    {
+        reader.refill();
+        if (reader.buffer == 0)
+        {
+            return false;
+        }
+        const auto quotient = (unsigned) __builtin_ctzll(reader.buffer);
+        uint64_t residual;
+        if (quotient < CODEC_RICE_ESCAPE)
+        {
+            if (reader.bits < quotient + 1 + k)
+            {
+                return false;
+            }
+            reader.take(quotient + 1);
+            residual = ((uint64_t) quotient << k) | reader.take(k);
+        } else
+        {
+            if (quotient > CODEC_RICE_ESCAPE)
+            {
+                return false;
+            }
+            reader.take(CODEC_RICE_ESCAPE + 1);
+            reader.refill();
+            if (reader.bits < 32)
+            {
+                return false;
+            }
+            residual = reader.take(32);
+            reader.refill();
+            if (reader.bits < 32)
+            {
+                return false;
+            }
+            residual |= reader.take(32) << 32u;
+        }
+        const int64_t value = 2 * prev1 - prev2 + unzigzag(residual);
+        values[i] = toValue(value);
+        prev2 = prev1;
+        prev1 = value;
+    }
+    return true;
+}
+
+/**
+ * Codes a block of values and appends it to a byte vector.
+ * @param values The values of the block.
+ * @param count The number of values.
+ * @param out The vector to append the coded block to.
+ */
+void RecordingCodec::encodeBlock(const double *values, size_t count, std::vector<uint8_t> &out)
+{
+    const int decimals = findDecimals(values, count);
+    if (decimals >= 0)
+    {
+        const double scale = powersOfTen[decimals];
+        encodeIntegers(count, (uint8_t) decimals, [values, scale](size_t i) {
+            return (int64_t) std::llround(values[i] * scale);
+        }, out);
+    } else if (isFloat32(values, count))
+    {
+        encodeIntegers(count, CODEC_FLOAT32, [values](size_t i) {
+            int32_t bits;
+            const auto value = (float) values[i];
+            std::memcpy(&bits, &value, sizeof(bits));
+            return (int64_t) toOrdered(bits);
+        }, out);
+    } else
+    {
+        out.push_back(CODEC_VERBATIM);
+        out.push_back(0);
+        const auto *bytes = reinterpret_cast<const uint8_t *>(values);
+        out.insert(out.end(), bytes, bytes + count * sizeof(double));
+    }
+}
+
+/**
+ * Decodes a block coded by encodeBlock().
+ * @param data The coded block.
+ * @param size The size of the coded block in bytes.
+ * @param values Returns the values, has to hold count values.
+ * @param count The number of values of the block.
+ * @return False if the block is corrupt.
+ */
+bool RecordingCodec::decodeBlock(const uint8_t *data, size_t size, double *values, size_t count)
+{
+    if (size < 2)
+    {
+        return false;
+    }
+    const unsigned k = data[0];
+    const unsigned mode = data[1];
+    if (k == CODEC_VERBATIM)
+    {
+        if (size != 2 + count * sizeof(double))
+        {
+            return false;
+        }
+        std::memcpy(values, data + 2, count * sizeof(double));
+        return true;
+    }
+    if (k > 31 || (mode > CODEC_MAX_DECIMALS && mode != CODEC_FLOAT32))
+    {
+        return false;
+    }
+    if (mode == CODEC_FLOAT32)
+    {
+        return decodeIntegers(data, size, k, values, count, [](int64_t value) {
+            // A corrupt block may give integers that are no ordered floats, any bit pattern is taken.
+            const int32_t bits = toOrdered((int32_t) value);
+            float result;
+            std::memcpy(&result, &bits, sizeof(result));
+            return (double) result;
+        });
+    }
+    const double scale = powersOfTen[mode];
+    return decodeIntegers(data, size, k, values, count, [scale](int64_t value) { return (double) value / scale; });
+}
+
+/**
+ * Finds the smallest number of decimal places that represents all values exactly as integers.
+ * @param values The values.
+ * @param count The number of values.
+ * @return The number of decimal places, -1 if there is none up to CODEC_MAX_DECIMALS.
+ */
+int RecordingCodec::findDecimals(const double *values, size_t count)
+{
+    // The integers have to be exact doubles, so that the division by the power of ten is correctly rounded.
+    const double maxInteger = 9007199254740992.0;
+    int decimals = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double value = values[i];
+        if (!std::isfinite(value) || (value == 0.0 && std::signbit(value)))
+        {
+            return -1;
+        }
+        // Usually the value fits the decimals found so far and this loop is left at once.
+        while (true)
+        {
+            const double scaled = std::round(value * powersOfTen[decimals]);
+            if (std::abs(scaled) >= maxInteger)
+            {
+                return -1;
+            }
+            if (scaled / powersOfTen[decimals] == value)
+            {
+                break;
+            }
+            if (++decimals > CODEC_MAX_DECIMALS)
+            {
+                return -1;
+            }
+        }
+    }
+    return decimals;
+}
+
+/**
+ * Checks if all values of a block are floats converted to double, as the samples of binary recordings are.
+ * @param values The values.
+ * @param count The number of values.
+ * @return True if every value is restored bit by bit when it is converted to float and back.
+ */
+bool RecordingCodec::isFloat32(const double *values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double restored = (double) (float) values[i];
+        if (std::memcmp(&restored, &values[i], sizeof(double)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
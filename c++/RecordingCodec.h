@@ -0,0 +1,61 @@
+/**
+ * @file        RecordingCodec.h
+ * @brief       The header file of the RecordingCodec class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the RecordingCodec class and contains the general class description.
+ */
+#ifndef OBP_RECORDINGCODEC_H
+#define OBP_RECORDINGCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Class dependant configuration values:
+ */
+#define CODEC_MAX_DECIMALS  15      //!< Max. number of decimal places of values that are coded as integers.
+#define CODEC_RICE_ESCAPE   24      //!< Quotients from this value on are escaped and the residual is stored as is.
+#define CODEC_VERBATIM      0xFF    //!< Rice parameter of blocks that store the values as they are.
+#define CODEC_FLOAT32       0xFE    //!< Instead of the decimal places for blocks of floats coded by their bits.
+
+//! The RecordingCodec class compresses blocks of samples losslessly.
+/*!
+ * The recorded signals vary slowly compared to the sampling rate, so each sample is predicted well from the two
+ * before it by linear extrapolation (2 x[n-1] - x[n-2]). Only the prediction residuals are stored, with Rice codes:
+ * the residual is mapped to an unsigned value (zigzag), its upper bits are stored in unary and its lower k bits as
+ * they are. k is chosen per block from the mean residual, so small residuals take a few bits. Residuals that would
+ * need a long unary code are escaped and stored with 64 bits.
+ *
+ * The prediction works on integers, so the codec is exact. Integer samples, like the values of the ADC, are coded as
+ * they are. Recordings that were stored as text have a limited number of decimal places; the smallest number of
+ * decimal places d that represents all values of a block exactly is searched, and the values are coded as integers
+ * in units of 10^-d. Decoding divides by 10^d, which gives exactly the same double as parsing the text did.
+ *
+ * The samples of binary recordings are floats, which need more decimal places than a double can scale exactly. If
+ * all values of a block are floats, the bit pattern of each float is coded instead, mapped to an integer in the
+ * order of the floats (negative floats have their magnitude bits inverted). Within the same exponent, neighbouring
+ * floats are neighbouring integers, so the prediction works on them as on ADC values, with a few more bits for the
+ * residual. Blocks that cannot be represented either way (e.g. filtered doubles) are stored verbatim.
+ *
+ * A block is coded on its own: one byte with the Rice parameter k, one byte with d or CODEC_FLOAT32, the first value
+ * as a zigzag varint and the bit stream of the residuals, padded to a full byte. The bits are read and written 64 at
+ * a time.
+ */
+class RecordingCodec {
+
+public:
+    static void encodeBlock(const double *values, size_t count, std::vector<uint8_t> &out);
+    static bool decodeBlock(const uint8_t *data, size_t size, double *values, size_t count);
+
+private:
+    static int findDecimals(const double *values, size_t count);
+    static bool isFloat32(const double *values, size_t count);
+};
+
+
+#endif //OBP_RECORDINGCODEC_H
@@ -0,0 +1,476 @@
+/**
+ * @file        RecordingFormat.h
+ * @brief       The header file of the binary recording format.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the header and footer of binary recordings, which are written by the Datarecord and read by the
+ * RecordingReader, the header of compressed archives, which are written and read by the RecordingArchive, and the
+ * structures of debug recordings, which are written by the DebugRecord and read by the DebugRecordReader, the
+ * header of the file of the FlightRecorder, the structures of the measurement index and the header of the files of
+ * the ResultCache.
+ */
+#ifndef OBP_RECORDINGFORMAT_H
+#define OBP_RECORDINGFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Format dependant configuration values:
+ */
+#define RECORDING_MAGIC         "OBPREC\r\n"    //!< First 8 bytes of a binary recording, \r\n detects text mode copies.
+#define RECORDING_VERSION       2               //!< The current version of the format.
+#define RECORDING_HEADER_SIZE   64              //!< Size of the header in the file, the samples start after it.
+#define RECORDING_EXTENSION     ".obp"          //!< File extension of binary recordings.
+#define RECORDING_FOOTER_MAGIC  "OBPRES\r\n"    //!< First 8 bytes of the footer with the results.
+#define RECORDING_SAMPLES_UNKNOWN UINT64_MAX    //!< Sample count of a recording that was not finished.
+#define ARCHIVE_MAGIC           "OBPARC\r\n"    //!< First 8 bytes of a compressed archive.
+#define ARCHIVE_VERSION         2               //!< The current version of the archive format.
+#define ARCHIVE_EXTENSION       ".obz"          //!< File extension of compressed archives.
+#define DEBUG_MAGIC             "OBPDBG\r\n"    //!< First 8 bytes of a debug recording.
+#define DEBUG_VERSION           2               //!< The current version of the debug recording format.
+#define DEBUG_HEADER_SIZE_V1    48              //!< Size of the header of version 1, without the range of the ADC.
+#define DEBUG_EXTENSION         ".obd"          //!< File extension of debug recordings.
+#define DEBUG_STREAM_COUNT      8               //!< The number of streams of a debug recording, see DebugStream.
+#define FLIGHT_MAGIC            "OBPFLT\r\n"    //!< First 8 bytes of the file of the flight recorder.
+#define FLIGHT_VERSION          1               //!< The current version of the flight recorder format.
+#define FLIGHT_EXTENSION        ".obf"          //!< File extension of the flight recorder.
+#define INDEX_MAGIC             "OBPIDX\r\n"    //!< First 8 bytes of a measurement index.
+#define INDEX_VERSION           1               //!< The current version of the measurement index format.
+#define INDEX_EXTENSION         ".obi"          //!< File extension of measurement indexes.
+#define CACHE_MAGIC             "OBPCCH\r\n"    //!< First 8 bytes of a file of the result cache.
+#define CACHE_VERSION           1               //!< The current version of the cache format, raise it when the
+//!< filters or the detection change, so results of older versions are calculated again.
+#define CACHE_EXTENSION         ".obc"          //!< File extension of the files of the result cache.
+
+/**
+ * The data type of the samples in a binary recording.
+ */
+enum class SampleFormat : uint32_t
+{
+    float32 = 1,    //!< 32 bit IEEE floats.
+};
+
+//! The header at the start of a binary recording.
+/*!
+ * A binary recording consists of this header, padded to RECORDING_HEADER_SIZE bytes, followed by the samples as one
+ * contiguous block. With more than one channel, the samples of all channels at one time are stored next to each
+ * other. All values are little endian, as on all platforms the application runs on.
+ *
+ * The samples are in mmHg. The calibration that converted the voltages of the pressure sensor is stored as well, so
+ * the voltages can be restored with voltage = sample / mmHgPerVolt + ambientVoltage.
+ *
+ * Recordings are streamed to the file while they are measured. Until the recording is finished, the sample count is
+ * RECORDING_SAMPLES_UNKNOWN and readers take all complete samples in the file, so a recording that was interrupted
+ * by a crash can still be read. When it is finished, the count is written and the RecordingFooter can follow the
+ * samples (version 2).
+ *
+ * Readers have to reject files with a newer version. Fields can be added in the padding without breaking older
+ * readers, as long as headerSize tells them where the samples start.
+ */
+struct RecordingHeader
+{
+    char magic[8];                  //!< RECORDING_MAGIC, without the terminating zero.
+    uint32_t version;               //!< The version of the format, RECORDING_VERSION when written.
+    uint32_t headerSize;            //!< Offset of the samples in the file.
+    double samplingRate;            //!< The sampling rate in Hz.
+    double mmHgPerVolt;             //!< The calibration of the pressure sensor.
+    double ambientVoltage;          //!< The voltage at ambient pressure.
+    uint32_t channels;              //!< The number of interleaved channels.
+    SampleFormat format;            //!< The data type of the samples.
+    uint64_t samples;               //!< The number of samples per channel.
+
+    /**
+     * Creates the header of a new recording.
+     * @param samplingRate The sampling rate in Hz.
+     * @param mmHgPerVolt The calibration of the pressure sensor.
+     * @param ambientVoltage The voltage at ambient pressure.
+     * @param channels The number of interleaved channels.
+     * @param samples The number of samples per channel.
+     * @return The header.
+     */
+    static RecordingHeader create(double samplingRate, double mmHgPerVolt, double ambientVoltage, uint32_t channels,
+                                  uint64_t samples) {
+        RecordingHeader header{};
+        std::memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+        header.version = RECORDING_VERSION;
+        header.headerSize = RECORDING_HEADER_SIZE;
+        header.samplingRate = samplingRate;
+        header.mmHgPerVolt = mmHgPerVolt;
+        header.ambientVoltage = ambientVoltage;
+        header.channels = channels;
+        header.format = SampleFormat::float32;
+        header.samples = samples;
+        return header;
+    }
+};
+
+//! The footer after the samples of a finished binary recording, with the results of the measurement.
+struct RecordingFooter
+{
+    char magic[8];                  //!< RECORDING_FOOTER_MAGIC, without the terminating zero.
+    double map;                     //!< The mean arterial pressure in mmHg.
+    double sbp;                     //!< The systolic blood pressure in mmHg.
+    double dbp;                     //!< The diastolic blood pressure in mmHg.
+    double heartRate;               //!< The average heart rate in bpm.
+    uint32_t algorithm;             //!< The DetectionAlgorithm the results were found with.
+    uint32_t reserved;              //!< Zero.
+
+    /**
+     * Creates the footer of a recording.
+     * @param map The mean arterial pressure in mmHg.
+     * @param sbp The systolic blood pressure in mmHg.
+     * @param dbp The diastolic blood pressure in mmHg.
+     * @param heartRate The average heart rate in bpm.
+     * @param algorithm The DetectionAlgorithm the results were found with.
+     * @return The footer.
+     */
+    static RecordingFooter create(double map, double sbp, double dbp, double heartRate, uint32_t algorithm) {
+        RecordingFooter footer{};
+        std::memcpy(footer.magic, RECORDING_FOOTER_MAGIC, sizeof(footer.magic));
+        footer.map = map;
+        footer.sbp = sbp;
+        footer.dbp = dbp;
+        footer.heartRate = heartRate;
+        footer.algorithm = algorithm;
+        return footer;
+    }
+};
+
+//! The header at the start of a compressed archive.
+/*!
+ * An archive stores the channels of a recording losslessly compressed by the RecordingCodec. The channels are split
+ * into blocks of blockSize samples, the last block may be shorter. The blocks of all channels at one time follow each
+ * other (block 0 of channel 0, block 0 of channel 1, ..., block 1 of channel 0, ...), directly after the header. Each
+ * block can be decoded on its own. The index at indexOffset holds the file offset of every block in this order plus
+ * the offset of the end of the last block, so block i of channel c spans index[i * channels + c] up to the next
+ * entry. Blocks can hold floats coded by their bits since version 2, archives of binary recordings need it.
+ */
+struct ArchiveHeader
+{
+    char magic[8];                  //!< ARCHIVE_MAGIC, without the terminating zero.
+    uint32_t version;               //!< The version of the format, ARCHIVE_VERSION when written.
+    uint32_t headerSize;            //!< Offset of the first block in the file.
+    double samplingRate;            //!< The sampling rate in Hz.
+    uint32_t channels;              //!< The number of channels.
+    uint32_t blockSize;             //!< The number of samples per block and channel.
+    uint64_t samples;               //!< The number of samples per channel.
+    uint64_t indexOffset;           //!< Offset of the block index in the file.
+};
+
+/**
+ * The streams of a debug recording. The first four are continuous, with one value per sample of the recording, the
+ * others are events at single samples.
+ */
+enum class DebugStream : uint32_t
+{
+    raw,            //!< The ADC counts, as int32.
+    mmHg,           //!< The pressure in mmHg, as float32.
+    lowPass,        //!< The low-pass filtered pressure, as float32.
+    highPass,       //!< The high-pass filtered oscillation, as float32.
+    peaks,          //!< The peaks of the beats, with the amplitude and the BeatType as flags.
+    troughs,        //!< The troughs after the peaks, with the amplitude and the BeatType of the beat as flags.
+    envelope,       //!< The points of the OMWE, with the amplitude.
+    state,          //!< The state transitions of the Processing, with the new state as value and flags.
+};
+
+//! The header at the start of a debug recording.
+/*!
+ * A debug recording holds all stages of the processing of one measurement in one file, so a measurement can be
+ * replayed and every stage inspected without running the pipeline again. The header is followed by chunks, each of
+ * them a DebugChunk and the values of one stream. The continuous streams are written in chunks of the same samples
+ * one after the other, the events of the same time follow them. All times are sample numbers from the start of the
+ * recording, the same as in the recording of the Datarecord.
+ *
+ * The header holds the conversion of the ADC counts into mmHg: a count is converted into a voltage with the range of
+ * the ADC (rangeMin at 0, rangeMax at maxData), the voltage into mmHg with mmHgPerVolt relative to ambientVoltage.
+ * Version 1 ends before rangeMin and has zero instead of maxData, its range of the ADC is unknown.
+ *
+ * A recording that was interrupted ends with the last complete chunk. Readers have to skip chunks of unknown streams,
+ * so streams can be added without breaking older readers.
+ */
+struct DebugHeader
+{
+    char magic[8];                  //!< DEBUG_MAGIC, without the terminating zero.
+    uint32_t version;               //!< The version of the format, DEBUG_VERSION when written.
+    uint32_t headerSize;            //!< Offset of the first chunk in the file.
+    double samplingRate;            //!< The sampling rate in Hz.
+    double mmHgPerVolt;             //!< The calibration of the pressure sensor.
+    double ambientVoltage;          //!< The voltage at ambient pressure.
+    uint32_t streams;               //!< The number of streams the writer knew, DEBUG_STREAM_COUNT.
+    uint32_t maxData;               //!< The largest ADC count, 0 if the range of the ADC is unknown.
+    double rangeMin;                //!< The voltage of the ADC count 0.
+    double rangeMax;                //!< The voltage of the ADC count maxData.
+
+    /**
+     * Creates the header of a new debug recording.
+     * @param samplingRate The sampling rate in Hz.
+     * @param mmHgPerVolt The calibration of the pressure sensor.
+     * @param ambientVoltage The voltage at ambient pressure.
+     * @param maxData The largest ADC count.
+     * @param rangeMin The voltage of the ADC count 0.
+     * @param rangeMax The voltage of the ADC count maxData.
+     * @return The header.
+     */
+    static DebugHeader create(double samplingRate, double mmHgPerVolt, double ambientVoltage, uint32_t maxData,
+                              double rangeMin, double rangeMax) {
+        DebugHeader header{};
+        std::memcpy(header.magic, DEBUG_MAGIC, sizeof(header.magic));
+        header.version = DEBUG_VERSION;
+        header.headerSize = sizeof(DebugHeader);
+        header.samplingRate = samplingRate;
+        header.mmHgPerVolt = mmHgPerVolt;
+        header.ambientVoltage = ambientVoltage;
+        header.streams = DEBUG_STREAM_COUNT;
+        header.maxData = maxData;
+        header.rangeMin = rangeMin;
+        header.rangeMax = rangeMax;
+        return header;
+    }
+};
+
+//! The header of a chunk of a debug recording.
+struct DebugChunk
+{
+    DebugStream stream;             //!< The stream the values belong to.
+    uint32_t size;                  //!< The size of the values that follow in bytes.
+    uint64_t first;                 //!< The sample number of the first value, of the first event for events.
+
+    /**
+     * Gets the size of one value of a stream.
+     * @param stream The stream, one of DebugStream.
+     * @return The size in bytes.
+     */
+    static constexpr size_t valueSize(DebugStream stream) {
+        return stream < DebugStream::peaks ? 4 : 16;
+    }
+};
+
+//! An event of a debug recording.
+struct DebugEvent
+{
+    uint64_t sample;                //!< The sample number of the event.
+    float value;                    //!< The amplitude or state.
+    uint32_t flags;                 //!< Additional information, depends on the stream.
+};
+
+/**
+ * The kinds of events of the flight recorder, stored as flags of a DebugEvent.
+ */
+enum class FlightEventType : uint32_t
+{
+    state,          //!< A transition of the state machine, with the new state as value.
+    ambient,        //!< The ambient pressure was found, with the ambient voltage as value.
+    cancelled,      //!< A measurement was cancelled by a fault, with the pressure in mmHg as value.
+};
+
+//! The header at the start of the file of the flight recorder.
+/*!
+ * The file has a fixed size and is used as two rings: the last capacity samples of the pressure sensor in volts, as
+ * float32, directly after the header, and the last eventCapacity events as DebugEvent, at eventsOffset(). Sample n
+ * is stored at index n % capacity, event n at index n % eventCapacity.
+ *
+ * samples and events count everything that was ever written. The writer stores a value first and then increments the
+ * counter with release semantics, so a reader that loads the counter with acquire semantics sees all values up to
+ * it. The oldest values may be overwritten while a reader copies them, a reader has to load the counter again after
+ * copying and drop the values the writer may have reached in the meantime. The slot the next value is stored in is
+ * never read, so the last capacity - 1 values can be read.
+ *
+ * All times are sample numbers since the file was created at startTime.
+ */
+struct FlightHeader
+{
+    char magic[8];                  //!< FLIGHT_MAGIC, without the terminating zero.
+    uint32_t version;               //!< The version of the format, FLIGHT_VERSION when written.
+    uint32_t headerSize;            //!< Offset of the ring of samples in the file.
+    double samplingRate;            //!< The sampling rate in Hz.
+    double mmHgPerVolt;             //!< The calibration of the pressure sensor.
+    double ambientVoltage;          //!< The voltage at ambient pressure, 0 until it was found.
+    uint64_t capacity;              //!< The number of samples the ring holds.
+    uint64_t eventCapacity;         //!< The number of events the ring holds.
+    int64_t startTime;              //!< The time of sample 0 in ms since the epoch.
+    uint64_t samples;               //!< The number of samples written, accessed atomically.
+    uint64_t events;                //!< The number of events written, accessed atomically.
+
+    /**
+     * Creates the header of a new flight recorder file.
+     * @param samplingRate The sampling rate in Hz.
+     * @param capacity The number of samples the ring holds.
+     * @param eventCapacity The number of events the ring holds.
+     * @param startTime The time of sample 0 in ms since the epoch.
+     * @return The header.
+     */
+    static FlightHeader create(double samplingRate, uint64_t capacity, uint64_t eventCapacity, int64_t startTime) {
+        FlightHeader header{};
+        std::memcpy(header.magic, FLIGHT_MAGIC, sizeof(header.magic));
+        header.version = FLIGHT_VERSION;
+        header.headerSize = sizeof(FlightHeader);
+        header.samplingRate = samplingRate;
+        header.capacity = capacity;
+        header.eventCapacity = eventCapacity;
+        header.startTime = startTime;
+        return header;
+    }
+
+    /**
+     * @return The offset of the ring of events in the file, 8 byte aligned.
+     */
+    [[nodiscard]] uint64_t eventsOffset() const {
+        return (headerSize + capacity * sizeof(float) + 7) / 8 * 8;
+    }
+
+    /**
+     * @return The size of the file in bytes.
+     */
+    [[nodiscard]] uint64_t fileSize() const {
+        return eventsOffset() + eventCapacity * sizeof(DebugEvent);
+    }
+};
+
+/**
+ * The flags of an IndexEntry.
+ */
+enum class IndexFlag : uint32_t
+{
+    complete = 1,           //!< The measurement was finished with results, it was not cancelled.
+    predictive = 2,         //!< The DBP could be predicted, ProcessingConfig::predictive.
+    adaptiveInflate = 4,    //!< The pump-up value was lowered when the oscillations vanished.
+    bootstrap = 8,          //!< Confidence intervals were calculated after the measurement.
+};
+
+//! An entry of a measurement index, one measurement with its results, configuration and recording.
+struct IndexEntry
+{
+    int64_t time;                   //!< The start of the measurement in ms since the epoch, the key of the index.
+    char fileName[32];              //!< The name of the recording, zero terminated.
+    double map;                     //!< The mean arterial pressure in mmHg, 0 if none was found.
+    double sbp;                     //!< The systolic blood pressure in mmHg, 0 if none was found.
+    double dbp;                     //!< The diastolic blood pressure in mmHg, 0 if none was found.
+    double heartRate;               //!< The average heart rate in bpm, 0 if none was found.
+    double ratioSBP;                //!< The SBP ratio of the configuration.
+    double ratioDBP;                //!< The DBP ratio of the configuration.
+    double mmHgInflate;             //!< The pump-up value of the configuration.
+    double inflatePressure;         //!< The highest pressure during the inflation in mmHg.
+    double deflationRate;           //!< The mean deflation rate in mmHg/s.
+    double duration;                //!< The duration of the recording in s.
+    uint64_t samples;               //!< The number of samples of the recording.
+    uint32_t dataOffset;            //!< Offset of the samples in the recording, 0 for text recordings.
+    uint32_t algorithm;             //!< The DetectionAlgorithm of the configuration.
+    uint32_t minNbrPeaks;           //!< The minimal number of peaks of the configuration.
+    uint32_t beats;                 //!< The number of beats found.
+    uint32_t artifacts;             //!< The number of beats marked as artifacts.
+    uint32_t flags;                 //!< Combination of IndexFlag.
+
+    /**
+     * Tests a flag.
+     * @param flag The flag.
+     * @return True if the flag is set.
+     */
+    [[nodiscard]] bool hasFlag(IndexFlag flag) const {
+        return (flags & (uint32_t) flag) != 0;
+    }
+};
+
+//! The header at the start of a measurement index.
+/*!
+ * A measurement index holds one IndexEntry per measurement, appended when the measurement ended. The entries follow
+ * the header directly, each entrySize bytes long, so the file can be mapped and searched without reading it. Entries
+ * are appended in the order of their time, readers must not rely on it though, as the clock may have been set back.
+ * An entry that was not written completely is ignored, the next append replaces it.
+ *
+ * Fields can be added at the end of the entry in a new version, readers take entrySize from the header.
+ */
+struct IndexHeader
+{
+    char magic[8];                  //!< INDEX_MAGIC, without the terminating zero.
+    uint32_t version;               //!< The version of the format, INDEX_VERSION when written.
+    uint32_t headerSize;            //!< Offset of the first entry in the file.
+    uint32_t entrySize;             //!< The size of an entry in bytes, a multiple of 8.
+    uint32_t reserved;              //!< Zero.
+
+    /**
+     * Creates the header of a new measurement index.
+     * @return The header.
+     */
+    static IndexHeader create() {
+        IndexHeader header{};
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+        header.version = INDEX_VERSION;
+        header.headerSize = sizeof(IndexHeader);
+        header.entrySize = sizeof(IndexEntry);
+        return header;
+    }
+};
+
+/**
+ * The stages of the analysis the ResultCache stores.
+ */
+enum class CacheStage : uint32_t
+{
+    filtered = 1,   //!< The low-pass filtered pressure and the oscillation, as float64, one stream after the other.
+    result = 2,     //!< The OBPResult of the detection, as it is in memory.
+};
+
+//! The header at the start of a file of the result cache.
+/*!
+ * Each file holds one stage of the analysis of one recording. The recording is identified by the hash of its samples,
+ * the configuration by the hash of all values the stage depends on, both are part of the file name as well. The data
+ * follows the header directly. A file is only valid if the hashes, the version and the size of the data match, any
+ * other file is ignored and replaced.
+ */
+struct CacheHeader
+{
+    char magic[8];                  //!< CACHE_MAGIC, without the terminating zero.
+    uint32_t version;               //!< The version of the format, CACHE_VERSION when written.
+    uint32_t headerSize;            //!< Offset of the data in the file.
+    CacheStage stage;               //!< The stage of the analysis.
+    uint32_t reserved;              //!< Zero.
+    uint64_t recordingHash;         //!< The hash of the samples of the recording.
+    uint64_t configHash;            //!< The hash of the configuration of the stage.
+    uint64_t samples;               //!< The number of samples of each stream, 0 for results.
+    uint64_t start;                 //!< The sample the detection starts at, where the pressure is maximal.
+    uint64_t dataSize;              //!< The size of the data in bytes.
+
+    /**
+     * Creates the header of a new file of the result cache.
+     * @param stage The stage of the analysis.
+     * @param recordingHash The hash of the samples of the recording.
+     * @param configHash The hash of the configuration of the stage.
+     * @param dataSize The size of the data in bytes.
+     * @return The header.
+     */
+    static CacheHeader create(CacheStage stage, uint64_t recordingHash, uint64_t configHash, uint64_t dataSize) {
+        CacheHeader header{};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        header.version = CACHE_VERSION;
+        header.headerSize = sizeof(CacheHeader);
+        header.stage = stage;
+        header.recordingHash = recordingHash;
+        header.configHash = configHash;
+        header.dataSize = dataSize;
+        return header;
+    }
+};
+
+static_assert(sizeof(CacheHeader) == 64, "The cache header must not contain padding.");
+static_assert(sizeof(IndexHeader) == 24, "The index header must not contain padding.");
+static_assert(sizeof(IndexEntry) == 152, "The index entry must not contain padding.");
+static_assert(sizeof(IndexEntry) % 8 == 0, "The index entries have to stay aligned.");
+static_assert(sizeof(FlightHeader) == 80, "The flight recorder header must not contain padding.");
+static_assert(offsetof(FlightHeader, samples) % 8 == 0, "The counters of the flight recorder have to be aligned.");
+static_assert(sizeof(DebugHeader) == 64, "The debug header must not contain padding.");
+static_assert(offsetof(DebugHeader, rangeMin) == DEBUG_HEADER_SIZE_V1, "The debug header has to extend version 1.");
+static_assert(sizeof(DebugChunk) == 16, "The debug chunk must not contain padding.");
+static_assert(sizeof(DebugEvent) == DebugChunk::valueSize(DebugStream::peaks), "The debug event has the wrong size.");
+static_assert(sizeof(ArchiveHeader) == 48, "The archive header must not contain padding.");
+static_assert(sizeof(RecordingHeader) == 56, "The recording header must not contain padding.");
+static_assert(sizeof(RecordingHeader) <= RECORDING_HEADER_SIZE, "The recording header is too large.");
+static_assert(sizeof(RecordingFooter) == 48, "The recording footer must not contain padding.");
+static_assert(sizeof(float) == 4, "The samples are stored as 32 bit floats.");
+
+
+#endif //OBP_RECORDINGFORMAT_H
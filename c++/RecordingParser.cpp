@@ -0,0 +1,284 @@
+/**
+ * @file        RecordingParser.cpp
+ * @brief       The implementation of the RecordingParser class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "common.h"
+#include "MappedFile.h"
+#include "RecordingParser.h"
+
+/**
+ * The powers of ten that are exact doubles.
+ */
+static constexpr double exactPowersOfTen[PARSER_FAST_DIGITS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                                                    1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+/**
+ * Parses a number. Plain decimals with up to PARSER_FAST_DIGITS digits, which is what the recordings contain, are
+ * converted directly: the digits form an exact integer and dividing it by an exact power of ten is rounded correctly,
+ * so the result is the same as that of std::from_chars. All other numbers are passed to std::from_chars.
+ * @param first The start of the number.
+ * @param last The end of the text.
+ * @param value Returns the number.
+ * @return The result of the conversion, like std::from_chars.
+ */
+static inline std::from_chars_result parseNumber(const char *first, const char *last, double &value)
+{
+    const char *pos = first;
+    const bool negative = pos < last && *pos == '-';
+    pos += negative;
+    uint64_t mantissa = 0;
+    unsigned digits = 0;
+    unsigned decimals = 0;
+    for (; pos < last && (unsigned) (*pos - '0') < 10; ++pos, ++digits)
+    {
+        mantissa = mantissa * 10 + (unsigned) (*pos - '0');
+    }
+    if (pos < last && *pos == '.')
+    {
+        for (++pos; pos < last && (unsigned) (*pos - '0') < 10; ++pos, ++digits, ++decimals)
+        {
+            mantissa = mantissa * 10 + (unsigned) (*pos - '0');
+        }
+    }
+    if (digits == 0 || digits > PARSER_FAST_DIGITS || (pos < last && (*pos == 'e' || *pos == 'E')))
+    {
+        return std::from_chars(first, last, value);
+    }
+    value = (double) mantissa / exactPowersOfTen[decimals];
+    if (negative)
+    {
+        value = -value;
+    }
+    return {pos, std::errc()};
+}
+
+/**
+ * Constructor that loads a file immediately.
+ * @param fileName The name of the text recording.
+ */
+RecordingParser::RecordingParser(const std::string &fileName)
+{
+    load(fileName);
+}
+
+/**
+ * Loads a text recording. A recording that was loaded before is cleared first.
+ * @param fileName The name of the text recording.
+ * @return False if the file could not be read or is not a valid text recording; nothing is loaded then.
+ */
+bool RecordingParser::load(const std::string &fileName)
+{
+    clear();
+
+    MappedFile file;
+    if (!file.map(fileName, 1, "text recording"))
+    {
+        return false;
+    }
+    file.adviseSequential();
+    const bool ok = parse(reinterpret_cast<const char *>(file.data()), file.size(), fileName);
+    file.unmap();
+    if (!ok)
+    {
+        clear();
+        return false;
+    }
+    detectContent();
+    return true;
+}
+
+/**
+ * Removes the loaded recording.
+ */
+void RecordingParser::clear()
+{
+    columns.clear();
+    timeInSeconds = false;
+    raw = false;
+}
+
+/**
+ * @return The number of columns including the time, 0 if nothing is loaded.
+ */
+size_t RecordingParser::getColumnCount() const
+{
+    return columns.size();
+}
+
+/**
+ * @return The number of lines with samples, 0 if nothing is loaded.
+ */
+size_t RecordingParser::getSampleCount() const
+{
+    return columns.empty() ? 0 : columns[0].size();
+}
+
+/**
+ * @return The first column, in seconds or the sample numbers.
+ */
+const std::vector<double> &RecordingParser::getTime() const
+{
+    return getColumn(0);
+}
+
+/**
+ * Gets the values of a channel.
+ * @param channel The channel, starting at 0 for the column after the time.
+ * @return The values, empty if the channel does not exist.
+ */
+const std::vector<double> &RecordingParser::getChannel(size_t channel) const
+{
+    return getColumn(channel + 1);
+}
+
+/**
+ * Gets a column as it is in the file.
+ * @param column The column, starting at 0 for the time.
+ * @return The values, empty if the column does not exist.
+ */
+const std::vector<double> &RecordingParser::getColumn(size_t column) const
+{
+    static const std::vector<double> empty;
+    return column < columns.size() ? columns[column] : empty;
+}
+
+/**
+ * @return True if the time is in seconds, false if it is the sample number.
+ */
+bool RecordingParser::isTimeInSeconds() const
+{
+    return timeInSeconds;
+}
+
+/**
+ * @return True if all values are ADC counts, false if they are voltages or pressures.
+ */
+bool RecordingParser::isRaw() const
+{
+    return raw;
+}
+
+/**
+ * Estimates the sampling rate from the time in seconds.
+ * @return The sampling rate in Hz, 0 if the time is not in seconds.
+ */
+double RecordingParser::getSamplingRate() const
+{
+    const std::vector<double> &time = getTime();
+    if (!timeInSeconds || time.size() < 2 || time.back() <= time.front())
+    {
+        return 0.0;
+    }
+    return (double) (time.size() - 1) / (time.back() - time.front());
+}
+
+/**
+ * Parses the text into the columns.
+ * @param text The text of the file.
+ * @param size The size of the text in bytes.
+ * @param fileName The name of the file for the log.
+ * @return False if a line could not be parsed or has a different number of columns than the first.
+ */
+bool RecordingParser::parse(const char *text, size_t size, const std::string &fileName)
+{
+    const char *const end = text + size;
+    size_t lines = 1;
+    for (const char *pos = text; (pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos))) != nullptr;
+         ++pos)
+    {
+        lines++;
+    }
+
+    double row[PARSER_MAX_COLUMNS];
+    size_t lineNumber = 0;
+    for (const char *pos = text; pos < end; ++pos)
+    {
+        lineNumber++;
+        size_t column = 0;
+        while (true)
+        {
+            while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+            {
+                pos++;
+            }
+            if (pos == end || *pos == '\n')
+            {
+                break;
+            }
+            if (column == PARSER_MAX_COLUMNS)
+            {
+                PLOG_WARNING << fileName << ": line " << lineNumber << " has more than " << PARSER_MAX_COLUMNS
+                             << " columns";
+                return false;
+            }
+            const auto result = parseNumber(pos, end, row[column]);
+            if (result.ec != std::errc() || (result.ptr < end && *result.ptr != ' ' && *result.ptr != '\t' &&
+                                             *result.ptr != '\r' && *result.ptr != '\n'))
+            {
+                PLOG_WARNING << fileName << ": line " << lineNumber << " is not a number in column " << column + 1;
+                return false;
+            }
+            pos = result.ptr;
+            column++;
+        }
+        if (column == 0)
+        {
+            continue;
+        }
+        if (columns.empty())
+        {
+            if (column < 2)
+            {
+                PLOG_WARNING << fileName << " has no values besides the time";
+                return false;
+            }
+            columns.resize(column);
+            for (auto &values : columns)
+            {
+                values.reserve(lines);
+            }
+        }
+        if (column != columns.size())
+        {
+            PLOG_WARNING << fileName << ": line " << lineNumber << " has " << column << " instead of "
+                         << columns.size() << " columns";
+            return false;
+        }
+        for (size_t i = 0; i < column; ++i)
+        {
+            columns[i].push_back(row[i]);
+        }
+    }
+    if (columns.empty())
+    {
+        PLOG_WARNING << fileName << " contains no samples";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Detects whether the time is in seconds and whether the values are ADC counts.
+ */
+void RecordingParser::detectContent()
+{
+    auto isInteger = [](double value) { return value == std::floor(value); };
+    const std::vector<double> &time = getTime();
+    timeInSeconds = !std::all_of(time.begin(), time.end(), isInteger);
+    raw = true;
+    for (size_t column = 1; raw && column < columns.size(); ++column)
+    {
+        raw = std::all_of(columns[column].begin(), columns[column].end(), [isInteger](double value) {
+            return value >= 0.0 && value < PARSER_MAX_RAW && isInteger(value);
+        });
+    }
+}
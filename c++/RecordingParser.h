@@ -0,0 +1,67 @@
+/**
+ * @file        RecordingParser.h
+ * @brief       The header file of the RecordingParser class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the RecordingParser class and contains the general class description.
+ */
+#ifndef OBP_RECORDINGPARSER_H
+#define OBP_RECORDINGPARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Class dependant configuration values:
+ */
+#define PARSER_MAX_COLUMNS  4           //!< Max. number of columns of a text recording, the time and up to 3 values.
+#define PARSER_MAX_RAW      16777216.0  //!< Values of raw recordings are ADC counts below this value (24 bit).
+#define PARSER_FAST_DIGITS  15          //!< Max. number of digits of numbers that are parsed without std::from_chars.
+
+//! The RecordingParser class loads text recordings quickly.
+/*!
+ * Text recordings are the .dat files written by the Datarecord and the older files in the data folder. Every line
+ * holds the time and one to three values, separated by spaces or tabs. The time is either in seconds or the sample
+ * number, the values are voltages, pressures or the counts of the ADC.
+ *
+ * The file is mapped into memory and parsed without copying the text. Plain decimals are converted directly, any other
+ * number with std::from_chars; neither depends on the locale and both give the same, correctly rounded result. The
+ * lines are counted first, so the columns are allocated once. The number of columns is taken from the first line and
+ * every other line has to have as many; blank lines are skipped.
+ *
+ * After loading, the parser tells whether the time is in seconds and estimates the sampling rate from it, and whether
+ * the values are raw ADC counts (all integers from 0 to PARSER_MAX_RAW) or physical values.
+ */
+class RecordingParser {
+
+public:
+    RecordingParser() = default;
+    explicit RecordingParser(const std::string &fileName);
+
+    bool load(const std::string &fileName);
+    void clear();
+
+    [[nodiscard]] size_t getColumnCount() const;
+    [[nodiscard]] size_t getSampleCount() const;
+    [[nodiscard]] const std::vector<double> &getTime() const;
+    [[nodiscard]] const std::vector<double> &getChannel(size_t channel) const;
+    [[nodiscard]] const std::vector<double> &getColumn(size_t column) const;
+    [[nodiscard]] bool isTimeInSeconds() const;
+    [[nodiscard]] bool isRaw() const;
+    [[nodiscard]] double getSamplingRate() const;
+
+private:
+    bool parse(const char *text, size_t size, const std::string &fileName);
+    void detectContent();
+
+    std::vector<std::vector<double>> columns;   //!< The columns, the time first.
+    bool timeInSeconds = false;                 //!< The time column holds seconds, not sample numbers.
+    bool raw = false;                           //!< The values are ADC counts.
+};
+
+
+#endif //OBP_RECORDINGPARSER_H
@@ -0,0 +1,181 @@
+/**
+ * @file        RecordingReader.cpp
+ * @brief       The implementation of the RecordingReader class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "common.h"
+#include "RecordingReader.h"
+
+/**
+ * Constructor that opens a recording immediately.
+ * @param fileName The name of the binary recording.
+ */
+RecordingReader::RecordingReader(const std::string &fileName)
+{
+    open(fileName);
+}
+
+/**
+ * Destructor of the RecordingReader. Releases the mapping.
+ */
+RecordingReader::~RecordingReader()
+{
+    close();
+}
+
+/**
+ * Opens a binary recording and checks its header. A recording that is already open is closed first.
+ * @param fileName The name of the binary recording.
+ * @return False if the file could not be mapped or is not a valid recording.
+ */
+bool RecordingReader::open(const std::string &fileName)
+{
+    close();
+
+    if (!file.map(fileName, sizeof(RecordingHeader), "recording"))
+    {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(RecordingHeader));
+
+    bool valid = std::memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version >= 1 && header.version <= RECORDING_VERSION &&
+                 header.headerSize >= sizeof(RecordingHeader) && header.headerSize % sizeof(float) == 0 &&
+                 header.format == SampleFormat::float32 && header.channels > 0 && header.samplingRate > 0.0;
+    if (valid)
+    {
+        // Compared by division, so a corrupt sample count cannot overflow.
+        const size_t available = (file.size() - std::min<size_t>(file.size(), header.headerSize)) / sizeof(float);
+        complete = header.samples != RECORDING_SAMPLES_UNKNOWN;
+        if (!complete)
+        {
+            // An interrupted recording, all complete samples in the file are used.
+            header.samples = available / header.channels;
+            PLOG_WARNING << "Recording " << fileName << " was not finished, " << header.samples << " samples recovered";
+        }
+        valid = header.samples <= available / header.channels;
+    }
+    if (!valid)
+    {
+        PLOG_WARNING << "Recording " << fileName << " has an invalid header or is truncated";
+        close();
+        return false;
+    }
+    file.adviseSequential();
+    return true;
+}
+
+/**
+ * Closes the recording and releases the mapping. The spans returned before are invalid afterwards.
+ */
+void RecordingReader::close()
+{
+    file.unmap();
+    header = RecordingHeader{};
+    complete = false;
+}
+
+/**
+ * @return True if a valid recording is open.
+ */
+bool RecordingReader::isOpen() const
+{
+    return file.isMapped();
+}
+
+/**
+ * @return True if the open recording was finished, false if it was interrupted and the samples were recovered.
+ */
+bool RecordingReader::isComplete() const
+{
+    return complete;
+}
+
+/**
+ * Gets the header of the open recording. The sample count of an interrupted recording is the recovered one.
+ * @return The header, all zero if no recording is open.
+ */
+const RecordingHeader &RecordingReader::getHeader() const
+{
+    return header;
+}
+
+/**
+ * Gets all samples of the open recording, directly from the mapping. The channels are interleaved.
+ * @return The samples, empty if no recording is open.
+ */
+std::span<const float> RecordingReader::getSamples() const
+{
+    if (!file.isMapped())
+    {
+        return {};
+    }
+    return {reinterpret_cast<const float *>(file.data() + header.headerSize), header.samples * header.channels};
+}
+
+/**
+ * Gets the footer with the results of the open recording.
+ * @param footer Returns the footer, unchanged if there is none.
+ * @return False if no recording is open or it has no footer.
+ */
+bool RecordingReader::getFooter(RecordingFooter &footer) const
+{
+    if (!file.isMapped() || !complete)
+    {
+        return false;
+    }
+    const size_t offset = header.headerSize + header.samples * header.channels * sizeof(float);
+    if (file.size() < offset + sizeof(RecordingFooter) ||
+        std::memcmp(file.data() + offset, RECORDING_FOOTER_MAGIC, sizeof(footer.magic)) != 0)
+    {
+        return false;
+    }
+    std::memcpy(&footer, file.data() + offset, sizeof(RecordingFooter));
+    return true;
+}
+
+/**
+ * Copies one channel of the open recording into a vector of doubles.
+ * @param channel The channel, starting at 0.
+ * @return The samples of the channel, empty if no recording is open or the channel does not exist.
+ */
+std::vector<double> RecordingReader::getChannel(size_t channel) const
+{
+    std::vector<double> values;
+    if (!file.isMapped() || channel >= header.channels)
+    {
+        return values;
+    }
+    const std::span<const float> samples = getSamples();
+    values.reserve(header.samples);
+    for (size_t i = channel; i < samples.size(); i += header.channels)
+    {
+        values.push_back(samples[i]);
+    }
+    return values;
+}
+
+/**
+ * Checks if a file starts like a binary recording, without checking the rest of it.
+ * @param fileName The name of the file.
+ * @return True if the file starts with RECORDING_MAGIC.
+ */
+bool RecordingReader::isRecording(const std::string &fileName)
+{
+    char magic[sizeof(RecordingHeader::magic)];
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const ssize_t n = read(fd, magic, sizeof(magic));
+    ::close(fd);
+    return n == (ssize_t) sizeof(magic) && std::memcmp(magic, RECORDING_MAGIC, sizeof(magic)) == 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file        RecordingReader.h
+ * @brief       The header file of the RecordingReader class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the RecordingReader class and contains the general class description.
+ */
+#ifndef OBP_RECORDINGREADER_H
+#define OBP_RECORDINGREADER_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "RecordingFormat.h"
+
+//! The RecordingReader class reads binary recordings without copying them.
+/*!
+ * The file is mapped into memory read-only and the samples are accessed directly in the mapping, so opening a
+ * recording costs the same for any length and the pages are only read from disk when they are used. The header is
+ * checked when the file is opened: the magic, the version, the sample format and that the file holds all samples the
+ * header announces. If any check fails, the reader stays closed. Recordings that were interrupted before they were
+ * finished are opened with all complete samples in the file, isComplete() tells them apart.
+ *
+ * The detection works with doubles, getChannel() converts one channel into a vector for it. The mapping is released
+ * by close() or the destructor, the spans returned before are invalid afterwards.
+ */
+class RecordingReader {
+
+public:
+    RecordingReader() = default;
+    explicit RecordingReader(const std::string &fileName);
+    ~RecordingReader();
+    RecordingReader(const RecordingReader &) = delete;
+    RecordingReader &operator=(const RecordingReader &) = delete;
+
+    bool open(const std::string &fileName);
+    void close();
+
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] bool isComplete() const;
+    [[nodiscard]] const RecordingHeader &getHeader() const;
+    bool getFooter(RecordingFooter &footer) const;
+    [[nodiscard]] std::span<const float> getSamples() const;
+    [[nodiscard]] std::vector<double> getChannel(size_t channel) const;
+
+    static bool isRecording(const std::string &fileName);
+
+private:
+    RecordingHeader header{};               //!< Copy of the header of the open file.
+    MappedFile file;                        //!< The mapped file, not mapped if closed.
+    bool complete = false;                  //!< The recording was finished, its sample count is known.
+};
+
+
+#endif //OBP_RECORDINGREADER_H
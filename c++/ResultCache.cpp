@@ -0,0 +1,373 @@
+/**
+ * @file        ResultCache.cpp
+ * @brief       The implementation of the ResultCache class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "ResultCache.h"
+
+static constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;  //!< The start value of the FNV-1a hash.
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;           //!< The prime of the FNV-1a hash.
+
+// A value that is added to the configuration has to be added to hashConfig() as well.
+static_assert(sizeof(PipelineConfig) == 24, "A value of the pipeline configuration is missing in the hash.");
+static_assert(sizeof(DetectionConfig) == 112, "A value of the detection configuration is missing in the hash.");
+static_assert(std::is_trivially_copyable_v<OBPResult>, "OBPResult has to be stored as a whole.");
+
+/**
+ * Continues a 64 bit FNV-1a hash with some bytes.
+ * @param hash The hash so far.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return The hash.
+ */
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Continues a hash with a value.
+ * @tparam T The type of the value, without padding.
+ * @param hash The hash so far.
+ * @param value The value.
+ * @return The hash.
+ */
+template<typename T>
+static uint64_t hashValue(uint64_t hash, T value)
+{
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+/**
+ * Constructor of the ResultCache. The directory is created when the first file is stored.
+ * @param directory The directory of the cache files.
+ */
+ResultCache::ResultCache(std::string directory) :
+        directory(std::move(directory))
+{
+}
+
+/**
+ * Analyses a recorded measurement like Pipeline::analyze(), with the stages that are cached read from the cache.
+ * @param recording The recorded pressure in mmHg, as it is stored by Processing.
+ * @param config The configuration of the pipeline the recording is analysed with.
+ * @param detector The detector to analyse the recording with, its configuration is used. It is reset, but only holds
+ * the beats of the recording if the result was not cached.
+ * @return The results of the analysis.
+ */
+OBPResult ResultCache::analyze(std::span<const double> recording, const PipelineConfig &config,
+                               OBPDetection &detector)
+{
+    // The detection takes over its published configuration when it is reset.
+    detector.reset();
+    const DetectionConfig detection = detector.getConfig();
+    const uint64_t recordingHash = hashRecording(recording);
+    const uint64_t filteredHash = hashConfig(config);
+    const uint64_t resultHash = hashConfig(config, detection, detector.getAlgorithm());
+    const std::string filteredFile = getFileName(CacheStage::filtered, recordingHash, filteredHash);
+    CacheHeader filteredHeader = CacheHeader::create(CacheStage::filtered, recordingHash, filteredHash,
+                                                     2 * recording.size() * sizeof(double));
+    filteredHeader.samples = recording.size();
+
+    OBPResult result;
+    CacheHeader header{};
+    const std::string resultFile = getFileName(CacheStage::result, recordingHash, resultHash);
+    const CacheHeader resultHeader = CacheHeader::create(CacheStage::result, recordingHash, resultHash,
+                                                         sizeof(OBPResult));
+    if (load(resultFile, resultHeader, 0,
+             {std::span(reinterpret_cast<unsigned char *>(&result), sizeof(OBPResult))}, header))
+    {
+        resultHits++;
+        if (detector.getAlgorithm() == DetectionAlgorithm::FixedRatio)
+        {
+            findSBP(result, detection, recording, config, filteredFile, filteredHeader);
+        }
+        return result;
+    }
+
+    std::vector<double> yLP(recording.size());
+    std::vector<double> yHP(recording.size());
+    size_t start;
+    if (load(filteredFile, filteredHeader, 0,
+             {std::span(reinterpret_cast<unsigned char *>(yLP.data()), yLP.size() * sizeof(double)),
+              std::span(reinterpret_cast<unsigned char *>(yHP.data()), yHP.size() * sizeof(double))}, header) &&
+        header.start < std::max<size_t>(recording.size(), 1))
+    {
+        filteredHits++;
+        start = header.start;
+    } else
+    {
+        misses++;
+        start = Pipeline::filterRecording(recording, config, yLP, yHP);
+        filteredHeader.start = start;
+        store(filteredFile, filteredHeader,
+              {std::span(reinterpret_cast<const unsigned char *>(yLP.data()), yLP.size() * sizeof(double)),
+               std::span(reinterpret_cast<const unsigned char *>(yHP.data()), yHP.size() * sizeof(double))});
+    }
+
+    result = detector.analyze(std::span<const double>(yLP).subspan(start),
+                              std::span<const double>(yHP).subspan(start));
+    result.offset = start;
+    store(resultFile, resultHeader,
+          {std::span(reinterpret_cast<const unsigned char *>(&result), sizeof(OBPResult))});
+    return result;
+}
+
+/**
+ * Finds the SBP of a cached result of the fixed ratio algorithm again, the result may have been calculated with
+ * another SBP ratio. Only if the time of the SBP changes, the pressure is read from the filtered streams, or filtered
+ * again if they are not cached.
+ * @param result The cached result, its SBP is updated.
+ * @param detection The configuration of the detection.
+ * @param recording The recorded pressure in mmHg.
+ * @param config The configuration of the pipeline.
+ * @param filteredFile The name of the file of the filtered streams.
+ * @param filteredHeader The header the file of the filtered streams has to have.
+ */
+void ResultCache::findSBP(OBPResult &result, const DetectionConfig &detection, std::span<const double> recording,
+                          const PipelineConfig &config, const std::string &filteredFile,
+                          const CacheHeader &filteredHeader) const
+{
+    if (!result.finished || result.envelope.empty() || result.offset + result.decisionTime >= recording.size())
+    {
+        return;
+    }
+    size_t mapTime;
+    size_t sbpTime;
+    size_t dbpTime;
+    bool foundSBP;
+    OBPDetection::findRatioTimes(result.envelope, detection.ratioSBP, detection.ratioDBP, mapTime, sbpTime, dbpTime,
+                                 foundSBP);
+    if (!foundSBP)
+    {
+        // As the detection does when it does not find the SBP.
+        result.sbpTime = 0;
+        result.sbp = 0.0;
+        return;
+    }
+    if (sbpTime == result.sbpTime)
+    {
+        return;
+    }
+
+    // The pressure up to the decision, as the detection had it when it calculated the results.
+    std::vector<double> pressure(result.decisionTime + 1);
+    CacheHeader header{};
+    if (!load(filteredFile, filteredHeader, result.offset * sizeof(double),
+              {std::span(reinterpret_cast<unsigned char *>(pressure.data()), pressure.size() * sizeof(double))},
+              header) || header.start != result.offset)
+    {
+        std::vector<double> yLP;
+        std::vector<double> yHP;
+        Pipeline::filterRecording(recording, config, yLP, yHP);
+        std::copy_n(yLP.begin() + (ptrdiff_t) result.offset, pressure.size(), pressure.begin());
+    }
+    result.sbpTime = sbpTime;
+    result.sbp = OBPDetection::getAveragePressureAt(pressure, sbpTime, result.heartRate, detection.samplingRate);
+}
+
+/**
+ * @return The directory of the cache files.
+ */
+const std::string &ResultCache::getDirectory() const
+{
+    return directory;
+}
+
+/**
+ * @return The number of analyses whose result was read from the cache.
+ */
+size_t ResultCache::getResultHits() const
+{
+    return resultHits;
+}
+
+/**
+ * @return The number of analyses whose filtered streams were read from the cache and that were only detected again.
+ */
+size_t ResultCache::getFilteredHits() const
+{
+    return filteredHits;
+}
+
+/**
+ * @return The number of analyses that were not in the cache at all.
+ */
+size_t ResultCache::getMisses() const
+{
+    return misses;
+}
+
+/**
+ * Calculates the hash of the samples of a recording.
+ * @param recording The recorded pressure.
+ * @return The 64 bit hash of the samples and their number.
+ */
+uint64_t ResultCache::hashRecording(std::span<const double> recording)
+{
+    // Four independent lanes over the 64 bit words, the high half of each step is folded back into the low half.
+    uint64_t lanes[4] = {FNV_OFFSET, FNV_OFFSET + 1, FNV_OFFSET + 2, FNV_OFFSET + 3};
+    const auto step = [](uint64_t &lane, double value) {
+        uint64_t word;
+        std::memcpy(&word, &value, sizeof(word));
+        lane = (lane ^ word) * FNV_PRIME;
+        lane ^= lane >> 32;
+    };
+    size_t i = 0;
+    for (; i + 4 <= recording.size(); i += 4)
+    {
+        step(lanes[0], recording[i]);
+        step(lanes[1], recording[i + 1]);
+        step(lanes[2], recording[i + 2]);
+        step(lanes[3], recording[i + 3]);
+    }
+    for (; i < recording.size(); ++i)
+    {
+        step(lanes[0], recording[i]);
+    }
+    return hashBytes(hashValue(FNV_OFFSET, (uint64_t) recording.size()), lanes, sizeof(lanes));
+}
+
+/**
+ * Calculates the hash of the configuration of the filters.
+ * @param config The configuration of the pipeline.
+ * @return The hash of all values of the configuration.
+ */
+uint64_t ResultCache::hashConfig(const PipelineConfig &config)
+{
+    uint64_t hash = hashValue(FNV_OFFSET, (uint32_t) CacheStage::filtered);
+    hash = hashValue(hash, config.samplingRate);
+    hash = hashValue(hash, config.fcLP);
+    return hashValue(hash, config.fcHP);
+}
+
+/**
+ * Calculates the hash of the configuration of the detection, which includes the configuration of the filters. The SBP
+ * ratio is left out: it is only used to find the SBP in the envelope, which is done again for cached results.
+ * @param config The configuration of the pipeline.
+ * @param detection The configuration of the detection.
+ * @param algorithm The algorithm of the detection.
+ * @return The hash of all other values of the configurations and the algorithm.
+ */
+uint64_t ResultCache::hashConfig(const PipelineConfig &config, const DetectionConfig &detection,
+                                 DetectionAlgorithm algorithm)
+{
+    uint64_t hash = hashValue(hashConfig(config), (uint32_t) CacheStage::result);
+    hash = hashValue(hash, (uint32_t) algorithm);
+    hash = hashValue(hash, detection.ratioDBP);
+    hash = hashValue(hash, detection.maxValidHR);
+    hash = hashValue(hash, detection.minValidHR);
+    hash = hashValue(hash, detection.prominence);
+    hash = hashValue(hash, (uint64_t) detection.minDataSize);
+    hash = hashValue(hash, (uint64_t) detection.minPeakTime);
+    hash = hashValue(hash, (uint8_t) detection.adaptivePeakTime);
+    hash = hashValue(hash, detection.samplingRate);
+    hash = hashValue(hash, (int32_t) detection.minNbrPeaks);
+    hash = hashValue(hash, detection.cutoffHyst);
+    hash = hashValue(hash, (uint8_t) detection.predictive);
+    hash = hashValue(hash, detection.predictionTolerance);
+    return hashValue(hash, (int32_t) detection.minFlankPoints);
+}
+
+/**
+ * Gets the name of the file of a stage.
+ * @param stage The stage of the analysis.
+ * @param recordingHash The hash of the recording.
+ * @param configHash The hash of the configuration of the stage.
+ * @return The name of the file with the directory.
+ */
+std::string ResultCache::getFileName(CacheStage stage, uint64_t recordingHash, uint64_t configHash) const
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%016" PRIx64 "_%016" PRIx64 "%s", recordingHash, configHash,
+                  stage == CacheStage::filtered ? "_filtered" CACHE_EXTENSION : "_result" CACHE_EXTENSION);
+    return directory + name;
+}
+
+/**
+ * Reads a stage from the cache.
+ * @param fileName The name of the file.
+ * @param expected The header the file has to have, except for the start.
+ * @param offset The offset in the data to read from.
+ * @param data Returns the data from the offset on, in the given sizes.
+ * @param header Returns the header of the file.
+ * @return False if the file does not exist or does not match.
+ */
+bool ResultCache::load(const std::string &fileName, const CacheHeader &expected, uint64_t offset,
+                       std::initializer_list<std::span<unsigned char>> data, CacheHeader &header) const
+{
+    std::FILE *file = std::fopen(fileName.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    bool valid = std::fread(&header, sizeof(CacheHeader), 1, file) == 1 &&
+                 std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == CACHE_VERSION && header.headerSize >= sizeof(CacheHeader) &&
+                 header.stage == expected.stage && header.recordingHash == expected.recordingHash &&
+                 header.configHash == expected.configHash && header.samples == expected.samples &&
+                 header.dataSize == expected.dataSize &&
+                 std::fseek(file, (long) (header.headerSize + offset), SEEK_SET) == 0;
+    for (const std::span<unsigned char> &part : data)
+    {
+        valid = valid && std::fread(part.data(), 1, part.size(), file) == part.size();
+    }
+    std::fclose(file);
+    if (!valid)
+    {
+        PLOG_WARNING << "Cache file " << fileName << " is invalid, it is replaced";
+    }
+    return valid;
+}
+
+/**
+ * Writes a stage to the cache. The file is written under a temporary name and renamed when it is complete. A cache
+ * that cannot be written only makes the analysis slower, so failures are only logged.
+ * @param fileName The name of the file.
+ * @param header The header of the file.
+ * @param data The data, the sizes of the spans have to add up to the data size of the header.
+ */
+void ResultCache::store(const std::string &fileName, const CacheHeader &header,
+                        std::initializer_list<std::span<const unsigned char>> data) const
+{
+    static std::atomic<unsigned> tempCounter{0};
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        PLOG_WARNING << "Could not create the cache directory " << directory;
+        return;
+    }
+    const std::string tempName = fileName + "." + std::to_string(getpid()) + "." + std::to_string(tempCounter++);
+    std::FILE *file = std::fopen(tempName.c_str(), "wb");
+    if (file == nullptr)
+    {
+        PLOG_WARNING << "Could not create cache file " << tempName;
+        return;
+    }
+    bool success = std::fwrite(&header, sizeof(CacheHeader), 1, file) == 1;
+    for (const std::span<const unsigned char> &part : data)
+    {
+        success = success && std::fwrite(part.data(), 1, part.size(), file) == part.size();
+    }
+    success = std::fclose(file) == 0 && success;
+    if (!success || std::rename(tempName.c_str(), fileName.c_str()) != 0)
+    {
+        PLOG_WARNING << "Could not write cache file " << fileName;
+        std::remove(tempName.c_str());
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file        ResultCache.h
+ * @brief       The header file of the ResultCache class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the ResultCache class and contains the general class description.
+ */
+#ifndef OBP_RESULTCACHE_H
+#define OBP_RESULTCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <vector>
+#include "OBPDetection.h"
+#include "Pipeline.h"
+#include "RecordingFormat.h"
+
+/**
+ * Class dependant configuration values:
+ */
+#define CACHE_DIRECTORY "obp_cache" //!< The default directory of the result cache.
+
+//! The ResultCache class stores the stages of the analysis of recordings, so a reanalysis only repeats what changed.
+/*!
+ * The analysis of a recording has two stages: the Pipeline filters the pressure into the low-pass filtered pressure
+ * and the oscillation, and the detection finds the beats and the results in them. The filtered streams only depend
+ * on the recording and the PipelineConfig, the results on those and the DetectionConfig and the algorithm. Each stage
+ * is stored in its own file in the cache directory, named by the hash of the samples of the recording and the hash of
+ * the configuration of the stage (see CacheHeader).
+ *
+ * analyze() gives the same result as Pipeline::analyze(). If the result of the configuration is cached, it is read;
+ * otherwise the filtered streams are read if they are cached, or filtered and stored, and the detection is run on
+ * them. The SBP ratio is not part of the configuration of the results: the detection does not use it until it
+ * calculates the results, so the SBP of a cached result is found again in its envelope with the current ratio. A
+ * sweep of the SBP ratio therefore costs reading one file per recording, while a change of the other values of the
+ * detection, the DBP ratio and the min. number of peaks included, runs the detection again on the filtered streams:
+ * they decide when the detection stops and with it which beats are found.
+ *
+ * The cache cannot see changes of the code of the filters and the detection, CACHE_VERSION has to be raised with
+ * them. Files are written under a temporary name and renamed, so several threads and processes can share a cache and
+ * a file that was not written completely is never read. Files that are invalid are ignored and replaced. Nothing is
+ * ever removed, the directory can be deleted at any time.
+ */
+class ResultCache {
+
+public:
+    explicit ResultCache(std::string directory = CACHE_DIRECTORY);
+
+    OBPResult analyze(std::span<const double> recording, const PipelineConfig &config, OBPDetection &detector);
+
+    [[nodiscard]] const std::string &getDirectory() const;
+    [[nodiscard]] size_t getResultHits() const;
+    [[nodiscard]] size_t getFilteredHits() const;
+    [[nodiscard]] size_t getMisses() const;
+
+    static uint64_t hashRecording(std::span<const double> recording);
+    static uint64_t hashConfig(const PipelineConfig &config);
+    static uint64_t hashConfig(const PipelineConfig &config, const DetectionConfig &detection,
+                               DetectionAlgorithm algorithm);
+
+private:
+    [[nodiscard]] std::string getFileName(CacheStage stage, uint64_t recordingHash, uint64_t configHash) const;
+    void findSBP(OBPResult &result, const DetectionConfig &detection, std::span<const double> recording,
+                 const PipelineConfig &config, const std::string &filteredFile,
+                 const CacheHeader &filteredHeader) const;
+    bool load(const std::string &fileName, const CacheHeader &expected, uint64_t offset,
+              std::initializer_list<std::span<unsigned char>> data, CacheHeader &header) const;
+    void store(const std::string &fileName, const CacheHeader &header,
+               std::initializer_list<std::span<const unsigned char>> data) const;
+
+    std::string directory;                  //!< The directory of the cache files.
+    std::atomic<size_t> resultHits{0};      //!< Number of analyses whose result was cached.
+    std::atomic<size_t> filteredHits{0};    //!< Number of analyses whose filtered streams were cached.
+    std::atomic<size_t> misses{0};          //!< Number of analyses that were not cached at all.
+};
+
+
+#endif //OBP_RESULTCACHE_H
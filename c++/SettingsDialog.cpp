@@ -80,6 +80,98 @@ void SettingsDialog::setPumpUpValue(int val) {
     sbPumpUpValue->setValue(val);
 }
 
+/**
+ * Gets the index of the selected algorithm in the combo box.
+ * @return The index of the algorithm, in the order of the DetectionAlgorithm enum.
+ */
+int SettingsDialog::getAlgorithm() {
+    return cbAlgorithm->currentIndex();
+}
+
+/**
+ * Selects an algorithm in the combo box.
+ * @param val The index of the algorithm, in the order of the DetectionAlgorithm enum.
+ */
+void SettingsDialog::setAlgorithm(int val) {
+    cbAlgorithm->setCurrentIndex(val);
+}
+
+/**
+ * Gets the state of the check box for the predictive mode.
+ * @return True if the check box is checked.
+ */
+bool SettingsDialog::getPredictive() {
+    return cbPredictive->isChecked();
+}
+
+/**
+ * Sets the state of the check box for the predictive mode.
+ * @param val True to check the check box.
+ */
+void SettingsDialog::setPredictive(bool val) {
+    cbPredictive->setChecked(val);
+}
+
+/**
+ * Gets the state of the check box for the adaptive pump-up value.
+ * @return True if the check box is checked.
+ */
+bool SettingsDialog::getAdaptiveInflate() {
+    return cbAdaptiveInflate->isChecked();
+}
+
+/**
+ * Sets the state of the check box for the adaptive pump-up value.
+ * @param val True to check the check box.
+ */
+void SettingsDialog::setAdaptiveInflate(bool val) {
+    cbAdaptiveInflate->setChecked(val);
+}
+
+/**
+ * Gets the state of the check box for the confidence intervals.
+ * @return True if the check box is checked.
+ */
+bool SettingsDialog::getBootstrap() {
+    return cbBootstrap->isChecked();
+}
+
+/**
+ * Sets the state of the check box for the confidence intervals.
+ * @param val True to check the check box.
+ */
+void SettingsDialog::setBootstrap(bool val) {
+    cbBootstrap->setChecked(val);
+}
+
+/**
+ * @return True if the check box is checked.
+ */
+bool SettingsDialog::getBinaryRecording() {
+    return cbBinaryRecording->isChecked();
+}
+
+/**
+ * @param val True to check the check box.
+ */
+void SettingsDialog::setBinaryRecording(bool val) {
+    cbBinaryRecording->setChecked(val);
+}
+
+/**
+ * @return True if the check box is checked.
+ */
+bool SettingsDialog::getDebugRecording() {
+    return cbDebugRecording->isChecked();
+}
+
+/**
+ * @param val True to check the check box.
+ */
+void SettingsDialog::setDebugRecording(bool val) {
+    cbDebugRecording->setChecked(val);
+}
+
 /**
  * This method is to be called at the initialisation of the object. It builds the user interface.
  * @param SettingsDialog A pointer to the object itself.
@@ -117,6 +209,32 @@ void SettingsDialog::setupUi(QDialog *SettingsDialog) {
     sbPumpUpValue->setObjectName(QString::fromUtf8("sbPumpUpValue"));
     sbPumpUpValue->setRange(PUMP_UP_VALUE_MIN, PUMP_UP_VALUE_MAX);
     sbPumpUpValue->setSingleStep(10);
+    lAlgorithm = new QLabel(SettingsDialog);
+    lAlgorithm->setObjectName(QString::fromUtf8("lAlgorithm"));
+    cbAlgorithm = new QComboBox(SettingsDialog);
+    cbAlgorithm->setObjectName(QString::fromUtf8("cbAlgorithm"));
+    cbAlgorithm->addItem(QString());
+    cbAlgorithm->addItem(QString());
+    lPredictive = new QLabel(SettingsDialog);
+    lPredictive->setObjectName(QString::fromUtf8("lPredictive"));
+    cbPredictive = new QCheckBox(SettingsDialog);
+    cbPredictive->setObjectName(QString::fromUtf8("cbPredictive"));
+    lAdaptiveInflate = new QLabel(SettingsDialog);
+    lAdaptiveInflate->setObjectName(QString::fromUtf8("lAdaptiveInflate"));
+    cbAdaptiveInflate = new QCheckBox(SettingsDialog);
+    cbAdaptiveInflate->setObjectName(QString::fromUtf8("cbAdaptiveInflate"));
+    lBootstrap = new QLabel(SettingsDialog);
+    lBootstrap->setObjectName(QString::fromUtf8("lBootstrap"));
+    cbBootstrap = new QCheckBox(SettingsDialog);
+    cbBootstrap->setObjectName(QString::fromUtf8("cbBootstrap"));
+    lBinaryRecording = new QLabel(SettingsDialog);
+    lBinaryRecording->setObjectName(QString::fromUtf8("lBinaryRecording"));
+    cbBinaryRecording = new QCheckBox(SettingsDialog);
+    cbBinaryRecording->setObjectName(QString::fromUtf8("cbBinaryRecording"));
+    lDebugRecording = new QLabel(SettingsDialog);
+    lDebugRecording->setObjectName(QString::fromUtf8("lDebugRecording"));
+    cbDebugRecording = new QCheckBox(SettingsDialog);
+    cbDebugRecording->setObjectName(QString::fromUtf8("cbDebugRecording"));
 
     formL->setWidget(0, QFormLayout::LabelRole, lRatioSBP);
     formL->setWidget(0, QFormLayout::FieldRole, dsbRatioSBP);
@@ -126,6 +244,18 @@ void SettingsDialog::setupUi(QDialog *SettingsDialog) {
     formL->setWidget(2, QFormLayout::FieldRole, sbMinNbrPeaks);
     formL->setWidget(3, QFormLayout::LabelRole, lPumpUpValue);
     formL->setWidget(3, QFormLayout::FieldRole, sbPumpUpValue);
+    formL->setWidget(4, QFormLayout::LabelRole, lAlgorithm);
+    formL->setWidget(4, QFormLayout::FieldRole, cbAlgorithm);
+    formL->setWidget(5, QFormLayout::LabelRole, lPredictive);
+    formL->setWidget(5, QFormLayout::FieldRole, cbPredictive);
+    formL->setWidget(6, QFormLayout::LabelRole, lAdaptiveInflate);
+    formL->setWidget(6, QFormLayout::FieldRole, cbAdaptiveInflate);
+    formL->setWidget(7, QFormLayout::LabelRole, lBootstrap);
+    formL->setWidget(7, QFormLayout::FieldRole, cbBootstrap);
+    formL->setWidget(8, QFormLayout::LabelRole, lBinaryRecording);
+    formL->setWidget(8, QFormLayout::FieldRole, cbBinaryRecording);
+    formL->setWidget(9, QFormLayout::LabelRole, lDebugRecording);
+    formL->setWidget(9, QFormLayout::FieldRole, cbDebugRecording);
 
     vlMain->addLayout(formL);
 
@@ -165,9 +295,16 @@ void SettingsDialog::retranslateUi(QDialog *SettingsDialog) {
     lRatioDBP->setText("DBP ratio:");
     lMinNbrPeaks->setText("Min detected peaks:");
     lPumpUpValue->setText("Pump-up value (mmHg):");
+    lAlgorithm->setText("Algorithm:");
+    cbAlgorithm->setItemText(0, "Fixed ratio");
+    cbAlgorithm->setItemText(1, "Envelope derivative");
+    lPredictive->setText("Predict DBP (shorter deflation):");
+    lAdaptiveInflate->setText("Adaptive pump-up value:");
+    lBootstrap->setText("Confidence intervals (fixed ratio):");
+    lBinaryRecording->setText("Binary recording (.obp):");
+    lDebugRecording->setText("Debug recording of all stages (.obd):");
     lDescription->setText("The application is not guaranteed to work reliably if the values are changed.<br>"
-                          "<b>Changes take effect after restarting the application.</b><br>"
-                          "Resetting the values takes effect immediately.");
+                          "<b>Changes take effect at the start of the next measurement.</b>");
 }
 
 /**
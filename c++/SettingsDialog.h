@@ -19,6 +19,8 @@
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QDoubleSpinBox>
+#include <QtWidgets/QComboBox>
+#include <QtWidgets/QCheckBox>
 #include <QtWidgets/QDialogButtonBox>
 
 #include "common.h"
@@ -41,6 +43,18 @@ public:
     void setMinNbrPeaks(int val);
     int getPumpUpValue();
     void setPumpUpValue(int val);
+    int getAlgorithm();
+    void setAlgorithm(int val);
+    bool getPredictive();
+    void setPredictive(bool val);
+    bool getAdaptiveInflate();
+    void setAdaptiveInflate(bool val);
+    bool getBootstrap();
+    void setBootstrap(bool val);
+    bool getBinaryRecording();
+    void setBinaryRecording(bool val);
+    bool getDebugRecording();
+    void setDebugRecording(bool val);
 
 signals:
     // Signals are automatically generated by the moc and must not be implemented in the .cpp file.
@@ -62,6 +76,18 @@ private:
     QSpinBox *sbMinNbrPeaks;
     QLabel *lPumpUpValue;
     QSpinBox *sbPumpUpValue;
+    QLabel *lAlgorithm;
+    QComboBox *cbAlgorithm;
+    QLabel *lPredictive;
+    QCheckBox *cbPredictive;
+    QLabel *lAdaptiveInflate;
+    QCheckBox *cbAdaptiveInflate;
+    QLabel *lBootstrap;
+    QCheckBox *cbBootstrap;
+    QLabel *lBinaryRecording;
+    QCheckBox *cbBinaryRecording;
+    QLabel *lDebugRecording;
+    QCheckBox *cbDebugRecording;
     QPushButton *btnReset;
     QDialogButtonBox *buttonBox;
     QLabel *lDescription;
@@ -0,0 +1,159 @@
+/**
+ * @file        SlidingMedian.h
+ * @brief       The header file of the SlidingMedian class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines and implements the SlidingMedian class and contains the general class description.
+ */
+#ifndef OBP_SLIDINGMEDIAN_H
+#define OBP_SLIDINGMEDIAN_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+
+/**
+ * Class dependant configuration values:
+ */
+#define SLIDING_MEDIAN_CAPACITY 32  //!< Maximal number of values in the window.
+#define MAD_TO_SIGMA 1.4826         //!< Scales the MAD to the standard deviation of normally distributed values.
+
+//! The SlidingMedian class provides the running median and MAD over the last values of a series.
+/*!
+ * The median and the median absolute deviation (MAD) are robust against single outliers, unlike the mean and the
+ * standard deviation. The window holds the last values in the order they were added (to know which one to remove)
+ * and the same values sorted. A new value replaces the oldest one: both are found in the sorted values by binary
+ * search in O(log k) and the values in between are moved by one position, which is a single move of contiguous memory
+ * for the small windows used here. The median is then read in O(1).
+ *
+ * The MAD is the median of the distances to the median. The values below the median have ascending distances when
+ * read downwards, the values above it when read upwards. The MAD is therefore the middle element of two sorted
+ * sequences and is found by binary search in O(log k) as well, without sorting the distances.
+ *
+ * Like the BeatTable, the capacity is fixed at compile time and the class never allocates memory.
+ */
+class SlidingMedian {
+
+public:
+    /**
+     * Constructor of the SlidingMedian class.
+     * @param windowSize The number of values the median is taken over, limited to SLIDING_MEDIAN_CAPACITY.
+     */
+    explicit SlidingMedian(size_t windowSize) :
+            window(std::clamp<size_t>(windowSize, 1, SLIDING_MEDIAN_CAPACITY)) {
+    }
+
+    /**
+     * Removes all values from the window.
+     */
+    void clear() {
+        count = 0;
+        oldest = 0;
+    }
+
+    /**
+     * Adds a value to the window. If the window is full, the oldest value is removed.
+     * @param value The value to add.
+     */
+    void add(double value) {
+        if (count == window) {
+            auto pos = std::lower_bound(sorted.begin(), sorted.begin() + count, values[oldest]);
+            std::copy(pos + 1, sorted.begin() + count, pos);
+            count--;
+            values[oldest] = value;
+            oldest = (oldest + 1) % window;
+        } else {
+            values[(oldest + count) % window] = value;
+        }
+        auto pos = std::upper_bound(sorted.begin(), sorted.begin() + count, value);
+        std::copy_backward(pos, sorted.begin() + count, sorted.begin() + count + 1);
+        *pos = value;
+        count++;
+    }
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] bool full() const { return count == window; }
+    [[nodiscard]] size_t windowSize() const { return window; }
+
+    /**
+     * Gets the median of the values in the window, the mean of the two middle values for an even number of values.
+     * @return The median, 0.0 if the window is empty.
+     */
+    [[nodiscard]] double median() const {
+        if (count == 0) {
+            return 0.0;
+        }
+        if (count % 2 == 1) {
+            return sorted[count / 2];
+        }
+        return 0.5 * (sorted[count / 2 - 1] + sorted[count / 2]);
+    }
+
+    /**
+     * Gets the median absolute deviation (MAD) of the values in the window.
+     * @return The MAD, 0.0 if the window is empty.
+     */
+    [[nodiscard]] double mad() const {
+        if (count == 0) {
+            return 0.0;
+        }
+        const double m = median();
+        const size_t split = std::lower_bound(sorted.begin(), sorted.begin() + count, m) - sorted.begin();
+        if (count % 2 == 1) {
+            return getDistance(count / 2, m, split);
+        }
+        return 0.5 * (getDistance(count / 2 - 1, m, split) + getDistance(count / 2, m, split));
+    }
+
+    /**
+     * Gets the MAD scaled to the standard deviation of normally distributed values.
+     * @return The scaled MAD.
+     */
+    [[nodiscard]] double sigma() const {
+        return MAD_TO_SIGMA * mad();
+    }
+
+private:
+    /**
+     * Finds the k-th smallest distance to the median by binary search in the two sorted sequences of distances.
+     * @param k The index of the distance in ascending order.
+     * @param m The median.
+     * @param split The index of the first value that is not smaller than the median.
+     * @return The distance.
+     */
+    [[nodiscard]] double getDistance(size_t k, double m, size_t split) const {
+        const size_t nBelow = split;
+        const size_t nAbove = count - split;
+        auto below = [&](size_t i) { return m - sorted[split - 1 - i]; };
+        auto above = [&](size_t i) { return sorted[split + i] - m; };
+
+        // Find how many of the k + 1 smallest distances are below the median.
+        size_t lo = (k + 1 > nAbove) ? k + 1 - nAbove : 0;
+        size_t hi = std::min(k + 1, nBelow);
+        while (lo < hi) {
+            const size_t i = (lo + hi) / 2;
+            if (below(i) < above(k - i)) {
+                lo = i + 1;
+            } else {
+                hi = i;
+            }
+        }
+        const double lowest = -std::numeric_limits<double>::infinity();
+        const size_t j = k + 1 - lo;
+        return std::max(lo > 0 ? below(lo - 1) : lowest, j > 0 ? above(j - 1) : lowest);
+    }
+
+    size_t window;                                          //!< Number of values the median is taken over.
+    size_t count = 0;                                       //!< Number of values in the window.
+    size_t oldest = 0;                                      //!< Position of the oldest value in values.
+    std::array<double, SLIDING_MEDIAN_CAPACITY> values{};   //!< The values in the order they were added (ring).
+    std::array<double, SLIDING_MEDIAN_CAPACITY> sorted{};   //!< The values in ascending order.
+};
+
+
+#endif //OBP_SLIDINGMEDIAN_H
@@ -0,0 +1,603 @@
+/**
+ * @file        WaveformExporter.cpp
+ * @brief       The implementation of the WaveformExporter class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include "common.h"
+#include "WaveformExporter.h"
+
+/**
+ * MIT annotation codes, see the WFDB documentation.
+ */
+static constexpr uint16_t MIT_NORMAL = 1;   //!< A normal beat.
+static constexpr uint16_t MIT_ARFCT = 16;   //!< An isolated artifact.
+static constexpr uint16_t MIT_NOTE = 22;    //!< A comment, with the text as aux string.
+static constexpr uint16_t MIT_SKIP = 59;    //!< The next four bytes hold an interval longer than 1023 samples.
+static constexpr uint16_t MIT_AUX = 63;     //!< The aux string of the annotation before.
+
+/**
+ * Formats a number with as many decimals as fit into a width.
+ * @param value The number.
+ * @param width The maximal number of characters.
+ * @return The number.
+ */
+static std::string formatNumber(double value, size_t width)
+{
+    char text[64];
+    for (int decimals = 10; decimals >= 0; --decimals)
+    {
+        std::snprintf(text, sizeof(text), "%.*f", decimals, value);
+        if (decimals > 0)
+        {
+            // Trailing zeros only take room.
+            char *last = text + std::strlen(text) - 1;
+            while (*last == '0')
+            {
+                *last-- = '\0';
+            }
+            if (*last == '.')
+            {
+                *last = '\0';
+            }
+        }
+        if (std::strlen(text) <= width)
+        {
+            break;
+        }
+    }
+    return text;
+}
+
+/**
+ * Pads a text with spaces to the width of a field of an EDF header, a longer text is cut.
+ * @param text The text.
+ * @param width The width of the field.
+ * @return The field.
+ */
+static std::string edfField(const std::string &text, size_t width)
+{
+    std::string field = text.substr(0, width);
+    field.resize(width, ' ');
+    return field;
+}
+
+/**
+ * Destructor of the WaveformExporter. Finishes the record if there is one.
+ */
+WaveformExporter::~WaveformExporter()
+{
+    close();
+}
+
+/**
+ * Starts a record. A record that is open is finished first.
+ * @param baseName The name of the record with the directory and without extension.
+ * @param format The format.
+ * @param samplingRate The sampling rate in Hz.
+ * @param signals The signals, each frame of samples holds one sample of each of them in this order.
+ * @param startTime The start of the recording, 0 if unknown.
+ * @return False if there are no signals, a file of the record exists already or the file could not be created.
+ */
+bool WaveformExporter::open(const std::string &baseName, WaveformFormat format, double samplingRate,
+                            const std::vector<WaveformSignal> &signals, std::time_t startTime)
+{
+    close();
+    if (signals.empty() || !(samplingRate > 0.0))
+    {
+        PLOG_WARNING << "Waveform record " << baseName << " needs signals and a sampling rate";
+        return false;
+    }
+    for (const std::string &fileName : getFileNames(baseName, format))
+    {
+        std::error_code error;
+        if (std::filesystem::exists(fileName, error) || error)
+        {
+            PLOG_WARNING << "Waveform record " << baseName << " would replace " << fileName;
+            return false;
+        }
+    }
+    this->baseName = baseName;
+    this->format = format;
+    this->samplingRate = samplingRate;
+    this->signals = signals;
+    this->startTime = startTime;
+
+    const int32_t digitalMax = format == WaveformFormat::wfdb212 ? 2047 : 32767;
+    conversions.clear();
+    for (const WaveformSignal &signal : signals)
+    {
+        // The smallest digital value is reserved for missing samples by WFDB.
+        Conversion conversion{};
+        conversion.min = -digitalMax;
+        conversion.max = digitalMax;
+        const double min = signal.min;
+        const double max = signal.max > signal.min ? signal.max : signal.min + 1.0;
+        const double range = 2.0 * digitalMax;
+        if (signal.gain > 0.0)
+        {
+            // The counts lose as many bits as needed to fit and are shifted to the middle of the digital range.
+            conversion.gain = signal.gain;
+            conversion.baseline = signal.baseline;
+            int bits = 0;
+            for (; (max - min) * conversion.gain > range; ++bits)
+            {
+                conversion.gain /= 2.0;
+                conversion.baseline /= 2.0;
+            }
+            conversion.gain = std::stod(formatNumber(conversion.gain, 20));
+            conversion.baseline = std::round(conversion.baseline);
+            const double low = conversion.baseline + min * conversion.gain;
+            const double high = conversion.baseline + max * conversion.gain;
+            if (low < conversion.min || high > conversion.max)
+            {
+                conversion.baseline -= std::round((low + high) / 2.0);
+                PLOG_INFO << "Signal " << signal.label << " loses " << bits << " bits of its counts and is shifted";
+            }
+        } else
+        {
+            if (signal.resolution > 0.0 && (max - min) / signal.resolution <= range)
+            {
+                conversion.gain = 1.0 / signal.resolution;
+            } else
+            {
+                if (signal.resolution > 0.0)
+                {
+                    PLOG_WARNING << "Signal " << signal.label << " does not fit at its resolution, it is scaled";
+                }
+                conversion.gain = range / (max - min);
+            }
+            // The gain is used as it is written to the header, the baseline of WFDB is an integer.
+            conversion.gain = std::stod(formatNumber(conversion.gain, 20));
+            conversion.baseline = std::round(conversion.min - min * conversion.gain);
+        }
+        conversion.physicalMin = (conversion.min - conversion.baseline) / conversion.gain;
+        conversion.physicalMax = (conversion.max - conversion.baseline) / conversion.gain;
+        if (format == WaveformFormat::edf)
+        {
+            // EDF converts with the physical range as written to the header.
+            conversion.physicalMin = std::stod(formatNumber(conversion.physicalMin, EDF_FIELD_WIDTH));
+            conversion.physicalMax = std::stod(formatNumber(conversion.physicalMax, EDF_FIELD_WIDTH));
+            conversion.gain = range / (conversion.physicalMax - conversion.physicalMin);
+            conversion.baseline = conversion.min - conversion.physicalMin * conversion.gain;
+        }
+        conversions.push_back(conversion);
+    }
+
+    const std::string fileName = baseName + (format == WaveformFormat::edf ? ".edf" : ".dat");
+    file = std::fopen(fileName.c_str(), "wbx");
+    if (file == nullptr)
+    {
+        PLOG_WARNING << "Could not create waveform record " << fileName;
+        return false;
+    }
+    success = true;
+    frames = 0;
+    hasPending = false;
+    annotations.clear();
+    comments.clear();
+    if (format == WaveformFormat::edf)
+    {
+        samplesPerRecord = (size_t) std::max(1.0, std::round(samplingRate));
+        record.assign(signals.size() * samplesPerRecord + EDF_ANNOTATION_BYTES / 2, 0);
+        recordFrames = 0;
+        records = 0;
+        nextAnnotation = 0;
+        // The number of data records is unknown until the file is closed.
+        const std::string header = getEdfHeader(0);
+        success = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    }
+    return success;
+}
+
+/**
+ * Adds a comment, for example the calibration. For EDF+, it has to be added before the samples.
+ * @param comment The comment.
+ */
+void WaveformExporter::addComment(const std::string &comment)
+{
+    if (format == WaveformFormat::edf)
+    {
+        addAnnotation(WaveformAnnotation{0, WaveformAnnotationType::note, comment});
+    } else
+    {
+        comments.push_back(comment);
+    }
+}
+
+/**
+ * Adds an annotation. For EDF+, it has to be added before the samples of its time, otherwise it is written to a later
+ * data record.
+ * @param annotation The annotation.
+ */
+void WaveformExporter::addAnnotation(const WaveformAnnotation &annotation)
+{
+    annotations.push_back(annotation);
+}
+
+/**
+ * Converts a physical value of a signal into a digital value and adds it to the checksum.
+ * @param signal The signal.
+ * @param value The physical value.
+ * @return The digital value, limited to the digital range.
+ */
+int32_t WaveformExporter::toDigital(size_t signal, double value)
+{
+    Conversion &conversion = conversions[signal];
+    const double digital = std::round(conversion.baseline + value * conversion.gain);
+    const int32_t sample = digital >= conversion.max ? conversion.max :
+                           digital > conversion.min ? (int32_t) digital : conversion.min;
+    if (frames == 0)
+    {
+        conversion.initial = sample;
+    }
+    conversion.checksum += (uint32_t) sample;
+    return sample;
+}
+
+/**
+ * Adds a block of frames. The block is converted and written at once.
+ * @param frames The frames, each with one sample of every signal.
+ * @param count The number of frames.
+ * @return False if no record is open or the samples could not be written.
+ */
+bool WaveformExporter::addSamples(const double *frames, size_t count)
+{
+    if (file == nullptr)
+    {
+        return false;
+    }
+    const size_t nsig = signals.size();
+    encoded.clear();
+    for (size_t frame = 0; frame < count; ++frame, ++this->frames)
+    {
+        for (size_t signal = 0; signal < nsig; ++signal)
+        {
+            const int32_t sample = toDigital(signal, frames[frame * nsig + signal]);
+            switch (format)
+            {
+                case WaveformFormat::wfdb16:
+                    encoded.push_back((uint8_t) (sample & 0xFF));
+                    encoded.push_back((uint8_t) ((sample >> 8) & 0xFF));
+                    break;
+                case WaveformFormat::wfdb212:
+                    // Two samples in three bytes, the high nibbles of both are in the middle byte.
+                    if (!hasPending)
+                    {
+                        pending = sample;
+                        hasPending = true;
+                    } else
+                    {
+                        encoded.push_back((uint8_t) (pending & 0xFF));
+                        encoded.push_back((uint8_t) (((sample >> 4) & 0xF0) | ((pending >> 8) & 0x0F)));
+                        encoded.push_back((uint8_t) (sample & 0xFF));
+                        hasPending = false;
+                    }
+                    break;
+                case WaveformFormat::edf:
+                    record[signal * samplesPerRecord + recordFrames] = (int16_t) sample;
+                    break;
+            }
+        }
+        if (format == WaveformFormat::edf && ++recordFrames == samplesPerRecord)
+        {
+            writeRecord(false);
+        }
+    }
+    if (!encoded.empty() && std::fwrite(encoded.data(), 1, encoded.size(), file) != encoded.size())
+    {
+        success = false;
+    }
+    return success;
+}
+
+/**
+ * Writes the current data record of an EDF+ file with the annotations up to its end. The last data record takes all
+ * remaining annotations that fit.
+ * @param last True for the last data record.
+ */
+void WaveformExporter::writeRecord(bool last)
+{
+    auto *annotationBytes = reinterpret_cast<char *>(record.data() + signals.size() * samplesPerRecord);
+    std::memset(annotationBytes, 0, EDF_ANNOTATION_BYTES);
+    const auto onset = [this](uint64_t sample) {
+        return "+" + formatNumber((double) sample / samplingRate, 20);
+    };
+
+    // Every data record starts with its time.
+    std::string tals = onset(records * samplesPerRecord) + "\x14\x14";
+    tals.push_back('\0');
+    std::stable_sort(annotations.begin() + (ptrdiff_t) nextAnnotation, annotations.end(),
+                     [](const WaveformAnnotation &a, const WaveformAnnotation &b) { return a.sample < b.sample; });
+    const uint64_t end = (records + 1) * samplesPerRecord;
+    for (; nextAnnotation < annotations.size() && (last || annotations[nextAnnotation].sample < end);
+           ++nextAnnotation)
+    {
+        const WaveformAnnotation &annotation = annotations[nextAnnotation];
+        std::string text = annotation.text;
+        if (text.empty())
+        {
+            text = annotation.type == WaveformAnnotationType::beat ? "Beat" :
+                   annotation.type == WaveformAnnotationType::artifact ? "Artifact" : "Note";
+        }
+        std::string tal = onset(annotation.sample) + "\x14" + text + "\x14";
+        tal.push_back('\0');
+        if (tals.size() + tal.size() > EDF_ANNOTATION_BYTES)
+        {
+            break;
+        }
+        tals += tal;
+    }
+    std::memcpy(annotationBytes, tals.data(), tals.size());
+
+    const size_t bytes = record.size() * sizeof(int16_t);
+    if (std::fwrite(record.data(), 1, bytes, file) != bytes)
+    {
+        success = false;
+    }
+    records++;
+    recordFrames = 0;
+}
+
+/**
+ * Finishes the record: writes the remaining samples and, for WFDB, the header and the annotations, for EDF+, the
+ * number of data records.
+ * @return False if no record was open or anything could not be written.
+ */
+bool WaveformExporter::close()
+{
+    if (file == nullptr)
+    {
+        return false;
+    }
+    if (format == WaveformFormat::wfdb212 && hasPending)
+    {
+        // The last sample of an odd number of samples takes two bytes.
+        const uint8_t bytes[2] = {(uint8_t) (pending & 0xFF), (uint8_t) ((pending >> 8) & 0x0F)};
+        success = success && std::fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+        hasPending = false;
+    }
+    if (format == WaveformFormat::edf)
+    {
+        // The last data record is filled up with the last samples.
+        if (recordFrames > 0 || records == 0)
+        {
+            for (size_t signal = 0; signal < signals.size(); ++signal)
+            {
+                int16_t *samples = record.data() + signal * samplesPerRecord;
+                std::fill(samples + recordFrames, samples + samplesPerRecord,
+                          recordFrames > 0 ? samples[recordFrames - 1] : (int16_t) 0);
+            }
+            writeRecord(true);
+        }
+        if (nextAnnotation < annotations.size())
+        {
+            PLOG_WARNING << annotations.size() - nextAnnotation << " annotations did not fit into " << baseName;
+        }
+        const std::string header = getEdfHeader(records);
+        success = success && std::fseek(file, 0, SEEK_SET) == 0 &&
+                  std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    }
+    success = std::fclose(file) == 0 && success;
+    file = nullptr;
+    if (format != WaveformFormat::edf)
+    {
+        success = writeWfdbHeader() && success;
+        success = (annotations.empty() || writeWfdbAnnotations()) && success;
+    }
+    if (!success)
+    {
+        PLOG_WARNING << "Could not write waveform record " << baseName;
+    }
+    return success;
+}
+
+/**
+ * @return True while a record is open.
+ */
+bool WaveformExporter::isOpen() const
+{
+    return file != nullptr;
+}
+
+/**
+ * @return The number of frames added to the record.
+ */
+uint64_t WaveformExporter::getFrameCount() const
+{
+    return frames;
+}
+
+/**
+ * Gets the extension of the file a record is opened with, the header for WFDB.
+ * @param format The format.
+ * @return The extension.
+ */
+std::string WaveformExporter::getExtension(WaveformFormat format)
+{
+    return format == WaveformFormat::edf ? ".edf" : ".hea";
+}
+
+/**
+ * Gets the name of the record of a recording, so the record cannot replace the recording or one of its other files.
+ * @param name The name of the recording with the directory and without extension.
+ * @param format The format.
+ * @return The name of the record, with WFDB_RECORD_SUFFIX for WFDB.
+ */
+std::string WaveformExporter::getRecordName(const std::string &name, WaveformFormat format)
+{
+    return format == WaveformFormat::edf ? name : name + WFDB_RECORD_SUFFIX;
+}
+
+/**
+ * Gets the names of all files of a record.
+ * @param baseName The name of the record with the directory and without extension.
+ * @param format The format.
+ * @return The names of the files.
+ */
+std::vector<std::string> WaveformExporter::getFileNames(const std::string &baseName, WaveformFormat format)
+{
+    if (format == WaveformFormat::edf)
+    {
+        return {baseName + ".edf"};
+    }
+    return {baseName + ".dat", baseName + ".hea", baseName + ".atr"};
+}
+
+/**
+ * Writes the header of a WFDB record: the record line, one line per signal and the comments.
+ * @return False if the header could not be written.
+ */
+bool WaveformExporter::writeWfdbHeader() const
+{
+    const size_t slash = baseName.find_last_of('/');
+    const std::string recordName = slash == std::string::npos ? baseName : baseName.substr(slash + 1);
+    std::string header = recordName + " " + std::to_string(signals.size()) + " " + formatNumber(samplingRate, 20) +
+                         " " + std::to_string(frames);
+    if (startTime != 0)
+    {
+        std::tm local{};
+        localtime_r(&startTime, &local);
+        char time[24];
+        std::strftime(time, sizeof(time), " %H:%M:%S %d/%m/%Y", &local);
+        header += time;
+    }
+    header += "\n";
+    const char *const formatName = format == WaveformFormat::wfdb212 ? " 212 " : " 16 ";
+    const char *const resolution = format == WaveformFormat::wfdb212 ? " 12 0 " : " 16 0 ";
+    for (size_t i = 0; i < signals.size(); ++i)
+    {
+        const Conversion &conversion = conversions[i];
+        header += recordName + ".dat" + formatName + formatNumber(conversion.gain, 20) + "(" +
+                  std::to_string((int32_t) conversion.baseline) + ")";
+        if (!signals[i].unit.empty())
+        {
+            header += "/" + signals[i].unit;
+        }
+        header += resolution + std::to_string(conversion.initial) + " " +
+                  std::to_string((int16_t) (uint16_t) conversion.checksum) + " 0 " + signals[i].label + "\n";
+    }
+    for (const std::string &comment : comments)
+    {
+        header += "# " + comment + "\n";
+    }
+
+    std::FILE *headerFile = std::fopen((baseName + ".hea").c_str(), "wx");
+    if (headerFile == nullptr)
+    {
+        return false;
+    }
+    const bool written = std::fwrite(header.data(), 1, header.size(), headerFile) == header.size();
+    return std::fclose(headerFile) == 0 && written;
+}
+
+/**
+ * Writes the annotations of a WFDB record in the MIT format: 16 bit words with the code in the upper 6 bits and the
+ * interval to the annotation before in the lower 10 bits.
+ * @return False if the annotations could not be written.
+ */
+bool WaveformExporter::writeWfdbAnnotations() const
+{
+    std::vector<WaveformAnnotation> sorted = annotations;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const WaveformAnnotation &a, const WaveformAnnotation &b) { return a.sample < b.sample; });
+    std::vector<uint8_t> bytes;
+    const auto addWord = [&bytes](uint32_t word) {
+        bytes.push_back((uint8_t) (word & 0xFF));
+        bytes.push_back((uint8_t) ((word >> 8) & 0xFF));
+    };
+    uint64_t previous = 0;
+    for (const WaveformAnnotation &annotation : sorted)
+    {
+        uint64_t interval = annotation.sample - previous;
+        if (interval > 1023)
+        {
+            // Longer intervals follow as 32 bit value, the high word first.
+            addWord(MIT_SKIP << 10);
+            addWord((uint32_t) (interval >> 16) & 0xFFFF);
+            addWord((uint32_t) interval & 0xFFFF);
+            interval = 0;
+        }
+        const uint16_t code = annotation.type == WaveformAnnotationType::beat ? MIT_NORMAL :
+                              annotation.type == WaveformAnnotationType::artifact ? MIT_ARFCT : MIT_NOTE;
+        addWord((uint32_t) (code << 10) | (uint32_t) interval);
+        if (!annotation.text.empty())
+        {
+            const size_t length = std::min<size_t>(annotation.text.size(), 255);
+            addWord((uint32_t) (MIT_AUX << 10) | (uint32_t) length);
+            bytes.insert(bytes.end(), annotation.text.begin(), annotation.text.begin() + (ptrdiff_t) length);
+            if (length % 2 != 0)
+            {
+                bytes.push_back(0);
+            }
+        }
+        previous = annotation.sample;
+    }
+    addWord(0);
+
+    std::FILE *annotationFile = std::fopen((baseName + ".atr").c_str(), "wbx");
+    if (annotationFile == nullptr)
+    {
+        return false;
+    }
+    const bool written = std::fwrite(bytes.data(), 1, bytes.size(), annotationFile) == bytes.size();
+    return std::fclose(annotationFile) == 0 && written;
+}
+
+/**
+ * Creates the header of an EDF+ file, the signals followed by the annotation signal.
+ * @param records The number of data records, 0 if still unknown.
+ * @return The header.
+ */
+std::string WaveformExporter::getEdfHeader(uint64_t records) const
+{
+    static const char *const months[] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV",
+                                         "DEC"};
+    std::string recording = "Startdate X X X X";
+    char date[16] = "01.01.85";
+    char time[16] = "00.00.00";
+    if (startTime != 0)
+    {
+        std::tm local{};
+        localtime_r(&startTime, &local);
+        char startdate[32];
+        std::snprintf(startdate, sizeof(startdate), "Startdate %02d-%s-%04d X X X", local.tm_mday,
+                      months[local.tm_mon], local.tm_year + 1900);
+        recording = startdate;
+        std::strftime(date, sizeof(date), "%d.%m.%y", &local);
+        std::strftime(time, sizeof(time), "%H.%M.%S", &local);
+    }
+
+    const size_t nsig = signals.size() + 1;
+    std::string header = edfField("0", 8) + edfField("X X X X", 80) + edfField(recording, 80) + date + time +
+                         edfField(std::to_string(256 * (nsig + 1)), 8) + edfField("EDF+C", 44) +
+                         edfField(records == 0 ? "-1" : std::to_string(records), 8) +
+                         edfField(formatNumber((double) samplesPerRecord / samplingRate, EDF_FIELD_WIDTH), 8) +
+                         edfField(std::to_string(nsig), 4);
+    // The fields of all signals follow each other, one field after the other.
+    const auto addFields = [&](size_t width, auto getSignal, const std::string &annotationField) {
+        for (size_t i = 0; i < signals.size(); ++i)
+        {
+            header += edfField(getSignal(i), width);
+        }
+        header += edfField(annotationField, width);
+    };
+    addFields(16, [this](size_t i) { return signals[i].label; }, "EDF Annotations");
+    addFields(80, [](size_t) { return std::string(); }, "");
+    addFields(8, [this](size_t i) { return signals[i].unit; }, "");
+    addFields(8, [this](size_t i) { return formatNumber(conversions[i].physicalMin, EDF_FIELD_WIDTH); }, "-1");
+    addFields(8, [this](size_t i) { return formatNumber(conversions[i].physicalMax, EDF_FIELD_WIDTH); }, "1");
+    addFields(8, [this](size_t i) { return std::to_string(conversions[i].min); }, "-32768");
+    addFields(8, [this](size_t i) { return std::to_string(conversions[i].max); }, "32767");
+    addFields(80, [](size_t) { return std::string(); }, "");
+    addFields(8, [this](size_t) { return std::to_string(samplesPerRecord); },
+              std::to_string(EDF_ANNOTATION_BYTES / 2));
+    addFields(32, [](size_t) { return std::string(); }, "");
+    return header;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file        WaveformExporter.h
+ * @brief       The header file of the WaveformExporter class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Defines the WaveformExporter class and contains the general class description.
+ */
+#ifndef OBP_WAVEFORMEXPORTER_H
+#define OBP_WAVEFORMEXPORTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/**
+ * Class dependant configuration values:
+ */
+#define EDF_ANNOTATION_BYTES    512     //!< The bytes for annotations in each data record of an EDF+ file.
+#define EDF_FIELD_WIDTH         8       //!< The width of the numeric fields of an EDF header.
+#define WFDB_RECORD_SUFFIX      "_wfdb" //!< Appended to the names of WFDB records, name.dat is a text recording.
+
+/**
+ * The formats the WaveformExporter writes.
+ */
+enum class WaveformFormat
+{
+    wfdb16,         //!< WFDB record with 16 bit samples (format 16) and MIT annotations.
+    wfdb212,        //!< WFDB record with 12 bit samples packed into 3 bytes per pair (format 212) and MIT annotations.
+    edf,            //!< EDF+ file with 16 bit samples and an annotation signal.
+};
+
+/**
+ * A signal of a waveform record. The physical range is mapped to the whole digital range of the format, unless a
+ * resolution or a calibration is given.
+ */
+struct WaveformSignal
+{
+    std::string label;              //!< The name of the signal.
+    std::string unit;               //!< The physical unit, for example mmHg.
+    double min = 0.0;               //!< The smallest physical value.
+    double max = 0.0;               //!< The largest physical value.
+    double resolution = 0.0;        //!< The physical value of one digital step, 0 to use the whole digital range.
+    double gain = 0.0;              //!< ADC counts per physical unit of the calibration, 0 if there is none.
+    double baseline = 0.0;          //!< The ADC count of the physical value 0, with the gain.
+};
+
+/**
+ * The kinds of annotations.
+ */
+enum class WaveformAnnotationType
+{
+    beat,           //!< A valid beat, at its peak.
+    artifact,       //!< A beat that was marked as artifact.
+    note,           //!< A text, for example the results of the measurement.
+};
+
+/**
+ * An annotation of a waveform record.
+ */
+struct WaveformAnnotation
+{
+    uint64_t sample;                //!< The sample number of the annotation.
+    WaveformAnnotationType type;    //!< The kind of annotation.
+    std::string text;               //!< The text, may be empty for beats and artifacts.
+};
+
+//! The WaveformExporter class writes recordings in standard formats for physiological waveforms.
+/*!
+ * The recordings can be exported as WFDB record (PhysioNet) with the samples in format 16 or 212, or as EDF+ file.
+ * The samples are handed over in blocks of frames, a frame holding one sample of every signal, and are converted into
+ * integers and encoded block by block, so a recording of any length is streamed to the file. The physical range of
+ * each signal is mapped to the digital range of the format, unless the signal has a resolution: ADC counts with a
+ * resolution of 1 are stored exactly, as long as their range fits. A signal with a calibration is stored as the ADC
+ * counts of its physical values, so the gain and the baseline of the record are those of the calibration. Counts that
+ * do not fit the format lose their lowest bits and are shifted into the digital range, as by an ADC with less bits,
+ * the baseline is the shifted count of the physical value 0 then.
+ *
+ * A WFDB record consists of the signal file name.dat, the header name.hea, which is written when the record is
+ * closed, as it holds the number of samples and the checksums, and the annotations name.atr. The comments are added
+ * to the header. As name.dat is also the name of a text recording, getRecordName() appends WFDB_RECORD_SUFFIX to the
+ * names of WFDB records. A record is never written over existing files, open() fails if any of them exists.
+ *
+ * An EDF+ file consists of data records of one second. Each of them holds the samples of all signals and the
+ * annotations that fall into it in the annotation signal, annotations have to be added before the samples of their
+ * time therefore. The comments are annotations at the start. The number of data records is written when the file is
+ * closed.
+ */
+class WaveformExporter {
+
+public:
+    WaveformExporter() = default;
+    ~WaveformExporter();
+    WaveformExporter(const WaveformExporter &) = delete;
+    WaveformExporter &operator=(const WaveformExporter &) = delete;
+
+    bool open(const std::string &baseName, WaveformFormat format, double samplingRate,
+              const std::vector<WaveformSignal> &signals, std::time_t startTime);
+    void addComment(const std::string &comment);
+    void addAnnotation(const WaveformAnnotation &annotation);
+    bool addSamples(const double *frames, size_t count);
+    bool close();
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] uint64_t getFrameCount() const;
+
+    static std::string getExtension(WaveformFormat format);
+    static std::string getRecordName(const std::string &name, WaveformFormat format);
+    static std::vector<std::string> getFileNames(const std::string &baseName, WaveformFormat format);
+
+private:
+    //! The conversion of the physical values of a signal into digital values.
+    struct Conversion {
+        double gain;                //!< Digital values per physical unit.
+        double baseline;            //!< The digital value of the physical value 0.
+        int32_t min;                //!< The smallest digital value.
+        int32_t max;                //!< The largest digital value.
+        double physicalMin;         //!< The physical value of min.
+        double physicalMax;         //!< The physical value of max.
+        int32_t initial = 0;        //!< The first digital value.
+        uint32_t checksum = 0;      //!< The sum of all digital values.
+    };
+
+    [[nodiscard]] int32_t toDigital(size_t signal, double value);
+    void writeRecord(bool last);
+    bool writeWfdbHeader() const;
+    bool writeWfdbAnnotations() const;
+    [[nodiscard]] std::string getEdfHeader(uint64_t records) const;
+
+    WaveformFormat format = WaveformFormat::wfdb16;     //!< The format of the open record.
+    std::string baseName;                               //!< The name of the record without extension.
+    double samplingRate = 0.0;                          //!< The sampling rate in Hz.
+    std::time_t startTime = 0;                          //!< The start of the recording, 0 if unknown.
+    std::vector<WaveformSignal> signals;                //!< The signals.
+    std::vector<Conversion> conversions;                //!< The conversions of the signals.
+    std::vector<WaveformAnnotation> annotations;        //!< The annotations.
+    std::vector<std::string> comments;                  //!< The comments.
+    std::FILE *file = nullptr;                          //!< The file of the samples, nullptr if closed.
+    bool success = true;                                //!< All samples were written.
+    uint64_t frames = 0;                                //!< The number of frames added.
+    std::vector<uint8_t> encoded;                       //!< The encoded samples of the current block.
+
+    /**
+     * Format 212:
+     */
+    bool hasPending = false;                            //!< A sample waits for the second sample of its pair.
+    int32_t pending = 0;                                //!< The first sample of the pair.
+
+    /**
+     * EDF+:
+     */
+    size_t samplesPerRecord = 0;                        //!< The samples of each signal in a data record.
+    std::vector<int16_t> record;                        //!< The samples of the current data record.
+    size_t recordFrames = 0;                            //!< The frames in the current data record.
+    uint64_t records = 0;                               //!< The number of data records written.
+    size_t nextAnnotation = 0;                          //!< The first annotation not written to a data record.
+};
+
+
+#endif //OBP_WAVEFORMEXPORTER_H
@@ -334,6 +334,9 @@ QWidget *Window::setupDeflatePage(QWidget *parent)
     lheartRate = new QLabel(parent);
     lheartRate->setObjectName(QString::fromUtf8("lheartRate"));
     lheartRate->setAlignment(Qt::AlignCenter);
+    lDeflationRate = new QLabel(parent);
+    lDeflationRate->setObjectName(QString::fromUtf8("lDeflationRate"));
+    lDeflationRate->setAlignment(Qt::AlignCenter);
 
     vSpace4 = new QSpacerItem(20, 40, QSizePolicy::Minimum, QSizePolicy::Expanding);
     vSpace5 = new QSpacerItem(20, 40, QSizePolicy::Minimum, QSizePolicy::Expanding);
@@ -341,6 +344,7 @@ QWidget *Window::setupDeflatePage(QWidget *parent)
     vlRelease->addItem(vSpace5);
     vlRelease->addWidget(lInfoRelease);
     vlRelease->addItem(vSpace4);
+    vlRelease->addWidget(lDeflationRate);
     vlRelease->addWidget(lheartRate);
 
     lInstrRelease->setLayout(vlRelease);
@@ -436,6 +440,9 @@ QWidget *Window::setupResultPage(QWidget *parent)
     lHRvalAV->setAlignment(Qt::AlignRight);
     lDBPval->setAlignment(Qt::AlignRight);
     lSBPval->setAlignment(Qt::AlignRight);
+    lConfidence = new QLabel(parent);
+    lConfidence->setObjectName(QString::fromUtf8("lConfidence"));
+    lConfidence->setWordWrap(true);
 
     flResults->setWidget(0, QFormLayout::LabelRole, lMeasured);
     flResults->setWidget(1, QFormLayout::LabelRole, lMAP);
@@ -447,6 +454,7 @@ QWidget *Window::setupResultPage(QWidget *parent)
     flResults->setWidget(5, QFormLayout::FieldRole, lDBPval);
     flResults->setWidget(2, QFormLayout::LabelRole, lheartRateAV);
     flResults->setWidget(2, QFormLayout::FieldRole, lHRvalAV);
+    flResults->setWidget(6, QFormLayout::SpanningRole, lConfidence);
     flResults->setContentsMargins(50, 0, 50, 0);
 
     vlResult->addItem(vSpace6);
@@ -503,7 +511,9 @@ void Window::retranslateUi(QMainWindow *window)
     lInfoPump->setText(QString("<b>Pump-up to %1 mmHg</b><br><br>"
                                "Using your dominant hand, where your arm is not in the cuff, quickly pump up the cuff to %1 mmHg.<br><br>"
                                "The valve should stay fully closed.<br>"
-                               "Use the dial above for reference.").arg(pumpUpVal));
+                               "Use the dial above for reference.%2").arg(pumpUpVal)
+                               .arg(adaptiveInflate ? "<br><br>Pause for about 5 s while pumping, the "
+                                                      "measurement may start before the value is reached." : ""));
 
     lInfoRelease->setText("<b>Slowly and continuously release pressure.</b><br><br>"
                           "Open the valve slightly to release pressure at approximately 3 mmHg/s.<br>"
@@ -526,6 +536,7 @@ void Window::retranslateUi(QMainWindow *window)
     lDBP->setText(QString("<b>DBP (r=%1):</b>").arg(process->getRatioDBP()));
     lDBPval->setText("- mmHg");
     lheartRate->setText("Current heart rate:<br><b>--</b>");
+    lDeflationRate->setText("Deflation rate:<br><b>--</b>");
     lheartRateAV->setText("Heart rate:");
     lHRvalAV->setText("- beats/min");
     lEstimated->setText("estimated:");
@@ -636,6 +647,30 @@ void Window::eResults(double map, double sbp, double dbp)
     bOk = QMetaObject::invokeMethod(lDBPval, "setText", Qt::QueuedConnection,
                                     Q_ARG(QString, QString::number(dbp, 'f', 0) + " mmHg"));
     assert(bOk);
+    // The confidence intervals of the previous measurement are no longer valid.
+    bOk = QMetaObject::invokeMethod(lConfidence, "setText", Qt::QueuedConnection, Q_ARG(QString, QString()));
+    assert(bOk);
+}
+
+/**
+ * Handles notifications for the confidence intervals of the results and shows them below the results.
+ * @param map The confidence interval of the mean arterial pressure.
+ * @param sbp The confidence interval of the systolic blood pressure.
+ * @param dbp The confidence interval of the diastolic blood pressure, 0.0 if not available.
+ */
+void Window::eConfidence(ConfidenceInterval map, ConfidenceInterval sbp, ConfidenceInterval dbp)
+{
+    auto format = [](const ConfidenceInterval &interval) {
+        if (interval.lower == 0.0 && interval.upper == 0.0)
+        {
+            return QString("-");
+        }
+        return QString::number(interval.lower, 'f', 0) + "-" + QString::number(interval.upper, 'f', 0) + " mmHg";
+    };
+    bool bOk = QMetaObject::invokeMethod(lConfidence, "setText", Qt::QueuedConnection,
+                                         Q_ARG(QString, "95 % confidence intervals:<br>MAP " + format(map) +
+                                                        ", SBP " + format(sbp) + ", DBP " + format(dbp)));
+    assert(bOk);
 }
 
 /**
@@ -654,6 +689,38 @@ void Window::eHeartRate(double heartRate)
     assert(bOk);
 }
 
+/**
+ * Handles notifications about the deflation rate and shows the guidance on the deflate screen.
+ * @param rate The current deflation rate in mmHg/s.
+ * @param guidance The guidance for the user derived from the rate.
+ */
+void Window::eDeflationRate(double rate, DeflationGuidance guidance)
+{
+    QString advice;
+    switch (guidance)
+    {
+        case DeflationGuidance::unknown:
+            advice = "--";
+            break;
+        case DeflationGuidance::tooSlow:
+            advice = "<font color=\"orange\">too slow, open the valve a bit more</font>";
+            break;
+        case DeflationGuidance::good:
+            advice = "<font color=\"green\">good</font>";
+            break;
+        case DeflationGuidance::tooFast:
+            advice = "<font color=\"red\">too fast, close the valve a bit</font>";
+            break;
+        case DeflationGuidance::irregular:
+            advice = "<font color=\"red\">irregular, do not move the valve</font>";
+            break;
+    }
+    bool bOk = QMetaObject::invokeMethod(lDeflationRate, "setText", Qt::QueuedConnection,
+                                         Q_ARG(QString, "Deflation rate: " + QString::number(rate, 'f', 1) +
+                                                        " mmHg/s<br><b>" + advice + "</b>"));
+    assert(bOk);
+}
+
 /**
  * Handles the notification that the observed class is ready.
  */
@@ -741,7 +808,7 @@ void Window::loadSettings()
 {
     /** For every value: get the values from settings and get the default value from Processing.
     * Then set both the value in the settings dialog and in Processing with what was stored in the settings.
-    * Changing the values in Processing only works at startup, before the process is running.
+    * Processing applies the values at the start of the next measurement.
     */
     int iVal;
     double dVal;
@@ -762,24 +829,76 @@ void Window::loadSettings()
     settingsDialog->setPumpUpValue(iVal);
     process->setPumpUpValue(iVal);
     pumpUpVal = iVal;
+
+    iVal = settings.value("algorithm", (int) process->getAlgorithm()).toInt();
+    settingsDialog->setAlgorithm(iVal);
+    process->setAlgorithm((DetectionAlgorithm) iVal);
+
+    bool bVal = settings.value("predictive", process->getPredictive()).toBool();
+    settingsDialog->setPredictive(bVal);
+    process->setPredictive(bVal);
+
+    bVal = settings.value("adaptiveInflate", process->getAdaptiveInflate()).toBool();
+    settingsDialog->setAdaptiveInflate(bVal);
+    process->setAdaptiveInflate(bVal);
+    adaptiveInflate = bVal;
+
+    bVal = settings.value("bootstrap", process->getBootstrap()).toBool();
+    settingsDialog->setBootstrap(bVal);
+    process->setBootstrap(bVal);
+
+    bVal = settings.value("binaryRecording", process->getBinaryRecording()).toBool();
+    settingsDialog->setBinaryRecording(bVal);
+    process->setBinaryRecording(bVal);
+
+    bVal = settings.value("debugRecording", process->getDebugRecording()).toBool();
+    settingsDialog->setDebugRecording(bVal);
+    process->setDebugRecording(bVal);
 }
 
 /**
- * Does only update the values in the settings file. They will not be applied until the
- * application is restarted.
+ * Updates the values in the settings file and hands them to Processing. They are applied at the start of the next
+ * measurement.
  */
 void Window::updateValues()
 {
+    ProcessingConfig config;
+    config.ratioSBP = settingsDialog->getRatioSBP();
+    config.ratioDBP = settingsDialog->getRatioDBP();
+    config.minNbrPeaks = settingsDialog->getMinNbrPeaks();
+    config.mmHgInflate = settingsDialog->getPumpUpValue();
+    config.algorithm = (DetectionAlgorithm) settingsDialog->getAlgorithm();
+    config.predictive = settingsDialog->getPredictive();
+    config.adaptiveInflate = settingsDialog->getAdaptiveInflate();
+    config.bootstrap = settingsDialog->getBootstrap();
+    config.binaryRecording = settingsDialog->getBinaryRecording();
+    config.debugRecording = settingsDialog->getDebugRecording();
+    if (!process->setConfig(config))
+    {
+        // Show the values that are still in use.
+        loadSettings();
+        return;
+    }
+
     QSettings settings;
-    settings.setValue("ratioSBP", settingsDialog->getRatioSBP());
-    settings.setValue("ratioDBP", settingsDialog->getRatioDBP());
-    settings.setValue("minNbrPeaks", settingsDialog->getMinNbrPeaks());
-    settings.setValue("pumpUpValue", settingsDialog->getPumpUpValue());
+    settings.setValue("ratioSBP", config.ratioSBP);
+    settings.setValue("ratioDBP", config.ratioDBP);
+    settings.setValue("minNbrPeaks", config.minNbrPeaks);
+    settings.setValue("pumpUpValue", (int) config.mmHgInflate);
+    settings.setValue("algorithm", (int) config.algorithm);
+    settings.setValue("predictive", config.predictive);
+    settings.setValue("adaptiveInflate", config.adaptiveInflate);
+    settings.setValue("bootstrap", config.bootstrap);
+    settings.setValue("binaryRecording", config.binaryRecording);
+    settings.setValue("debugRecording", config.debugRecording);
+    pumpUpVal = (int) config.mmHgInflate;
+    adaptiveInflate = config.adaptiveInflate;
+    retranslateUi(this);
 }
 
 /**
  * Resets all values both in the application and in the settings file.
- * Changes take effect immediately.
+ * Changes take effect at the start of the next measurement.
  */
 void Window::resetValuesPerform()
 {
@@ -789,6 +908,12 @@ void Window::resetValuesPerform()
     settings.setValue("ratioDBP", process->getRatioDBP());
     settings.setValue("minNbrPeaks", process->getMinNbrPeaks());
     settings.setValue("pumpUpValue", process->getPumpUpValue());
+    settings.setValue("algorithm", (int) process->getAlgorithm());
+    settings.setValue("predictive", process->getPredictive());
+    settings.setValue("adaptiveInflate", process->getAdaptiveInflate());
+    settings.setValue("bootstrap", process->getBootstrap());
+    settings.setValue("binaryRecording", process->getBinaryRecording());
+    settings.setValue("debugRecording", process->getDebugRecording());
     // Reload the values from settings also writes them to the settings dialog:
     loadSettings();
     retranslateUi(this);
@@ -67,7 +67,9 @@ private:
     void eNewData(double pData, double oData) override;
     void eSwitchScreen(Screen eNewScreen) override;
     void eResults(double map, double sbp, double dbp) override;
+    void eConfidence(ConfidenceInterval map, ConfidenceInterval sbp, ConfidenceInterval dbp) override;
     void eHeartRate(double map) override;
+    void eDeflationRate(double rate, DeflationGuidance guidance) override;
     void eReady() override;
 
     // Setting up the UI:
@@ -91,6 +93,7 @@ private:
     yHPData[MAX_DATA_LENGTH];         //!< Y-axis of the high-pass filtered data.
     int dataLength;                   //!< Length of the shown data. Possibility to change zoom.
     int pumpUpVal;                    //!< Pump-up value used to display required pressure.
+    bool adaptiveInflate = false;     //!< The pump-up value is lowered if the oscillations vanished.
 
     // Variables that are changed from outside the UI are made
     // atomic, so access to them is thread safe.
@@ -134,6 +137,7 @@ private:
     QPushButton *btnReset;
     QPushButton *btnCancel;
     QLabel *lheartRate;
+    QLabel *lDeflationRate;
     QLabel *lheartRateAV;
     QLabel *lHRvalAV;
     QLabel *lMeasured;
@@ -144,6 +148,7 @@ private:
     QLabel *lSBPval;
     QLabel *lDBP;
     QLabel *lDBPval;
+    QLabel *lConfidence;
     Plot *pltPre;
     Plot *pltOsc;
     QFrame *line;
@@ -48,5 +48,26 @@ enum class Screen
     resultScreen,     //!< The screen showing the results.
 };
 
+/**
+ * Enum to describe the guidance for the user about the deflation rate.
+ */
+enum class DeflationGuidance
+{
+    unknown,          //!< Not enough data to estimate the rate yet.
+    tooSlow,          //!< The cuff is deflated too slowly.
+    good,             //!< The deflation rate is within the recommended range.
+    tooFast,          //!< The cuff is deflated too fast.
+    irregular,        //!< The pressure does not fall steadily.
+};
+
+/**
+ * A confidence interval of a result in mmHg. Both bounds are 0.0 if the interval could not be calculated.
+ */
+struct ConfidenceInterval
+{
+    double lower = 0.0;     //!< The lower bound.
+    double upper = 0.0;     //!< The upper bound.
+};
+
 
 #endif //OBP_COMMON_H
@@ -0,0 +1,131 @@
+/**
+ * @file        test_ArtifactTolerance.cpp
+ * @brief       Artifact tolerance test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Tests that single artifacts do not discard the beats found so far.
+ * The sample data in 'p.dat' and 'o.dat' is analysed as recorded and with three disturbances after the MAP: a spike
+ * between two beats, as caused by a movement of the arm, a beat that is too small to be detected and a beat that is
+ * twice as large as it should be. The test passes if all disturbed measurements finish without a restart and the
+ * results are within 2 mmHg of the undisturbed ones.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+
+#define MAX_DIFFERENCE 2.0 //!< Max. difference of the results to the undisturbed measurement in mmHg.
+
+/**
+ * Analyses the disturbed data and compares the results to the undisturbed ones.
+ * @param name The name of the disturbance, printed with the results.
+ * @param pData The pressure data.
+ * @param oData The disturbed oscillation data.
+ * @param reference The results of the undisturbed data.
+ * @param artifacts The number of beats expected to be marked as artifacts.
+ * @return True if the results match.
+ */
+bool check(const char *name, const std::vector<double> &pData, const std::vector<double> &oData,
+           const OBPResult &reference, size_t artifacts)
+{
+    OBPDetection obpDetect(1000.0);
+    OBPResult result = obpDetect.analyze(pData, oData);
+    std::cout << name << ": " << result.map << " " << result.sbp << " " << result.dbp << ", " << result.artifacts
+              << " artifact(s), " << result.restarts << " restart(s)" << std::endl;
+    return result.finished && result.restarts == 0 && result.artifacts == artifacts &&
+           std::abs(result.map - reference.map) < MAX_DIFFERENCE &&
+           std::abs(result.sbp - reference.sbp) < MAX_DIFFERENCE &&
+           std::abs(result.dbp - reference.dbp) < MAX_DIFFERENCE;
+}
+
+int main()
+{
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+    }
+
+    OBPDetection obpDetect(1000.0);
+    const OBPResult reference = obpDetect.analyze(pData, oData);
+    std::cout << "undisturbed: " << reference.map << " " << reference.sbp << " " << reference.dbp << std::endl;
+
+    int ret = 0;
+    if (!reference.finished || reference.restarts != 0)
+    {
+        ret = 1;
+    }
+
+    // The first beat after the MAP that is followed by at least two more beats.
+    size_t beat = 0;
+    while (beat + 3 < reference.beats.size() && reference.beats.peakTime(beat) <= reference.mapTime)
+    {
+        beat++;
+    }
+    const size_t peak1 = reference.beats.peakTime(beat) - 1;
+    const size_t peak2 = reference.beats.peakTime(beat + 1) - 1;
+    const size_t peak3 = reference.beats.peakTime(beat + 2) - 1;
+
+    // A spike of five times the largest peak halfway between two beats.
+    std::vector<double> spike(oData);
+    const double height = 5.0 * *std::max_element(reference.beats.peakAmplitudeColumn(),
+                                                  reference.beats.peakAmplitudeColumn() + reference.beats.size());
+    const size_t center = (peak1 + peak2) / 2;
+    for (size_t i = center - 40; i <= center + 40; ++i)
+    {
+        const double x = ((double) i - (double) center) / 15.0;
+        spike[i] += height * std::exp(-0.5 * x * x);
+    }
+    if (!check("spike", pData, spike, reference, 1))
+    {
+        ret = 1;
+    }
+
+    // The beat between two troughs is damped below the prominence.
+    std::vector<double> missed(oData);
+    const auto trough1 = std::min_element(oData.begin() + (long) peak1, oData.begin() + (long) peak2);
+    const auto trough2 = std::min_element(oData.begin() + (long) peak2, oData.begin() + (long) peak3);
+    for (auto i = trough1; i != trough2; ++i)
+    {
+        missed[std::distance(oData.begin(), i)] = 0.1 * *i;
+    }
+    if (!check("missed beat", pData, missed, reference, 0))
+    {
+        ret = 1;
+    }
+
+    // The peak of the same beat is twice as large, which is not an artifact, but an outlier of the envelope.
+    std::vector<double> large(oData);
+    for (auto i = trough1; i != trough2; ++i)
+    {
+        if (*i > 0.0)
+        {
+            large[std::distance(oData.begin(), i)] = 2.0 * *i;
+        }
+    }
+    if (!check("large beat", pData, large, reference, 0))
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
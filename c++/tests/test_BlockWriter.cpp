@@ -0,0 +1,115 @@
+/**
+ * @file        test_BlockWriter.cpp
+ * @brief       BlockWriter test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Hands numbered jobs with buffers to a BlockWriter, swapping the buffers with spare ones as the Datarecord does. The
+ * jobs have to be written in the order they were added, waitForDone() must only return when all of them are written and
+ * all buffers are back with the spare ones, and stop() has to write the jobs that are still pending. The test passes if
+ * all checks succeed.
+ */
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include "../BlockWriter.h"
+
+#define TEST_JOBS   1000    //!< The number of jobs of each pass.
+#define TEST_BLOCK  64      //!< The number of values of each job.
+
+/**
+ * A job of the test.
+ */
+struct TestJob
+{
+    size_t number = 0;              //!< The number of the job.
+    std::vector<double> values;     //!< The buffer of the job.
+};
+
+int main()
+{
+    int ret = 0;
+    std::vector<size_t> written;
+    size_t allocations[2] = {0, 0};
+    std::vector<std::vector<double>> spare;
+    std::vector<double> block;
+    {
+        BlockWriter<TestJob> writer([&written](TestJob &job) {
+            // Slow enough that jobs are pending when they are added.
+            if (job.number % 100 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (job.values.size() == TEST_BLOCK && job.values[0] == (double) job.number)
+            {
+                written.push_back(job.number);
+            }
+        }, [&spare](TestJob &job) {
+            job.values.clear();
+            spare.push_back(std::move(job.values));
+        });
+
+        for (size_t pass = 0; pass < 2; ++pass)
+        {
+            for (size_t i = 0; i < TEST_JOBS; ++i)
+            {
+                block.assign(TEST_BLOCK, (double) (pass * TEST_JOBS + i));
+                TestJob job;
+                job.number = pass * TEST_JOBS + i;
+                writer.add(job, [&](TestJob &added) {
+                    added.values.swap(block);
+                    if (!spare.empty())
+                    {
+                        block.swap(spare.back());
+                        spare.pop_back();
+                    } else
+                    {
+                        allocations[pass]++;
+                    }
+                });
+            }
+            if (pass == 0)
+            {
+                writer.waitForDone();
+                if (written.size() != TEST_JOBS)
+                {
+                    std::cout << "waitForDone() returned before all jobs were written" << std::endl;
+                    ret = 1;
+                }
+                // Each job without a spare buffer brought one more buffer into use, all but the next block are spare.
+                if (spare.size() != allocations[0])
+                {
+                    std::cout << "Buffers not returned" << std::endl;
+                    ret = 1;
+                }
+            }
+        }
+        writer.stop();
+    }
+
+    bool ordered = written.size() == 2 * TEST_JOBS;
+    for (size_t i = 0; ordered && i < written.size(); ++i)
+    {
+        ordered = written[i] == i;
+    }
+    if (!ordered)
+    {
+        std::cout << "Jobs not written in order or lost at stop()" << std::endl;
+        ret = 1;
+    }
+    std::cout << allocations[0] << " and " << allocations[1] << " of " << TEST_JOBS << " jobs needed a new buffer"
+              << std::endl;
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file        test_DebugRecord.cpp
+ * @brief       DebugRecord and DebugRecordReader test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * The pressure and oscillation of p.dat and o.dat are recorded as debug recording, together with ADC counts, state
+ * transitions and a few beats. The DebugRecordReader has to return every stream to float precision, also a part in
+ * the middle of the recording, all events at the right samples and the range of the ADC. A recording of version 1
+ * has to be read without the range. A chunk of an unknown stream has to be skipped and a truncated copy has to be
+ * read up to its last complete chunk. The time the acquisition thread spends per sample is printed. The test passes
+ * if all checks succeed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include "../DebugRecord.cpp"
+#include "../DebugRecordReader.cpp"
+
+#define TEST_FILE       "test_debug.obd"    //!< The temporary recording, removed at the end.
+#define TEST_FILE_V1    "test_debug_v1.obd" //!< The temporary recording of version 1, removed at the end.
+#define OFFSET          10000               //!< The sample at which the deflation starts in the test.
+
+/**
+ * Compares a stream with the values that were recorded.
+ * @param read The values read.
+ * @param written The values written, as doubles.
+ * @param first The first sample of the values read.
+ * @return True if all values are equal to float precision.
+ */
+bool isEqual(const std::vector<double> &read, const std::vector<double> &written, size_t first)
+{
+    for (size_t i = 0; i < read.size(); ++i)
+    {
+        if (read[i] != (double) (float) written[first + i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Gets the size of a file.
+ * @param fileName The name of the file.
+ * @return The size in bytes.
+ */
+size_t getFileSize(const char *fileName)
+{
+    std::ifstream in(fileName, std::ios::binary | std::ios::ate);
+    return (size_t) in.tellg();
+}
+
+int main()
+{
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
+    std::vector<double> rawData;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+        rawData.push_back(std::round(vP * 1000.0));
+    }
+
+    int ret = 0;
+    BeatTable beats;
+    beats.addBeat(100, 1.5);
+    beats.setTrough(0, 400, -1.0);
+    beats.addBeat(900, 1.7);
+    beats.setHeartRate(1, 75.0, BeatType::Valid);
+    Envelope envelope;
+    envelope.addPoint(100, 2.5);
+    envelope.addPoint(900, 2.7);
+
+    double addTime;
+    {
+        DebugRecord debugRecord(1000.0, 0xFFFFFF, -1.325, 1.325);
+        debugRecord.startRecording(TEST_FILE, 195.0, 0.42);
+        debugRecord.addEvent(DebugStream::state, 2.0, 2);
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pData.size(); ++i)
+        {
+            if (i == OFFSET)
+            {
+                debugRecord.addEvent(DebugStream::state, 3.0, 3);
+            }
+            debugRecord.addSample((int) rawData[i], pData[i], pData[i], oData[i]);
+        }
+        addTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        debugRecord.addBeats(beats, envelope, OFFSET);
+        if (debugRecord.getSampleCount() != pData.size() || !debugRecord.isRecording())
+        {
+            std::cout << "Sample count does not match" << std::endl;
+            ret = 1;
+        }
+        debugRecord.stopRecording();
+        debugRecord.waitForSaved();
+    }
+    std::cout << "Adding a sample takes " << addTime / (double) pData.size() * 1e9 << " ns" << std::endl;
+
+    DebugRecordReader reader(TEST_FILE);
+    const DebugHeader &header = reader.getHeader();
+    if (!reader.isOpen() || header.samplingRate != 1000.0 || header.mmHgPerVolt != 195.0 ||
+        header.ambientVoltage != 0.42 || header.maxData != 0xFFFFFF || header.rangeMin != -1.325 ||
+        header.rangeMax != 1.325 || reader.getSampleCount() != pData.size())
+    {
+        std::cout << "Header does not match" << std::endl;
+        ret = 1;
+    }
+    const std::vector<double> raw = reader.getStream(DebugStream::raw);
+    const std::vector<double> mmHg = reader.getStream(DebugStream::mmHg);
+    const std::vector<double> highPass = reader.getStream(DebugStream::highPass);
+    const std::vector<double> part = reader.getStream(DebugStream::highPass, 12345, 1000);
+    if (raw != rawData || mmHg.size() != pData.size() || !isEqual(mmHg, pData, 0) ||
+        highPass.size() != oData.size() || !isEqual(highPass, oData, 0) || part.size() != 1000 ||
+        !isEqual(part, oData, 12345) || !reader.getStream(DebugStream::peaks).empty())
+    {
+        std::cout << "Streams do not match" << std::endl;
+        ret = 1;
+    }
+
+    const std::vector<DebugEvent> states = reader.getEvents(DebugStream::state);
+    const std::vector<DebugEvent> peaks = reader.getEvents(DebugStream::peaks);
+    const std::vector<DebugEvent> troughs = reader.getEvents(DebugStream::troughs);
+    const std::vector<DebugEvent> points = reader.getEvents(DebugStream::envelope);
+    if (states.size() != 2 || states[0].sample != 0 || states[0].flags != 2 || states[1].sample != OFFSET ||
+        states[1].value != 3.0f || peaks.size() != 2 || peaks[1].sample != OFFSET + 900 || peaks[1].value != 1.7f ||
+        peaks[1].flags != (uint32_t) BeatType::Valid || troughs.size() != 1 || troughs[0].sample != OFFSET + 400 ||
+        points.size() != 2 || points[0].value != 2.5f || !reader.getEvents(DebugStream::raw).empty())
+    {
+        std::cout << "Events do not match" << std::endl;
+        ret = 1;
+    }
+    reader.close();
+
+    // A chunk of a stream added later has to be skipped.
+    {
+        std::ofstream out(TEST_FILE, std::ios::binary | std::ios::app);
+        const DebugChunk unknown{(DebugStream) 100, 24, 0};
+        const char values[24] = {};
+        out.write(reinterpret_cast<const char *>(&unknown), sizeof(unknown));
+        out.write(values, sizeof(values));
+    }
+    if (!reader.open(TEST_FILE) || reader.getSampleCount() != pData.size() ||
+        reader.getEvents(DebugStream::envelope).size() != 2)
+    {
+        std::cout << "Unknown stream not skipped" << std::endl;
+        ret = 1;
+    }
+    reader.close();
+
+    // A recording of version 1 has a shorter header without the range of the ADC.
+    {
+        std::ifstream in(TEST_FILE, std::ios::binary);
+        std::vector<char> content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        DebugHeader oldHeader = DebugHeader::create(1000.0, 195.0, 0.42, 0, 0.0, 0.0);
+        oldHeader.version = 1;
+        oldHeader.headerSize = DEBUG_HEADER_SIZE_V1;
+        std::ofstream out(TEST_FILE_V1, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&oldHeader), DEBUG_HEADER_SIZE_V1);
+        out.write(content.data() + sizeof(DebugHeader), (std::streamsize) (content.size() - sizeof(DebugHeader)));
+    }
+    if (!reader.open(TEST_FILE_V1) || reader.getHeader().mmHgPerVolt != 195.0 || reader.getHeader().maxData != 0 ||
+        reader.getHeader().rangeMax != 0.0 || reader.getSampleCount() != pData.size())
+    {
+        std::cout << "Recording of version 1 not read" << std::endl;
+        ret = 1;
+    }
+    reader.close();
+    std::remove(TEST_FILE_V1);
+
+    // An interrupted recording ends within a chunk.
+    {
+        std::ifstream in(TEST_FILE, std::ios::binary);
+        std::vector<char> content(sizeof(DebugHeader) + 10 * (4 * sizeof(DebugChunk) + 4 * 4 * DEBUG_BLOCK_SIZE) + 100);
+        in.read(content.data(), (std::streamsize) content.size());
+        std::ofstream out(TEST_FILE, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), (std::streamsize) content.size());
+    }
+    const std::vector<double> truncated = DebugRecordReader(TEST_FILE).getStream(DebugStream::lowPass);
+    if (truncated.size() != 10 * DEBUG_BLOCK_SIZE || !isEqual(truncated, pData, 0))
+    {
+        std::cout << "Interrupted recording not recovered" << std::endl;
+        ret = 1;
+    }
+    std::remove(TEST_FILE);
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file        test_DeflationMonitor.cpp
+ * @brief       DeflationMonitor test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Synthetic deflations at different rates, with a pulse of 1 mmHg on the pressure, are passed to the
+ * DeflationMonitor. The rate and residual are compared to a least squares fit calculated directly over the window
+ * and the guidance has to match the rate. A deflation where the valve is opened and closed in steps of 16 mmHg has
+ * to be detected as irregular while a step is within the window. The test passes if all checks succeed.
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include "../DeflationMonitor.cpp"
+
+#define MAX_RATE_ERROR 1e-6 //!< Max. difference of the rate to the direct fit in mmHg/s.
+
+/**
+ * Fits a line to the last values directly and returns the rate and the RMS residual.
+ * @param pressure All pressure values.
+ * @param window The number of values at the end to fit.
+ * @param residual Returns the RMS of the residuals.
+ * @return The rate in mmHg/s at 1 kHz.
+ */
+double fitDirect(const std::vector<double> &pressure, size_t window, double &residual)
+{
+    const size_t start = pressure.size() - window;
+    double meanX = 0.5 * ((double) window - 1.0);
+    double meanY = 0.0;
+    for (size_t i = 0; i < window; ++i)
+    {
+        meanY += pressure[start + i];
+    }
+    meanY /= (double) window;
+    double sxx = 0.0;
+    double sxy = 0.0;
+    for (size_t i = 0; i < window; ++i)
+    {
+        sxx += ((double) i - meanX) * ((double) i - meanX);
+        sxy += ((double) i - meanX) * (pressure[start + i] - meanY);
+    }
+    const double slope = sxy / sxx;
+    double sse = 0.0;
+    for (size_t i = 0; i < window; ++i)
+    {
+        const double r = pressure[start + i] - meanY - slope * ((double) i - meanX);
+        sse += r * r;
+    }
+    residual = std::sqrt(sse / ((double) window - 2.0));
+    return -slope * 1000.0;
+}
+
+/**
+ * Deflates from 180 mmHg at a constant rate and checks the guidance and the fit.
+ * @param rate The deflation rate in mmHg/s.
+ * @param steps True to open and close the valve every 4 s instead of deflating continuously.
+ * @param expected The expected guidance, for all updates or in steps for a quarter of them.
+ * @return True if all checks succeed.
+ */
+bool check(double rate, bool steps, DeflationGuidance expected)
+{
+    DeflationMonitor monitor(1000.0);
+    std::vector<double> pressure;
+    bool ok = true;
+    size_t updates = 0;
+    size_t matches = 0;
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        const double t = (double) i / 1000.0;
+        // In steps, the whole drop of 4 s happens within 200 ms.
+        const double cycle = std::floor(0.25 * t);
+        const double drop = steps ? 4.0 * rate * (cycle + std::min(1.0, 5.0 * (t - 4.0 * cycle))) : rate * t;
+        const double value = 180.0 - drop + std::sin(2.0 * M_PI * 1.2 * t);
+        pressure.push_back(value);
+        if (monitor.processSample(value))
+        {
+            updates++;
+            double residual;
+            const double direct = fitDirect(pressure, (size_t) (DEFLATE_WINDOW_TIME * 1000.0), residual);
+            if (std::abs(monitor.getRate() - direct) > MAX_RATE_ERROR ||
+                std::abs(monitor.getResidual() - residual) > MAX_RATE_ERROR)
+            {
+                ok = false;
+            }
+            if (monitor.getGuidance() == expected)
+            {
+                matches++;
+            }
+        }
+    }
+    std::cout << rate << " mmHg/s" << (steps ? " in steps" : "") << ": rate " << monitor.getRate() << ", residual "
+              << monitor.getResidual() << ", mean " << monitor.getMeanRate() << ", guidance "
+              << (int) monitor.getGuidance() << std::endl;
+    return ok && updates > 0 && (steps ? 4 * matches >= updates : matches == updates);
+}
+
+int main()
+{
+    int ret = 0;
+    if (!check(1.0, false, DeflationGuidance::tooSlow) || !check(3.0, false, DeflationGuidance::good) ||
+        !check(6.0, false, DeflationGuidance::tooFast) || !check(4.0, true, DeflationGuidance::irregular))
+    {
+        ret = 1;
+    }
+
+    DeflationMonitor monitor(1000.0);
+    monitor.processSample(180.0);
+    if (monitor.getGuidance() != DeflationGuidance::unknown || monitor.getRate() != 0.0)
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file        test_DerivativeDetection.cpp
+ * @brief       DerivativeDetection test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Very basic testing of the DerivativeDetection class.
+ * The sample data in 'p.dat' and 'o.dat' is processed sample by sample through the OBPDetection interface. The test
+ * passes if the measurement finishes with SBP > MAP > DBP > 0.0 and the batch analysis gives the same results.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+#include "../DerivativeDetection.cpp"
+
+int main()
+{
+    DerivativeDetection derivative(1000.0);
+    OBPDetection &obpDetect = derivative;
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+        obpDetect.processSample(vP, vO);
+        if (obpDetect.getIsEnoughData())
+        {
+            break;
+        }
+    }
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+    }
+
+    std::cout << obpDetect.getMAP() << " " << obpDetect.getSBP() << " " << obpDetect.getDBP() << std::endl;
+
+    int ret = 0;
+    if (obpDetect.getAlgorithm() != DetectionAlgorithm::Derivative || !obpDetect.getIsEnoughData() ||
+        !(obpDetect.getSBP() > obpDetect.getMAP() && obpDetect.getMAP() > obpDetect.getDBP() &&
+          obpDetect.getDBP() > 0.0))
+    {
+        ret = 1;
+    }
+
+    OBPResult batch = obpDetect.analyze(pData, oData);
+    if (!batch.finished || batch.map != obpDetect.getMAP() || batch.sbp != obpDetect.getSBP() ||
+        batch.dbp != obpDetect.getDBP())
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file        test_EnvelopeFit.cpp
+ * @brief       EnvelopeFit test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Very basic testing of the EnvelopeFit class.
+ * Envelopes are generated from a known polynomial and a known asymmetric Gaussian, at one point per beat over a 40 s
+ * deflation. The test passes if both fits recover the parameters and one fit takes less than a millisecond.
+ */
+
+#include <iostream>
+#include <chrono>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+#include "../EnvelopeFit.cpp"
+
+int main()
+{
+    int ret = 0;
+    Envelope polynomial;
+    Envelope gaussian;
+    const std::array<double, POLYFIT_DEGREE + 1> coefficients = {0.5, 4.0, 3.0, -12.0, 5.0};
+    for (size_t time = 1000; time <= 41000; time += 800)
+    {
+        const double t = (double) (time - 1000) / 40000.0;
+        double value = 0.0;
+        for (size_t k = POLYFIT_DEGREE + 1; k-- > 0;)
+        {
+            value = value * t + coefficients[k];
+        }
+        polynomial.addPoint(time, value);
+        const double d = t - 0.4;
+        const double sigma = (d < 0.0) ? 0.15 : 0.25;
+        gaussian.addPoint(time, 3.0 * std::exp(-d * d / (2.0 * sigma * sigma)));
+    }
+
+    EnvelopeFitResult polyFit = EnvelopeFit::fitPolynomial(polynomial);
+    for (size_t k = 0; k <= POLYFIT_DEGREE; ++k)
+    {
+        if (!polyFit.valid || std::abs(polyFit.params[k] - coefficients[k]) > 1e-6)
+        {
+            ret = 1;
+        }
+    }
+    std::cout << "polynomial: rms " << polyFit.rmsError << std::endl;
+
+    EnvelopeFitResult gaussFit = EnvelopeFit::fitGaussian(gaussian);
+    std::cout << "gaussian: " << gaussFit.params[0] << " " << gaussFit.params[1] << " " << gaussFit.params[2] << " "
+              << gaussFit.params[3] << " after " << gaussFit.iterations << " iterations" << std::endl;
+    if (!gaussFit.valid || std::abs(gaussFit.params[0] - 3.0) > 1e-3 || std::abs(gaussFit.params[1] - 0.4) > 1e-3 ||
+        std::abs(gaussFit.params[2] - 0.15) > 1e-3 || std::abs(gaussFit.params[3] - 0.25) > 1e-3)
+    {
+        ret = 1;
+    }
+
+    // MAP at the centre, SBP and DBP where the Gaussian falls to the ratio on either side.
+    size_t mapTime, sbpTime, dbpTime;
+    if (!EnvelopeFit::findRatioTimes(gaussFit, 0.57, 0.70, mapTime, sbpTime, dbpTime) ||
+        std::abs((double) mapTime - 17000.0) > 50.0 ||
+        std::abs(EnvelopeFit::evaluate(gaussFit, (double) sbpTime) - 0.57 * 3.0) > 1e-2 ||
+        std::abs(EnvelopeFit::evaluate(gaussFit, (double) dbpTime) - 0.70 * 3.0) > 1e-2 ||
+        sbpTime >= mapTime || dbpTime <= mapTime)
+    {
+        ret = 1;
+    }
+
+    const int nRuns = 1000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nRuns; ++i)
+    {
+        gaussFit = EnvelopeFit::fitGaussian(gaussian);
+    }
+    const double usPerFit = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count()
+                            / nRuns;
+    std::cout << "gaussian fit of " << gaussian.size() << " points: " << usPerFit << " us" << std::endl;
+    if (usPerFit > 1000.0)
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file        test_FlightRecorder.cpp
+ * @brief       FlightRecorder test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * The pressure of p.dat is added as voltages to a flight recorder that is smaller than the recording, so its rings
+ * wrap. Reading the file has to return the last samples and events in order, a part extracted as binary recording
+ * has to hold the same samples in mmHg. A child process writes a flight recorder and exits without closing it, the
+ * samples have to be in the file and have to be kept when the file is opened again. While a thread adds numbered
+ * samples as fast as it can, every read has to return consecutive samples. The time to add a sample is printed. The
+ * test passes if all checks succeed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <sys/wait.h>
+#include "../FlightRecorder.cpp"
+#include "../RecordingReader.cpp"
+
+#define TEST_FILE       "test_flight.obf"       //!< The temporary flight recorder, removed at the end.
+#define TEST_RECORDING  "test_flight.obp"       //!< The temporary extracted recording, removed at the end.
+#define CAPACITY        5000                    //!< The number of samples of the flight recorder in the test.
+#define EVENTS          8                       //!< The number of events of the flight recorder in the test.
+#define MMHG_PER_VOLT   195.0                   //!< The calibration used in the test.
+#define AMBIENT         0.42                    //!< The ambient voltage used in the test.
+#define CONCURRENT_SAMPLES 4000000              //!< The number of samples added while reading.
+
+int main()
+{
+    std::ifstream pFile("p.dat");
+    double t, p;
+    std::vector<double> voltages;
+    while (pFile >> t >> p)
+    {
+        voltages.push_back(p / MMHG_PER_VOLT + AMBIENT);
+    }
+    const uint64_t n = voltages.size();
+
+    int ret = 0;
+    double addTime;
+    {
+        FlightRecorder recorder;
+        if (!recorder.open(TEST_FILE, 1000.0, CAPACITY, EVENTS))
+        {
+            std::cout << "Flight recorder not created" << std::endl;
+            ret = 1;
+        }
+        recorder.setCalibration(MMHG_PER_VOLT, AMBIENT);
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            if (i % 1000 == 0)
+            {
+                recorder.addEvent(FlightEventType::state, (double) (i / 1000 % 6));
+            }
+            recorder.addSample(voltages[i]);
+        }
+        addTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (recorder.getSampleCount() != n)
+        {
+            std::cout << "Sample count does not match" << std::endl;
+            ret = 1;
+        }
+    }
+    std::cout << "Adding a sample takes " << addTime / (double) n * 1e9 << " ns" << std::endl;
+
+    FlightHeader header{};
+    uint64_t first;
+    std::vector<float> read;
+    std::vector<DebugEvent> events;
+    bool same = FlightRecorder::read(TEST_FILE, header, first, read, events) && first == n - CAPACITY + 1 &&
+                read.size() == CAPACITY - 1 && header.samples == n && header.mmHgPerVolt == MMHG_PER_VOLT &&
+                header.ambientVoltage == AMBIENT;
+    for (size_t i = 0; same && i < read.size(); ++i)
+    {
+        same = read[i] == (float) voltages[first + i];
+    }
+    const uint64_t lastEvent = (n - 1) / 1000 * 1000;
+    if (!same || events.size() != EVENTS - 1 || events.back().sample != lastEvent ||
+        events.back().value != (float) (lastEvent / 1000 % 6) || events.front().sample != lastEvent - 6000 ||
+        events.back().flags != (uint32_t) FlightEventType::state)
+    {
+        std::cout << "Rings do not match" << std::endl;
+        ret = 1;
+    }
+
+    // The last two seconds as recording, a part that starts before the oldest sample is limited to the file.
+    RecordingReader recording;
+    same = FlightRecorder::extract(TEST_FILE, TEST_RECORDING, n - 2000, 2000) && recording.open(TEST_RECORDING) &&
+           recording.getHeader().samples == 2000 && recording.getHeader().ambientVoltage == AMBIENT;
+    for (size_t i = 0; same && i < 2000; ++i)
+    {
+        same = recording.getSamples()[i] == (float) ((read[CAPACITY - 1 - 2000 + i] - AMBIENT) * MMHG_PER_VOLT);
+    }
+    recording.close();
+    if (!same || !FlightRecorder::extract(TEST_FILE, TEST_RECORDING, 0, n - CAPACITY + 11) ||
+        !recording.open(TEST_RECORDING) || recording.getHeader().samples != 10 ||
+        FlightRecorder::extract(TEST_FILE, TEST_RECORDING, 0, 100))
+    {
+        std::cout << "Extracted recording does not match" << std::endl;
+        ret = 1;
+    }
+    recording.close();
+
+    // A process that ends without closing the flight recorder.
+    const pid_t child = fork();
+    if (child == 0)
+    {
+        auto *recorder = new FlightRecorder();
+        recorder->open(TEST_FILE, 1000.0, CAPACITY, EVENTS);
+        for (uint64_t i = 0; i < 3000; ++i)
+        {
+            recorder->addSample(voltages[i]);
+        }
+        recorder->addEvent(FlightEventType::cancelled, 12.0);
+        _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    same = FlightRecorder::read(TEST_FILE, header, first, read, events) && first == 0 && read.size() == 3000 &&
+           read[2999] == (float) voltages[2999] && events.size() == 1 && events[0].sample == 3000;
+    {
+        FlightRecorder recorder;
+        same = same && recorder.open(TEST_FILE, 1000.0, CAPACITY, EVENTS) &&
+               FlightRecorder::read(std::string(TEST_FILE) + FLIGHT_PREVIOUS, header, first, read, events) &&
+               read.size() == 3000 && FlightRecorder::read(TEST_FILE, header, first, read, events) && read.empty();
+    }
+    if (!same)
+    {
+        std::cout << "Samples lost after exit" << std::endl;
+        ret = 1;
+    }
+
+    // Reading while numbered samples are added.
+    {
+        FlightRecorder recorder;
+        recorder.open(TEST_FILE, 1000.0, 1000, EVENTS);
+        std::atomic<bool> done = false;
+        std::thread writer([&recorder, &done] {
+            for (uint64_t i = 0; i < CONCURRENT_SAMPLES; ++i)
+            {
+                recorder.addSample((double) i);
+            }
+            done = true;
+        });
+        size_t reads = 0;
+        size_t torn = 0;
+        while (!done)
+        {
+            FlightRecorder::read(TEST_FILE, header, first, read, events);
+            for (size_t i = 0; i < read.size(); ++i)
+            {
+                if (read[i] != (float) (first + i))
+                {
+                    torn++;
+                    break;
+                }
+            }
+            reads++;
+        }
+        writer.join();
+        std::cout << reads << " reads while writing, " << torn << " inconsistent" << std::endl;
+        if (torn > 0 || !FlightRecorder::read(TEST_FILE, header, first, read, events) ||
+            first != CONCURRENT_SAMPLES - 999 || read.back() != (float) (CONCURRENT_SAMPLES - 1))
+        {
+            std::cout << "Concurrent reads inconsistent" << std::endl;
+            ret = 1;
+        }
+    }
+    std::remove(TEST_FILE);
+    std::remove((std::string(TEST_FILE) + FLIGHT_PREVIOUS).c_str());
+    std::remove(TEST_RECORDING);
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file        test_HeartRateEstimator.cpp
+ * @brief       HeartRateEstimator test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Synthetic oscillations at heart rates across the valid range, with a dicrotic wave and noise, are passed to the
+ * HeartRateEstimator. The test passes if every heart rate is found within 2 bpm after at most 3 s of signal, also at
+ * the rates where a multiple of the period lies within the range. The oscillation in 'o.dat' is then analysed by the
+ * OBPDetection, the estimate at the end has to be within 5 bpm of the average heart rate of the beats.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+
+#define MAX_LOCK_TIME 3.0       //!< Max. time in s until the heart rate has to be found.
+#define MAX_SYNTHETIC_ERROR 2.0 //!< Max. difference to the synthetic heart rate in bpm.
+#define MAX_RECORDED_ERROR 5.0  //!< Max. difference to the average heart rate of the recording in bpm.
+
+/**
+ * Passes a synthetic oscillation to a new estimator and returns when the heart rate is found.
+ * @param heartRate The heart rate of the oscillation in bpm.
+ * @param lockTime Is set to the time in s at which the heart rate was found.
+ * @return The estimated heart rate, 0.0 if it was not found within MAX_LOCK_TIME.
+ */
+double estimate(double heartRate, double &lockTime)
+{
+    std::mt19937 generator(7);
+    std::normal_distribution<double> noise(0.0, 0.05);
+    HeartRateEstimator estimator;
+    estimator.reset(1000.0, 50.0, 120.0);
+
+    const double period = 60.0 / heartRate;
+    for (size_t i = 0; i < (size_t) (MAX_LOCK_TIME * 1000.0); ++i)
+    {
+        const double t = (double) i / 1000.0;
+        const double phase = std::fmod(t, period) / period;
+        // A systolic peak followed by a smaller dicrotic wave.
+        const double value = std::exp(-0.5 * std::pow((phase - 0.15) / 0.06, 2.0)) +
+                             0.4 * std::exp(-0.5 * std::pow((phase - 0.45) / 0.06, 2.0)) - 0.3 + noise(generator);
+        if (estimator.processSample(value))
+        {
+            lockTime = t;
+            return estimator.getHeartRate();
+        }
+    }
+    return 0.0;
+}
+
+int main()
+{
+    int ret = 0;
+    for (double heartRate : {52.0, 60.0, 72.0, 85.0, 100.0, 118.0})
+    {
+        double lockTime = 0.0;
+        const double found = estimate(heartRate, lockTime);
+        std::cout << heartRate << " bpm: " << found << " bpm after " << lockTime << " s" << std::endl;
+        if (std::abs(found - heartRate) > MAX_SYNTHETIC_ERROR)
+        {
+            ret = 1;
+        }
+    }
+
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+    }
+
+    OBPDetection obpDetect(1000.0);
+    const OBPResult result = obpDetect.analyze(pData, oData);
+    const double estimated = obpDetect.getEstimatedHeartRate();
+    std::cout << "recording: " << estimated << " bpm, beats " << result.heartRate << " bpm" << std::endl;
+    if (!result.finished || std::abs(estimated - result.heartRate) > MAX_RECORDED_ERROR)
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
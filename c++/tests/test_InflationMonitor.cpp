@@ -0,0 +1,87 @@
+/**
+ * @file        test_InflationMonitor.cpp
+ * @brief       InflationMonitor test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Very basic testing of the InflationMonitor class with generated data.
+ * The cuff is inflated in steps of 10 mmHg with pauses of 5 s, the oscillation amplitude is maximal at 90 mmHg and
+ * vanishes above. The test passes if the target is lowered to a margin above the pressure where the oscillations
+ * vanished and stays at the fixed value if the cuff is inflated continuously.
+ */
+
+#include <iostream>
+#include <cmath>
+#include "../InflationMonitor.cpp"
+
+/**
+ * The oscillation amplitude at a given pressure, a Gaussian around the MAP at 90 mmHg.
+ */
+double amplitudeAt(double pressure)
+{
+    return 2.0 * std::exp(-std::pow((pressure - 90.0) / 30.0, 2.0));
+}
+
+int main()
+{
+    const double fs = 1000.0;
+    int ret = 0;
+    InflationMonitor monitor(fs);
+
+    // Inflation in steps with pauses:
+    monitor.reset(200.0, PUMP_UP_VALUE_MIN);
+    double pressure = 0.0;
+    double switchPressure = 0.0;
+    size_t n = 0;
+    while (pressure < 200.0 && switchPressure == 0.0)
+    {
+        const double start = pressure;
+        for (size_t i = 0; i < 5200 && switchPressure == 0.0; ++i, ++n)
+        {
+            // 200 ms pump stroke of 10 mmHg, then 5 s pause.
+            pressure = (i < 200) ? start + 10.0 * (double) i / 200.0 : start + 10.0;
+            const double oscillation = amplitudeAt(pressure) * std::sin(2.0 * M_PI * 1.2 * (double) n / fs);
+            if (monitor.processSample(pressure, oscillation))
+            {
+                switchPressure = pressure;
+            }
+        }
+    }
+    std::cout << "stepwise: target " << monitor.getTarget() << " mmHg, switched at " << switchPressure
+              << " mmHg" << std::endl;
+    // The amplitude falls below 30 % of the maximum at 123 mmHg, first pause above that is at 130 mmHg.
+    if (!monitor.isAdaptive() || std::abs(monitor.getTarget() - (130.0 + INFLATE_MARGIN)) > 1e-6 ||
+        switchPressure <= monitor.getTarget() || switchPressure >= 200.0)
+    {
+        ret = 1;
+    }
+
+    // Continuous inflation at 40 mmHg/s, the oscillations cannot be observed:
+    monitor.reset(200.0, PUMP_UP_VALUE_MIN);
+    switchPressure = 0.0;
+    for (n = 0; n < 10000 && switchPressure == 0.0; ++n)
+    {
+        pressure = 40.0 * (double) n / fs;
+        if (monitor.processSample(pressure, amplitudeAt(pressure) * std::sin(2.0 * M_PI * 1.2 * (double) n / fs)))
+        {
+            switchPressure = pressure;
+        }
+    }
+    std::cout << "continuous: target " << monitor.getTarget() << " mmHg, switched at " << switchPressure
+              << " mmHg" << std::endl;
+    if (monitor.isAdaptive() || monitor.getTarget() != 200.0 || switchPressure <= 200.0)
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file        test_MappedFile.cpp
+ * @brief       MappedFile test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Maps 'p.dat' and compares the mapping with the content read from the file. A missing file and a file shorter than
+ * the min. size must not be mapped, unmap() has to release the mapping and a shared mapping has to show the file.
+ * The test passes if all checks succeed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include "../MappedFile.h"
+
+#define TEST_FILE   "test_mapped.dat"   //!< The temporary file, removed at the end.
+
+int main()
+{
+    int ret = 0;
+    std::ifstream in("p.dat", std::ios::binary);
+    const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    MappedFile file;
+    if (!file.map("p.dat", 1, "test file") || file.size() != content.size() ||
+        std::memcmp(file.data(), content.data(), content.size()) != 0)
+    {
+        std::cout << "p.dat not mapped correctly" << std::endl;
+        ret = 1;
+    }
+    file.unmap();
+    if (file.isMapped() || file.data() != nullptr || file.size() != 0)
+    {
+        std::cout << "Mapping not released" << std::endl;
+        ret = 1;
+    }
+
+    if (file.map("does_not_exist.dat", 1, "test file"))
+    {
+        std::cout << "Missing file mapped" << std::endl;
+        ret = 1;
+    }
+    std::ofstream(TEST_FILE) << "1234";
+    if (file.map(TEST_FILE, 5, "test file") || file.isMapped())
+    {
+        std::cout << "File shorter than the min. size mapped" << std::endl;
+        ret = 1;
+    }
+    std::ofstream(TEST_FILE, std::ios::trunc).close();
+    if (file.map(TEST_FILE, 0, "test file"))
+    {
+        std::cout << "Empty file mapped" << std::endl;
+        ret = 1;
+    }
+    std::ofstream(TEST_FILE, std::ios::trunc) << "1234";
+    if (!file.map(TEST_FILE, 4, "test file", true) || file.size() != 4 || std::memcmp(file.data(), "1234", 4) != 0)
+    {
+        std::cout << "Shared mapping failed" << std::endl;
+        ret = 1;
+    }
+    file.unmap();
+    std::remove(TEST_FILE);
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file        test_MeasurementIndex.cpp
+ * @brief       MeasurementIndex test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * An index with a measurement every ten minutes for a year is written, every tenth measurement cancelled. Queries by
+ * time and results have to find the same entries as comparing all entries and have to take less than MAX_QUERY_TIME,
+ * opening the index included. An entry that was not written completely has to be ignored and replaced by the next
+ * one, an entry with an earlier time has to be found anyway and a file with a wrong magic has to be rejected. The
+ * test passes if all checks succeed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include "../MeasurementIndex.cpp"
+
+#define TEST_FILE       "test_index.obi"    //!< The temporary index, removed at the end.
+#define ENTRIES         52560               //!< One measurement every ten minutes for a year.
+#define START_TIME      1600000000000       //!< The time of the first measurement in ms since the epoch.
+#define INTERVAL        600000              //!< The time between the measurements in ms.
+#define MAX_QUERY_TIME  0.01                //!< Max. time to open the index and query it in s.
+
+/**
+ * Creates the entry of a test measurement.
+ * @param i The number of the measurement.
+ * @return The entry.
+ */
+IndexEntry createEntry(size_t i)
+{
+    IndexEntry entry{};
+    entry.time = START_TIME + (int64_t) i * INTERVAL;
+    std::snprintf(entry.fileName, sizeof(entry.fileName), "measurement_%zu.obp", i);
+    entry.sbp = 100.0 + (double) (i * 7919 % 80);
+    entry.dbp = 60.0 + (double) (i * 104729 % 40);
+    entry.map = (entry.sbp + 2.0 * entry.dbp) / 3.0;
+    entry.heartRate = 50.0 + (double) (i % 60);
+    entry.duration = 30.0 + (double) (i % 20);
+    entry.flags = i % 10 == 9 ? 0 : (uint32_t) IndexFlag::complete;
+    return entry;
+}
+
+/**
+ * Finds the entries of a query by comparing all entries.
+ * @param index The index.
+ * @param query The query.
+ * @return The indexes of the entries.
+ */
+std::vector<size_t> findAll(const MeasurementIndex &index, const IndexQuery &query)
+{
+    std::vector<size_t> found;
+    for (size_t i = 0; i < index.size(); ++i)
+    {
+        const IndexEntry &entry = index.getEntry(i);
+        bool match = entry.time >= query.from && entry.time < query.to &&
+                     (!query.completeOnly || entry.hasFlag(IndexFlag::complete));
+        for (const IndexCondition &condition : query.conditions)
+        {
+            const double value = MeasurementIndex::getValue(entry, condition.field);
+            match = match && value >= condition.min && value <= condition.max;
+        }
+        if (match)
+        {
+            found.push_back(i);
+        }
+    }
+    return found;
+}
+
+int main()
+{
+    int ret = 0;
+    std::remove(TEST_FILE);
+    const auto writeStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ENTRIES; ++i)
+    {
+        if (!MeasurementIndex::append(TEST_FILE, createEntry(i)))
+        {
+            std::cout << "Entry not appended" << std::endl;
+            ret = 1;
+            break;
+        }
+    }
+    const double writeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+    std::cout << "Appending an entry takes " << writeTime / ENTRIES * 1e6 << " us" << std::endl;
+
+    // The last week with SBP > 140, a month with a high heart rate and all cancelled measurements.
+    const int64_t end = START_TIME + (int64_t) ENTRIES * INTERVAL;
+    IndexQuery lastWeek;
+    lastWeek.from = end - 7 * 86400000LL;
+    lastWeek.conditions.push_back(IndexCondition{IndexField::sbp, 140.5});
+    IndexQuery month;
+    month.from = START_TIME + 90 * 86400000LL;
+    month.to = month.from + 30 * 86400000LL;
+    month.conditions.push_back(IndexCondition{IndexField::heartRate, 100.0});
+    month.conditions.push_back(IndexCondition{IndexField::dbp, -HUGE_VAL, 80.0});
+    IndexQuery all;
+    all.completeOnly = false;
+
+    double queryTime = 0.0;
+    for (const IndexQuery *query : {&lastWeek, &month, &all})
+    {
+        const auto start = std::chrono::steady_clock::now();
+        MeasurementIndex index(TEST_FILE);
+        const std::vector<size_t> found = index.query(*query);
+        queryTime = std::max(queryTime,
+                             std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        if (!index.isOpen() || index.size() != ENTRIES || found != findAll(index, *query) || found.empty())
+        {
+            std::cout << "Query does not match" << std::endl;
+            ret = 1;
+        }
+    }
+    std::cout << "Opening and querying takes " << queryTime * 1000.0 << " ms" << std::endl;
+    if (queryTime > MAX_QUERY_TIME)
+    {
+        std::cout << "Query too slow" << std::endl;
+        ret = 1;
+    }
+
+    // An entry that was interrupted is ignored and replaced.
+    {
+        std::ofstream out(TEST_FILE, std::ios::binary | std::ios::app);
+        const IndexEntry entry = createEntry(ENTRIES);
+        out.write(reinterpret_cast<const char *>(&entry), sizeof(IndexEntry) / 2);
+    }
+    MeasurementIndex index(TEST_FILE);
+    const bool ignored = index.size() == ENTRIES;
+    IndexEntry earlier = createEntry(ENTRIES);
+    earlier.time = START_TIME + 5;
+    earlier.sbp = 200.0;
+    IndexQuery high;
+    high.conditions.push_back(IndexCondition{IndexField::sbp, 190.0});
+    if (!ignored || !MeasurementIndex::append(TEST_FILE, earlier) || !index.open(TEST_FILE) ||
+        index.size() != ENTRIES + 1 || index.getEntry(ENTRIES).time != earlier.time ||
+        index.query(high) != std::vector<size_t>{ENTRIES} || index.query(lastWeek) != findAll(index, lastWeek))
+    {
+        std::cout << "Interrupted or earlier entry not handled" << std::endl;
+        ret = 1;
+    }
+    index.close();
+
+    // A file that is no index.
+    {
+        std::fstream file(TEST_FILE, std::ios::binary | std::ios::in | std::ios::out);
+        file.write("NOINDEX", 7);
+    }
+    if (index.open(TEST_FILE) || MeasurementIndex::append(TEST_FILE, earlier))
+    {
+        std::cout << "Invalid index accepted" << std::endl;
+        ret = 1;
+    }
+    std::remove(TEST_FILE);
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file        test_OBPBootstrap.cpp
+ * @brief       OBPBootstrap test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Calculates the confidence intervals of the results of the sample data in 'p.dat' and 'o.dat' with one and with
+ * several worker threads. The test passes if the intervals are identical for both, contain the results of the
+ * detection and are narrower than MAX_WIDTH, and if OBPDetection::findRatioTimes() only reports an SBP for resampled
+ * envelopes that rise through the SBP ratio before their maximum.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+#include "../OBPBootstrap.cpp"
+
+#define MAX_WIDTH 20.0 //!< Max. width of an interval in mmHg.
+
+/**
+ * Checks that an interval contains the result and is not too wide.
+ * @param name The name of the result, printed with the interval.
+ * @param interval The confidence interval.
+ * @param value The result of the detection.
+ * @return True if the interval is plausible.
+ */
+bool check(const char *name, const ConfidenceInterval &interval, double value)
+{
+    std::cout << name << " " << value << ": [" << interval.lower << ", " << interval.upper << "]" << std::endl;
+    return interval.lower <= value && value <= interval.upper && interval.upper - interval.lower < MAX_WIDTH;
+}
+
+/**
+ * Checks that the SBP is only found in an envelope that crosses the SBP ratio between two of its points.
+ * @return True if the SBP is found in the crossing envelope only and lies between the two points.
+ */
+bool checkSBPFound()
+{
+    Envelope crossing;
+    Envelope startsAbove;
+    Envelope startsAtMax;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        const double amplitude[] = {1.0, 3.0, 5.0, 4.0, 2.0};
+        crossing.addPoint(1000 * i, amplitude[i]);
+        startsAbove.addPoint(1000 * i, amplitude[i] + 5.0);
+        startsAtMax.addPoint(1000 * i, 5.0 - (double) i);
+    }
+    size_t mapTime;
+    size_t sbpTime;
+    size_t dbpTime;
+    bool foundSBP;
+    OBPDetection::findRatioTimes(crossing, 0.5, 0.7, mapTime, sbpTime, dbpTime, foundSBP);
+    bool valid = foundSBP && sbpTime > 0 && sbpTime < 1000;
+    OBPDetection::findRatioTimes(startsAbove, 0.5, 0.7, mapTime, sbpTime, dbpTime, foundSBP);
+    valid = valid && !foundSBP && sbpTime == 0;
+    OBPDetection::findRatioTimes(startsAtMax, 0.5, 0.7, mapTime, sbpTime, dbpTime, foundSBP);
+    return valid && !foundSBP && sbpTime == 0;
+}
+
+int main()
+{
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+    }
+
+    OBPDetection obpDetect(1000.0);
+    const OBPResult result = obpDetect.analyze(pData, oData);
+
+    auto start = std::chrono::steady_clock::now();
+    const BootstrapResult single = OBPBootstrap::analyze(result, pData, obpDetect.getConfig(), BOOTSTRAP_RESAMPLES, 1);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "1 thread: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    const BootstrapResult pool = OBPBootstrap::analyze(result, pData, obpDetect.getConfig(), BOOTSTRAP_RESAMPLES, 4);
+    end = std::chrono::steady_clock::now();
+    std::cout << "4 threads: " << std::chrono::duration<double, std::milli>(end - start).count() << " ms"
+              << std::endl;
+
+    int ret = 0;
+    if (!single.valid || single.resamples != pool.resamples || single.dbpResamples != pool.dbpResamples ||
+        single.map.lower != pool.map.lower || single.map.upper != pool.map.upper ||
+        single.sbp.lower != pool.sbp.lower || single.sbp.upper != pool.sbp.upper ||
+        single.dbp.lower != pool.dbp.lower || single.dbp.upper != pool.dbp.upper)
+    {
+        ret = 1;
+    }
+    if (!check("MAP", pool.map, result.map) || !check("SBP", pool.sbp, result.sbp) ||
+        !check("DBP", pool.dbp, result.dbp))
+    {
+        ret = 1;
+    }
+    if (!checkSBPFound())
+    {
+        std::cout << "SBP found in an envelope without crossing" << std::endl;
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
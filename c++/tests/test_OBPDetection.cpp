@@ -9,11 +9,14 @@
  * Very basic testing of the OBPDetection class.
  * A set of sample data is stored in the same folder as this test 'p.dat' contains pressure values and 'o.dat'
  * contains oscillation values. The values are passed to the OBPDetection object. If the OBPDetection object
- * successfully calculates all values as not equal to 0.0 the test passes.
+ * successfully calculates all values as not equal to 0.0 the test passes. The same data is then analysed as a whole
+ * with OBPDetection::analyze, which has to give the identical results.
  */
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include "../HeartRateEstimator.cpp"
 #include "../OBPDetection.cpp"
 
 int main()
@@ -25,12 +28,19 @@ int main()
     std::ifstream oFile("o.dat");
     double tP, vP;
     double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
     while (pFile >> tP >> vP)
     {
         if (!(oFile >> tO >> vO))
         { break; } // error
+        pData.push_back(vP);
+        oData.push_back(vO);
+    }
 
-        if (obpDetect->processSample(vP, vO))
+    for (size_t i = 0; i < pData.size(); ++i)
+    {
+        if (obpDetect->processSample(pData[i], oData[i]))
         {
             if (obpDetect->getIsEnoughData())
             {
@@ -46,10 +56,23 @@ int main()
     if (obpDetect->getMAP() != 0.0 && obpDetect->getSBP() != 0.0 && obpDetect->getDBP() != 0.0 &&
     obpDetect->getAverageHeartRate() != 0.0)
     {
-        std::cout << "Test passed";
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+        ret = 1;
+    }
+
+    OBPResult streamed = obpDetect->getResult();
+    OBPResult batch = obpDetect->analyze(pData, oData);
+    if (batch.finished && batch.map == streamed.map && batch.sbp == streamed.sbp && batch.dbp == streamed.dbp &&
+        batch.heartRate == streamed.heartRate && batch.decisionTime == streamed.decisionTime &&
+        batch.beats.size() == streamed.beats.size() && batch.envelope.size() == streamed.envelope.size())
+    {
+        std::cout << "Batch test passed" << std::endl;
     } else
     {
-        std::cout << "Test failed";
+        std::cout << "Batch test failed: " << batch.map << " " << batch.sbp << " " << batch.dbp << std::endl;
         ret = 1;
     }
 
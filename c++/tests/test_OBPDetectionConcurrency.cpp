@@ -0,0 +1,123 @@
+/**
+ * @file        test_OBPDetectionConcurrency.cpp
+ * @brief       OBPDetection concurrency test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Tests that several OBPDetection instances can be used in parallel threads.
+ * Different recordings are derived from the sample data in 'p.dat' and 'o.dat' by shifting the start, scaling the
+ * oscillation and offsetting the pressure. Every recording is analysed sequentially first and then again with one
+ * detector per thread, all threads running at the same time. The test passes if all parallel results are identical
+ * to the sequential ones.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+
+#define NBR_RECORDINGS 16   //!< Number of recordings and threads.
+
+/**
+ * One recording to analyse.
+ */
+struct Recording
+{
+    std::vector<double> pData;
+    std::vector<double> oData;
+};
+
+/**
+ * Checks if two results are identical.
+ * @param a The first result.
+ * @param b The second result.
+ * @return True if all values are the same.
+ */
+bool isSameResult(const OBPResult &a, const OBPResult &b)
+{
+    return a.finished == b.finished && a.map == b.map && a.sbp == b.sbp && a.dbp == b.dbp &&
+           a.heartRate == b.heartRate && a.decisionTime == b.decisionTime && a.beats.size() == b.beats.size() &&
+           a.envelope.size() == b.envelope.size();
+}
+
+int main()
+{
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    Recording original;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        original.pData.push_back(vP);
+        original.oData.push_back(vO);
+    }
+
+    std::vector<Recording> recordings(NBR_RECORDINGS);
+    for (int r = 0; r < NBR_RECORDINGS; ++r)
+    {
+        const size_t shift = r * 997;
+        for (size_t i = shift; i < original.pData.size(); ++i)
+        {
+            recordings[r].pData.push_back(original.pData[i] + r);
+            recordings[r].oData.push_back(original.oData[i] * (1.0 + 0.02 * r));
+        }
+    }
+
+    std::vector<OBPResult> sequential(NBR_RECORDINGS);
+    for (int r = 0; r < NBR_RECORDINGS; ++r)
+    {
+        OBPDetection obpDetect(1000.0);
+        obpDetect.resetConfigValues();
+        sequential[r] = obpDetect.analyze(recordings[r].pData, recordings[r].oData);
+    }
+
+    std::vector<OBPResult> parallel(NBR_RECORDINGS);
+    std::vector<std::thread> threads;
+    for (int r = 0; r < NBR_RECORDINGS; ++r)
+    {
+        threads.emplace_back([&recordings, &parallel, r]() {
+            OBPDetection obpDetect(1000.0);
+            obpDetect.resetConfigValues();
+            // Stream the samples, so the detectors interleave sample by sample.
+            for (size_t i = 0; i < recordings[r].pData.size(); ++i)
+            {
+                if (obpDetect.processSample(recordings[r].pData[i], recordings[r].oData[i]) &&
+                    obpDetect.getIsEnoughData())
+                {
+                    break;
+                }
+            }
+            parallel[r] = obpDetect.getResult();
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    int ret = 0;
+    for (int r = 0; r < NBR_RECORDINGS; ++r)
+    {
+        std::cout << sequential[r].map << " " << sequential[r].sbp << " " << sequential[r].dbp << std::endl;
+        if (!sequential[r].finished || !isSameResult(sequential[r], parallel[r]))
+        {
+            std::cout << "Recording " << r << " differs: " << parallel[r].map << " " << parallel[r].sbp << " "
+                      << parallel[r].dbp << std::endl;
+            ret = 1;
+        }
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
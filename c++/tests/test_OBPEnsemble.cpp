@@ -0,0 +1,82 @@
+/**
+ * @file        test_OBPEnsemble.cpp
+ * @brief       OBPEnsemble test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Very basic testing of the OBPEnsemble class.
+ * The sample data in 'p.dat' and 'o.dat' is analysed with all estimators. The test passes if every estimator
+ * calculates all values as not equal to 0.0 and the interpolation estimate equals the result of the OBPDetection.
+ * The interpolation estimate has to be invalid if the detection did not find the SBP, and if the beats were detected
+ * by the derivative algorithm, which does not interpolate the envelope.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+#include "../EnvelopeFit.cpp"
+#include "../OBPEnsemble.cpp"
+
+int main()
+{
+    OBPDetection obpDetect(1000.0);
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+    }
+
+    EnsembleResult ensemble = OBPEnsemble::analyze(obpDetect, pData, oData);
+
+    int ret = 0;
+    for (const Estimate &estimate : ensemble.estimates)
+    {
+        std::cout << OBPEnsemble::getName(estimate.estimator) << ": " << estimate.map << " " << estimate.sbp << " "
+                  << estimate.dbp << std::endl;
+        if (!estimate.valid || estimate.map == 0.0 || estimate.sbp == 0.0 || estimate.dbp == 0.0)
+        {
+            ret = 1;
+        }
+    }
+    const Estimate &interpolation = ensemble.estimates[(size_t) Estimator::Interpolation];
+    if (interpolation.map != ensemble.detection.map || interpolation.sbp != ensemble.detection.sbp ||
+        interpolation.dbp != ensemble.detection.dbp)
+    {
+        ret = 1;
+    }
+
+    OBPResult noSBP = ensemble.detection;
+    noSBP.sbpTime = 0;
+    noSBP.sbp = 0.0;
+    if (OBPEnsemble::evaluate(noSBP, pData, obpDetect.getConfig(),
+                              DetectionAlgorithm::FixedRatio)[(size_t) Estimator::Interpolation].valid)
+    {
+        std::cout << "Interpolation estimate valid without SBP" << std::endl;
+        ret = 1;
+    }
+    if (OBPEnsemble::evaluate(ensemble.detection, pData, obpDetect.getConfig(),
+                              DetectionAlgorithm::Derivative)[(size_t) Estimator::Interpolation].valid)
+    {
+        std::cout << "Interpolation estimate reported for the derivative algorithm" << std::endl;
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file        test_PredictiveTermination.cpp
+ * @brief       Validation of the predictive mode of the OBPDetection class.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * All recordings in 'data/sample_*.dat' are converted to mmHg, filtered and analysed twice with the Pipeline, once in
+ * the standard and once in the predictive mode. The time saved and the differences of the results are printed.
+ * The test passes if the predictive mode finishes on every recording the standard mode finishes on, never later, and
+ * the results differ by less than the prediction tolerance.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <numeric>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+#include "../Pipeline.cpp"
+
+/**
+ * Conversion of the recorded voltage to mmHg, as done by Processing.
+ */
+#define KPA_PER_MMHG 0.133322
+#define KPA_PER_V 50.0
+#define CORR_FACTOR 2.6
+
+int main()
+{
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry : std::filesystem::directory_iterator("../../data"))
+    {
+        if (entry.path().filename().string().rfind("sample_", 0) == 0)
+        {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    int ret = files.empty() ? 1 : 0;
+    double savedTotal = 0.0;
+    double standardTotal = 0.0;
+    for (const auto &file : files)
+    {
+        std::ifstream in(file);
+        std::vector<double> voltage;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            double t, v;
+            if (std::sscanf(line.c_str(), "%lf %lf", &t, &v) == 2)
+            {
+                voltage.push_back(v);
+            }
+        }
+        if (voltage.size() < AMBIENT_AV_TIME)
+        {
+            continue;
+        }
+        const double ambient = std::accumulate(voltage.begin(), voltage.begin() + AMBIENT_AV_TIME, 0.0) /
+                               AMBIENT_AV_TIME;
+        std::vector<double> mmHg(voltage.size());
+        std::transform(voltage.begin(), voltage.end(), mmHg.begin(), [ambient](double v) {
+            return ((v - ambient) * KPA_PER_V * CORR_FACTOR) / KPA_PER_MMHG;
+        });
+
+        OBPDetection obpDetect(1000.0);
+        PipelineConfig config;
+        const OBPResult standard = Pipeline::analyze(mmHg, config, obpDetect);
+        obpDetect.setPredictive(true);
+        const OBPResult predictive = Pipeline::analyze(mmHg, config, obpDetect);
+
+        std::cout << file.filename().string() << ": ";
+        if (!standard.finished)
+        {
+            std::cout << "not finished in standard mode";
+            if (predictive.finished)
+            {
+                std::cout << ", predictive mode: " << predictive.map << " " << predictive.sbp << " " << predictive.dbp
+                          << " +/- " << predictive.dbpConfidence;
+            }
+            std::cout << std::endl;
+            continue;
+        }
+
+        const double saved = ((double) standard.decisionTime - (double) predictive.decisionTime) / 1000.0;
+        savedTotal += saved;
+        standardTotal += (double) standard.decisionTime / 1000.0;
+        std::cout << "saved " << saved << " s of " << standard.decisionTime / 1000.0 << " s, differences MAP "
+                  << predictive.map - standard.map << " SBP " << predictive.sbp - standard.sbp << " DBP "
+                  << predictive.dbp - standard.dbp << (predictive.predicted ? " (predicted)" : "") << std::endl;
+
+        if (!predictive.finished || predictive.decisionTime > standard.decisionTime ||
+            std::abs(predictive.map - standard.map) > obpDetect.getConfig().predictionTolerance ||
+            std::abs(predictive.sbp - standard.sbp) > obpDetect.getConfig().predictionTolerance ||
+            std::abs(predictive.dbp - standard.dbp) > obpDetect.getConfig().predictionTolerance)
+        {
+            ret = 1;
+        }
+    }
+    std::cout << "Total time saved: " << savedTotal << " s of " << standardTotal << " s" << std::endl;
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,241 @@
+/**
+ * @file        test_RecordingArchive.cpp
+ * @brief       RecordingArchive and RecordingCodec test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * p.dat and o.dat are converted into archives. Decoding has to return exactly the values of the text files, also for
+ * parts of the recording that start and end within blocks, and the archives have to be at least five times smaller
+ * than the text files together. The pressure as binary recording of floats has to be restored bit by bit and its
+ * archive has to be at least 2.5 times smaller than the recording. Synthetic 24 bit ADC values have to be restored
+ * exactly, and random doubles that have no decimal representation have to be stored verbatim. The speed of encoding
+ * and decoding is printed. A corrupt archive and archives whose index is too long, cut off or missing have to be
+ * rejected. The test passes if all checks succeed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include "../RecordingCodec.cpp"
+#include "../RecordingParser.cpp"
+#include "../RecordingReader.cpp"
+#include "../RecordingArchive.cpp"
+
+#define TEST_FILE_P     "test_p.obz"        //!< The temporary archive of p.dat, removed at the end.
+#define TEST_FILE_O     "test_o.obz"        //!< The temporary archive of o.dat, removed at the end.
+#define TEST_FILE       "test_archive.obz"  //!< The temporary archive of the synthetic data, removed at the end.
+#define TEST_RECORDING  "test_archive.obp"  //!< The temporary binary recording of p.dat and o.dat, removed at the end.
+#define TEST_FILE_BIN   "test_binary.obz"   //!< The temporary archive of the binary recording, removed at the end.
+#define MIN_RATIO       5                   //!< Min. ratio between the size of the text files and the archives.
+#define MIN_RATIO_BIN   2.5                 //!< Min. ratio between the size of a binary recording and its archive.
+
+/**
+ * Gets the size of a file.
+ * @param fileName The name of the file.
+ * @return The size in bytes.
+ */
+size_t getFileSize(const char *fileName)
+{
+    std::ifstream in(fileName, std::ios::binary | std::ios::ate);
+    return (size_t) in.tellg();
+}
+
+/**
+ * Converts a text file and compares the archive with the text.
+ * @param textFile The name of the text file.
+ * @param archiveFile The name of the archive.
+ * @return True if all values of the archive equal the text.
+ */
+bool checkConversion(const char *textFile, const char *archiveFile)
+{
+    std::vector<std::vector<double>> text;
+    if (!RecordingArchive::readText(textFile, text) || text.size() != 2 ||
+        !RecordingArchive::convertText(textFile, archiveFile, 1000.0))
+    {
+        std::cout << textFile << " could not be converted" << std::endl;
+        return false;
+    }
+    RecordingArchive archive(archiveFile);
+    if (!archive.isOpen() || archive.getHeader().channels != 2 || archive.getHeader().samples != text[0].size() ||
+        archive.getHeader().samplingRate != 1000.0)
+    {
+        std::cout << archiveFile << ": header does not match" << std::endl;
+        return false;
+    }
+    for (size_t channel = 0; channel < 2; ++channel)
+    {
+        if (archive.getChannel(channel) != text[channel])
+        {
+            std::cout << archiveFile << ": channel " << channel << " does not match" << std::endl;
+            return false;
+        }
+    }
+    // A part that spans three blocks and the end of the recording.
+    const size_t first = ARCHIVE_BLOCK_SIZE - 10;
+    const std::vector<double> part = archive.getChannel(1, first, 2 * ARCHIVE_BLOCK_SIZE + 20);
+    const std::vector<double> tail = archive.getChannel(1, text[1].size() - 5, 100);
+    if (part.size() != 2 * ARCHIVE_BLOCK_SIZE + 20 || !std::equal(part.begin(), part.end(), text[1].begin() + first) ||
+        tail.size() != 5 || !std::equal(tail.begin(), tail.end(), text[1].end() - 5) ||
+        !archive.getChannel(2).empty() || !archive.getChannel(0, text[0].size(), 1).empty())
+    {
+        std::cout << archiveFile << ": random access does not match" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Writes the pressure of p.dat as binary recording with one channel of floats, as the Datarecord does, converts it
+ * and compares the archive with the recording.
+ * @return True if all samples of the archive equal the samples of the recording.
+ */
+bool checkRecordingConversion()
+{
+    std::vector<std::vector<double>> text;
+    if (!RecordingArchive::readText("p.dat", text))
+    {
+        return false;
+    }
+    std::vector<float> samples(text[1].begin(), text[1].end());
+    const RecordingHeader header = RecordingHeader::create(1000.0, 195.0, 0.42, 1, samples.size());
+    char padded[RECORDING_HEADER_SIZE] = {};
+    std::memcpy(padded, &header, sizeof(RecordingHeader));
+    {
+        std::ofstream out(TEST_RECORDING, std::ios::binary | std::ios::trunc);
+        out.write(padded, sizeof(padded));
+        out.write(reinterpret_cast<const char *>(samples.data()), (std::streamsize) (samples.size() * sizeof(float)));
+    }
+
+    if (!RecordingArchive::convertRecording(TEST_RECORDING, TEST_FILE_BIN))
+    {
+        std::cout << TEST_RECORDING << " could not be converted" << std::endl;
+        return false;
+    }
+    RecordingArchive archive(TEST_FILE_BIN);
+    if (!archive.isOpen() || archive.getHeader().channels != 1 || archive.getHeader().samples != samples.size() ||
+        archive.getHeader().samplingRate != 1000.0)
+    {
+        std::cout << TEST_FILE_BIN << ": header does not match" << std::endl;
+        return false;
+    }
+    const std::vector<double> restored = archive.getChannel(0);
+    const std::vector<double> recorded = RecordingReader(TEST_RECORDING).getChannel(0);
+    if (restored.size() != recorded.size() ||
+        std::memcmp(restored.data(), recorded.data(), recorded.size() * sizeof(double)) != 0)
+    {
+        std::cout << TEST_FILE_BIN << ": samples do not match" << std::endl;
+        return false;
+    }
+    const size_t recordingSize = getFileSize(TEST_RECORDING);
+    const size_t archiveSize = getFileSize(TEST_FILE_BIN);
+    std::cout << "Archive " << archiveSize << " bytes, binary recording " << recordingSize << " bytes" << std::endl;
+    return MIN_RATIO_BIN * (double) archiveSize <= (double) recordingSize;
+}
+
+int main()
+{
+    int ret = 0;
+    if (!checkConversion("p.dat", TEST_FILE_P) || !checkConversion("o.dat", TEST_FILE_O))
+    {
+        ret = 1;
+    }
+    const size_t archiveSize = getFileSize(TEST_FILE_P) + getFileSize(TEST_FILE_O);
+    const size_t textSize = getFileSize("p.dat") + getFileSize("o.dat");
+    std::cout << "Archive " << archiveSize << " bytes, text " << textSize << " bytes" << std::endl;
+    if (MIN_RATIO * archiveSize > textSize)
+    {
+        ret = 1;
+    }
+
+    if (!checkRecordingConversion())
+    {
+        ret = 1;
+    }
+
+    // Slowly varying 24 bit ADC values with noise, as integers.
+    std::mt19937 generator(42);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    std::vector<double> adc(300000);
+    for (size_t i = 0; i < adc.size(); ++i)
+    {
+        adc[i] = std::round(8388608.0 + 4000000.0 * std::sin((double) i * 0.001) + noise(generator));
+    }
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::vector<double> random(adc.size());
+    for (double &value : random)
+    {
+        value = uniform(generator);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!RecordingArchive::write(TEST_FILE, 1000.0, {adc, random}))
+    {
+        ret = 1;
+    }
+    const double encodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    RecordingArchive archive(TEST_FILE);
+    start = std::chrono::steady_clock::now();
+    const std::vector<double> adcRead = archive.getChannel(0);
+    const double decodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (adcRead != adc || archive.getChannel(1) != random)
+    {
+        std::cout << "Synthetic data does not match" << std::endl;
+        ret = 1;
+    }
+    const double megabytes = (double) (adc.size() * sizeof(double)) / 1e6;
+    std::cout << "Encoding " << 2 * megabytes / encodeTime << " MB/s, decoding " << megabytes / decodeTime
+              << " MB/s" << std::endl;
+
+    // A block index that points outside the data must be rejected.
+    archive.close();
+    {
+        std::fstream file(TEST_FILE, std::ios::binary | std::ios::in | std::ios::out);
+        ArchiveHeader header{};
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        const uint64_t wrongOffset = header.indexOffset + 1;
+        file.seekp((std::streamoff) header.indexOffset);
+        file.write(reinterpret_cast<const char *>(&wrongOffset), sizeof(wrongOffset));
+    }
+    if (archive.open(TEST_FILE) || archive.isOpen() || !archive.getChannel(0).empty())
+    {
+        std::cout << "Corrupt archive accepted" << std::endl;
+        ret = 1;
+    }
+
+    // Archives whose index is longer than the blocks or cut off, up to not a single entry, must be rejected as well.
+    const size_t pSize = getFileSize(TEST_FILE_P);
+    ArchiveHeader pHeader{};
+    {
+        std::ifstream file(TEST_FILE_P, std::ios::binary);
+        file.read(reinterpret_cast<char *>(&pHeader), sizeof(pHeader));
+    }
+    for (size_t size : {pSize + sizeof(uint64_t), pSize - 1, pSize - sizeof(uint64_t), (size_t) pHeader.indexOffset})
+    {
+        std::filesystem::resize_file(TEST_FILE_P, size);
+        if (archive.open(TEST_FILE_P) || archive.isOpen())
+        {
+            std::cout << "Archive with " << size << " instead of " << pSize << " bytes accepted" << std::endl;
+            ret = 1;
+        }
+    }
+    std::remove(TEST_FILE_P);
+    std::remove(TEST_FILE_O);
+    std::remove(TEST_FILE);
+    std::remove(TEST_RECORDING);
+    std::remove(TEST_FILE_BIN);
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file        test_RecordingParser.cpp
+ * @brief       RecordingParser test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * p.dat is loaded with the RecordingParser and with stream extraction, both have to give the same values. The layout
+ * of the files in the data folder has to be detected: the sample recordings have the time in seconds and three
+ * voltages, data0804/p.dat the sample number and one pressure. A file with ADC counts has to be detected as raw, and
+ * files with a missing column or text have to be rejected. The time to load the whole data folder is printed and has
+ * to stay below MAX_LOAD_TIME. The test passes if all checks succeed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include "../RecordingParser.cpp"
+
+#define DATA_FOLDER     "../../data"        //!< The folder with the recordings, relative to the tests.
+#define TEST_FILE       "test_parser.dat"   //!< The temporary text file, removed at the end.
+#define MAX_LOAD_TIME   0.5                 //!< Max. time in seconds to load the data folder, generous for debug build.
+
+/**
+ * Writes a text file.
+ * @param fileName The name of the file.
+ * @param text The content.
+ */
+void writeText(const char *fileName, const char *text)
+{
+    std::ofstream out(fileName, std::ios::trunc);
+    out << text;
+}
+
+int main()
+{
+    int ret = 0;
+
+    std::ifstream pFile("p.dat");
+    double t, v;
+    std::vector<double> time;
+    std::vector<double> values;
+    while (pFile >> t >> v)
+    {
+        time.push_back(t);
+        values.push_back(v);
+    }
+    RecordingParser parser("p.dat");
+    if (parser.getColumnCount() != 2 || parser.getTime() != time || parser.getChannel(0) != values ||
+        !parser.getChannel(1).empty() || parser.isTimeInSeconds() || parser.isRaw() || parser.getSamplingRate() != 0.0)
+    {
+        std::cout << "p.dat does not match" << std::endl;
+        ret = 1;
+    }
+
+    if (!parser.load(DATA_FOLDER "/sample_07_01.dat") || parser.getColumnCount() != 4 ||
+        parser.getSampleCount() != 63899 || !parser.isTimeInSeconds() || parser.isRaw() ||
+        std::abs(parser.getSamplingRate() - 1000.0) > 1e-3 || parser.getChannel(2)[0] != 0.710341)
+    {
+        std::cout << "The layout of sample_07_01.dat was not detected" << std::endl;
+        ret = 1;
+    }
+    if (!parser.load(DATA_FOLDER "/data0804/p.dat") || parser.getColumnCount() != 2 || parser.isTimeInSeconds() ||
+        parser.getChannel(0)[0] != 161.296)
+    {
+        std::cout << "The layout of data0804/p.dat was not detected" << std::endl;
+        ret = 1;
+    }
+
+    writeText(TEST_FILE, "0.000\t8388608\t12\r\n0.001\t8388610\t13\r\n\r\n0.002\t8388612\t15\r\n");
+    if (!parser.load(TEST_FILE) || parser.getSampleCount() != 3 || !parser.isRaw() ||
+        parser.getChannel(1) != std::vector<double>{12, 13, 15})
+    {
+        std::cout << "Raw file was not detected" << std::endl;
+        ret = 1;
+    }
+    writeText(TEST_FILE, "1 0.5\n2\n");
+    if (parser.load(TEST_FILE) || parser.getColumnCount() != 0)
+    {
+        std::cout << "Missing column accepted" << std::endl;
+        ret = 1;
+    }
+    writeText(TEST_FILE, "1 0.5\n2 nan?\n");
+    if (parser.load(TEST_FILE) || parser.load("does_not_exist.dat"))
+    {
+        std::cout << "Invalid file accepted" << std::endl;
+        ret = 1;
+    }
+    std::remove(TEST_FILE);
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t files = 0;
+    size_t samples = 0;
+    for (const auto &entry : std::filesystem::recursive_directory_iterator(DATA_FOLDER))
+    {
+        if (entry.path().extension() == ".dat")
+        {
+            if (!parser.load(entry.path().string()))
+            {
+                std::cout << entry.path() << " could not be loaded" << std::endl;
+                ret = 1;
+            }
+            files++;
+            samples += parser.getSampleCount();
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << files << " files with " << samples << " samples loaded in " << seconds * 1000.0 << " ms"
+              << std::endl;
+    if (files == 0 || seconds > MAX_LOAD_TIME)
+    {
+        ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
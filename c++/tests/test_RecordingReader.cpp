@@ -0,0 +1,164 @@
+/**
+ * @file        test_RecordingReader.cpp
+ * @brief       RecordingReader test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * The pressure and oscillation of p.dat and o.dat are written as a binary recording with two channels, the same way
+ * the Datarecord writes it. The RecordingReader has to return the header and both channels to float precision and
+ * the file has to be at least three times smaller than the text files. A truncated copy and a file with a wrong magic
+ * have to be rejected. A recording that was not finished has to be recovered up to the last complete sample and the
+ * footer of a finished recording has to be found after the samples. The test passes if all checks succeed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include "../RecordingReader.cpp"
+
+#define TEST_FILE "test_recording.obp"  //!< The temporary recording, removed at the end.
+#define MAX_ERROR 1e-4                  //!< Max. relative difference caused by the conversion to float.
+
+/**
+ * Writes a binary recording.
+ * @param fileName The name of the file.
+ * @param header The header to write.
+ * @param samples The interleaved samples.
+ * @param bytes The number of bytes of the samples to write, to create truncated files.
+ */
+void writeRecording(const char *fileName, const RecordingHeader &header, const std::vector<float> &samples,
+                    size_t bytes)
+{
+    char padded[RECORDING_HEADER_SIZE] = {};
+    std::memcpy(padded, &header, sizeof(RecordingHeader));
+    std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+    out.write(padded, sizeof(padded));
+    out.write(reinterpret_cast<const char *>(samples.data()), (std::streamsize) bytes);
+}
+
+/**
+ * Gets the size of a file.
+ * @param fileName The name of the file.
+ * @return The size in bytes.
+ */
+size_t getFileSize(const char *fileName)
+{
+    std::ifstream in(fileName, std::ios::binary | std::ios::ate);
+    return (size_t) in.tellg();
+}
+
+int main()
+{
+    std::ifstream pFile("p.dat");
+    std::ifstream oFile("o.dat");
+    double tP, vP;
+    double tO, vO;
+    std::vector<double> pData;
+    std::vector<double> oData;
+    std::vector<float> interleaved;
+    while (pFile >> tP >> vP && oFile >> tO >> vO)
+    {
+        pData.push_back(vP);
+        oData.push_back(vO);
+        interleaved.push_back((float) vP);
+        interleaved.push_back((float) vO);
+    }
+
+    int ret = 0;
+    const RecordingHeader written = RecordingHeader::create(1000.0, 195.0, 0.42, 2, pData.size());
+    writeRecording(TEST_FILE, written, interleaved, interleaved.size() * sizeof(float));
+
+    RecordingReader reader(TEST_FILE);
+    const RecordingHeader &header = reader.getHeader();
+    if (!reader.isOpen() || !RecordingReader::isRecording(TEST_FILE) || header.samplingRate != 1000.0 ||
+        header.mmHgPerVolt != 195.0 || header.ambientVoltage != 0.42 || header.channels != 2 ||
+        header.samples != pData.size() || reader.getSamples().size() != interleaved.size())
+    {
+        std::cout << "Header does not match" << std::endl;
+        ret = 1;
+    }
+    const std::vector<double> pRead = reader.getChannel(0);
+    const std::vector<double> oRead = reader.getChannel(1);
+    if (pRead.size() != pData.size() || oRead.size() != oData.size() || !reader.getChannel(2).empty())
+    {
+        std::cout << "Channels do not match" << std::endl;
+        ret = 1;
+    }
+    for (size_t i = 0; ret == 0 && i < pData.size(); ++i)
+    {
+        if (std::abs(pRead[i] - pData[i]) > MAX_ERROR * std::abs(pData[i]) ||
+            std::abs(oRead[i] - oData[i]) > MAX_ERROR * std::max(1.0, std::abs(oData[i])))
+        {
+            std::cout << "Sample " << i << " does not match" << std::endl;
+            ret = 1;
+        }
+    }
+    reader.close();
+
+    const size_t binarySize = getFileSize(TEST_FILE);
+    const size_t textSize = getFileSize("p.dat") + getFileSize("o.dat");
+    std::cout << "Binary " << binarySize << " bytes, text " << textSize << " bytes" << std::endl;
+    if (3 * binarySize > textSize)
+    {
+        ret = 1;
+    }
+
+    // A truncated file must be rejected.
+    writeRecording(TEST_FILE, written, interleaved, interleaved.size() * sizeof(float) - 6);
+    if (reader.open(TEST_FILE) || reader.isOpen() || !reader.getSamples().empty())
+    {
+        std::cout << "Truncated file accepted" << std::endl;
+        ret = 1;
+    }
+
+    // A file with a wrong magic must be rejected.
+    RecordingHeader wrongMagic = written;
+    wrongMagic.magic[0] = 'X';
+    writeRecording(TEST_FILE, wrongMagic, interleaved, interleaved.size() * sizeof(float));
+    if (reader.open(TEST_FILE) || RecordingReader::isRecording(TEST_FILE) || RecordingReader::isRecording("p.dat"))
+    {
+        std::cout << "Wrong magic accepted" << std::endl;
+        ret = 1;
+    }
+
+    // An interrupted recording has an unknown sample count and may end within a sample.
+    RecordingHeader interrupted = written;
+    interrupted.samples = RECORDING_SAMPLES_UNKNOWN;
+    writeRecording(TEST_FILE, interrupted, interleaved, 1000 * 2 * sizeof(float) + 6);
+    RecordingFooter footer{};
+    if (!reader.open(TEST_FILE) || reader.isComplete() || reader.getHeader().samples != 1000 ||
+        reader.getFooter(footer))
+    {
+        std::cout << "Interrupted recording not recovered" << std::endl;
+        ret = 1;
+    }
+
+    // The footer follows the samples of a finished recording.
+    const RecordingFooter results = RecordingFooter::create(80.8, 99.6, 63.3, 72.0, 0);
+    std::vector<float> withFooter(interleaved);
+    withFooter.resize(interleaved.size() + sizeof(RecordingFooter) / sizeof(float));
+    std::memcpy(withFooter.data() + interleaved.size(), &results, sizeof(RecordingFooter));
+    writeRecording(TEST_FILE, written, withFooter, withFooter.size() * sizeof(float));
+    if (!reader.open(TEST_FILE) || !reader.isComplete() || !reader.getFooter(footer) || footer.map != 80.8 ||
+        footer.sbp != 99.6 || footer.dbp != 63.3 || footer.heartRate != 72.0 ||
+        reader.getHeader().samples != pData.size())
+    {
+        std::cout << "Footer not found" << std::endl;
+        ret = 1;
+    }
+    reader.close();
+    std::remove(TEST_FILE);
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
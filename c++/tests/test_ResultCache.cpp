@@ -0,0 +1,248 @@
+/**
+ * @file        test_ResultCache.cpp
+ * @brief       ResultCache test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * All recordings in 'data/sample_*.dat' are converted to mmHg and analysed through the ResultCache several times: the
+ * first time nothing is cached, the second time all results are, after changing the SBP ratio the results are still
+ * used (with and without the filtered streams), after changing the DBP ratio only the filtered streams are and after
+ * changing the filters nothing is. Changing a sample of a recording and truncating the cache files have to lead to a
+ * new analysis. Every result has to be identical to the one of Pipeline::analyze() with the same configuration. The
+ * times of the analyses are printed. The test passes if all checks succeed and the analyses with cached results are
+ * faster than without the cache.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <chrono>
+#include <numeric>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include "../HeartRateEstimator.cpp"
+#include "../OBPDetection.cpp"
+#include "../Pipeline.cpp"
+#include "../ResultCache.cpp"
+
+#define TEST_DIRECTORY "test_cache"     //!< The temporary cache, removed at the end.
+
+/**
+ * Conversion of the recorded voltage to mmHg, as done by Processing.
+ */
+#define KPA_PER_MMHG 0.133322
+#define KPA_PER_V 50.0
+#define CORR_FACTOR 2.6
+
+/**
+ * Loads the sample recordings in mmHg.
+ * @return The recordings.
+ */
+std::vector<std::vector<double>> loadRecordings()
+{
+    std::vector<std::filesystem::path> files;
+    for (const auto &entry : std::filesystem::directory_iterator("../../data"))
+    {
+        if (entry.path().filename().string().rfind("sample_", 0) == 0)
+        {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<std::vector<double>> recordings;
+    for (const auto &file : files)
+    {
+        std::ifstream in(file);
+        std::vector<double> voltage;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            double t, v;
+            if (std::sscanf(line.c_str(), "%lf %lf", &t, &v) == 2)
+            {
+                voltage.push_back(v);
+            }
+        }
+        if (voltage.size() < AMBIENT_AV_TIME)
+        {
+            continue;
+        }
+        const double ambient = std::accumulate(voltage.begin(), voltage.begin() + AMBIENT_AV_TIME, 0.0) /
+                               AMBIENT_AV_TIME;
+        std::vector<double> mmHg(voltage.size());
+        std::transform(voltage.begin(), voltage.end(), mmHg.begin(), [ambient](double v) {
+            return ((v - ambient) * KPA_PER_V * CORR_FACTOR) / KPA_PER_MMHG;
+        });
+        recordings.push_back(std::move(mmHg));
+    }
+    return recordings;
+}
+
+/**
+ * Compares two results.
+ * @param a The first result.
+ * @param b The second result.
+ * @return True if the results and the beats are the same.
+ */
+bool isSame(const OBPResult &a, const OBPResult &b)
+{
+    bool same = a.finished == b.finished && a.map == b.map && a.sbp == b.sbp && a.dbp == b.dbp &&
+                a.heartRate == b.heartRate && a.offset == b.offset && a.decisionTime == b.decisionTime &&
+                a.mapTime == b.mapTime && a.sbpTime == b.sbpTime && a.dbpTime == b.dbpTime &&
+                a.artifacts == b.artifacts && a.beats.size() == b.beats.size() &&
+                a.envelope.size() == b.envelope.size();
+    for (size_t i = 0; same && i < a.beats.size(); ++i)
+    {
+        same = a.beats.peakTime(i) == b.beats.peakTime(i) && a.beats.peakAmplitude(i) == b.beats.peakAmplitude(i);
+    }
+    return same;
+}
+
+/**
+ * Analyses all recordings through the cache and compares the results with Pipeline::analyze().
+ * @param cache The cache.
+ * @param recordings The recordings.
+ * @param config The configuration of the pipeline.
+ * @param ratioSBP The SBP ratio.
+ * @param ratioDBP The DBP ratio.
+ * @param seconds Returns the time of the analyses through the cache.
+ * @param uncachedSeconds Returns the time of the analyses without the cache.
+ * @return True if all results are identical.
+ */
+bool analyzeAll(ResultCache &cache, const std::vector<std::vector<double>> &recordings, const PipelineConfig &config,
+                double ratioSBP, double ratioDBP, double &seconds, double &uncachedSeconds)
+{
+    OBPDetection obpDetect(1000.0);
+    obpDetect.setRatioSBP(ratioSBP);
+    obpDetect.setRatioDBP(ratioDBP);
+    std::vector<OBPResult> cached(recordings.size());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < recordings.size(); ++i)
+    {
+        cached[i] = cache.analyze(recordings[i], config, obpDetect);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool same = true;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < recordings.size(); ++i)
+    {
+        same = isSame(cached[i], Pipeline::analyze(recordings[i], config, obpDetect)) && same;
+    }
+    uncachedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return same;
+}
+
+/**
+ * Checks the counters of the cache.
+ * @param cache The cache.
+ * @param results The expected number of cached results.
+ * @param filtered The expected number of cached filtered streams.
+ * @param misses The expected number of analyses that were not cached.
+ * @return True if the counters match.
+ */
+bool checkCounters(const ResultCache &cache, size_t results, size_t filtered, size_t misses)
+{
+    return cache.getResultHits() == results && cache.getFilteredHits() == filtered && cache.getMisses() == misses;
+}
+
+int main()
+{
+    std::filesystem::remove_all(TEST_DIRECTORY);
+    std::vector<std::vector<double>> recordings = loadRecordings();
+    const size_t n = recordings.size();
+    int ret = n == 0 ? 1 : 0;
+    PipelineConfig config;
+    double seconds;
+    double uncachedSeconds;
+
+    ResultCache cache(TEST_DIRECTORY);
+    if (!analyzeAll(cache, recordings, config, 0.57, 0.70, seconds, uncachedSeconds) || !checkCounters(cache, 0, 0, n))
+    {
+        std::cout << "First analysis not correct" << std::endl;
+        ret = 1;
+    }
+    std::cout << "Not cached: " << seconds << " s, without the cache: " << uncachedSeconds << " s" << std::endl;
+
+    if (!analyzeAll(cache, recordings, config, 0.57, 0.70, seconds, uncachedSeconds) || !checkCounters(cache, n, 0, n))
+    {
+        std::cout << "Cached results not correct" << std::endl;
+        ret = 1;
+    }
+    std::cout << "Results cached: " << seconds << " s, without the cache: " << uncachedSeconds << " s" << std::endl;
+    const bool resultsFaster = seconds < uncachedSeconds;
+
+    if (!analyzeAll(cache, recordings, config, 0.5, 0.70, seconds, uncachedSeconds) ||
+        !checkCounters(cache, 2 * n, 0, n))
+    {
+        std::cout << "Analysis with another SBP ratio not correct" << std::endl;
+        ret = 1;
+    }
+    std::cout << "Results cached for another SBP ratio: " << seconds << " s, without the cache: " << uncachedSeconds
+              << " s" << std::endl;
+    if (!resultsFaster || seconds >= uncachedSeconds)
+    {
+        std::cout << "Cached results too slow" << std::endl;
+        ret = 1;
+    }
+
+    if (!analyzeAll(cache, recordings, config, 0.5, 0.65, seconds, uncachedSeconds) ||
+        !checkCounters(cache, 2 * n, n, n))
+    {
+        std::cout << "Analysis with another DBP ratio not correct" << std::endl;
+        ret = 1;
+    }
+    std::cout << "Filtered streams cached: " << seconds << " s, without the cache: " << uncachedSeconds << " s"
+              << std::endl;
+
+    // The SBP of the cached results is found without the filtered streams as well.
+    for (const auto &entry : std::filesystem::directory_iterator(TEST_DIRECTORY))
+    {
+        if (entry.path().string().find("_filtered") != std::string::npos)
+        {
+            std::filesystem::remove(entry.path());
+        }
+    }
+    if (!analyzeAll(cache, recordings, config, 0.45, 0.70, seconds, uncachedSeconds) ||
+        !checkCounters(cache, 3 * n, n, n))
+    {
+        std::cout << "Analysis with another SBP ratio without the filtered streams not correct" << std::endl;
+        ret = 1;
+    }
+
+    PipelineConfig other = config;
+    other.fcLP = 8.0;
+    if (!analyzeAll(cache, recordings, other, 0.5, 0.70, seconds, uncachedSeconds) ||
+        !checkCounters(cache, 3 * n, n, 2 * n))
+    {
+        std::cout << "Analysis with other filters not correct" << std::endl;
+        ret = 1;
+    }
+
+    // A changed recording and truncated files are analysed again.
+    recordings[0][recordings[0].size() / 2] += 1.0;
+    for (const auto &entry : std::filesystem::directory_iterator(TEST_DIRECTORY))
+    {
+        std::filesystem::resize_file(entry.path(), sizeof(CacheHeader) + 8);
+    }
+    if (!analyzeAll(cache, recordings, config, 0.57, 0.70, seconds, uncachedSeconds) ||
+        !checkCounters(cache, 3 * n, n, 3 * n))
+    {
+        std::cout << "Changed recording or truncated file not analysed again" << std::endl;
+        ret = 1;
+    }
+    std::filesystem::remove_all(TEST_DIRECTORY);
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file        test_SlidingMedian.cpp
+ * @brief       SlidingMedian test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * Compares the running median and MAD of the SlidingMedian class to the ones calculated by sorting the last values,
+ * for random values with duplicates and for all window sizes up to the capacity. The test passes if all values match.
+ */
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include "../SlidingMedian.h"
+
+/**
+ * Calculates the median of the values by sorting them.
+ * @param values The values, are sorted.
+ * @return The median.
+ */
+double getMedian(std::vector<double> &values)
+{
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    return (n % 2 == 1) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+int main()
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(0, 20);
+
+    int ret = 0;
+    for (size_t windowSize = 1; windowSize <= SLIDING_MEDIAN_CAPACITY; ++windowSize)
+    {
+        SlidingMedian sliding(windowSize);
+        std::vector<double> series;
+        for (int i = 0; i < 200; ++i)
+        {
+            // Values with duplicates and a few outliers.
+            double value = distribution(generator) * 0.5;
+            if (i % 17 == 0)
+            {
+                value *= 10.0;
+            }
+            series.push_back(value);
+            sliding.add(value);
+
+            std::vector<double> last(series.end() - (long) std::min(series.size(), windowSize), series.end());
+            const double median = getMedian(last);
+            for (double &v : last)
+            {
+                v = std::abs(v - median);
+            }
+            const double mad = getMedian(last);
+
+            if (sliding.size() != last.size() || sliding.median() != median || sliding.mad() != mad)
+            {
+                std::cout << "window " << windowSize << ", value " << i << ": median " << sliding.median() << " ("
+                          << median << "), MAD " << sliding.mad() << " (" << mad << ")" << std::endl;
+                ret = 1;
+            }
+        }
+        sliding.clear();
+        if (!sliding.empty() || sliding.median() != 0.0 || sliding.mad() != 0.0)
+        {
+            ret = 1;
+        }
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}
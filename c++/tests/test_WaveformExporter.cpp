@@ -0,0 +1,473 @@
+/**
+ * @file        test_WaveformExporter.cpp
+ * @brief       WaveformExporter test implementation.
+ * @author      Belinda Kneubühler
+ * @date        2020-08-18
+ * @copyright   GNU General Public License v2.0
+ *
+ * @details
+ * A recording with ADC counts and a pressure is exported in blocks of different sizes as WFDB record in format 16 and
+ * 212 and as EDF+ file. The files are decoded again: the ADC counts have to be exact, the pressure within half a
+ * digital step, the header has to hold the number of samples and the checksums, the MIT annotations have to hold the
+ * beats and notes in their order and the EDF+ file the number of data records and the annotations. ADC counts with a
+ * calibration have to keep its gain and baseline, and 24 bit counts have to lose their lowest bits. A record must not
+ * replace existing files: exporting over a text recording or over each file of a record has to fail and leave the file
+ * as it was, and the WFDB records of a recording must not be named like its text recording. The test passes if all
+ * checks succeed.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include "../WaveformExporter.cpp"
+
+#define TEST_RECORD     "test_waveform"     //!< The temporary record, removed at the end.
+#define TEST_RATE       1000.0              //!< The sampling rate in Hz.
+#define TEST_FRAMES     12345               //!< The number of frames, odd for format 212.
+
+/**
+ * Reads a file.
+ * @param fileName The name of the file.
+ * @return The content.
+ */
+std::string readFile(const std::string &fileName)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+/**
+ * Removes all files of the test record.
+ */
+void removeRecord()
+{
+    for (const char *extension : {".dat", ".hea", ".atr", ".edf"})
+    {
+        std::remove((std::string(TEST_RECORD) + extension).c_str());
+    }
+}
+
+/**
+ * Checks that a record is not written over an existing file.
+ * @param fileName The existing file, it is created with a text and removed again.
+ * @param format The format of the record.
+ * @param frames The frames.
+ * @return True if the export failed and the file was not changed.
+ */
+bool checkNotReplaced(const std::string &fileName, WaveformFormat format, const std::vector<double> &frames)
+{
+    const std::string text = "0.000 1.234\n";
+    std::FILE *file = std::fopen(fileName.c_str(), "w");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    std::fputs(text.c_str(), file);
+    std::fclose(file);
+    WaveformExporter exporter;
+    const std::vector<WaveformSignal> signals = {{"Pressure", "mmHg", 20.0, 140.0}};
+    const bool opened = exporter.open(TEST_RECORD, format, TEST_RATE, signals, 0);
+    if (opened)
+    {
+        exporter.addSamples(frames.data(), 1);
+        exporter.close();
+    }
+    const bool unchanged = readFile(fileName) == text;
+    removeRecord();
+    return !opened && unchanged;
+}
+
+/**
+ * Creates the test recording: ADC counts and the pressure, one frame after the other.
+ * @return The frames.
+ */
+std::vector<double> createFrames()
+{
+    std::vector<double> frames;
+    for (size_t i = 0; i < TEST_FRAMES; ++i)
+    {
+        frames.push_back((double) ((i * 37) % 4096));
+        frames.push_back(80.0 + 60.0 * std::sin((double) i / 300.0));
+    }
+    return frames;
+}
+
+/**
+ * Exports the test recording with annotations.
+ * @param format The format.
+ * @param frames The frames.
+ * @return False if the export failed.
+ */
+bool exportRecord(WaveformFormat format, const std::vector<double> &frames)
+{
+    WaveformExporter exporter;
+    const std::vector<WaveformSignal> signals = {{"ADC", "adu", 0.0, 4095.0, 1.0},
+                                                 {"Pressure", "mmHg", 20.0, 140.0}};
+    if (!exporter.open(TEST_RECORD, format, TEST_RATE, signals, 1600000000))
+    {
+        return false;
+    }
+    exporter.addComment("Calibration");
+    exporter.addAnnotation(WaveformAnnotation{100, WaveformAnnotationType::beat, ""});
+    exporter.addAnnotation(WaveformAnnotation{5000, WaveformAnnotationType::artifact, ""});
+    exporter.addAnnotation(WaveformAnnotation{900, WaveformAnnotationType::beat, ""});
+    exporter.addAnnotation(WaveformAnnotation{TEST_FRAMES - 1, WaveformAnnotationType::note, "SBP 120"});
+    bool success = true;
+    size_t block = 1;
+    for (size_t first = 0; first < TEST_FRAMES; first += block, block = block * 3 + 1)
+    {
+        success = exporter.addSamples(frames.data() + 2 * first, std::min<size_t>(block, TEST_FRAMES - first)) &&
+                  success;
+    }
+    return exporter.getFrameCount() == TEST_FRAMES && exporter.close() && success;
+}
+
+/**
+ * Checks decoded samples against the frames.
+ * @param digital The digital samples, one frame after the other.
+ * @param gains The gains of the signals.
+ * @param baselines The baselines of the signals.
+ * @param frames The frames.
+ * @return True if the ADC counts are exact and the pressure is within half a digital step.
+ */
+bool checkSamples(const std::vector<int32_t> &digital, const double gains[2], const double baselines[2],
+                  const std::vector<double> &frames)
+{
+    if (digital.size() < frames.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const size_t signal = i % 2;
+        const double value = (digital[i] - baselines[signal]) / gains[signal];
+        if (std::fabs(value - frames[i]) > 0.5 / gains[signal] + 1e-9)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Checks a WFDB record.
+ * @param format The format.
+ * @param frames The frames.
+ * @return True if the samples, the header and the annotations are correct.
+ */
+bool checkWfdb(WaveformFormat format, const std::vector<double> &frames)
+{
+    const std::string data = readFile(TEST_RECORD ".dat");
+    const auto *bytes = reinterpret_cast<const uint8_t *>(data.data());
+    std::vector<int32_t> digital;
+    if (format == WaveformFormat::wfdb16)
+    {
+        for (size_t i = 0; i + 1 < data.size(); i += 2)
+        {
+            digital.push_back((int16_t) (bytes[i] | bytes[i + 1] << 8));
+        }
+    } else
+    {
+        for (size_t i = 0; i + 2 < data.size(); i += 3)
+        {
+            const int32_t first = bytes[i] | (bytes[i + 1] & 0x0F) << 8;
+            const int32_t second = bytes[i + 2] | (bytes[i + 1] & 0xF0) << 4;
+            digital.push_back(first >= 2048 ? first - 4096 : first);
+            digital.push_back(second >= 2048 ? second - 4096 : second);
+        }
+    }
+
+    // The record line and a line per signal with gain(baseline), the initial value and the checksum.
+    std::istringstream header(readFile(TEST_RECORD ".hea"));
+    std::string name;
+    std::string time;
+    std::string date;
+    size_t nsig = 0;
+    double rate = 0.0;
+    size_t count = 0;
+    header >> name >> nsig >> rate >> count >> time >> date;
+    bool valid = name == TEST_RECORD && nsig == 2 && rate == TEST_RATE && count == TEST_FRAMES && date.size() == 10;
+    double gains[2];
+    double baselines[2];
+    for (size_t signal = 0; signal < 2 && valid; ++signal)
+    {
+        std::string fileName;
+        std::string gain;
+        int fmt;
+        int resolution;
+        int zero;
+        int initial;
+        int checksum;
+        int blockSize;
+        std::string label;
+        header >> fileName >> fmt >> gain >> resolution >> zero >> initial >> checksum >> blockSize >> label;
+        gains[signal] = std::stod(gain);
+        baselines[signal] = std::stod(gain.substr(gain.find('(') + 1));
+        uint32_t sum = 0;
+        for (size_t i = signal; i < 2 * TEST_FRAMES && i < digital.size(); i += 2)
+        {
+            sum += (uint32_t) digital[i];
+        }
+        valid = fileName == TEST_RECORD ".dat" && fmt == (format == WaveformFormat::wfdb16 ? 16 : 212) &&
+                initial == digital[signal] && checksum == (int16_t) (uint16_t) sum &&
+                label == (signal == 0 ? "ADC" : "Pressure");
+    }
+    std::string comment;
+    std::getline(header >> std::ws, comment);
+    if (!valid || comment != "# Calibration" || !checkSamples(digital, gains, baselines, frames))
+    {
+        return false;
+    }
+    if (format == WaveformFormat::wfdb212 &&
+        (gains[1] * 120.0 < 4000.0 || data.size() != 3 * TEST_FRAMES))
+    {
+        return false;
+    }
+
+    // The annotations in the order of time, with the interval to the previous one.
+    const std::string atr = readFile(TEST_RECORD ".atr");
+    const auto *words = reinterpret_cast<const uint8_t *>(atr.data());
+    std::vector<std::pair<uint64_t, int>> annotations;
+    std::string aux;
+    uint64_t sample = 0;
+    for (size_t i = 0; i + 1 < atr.size();)
+    {
+        const uint32_t word = words[i] | words[i + 1] << 8;
+        i += 2;
+        const uint32_t code = word >> 10;
+        if (word == 0)
+        {
+            break;
+        } else if (code == MIT_SKIP)
+        {
+            sample += (uint64_t) (words[i] | words[i + 1] << 8) << 16 | (words[i + 2] | words[i + 3] << 8);
+            i += 4;
+        } else if (code == MIT_AUX)
+        {
+            aux.assign(atr, i, word & 0x3FF);
+            i += ((word & 0x3FF) + 1) & ~1u;
+        } else
+        {
+            sample += word & 0x3FF;
+            annotations.emplace_back(sample, code);
+        }
+    }
+    const std::vector<std::pair<uint64_t, int>> expected = {{100, MIT_NORMAL}, {900, MIT_NORMAL},
+                                                            {5000, MIT_ARFCT}, {TEST_FRAMES - 1, MIT_NOTE}};
+    return annotations == expected && aux == "SBP 120";
+}
+
+/**
+ * Checks an EDF+ file.
+ * @param frames The frames.
+ * @return True if the header, the samples and the annotations are correct.
+ */
+bool checkEdf(const std::vector<double> &frames)
+{
+    const std::string edf = readFile(TEST_RECORD ".edf");
+    const auto field = [&edf](size_t offset, size_t width) { return std::stod(edf.substr(offset, width)); };
+    const size_t records = (TEST_FRAMES + 999) / 1000;
+    const size_t recordSize = 2 * 1000 * 2 + EDF_ANNOTATION_BYTES;
+    if (edf.size() != 4 * 256 + records * recordSize || field(184, 8) != 4 * 256 || field(236, 8) != (double) records ||
+        field(244, 8) != 1.0 || field(252, 4) != 3.0 || edf.substr(256 + 32, 15) != "EDF Annotations" ||
+        edf.substr(192, 5) != "EDF+C" || edf.substr(168, 8) != "13.09.20")
+    {
+        return false;
+    }
+
+    // The gain and the offset from the physical and the digital ranges of each signal.
+    double gains[2];
+    double baselines[2];
+    for (size_t signal = 0; signal < 2; ++signal)
+    {
+        const size_t base = 256 + 3 * (16 + 80 + 8);
+        const double physicalMin = field(base + 8 * signal, 8);
+        const double physicalMax = field(base + 3 * 8 + 8 * signal, 8);
+        const double digitalMin = field(base + 6 * 8 + 8 * signal, 8);
+        const double digitalMax = field(base + 9 * 8 + 8 * signal, 8);
+        gains[signal] = (digitalMax - digitalMin) / (physicalMax - physicalMin);
+        baselines[signal] = digitalMin - physicalMin * gains[signal];
+    }
+    std::vector<int32_t> digital;
+    std::string annotations;
+    for (size_t record = 0; record < records; ++record)
+    {
+        const auto *samples = reinterpret_cast<const uint8_t *>(edf.data() + 4 * 256 + record * recordSize);
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            for (size_t signal = 0; signal < 2; ++signal)
+            {
+                const size_t offset = 2 * (signal * 1000 + i);
+                digital.push_back((int16_t) (samples[offset] | samples[offset + 1] << 8));
+            }
+        }
+        annotations.append(reinterpret_cast<const char *>(samples) + 4000, EDF_ANNOTATION_BYTES);
+    }
+    return gains[0] == 1.0 && checkSamples(digital, gains, baselines, frames) &&
+           annotations.find(std::string("+0.1\x14" "Beat\x14", 10)) != std::string::npos &&
+           annotations.find(std::string("+5\x14" "Artifact\x14", 13)) != std::string::npos &&
+           annotations.find(std::string("+12.344\x14" "SBP 120\x14", 16)) != std::string::npos &&
+           annotations.find(std::string("+0\x14" "Calibration\x14", 15)) != std::string::npos &&
+           annotations.find(std::string("+12\x14\x14", 5)) != std::string::npos;
+}
+
+/**
+ * Exports ADC counts with a calibration as WFDB record in format 16 and decodes it again.
+ * @param counts The ADC counts.
+ * @param gain The counts per mmHg.
+ * @param baseline The count at ambient pressure.
+ * @param headerGain Returns the gain of the header.
+ * @param headerBaseline Returns the baseline of the header.
+ * @param digital Returns the digital samples.
+ * @return False if the export failed.
+ */
+bool exportCalibrated(const std::vector<double> &counts, double gain, double baseline, double &headerGain,
+                      int &headerBaseline, std::vector<int32_t> &digital)
+{
+    std::vector<double> mmHg;
+    for (double count : counts)
+    {
+        mmHg.push_back((count - baseline) / gain);
+    }
+    WaveformSignal signal{"Pressure (ADC)", "mmHg", *std::min_element(mmHg.begin(), mmHg.end()),
+                          *std::max_element(mmHg.begin(), mmHg.end())};
+    signal.gain = gain;
+    signal.baseline = baseline;
+    WaveformExporter exporter;
+    if (!exporter.open(TEST_RECORD, WaveformFormat::wfdb16, TEST_RATE, {signal}, 0) ||
+        !exporter.addSamples(mmHg.data(), mmHg.size()) || !exporter.close())
+    {
+        return false;
+    }
+    std::istringstream header(readFile(TEST_RECORD ".hea"));
+    std::string line;
+    std::getline(header, line);
+    std::string fileName;
+    std::string gainField;
+    int fmt;
+    header >> fileName >> fmt >> gainField;
+    headerGain = std::stod(gainField);
+    headerBaseline = std::stoi(gainField.substr(gainField.find('(') + 1));
+    const std::string data = readFile(TEST_RECORD ".dat");
+    const auto *bytes = reinterpret_cast<const uint8_t *>(data.data());
+    digital.clear();
+    for (size_t i = 0; i + 1 < data.size(); i += 2)
+    {
+        digital.push_back((int16_t) (bytes[i] | bytes[i + 1] << 8));
+    }
+    removeRecord();
+    return digital.size() == counts.size() && gainField.find("/mmHg") != std::string::npos;
+}
+
+/**
+ * Checks the export with a calibration. 12 bit counts have to be stored as they are, with the calibrated gain and the
+ * count at ambient pressure as baseline. 24 bit counts have to lose the lowest bits, the gain has to be the calibrated
+ * one divided by a power of two and the pressure has to be restored within half a digital step.
+ * @return True if all checks succeed.
+ */
+bool checkCalibration()
+{
+    std::vector<double> counts;
+    for (size_t i = 0; i < TEST_FRAMES; ++i)
+    {
+        counts.push_back((double) ((i * 37) % 4096));
+    }
+    double gain;
+    int baseline;
+    std::vector<int32_t> digital;
+    if (!exportCalibrated(counts, 12.5, 2000.3, gain, baseline, digital) || gain != 12.5 || baseline != 2000 ||
+        !std::equal(counts.begin(), counts.end(), digital.begin()))
+    {
+        std::cout << "12 bit counts not stored as they are" << std::endl;
+        return false;
+    }
+
+    const double adcGain = 6490.5;
+    const double adcBaseline = 8388608.0 + 1234.5;
+    for (size_t i = 0; i < TEST_FRAMES; ++i)
+    {
+        counts[i] = std::round(adcBaseline + adcGain * (150.0 + 100.0 * std::sin((double) i / 300.0)));
+    }
+    if (!exportCalibrated(counts, adcGain, adcBaseline, gain, baseline, digital) || gain >= adcGain ||
+        adcGain / gain != std::exp2(std::round(std::log2(adcGain / gain))))
+    {
+        std::cout << "24 bit counts not reduced" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        const double mmHg = (counts[i] - adcBaseline) / adcGain;
+        if (std::fabs((digital[i] - baseline) / gain - mmHg) > 0.5 / gain + 0.5 / adcGain + 1e-9)
+        {
+            std::cout << "24 bit counts not restored" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    int ret = 0;
+    const std::vector<double> frames = createFrames();
+    for (WaveformFormat format : {WaveformFormat::wfdb16, WaveformFormat::wfdb212})
+    {
+        if (!exportRecord(format, frames) || !checkWfdb(format, frames))
+        {
+            std::cout << "WFDB format " << (format == WaveformFormat::wfdb16 ? 16 : 212) << " not correct"
+                      << std::endl;
+            ret = 1;
+        }
+        removeRecord();
+    }
+    if (!exportRecord(WaveformFormat::edf, frames) || !checkEdf(frames))
+    {
+        std::cout << "EDF+ not correct" << std::endl;
+        ret = 1;
+    }
+    removeRecord();
+    if (!checkCalibration())
+    {
+        ret = 1;
+    }
+
+    // Neither a text recording nor an earlier record is replaced.
+    const std::vector<std::pair<std::string, WaveformFormat>> existing = {
+            {TEST_RECORD ".dat", WaveformFormat::wfdb16}, {TEST_RECORD ".hea", WaveformFormat::wfdb212},
+            {TEST_RECORD ".atr", WaveformFormat::wfdb16}, {TEST_RECORD ".edf", WaveformFormat::edf}};
+    for (const auto &[fileName, format] : existing)
+    {
+        if (!checkNotReplaced(fileName, format, frames))
+        {
+            std::cout << "Existing " << fileName << " replaced" << std::endl;
+            ret = 1;
+        }
+    }
+    for (WaveformFormat format : {WaveformFormat::wfdb16, WaveformFormat::wfdb212})
+    {
+        for (const std::string &fileName : WaveformExporter::getFileNames(
+                WaveformExporter::getRecordName(TEST_RECORD, format), format))
+        {
+            if (fileName == TEST_RECORD ".dat")
+            {
+                std::cout << "WFDB record named like the text recording" << std::endl;
+                ret = 1;
+            }
+        }
+    }
+
+    if (ret == 0)
+    {
+        std::cout << "Test passed" << std::endl;
+    } else
+    {
+        std::cout << "Test failed" << std::endl;
+    }
+    return ret;
+}